@@ -1,6 +1,8 @@
 #include "woort.h"
 #include "woomem.h"
 #include "woort_codeenv.h"
+#include "woort_epoch.h"
+#include "woort_threads.h"
 #include "woort_log.h"
 
 #include <stdlib.h>
@@ -9,6 +11,18 @@ void woort_init(void)
 {
     woomem_init(NULL, NULL, NULL);
 
+    if (!woort_thread_pool_bootup())
+    {
+        WOORT_DEBUG("Failed to bootup thread pool.");
+        abort();
+    }
+
+    if (!woort_epoch_bootup())
+    {
+        WOORT_DEBUG("Failed to bootup epoch.");
+        abort();
+    }
+
     if (!woort_CodeEnv_bootup())
     {
         WOORT_DEBUG("Failed to bootup code env.");
@@ -18,6 +32,8 @@ void woort_init(void)
 void woort_shutdown(void)
 {
     woort_CodeEnv_shutdown();
+    woort_epoch_shutdown();
+    woort_thread_pool_shutdown();
 
     woomem_shutdown();
 }
\ No newline at end of file
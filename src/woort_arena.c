@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "woort_arena.h"
+#include "woort_log.h"
+
+#define WOORT_ARENA_ALIGNMENT 16
+
+void _woort_arena_free_chunks(woort_Arena_Chunk* chunk)
+{
+    while (chunk != NULL)
+    {
+        woort_Arena_Chunk* const next = chunk->m_next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+void woort_arena_init(woort_Arena* arena, size_t chunk_size)
+{
+    assert(chunk_size != 0);
+
+    arena->m_chunks = NULL;
+    arena->m_free_chunks = NULL;
+    arena->m_used = 0;
+    arena->m_chunk_size = chunk_size;
+}
+void woort_arena_deinit(woort_Arena* arena)
+{
+    _woort_arena_free_chunks(arena->m_chunks);
+    _woort_arena_free_chunks(arena->m_free_chunks);
+
+    arena->m_chunks = NULL;
+    arena->m_free_chunks = NULL;
+}
+
+WOORT_NODISCARD void* woort_arena_alloc(woort_Arena* arena, size_t size)
+{
+    const size_t aligned_size =
+        (size + WOORT_ARENA_ALIGNMENT - 1) & ~(size_t)(WOORT_ARENA_ALIGNMENT - 1);
+
+    if (aligned_size < size)
+    {
+        WOORT_DEBUG("Allocation too large.");
+        return NULL;
+    }
+
+    woort_Arena_Chunk* chunk = arena->m_chunks;
+    if (chunk == NULL || chunk->m_size - arena->m_used < aligned_size)
+    {
+        // Reuse released chunk if it is big enough.
+        woort_Arena_Chunk* new_chunk = arena->m_free_chunks;
+        if (new_chunk != NULL && new_chunk->m_size >= aligned_size)
+            arena->m_free_chunks = new_chunk->m_next;
+        else
+        {
+            const size_t chunk_size =
+                aligned_size > arena->m_chunk_size ? aligned_size : arena->m_chunk_size;
+
+            new_chunk = malloc(sizeof(woort_Arena_Chunk) + chunk_size);
+            if (new_chunk == NULL)
+            {
+                WOORT_DEBUG("Allocation failed.");
+                return NULL;
+            }
+            new_chunk->m_size = chunk_size;
+        }
+
+        new_chunk->m_next = chunk;
+        arena->m_chunks = new_chunk;
+        arena->m_used = 0;
+        chunk = new_chunk;
+    }
+
+    void* const result = chunk->m_storage + arena->m_used;
+    arena->m_used += aligned_size;
+
+    return result;
+}
+
+void woort_arena_reset(woort_Arena* arena)
+{
+    woort_Arena_Chunk* chunk = arena->m_chunks;
+    while (chunk != NULL)
+    {
+        woort_Arena_Chunk* const next = chunk->m_next;
+
+        chunk->m_next = arena->m_free_chunks;
+        arena->m_free_chunks = chunk;
+
+        chunk = next;
+    }
+    arena->m_chunks = NULL;
+    arena->m_used = 0;
+}
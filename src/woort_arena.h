@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+woort_arena.h
+
+Bump allocator for short-lived allocations, everything allocated from an arena is
+released together by woort_arena_reset or woort_arena_deinit.
+*/
+
+#include "woort_diagnosis.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+Default size of each chunk, bigger allocations get their own chunk.
+*/
+#define WOORT_ARENA_DEFAULT_CHUNK_SIZE (16 * 1024)
+
+typedef struct woort_Arena_Chunk
+{
+    struct woort_Arena_Chunk* m_next;
+    size_t m_size;
+
+    _Alignas(16) char m_storage[];
+
+} woort_Arena_Chunk;
+
+typedef struct woort_Arena
+{
+    // Chunks in use, the first one is allocating.
+    /* OPTIONAL */ woort_Arena_Chunk* m_chunks;
+
+    // Chunks released by woort_arena_reset, reused before allocating new ones.
+    /* OPTIONAL */ woort_Arena_Chunk* m_free_chunks;
+
+    size_t m_used;
+    size_t m_chunk_size;
+
+} woort_Arena;
+
+void woort_arena_init(woort_Arena* arena, size_t chunk_size);
+void woort_arena_deinit(woort_Arena* arena);
+
+/*
+Allocate `size` bytes aligned to 16, returns NULL if out of memory. The memory cannot
+be freed alone.
+*/
+WOORT_NODISCARD /* OPTIONAL */ void* woort_arena_alloc(woort_Arena* arena, size_t size);
+
+/*
+Release all allocations, chunks are kept for reusing.
+*/
+void woort_arena_reset(woort_Arena* arena);
@@ -3,18 +3,60 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <assert.h>
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+/*
+Index of the lowest set bit, `word` must not be 0.
+*/
+WOORT_NODISCARD size_t _woort_bitset_ctz(uint64_t word)
+{
+    assert(word != 0);
+
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    (void)_BitScanForward64(&index, word);
+    return (size_t)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_ctzll(word);
+#else
+    size_t index = 0;
+    while (!(word & 1))
+    {
+        word >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+void _woort_bitset_update_summary(woort_Bitset* bitset, size_t word_index)
+{
+    const uint64_t summary_bit = 1ULL << (word_index % 64);
+    if (bitset->m_data[word_index] == UINT64_MAX)
+        bitset->m_full_words[word_index / 64] |= summary_bit;
+    else
+        bitset->m_full_words[word_index / 64] &= ~summary_bit;
+}
 
 WOORT_NODISCARD bool woort_bitset_init(woort_Bitset* bitset, size_t bit_count)
 {
     bitset->m_bit_count = bit_count;
     bitset->m_word_count = (bit_count + 63) / 64;
+    bitset->m_summary_word_count = (bitset->m_word_count + 63) / 64;
 
-    bitset->m_data = (uint64_t*)calloc(bitset->m_word_count, sizeof(uint64_t));
+    // Words & summary words are in one allocation.
+    bitset->m_data = (uint64_t*)calloc(
+        bitset->m_word_count + bitset->m_summary_word_count, sizeof(uint64_t));
     if (bitset->m_data == NULL)
     {
         WOORT_DEBUG("Out of memory.");
         return false;
     }
+    bitset->m_full_words = bitset->m_data + bitset->m_word_count;
     return true;
 }
 
@@ -24,9 +66,11 @@ void woort_bitset_deinit(woort_Bitset* bitset)
     {
         free(bitset->m_data);
         bitset->m_data = NULL;
+        bitset->m_full_words = NULL;
     }
     bitset->m_bit_count = 0;
     bitset->m_word_count = 0;
+    bitset->m_summary_word_count = 0;
 }
 
 WOORT_NODISCARD bool woort_bitset_set(woort_Bitset* bitset, size_t index)
@@ -35,6 +79,7 @@ WOORT_NODISCARD bool woort_bitset_set(woort_Bitset* bitset, size_t index)
         return false;
 
     bitset->m_data[index / 64] |= (1ULL << (index % 64));
+    _woort_bitset_update_summary(bitset, index / 64);
     return true;
 }
 
@@ -44,6 +89,7 @@ WOORT_NODISCARD bool woort_bitset_reset(woort_Bitset* bitset, size_t index)
         return false;
 
     bitset->m_data[index / 64] &= ~(1ULL << (index % 64));
+    bitset->m_full_words[index / 64 / 64] &= ~(1ULL << (index / 64 % 64));
     return true;
 }
 
@@ -54,27 +100,99 @@ WOORT_NODISCARD bool woort_bitset_test(const woort_Bitset* bitset, size_t index)
     return (bitset->m_data[index / 64] & (1ULL << (index % 64))) != 0;
 }
 
+/*
+Mask of bits in [begin, end) of word `word_index`.
+*/
+WOORT_NODISCARD uint64_t _woort_bitset_word_mask(
+    size_t word_index, size_t begin, size_t end)
+{
+    uint64_t mask = UINT64_MAX;
+    if (word_index == begin / 64)
+        mask &= UINT64_MAX << (begin % 64);
+    if (word_index == end / 64)
+        mask &= (1ULL << (end % 64)) - 1;
+    return mask;
+}
+
+void woort_bitset_set_range(woort_Bitset* bitset, size_t begin, size_t end)
+{
+    if (end > bitset->m_bit_count)
+        end = bitset->m_bit_count;
+
+    for (size_t i = begin / 64; i * 64 < end; ++i)
+    {
+        bitset->m_data[i] |= _woort_bitset_word_mask(i, begin, end);
+        _woort_bitset_update_summary(bitset, i);
+    }
+}
+
+void woort_bitset_reset_range(woort_Bitset* bitset, size_t begin, size_t end)
+{
+    if (end > bitset->m_bit_count)
+        end = bitset->m_bit_count;
+
+    for (size_t i = begin / 64; i * 64 < end; ++i)
+    {
+        bitset->m_data[i] &= ~_woort_bitset_word_mask(i, begin, end);
+        _woort_bitset_update_summary(bitset, i);
+    }
+}
+
 WOORT_NODISCARD bool woort_bitset_find_first_unset(const woort_Bitset* bitset, size_t* out_index)
 {
-    for (size_t i = 0; i < bitset->m_word_count; ++i)
+    return woort_bitset_find_first_unset_in_range(
+        bitset, 0, bitset->m_bit_count, out_index);
+}
+
+WOORT_NODISCARD bool woort_bitset_find_first_unset_in_range(
+    const woort_Bitset* bitset,
+    size_t begin,
+    size_t end,
+    size_t* out_index)
+{
+    if (end > bitset->m_bit_count)
+        end = bitset->m_bit_count;
+
+    if (begin >= end)
+        return false;
+
+    size_t word_index = begin / 64;
+
+    // Treat bits before `begin` as set.
+    uint64_t unset_bits = ~bitset->m_data[word_index] & (UINT64_MAX << (begin % 64));
+    if (unset_bits == 0)
     {
-        uint64_t word = bitset->m_data[i];
-        if (word != UINT64_MAX)
+        // Find next word which is not full in summary.
+        const size_t next_word_index = word_index + 1;
+        bool found = false;
+
+        for (size_t i = next_word_index / 64;
+            i < bitset->m_summary_word_count && i * 64 * 64 < end;
+            ++i)
         {
-            for (size_t bit = 0; bit < 64; ++bit)
+            uint64_t not_full_words = ~bitset->m_full_words[i];
+            if (i == next_word_index / 64)
+                not_full_words &= UINT64_MAX << (next_word_index % 64);
+
+            if (not_full_words != 0)
             {
-                if (!((word >> bit) & 1))
-                {
-                    size_t index = i * 64 + bit;
-                    if (index < bitset->m_bit_count)
-                    {
-                        *out_index = index;
-                        return true;
-                    }
-                    return false;
-                }
+                word_index = i * 64 + _woort_bitset_ctz(not_full_words);
+                found = true;
+                break;
             }
         }
+
+        // Summary bits after the last word are unset, they are not real words.
+        if (!found || word_index >= bitset->m_word_count)
+            return false;
+
+        unset_bits = ~bitset->m_data[word_index];
     }
-    return false;
+
+    const size_t index = word_index * 64 + _woort_bitset_ctz(unset_bits);
+    if (index >= end)
+        return false;
+
+    *out_index = index;
+    return true;
 }
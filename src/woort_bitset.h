@@ -10,11 +10,18 @@ woort_bitset.h
 #include <stdbool.h>
 #include <stddef.h>
 
+/*
+Bitset with a summary level, bit i of `m_full_words` is set if word i of `m_data`
+is full, so the first unset bit can be found by two `ctz` instead of scanning all
+words.
+*/
 typedef struct woort_Bitset
 {
     uint64_t*   m_data;
+    uint64_t*   m_full_words;
     size_t      m_bit_count;
     size_t      m_word_count;
+    size_t      m_summary_word_count;
 
 } woort_Bitset;
 
@@ -25,4 +32,19 @@ WOORT_NODISCARD bool woort_bitset_set(woort_Bitset* bitset, size_t index);
 WOORT_NODISCARD bool woort_bitset_reset(woort_Bitset* bitset, size_t index);
 WOORT_NODISCARD bool woort_bitset_test(const woort_Bitset* bitset, size_t index);
 
+/*
+Set or reset all bits in [begin, end), `end` will be clamped to bit count.
+*/
+void woort_bitset_set_range(woort_Bitset* bitset, size_t begin, size_t end);
+void woort_bitset_reset_range(woort_Bitset* bitset, size_t begin, size_t end);
+
 WOORT_NODISCARD bool woort_bitset_find_first_unset(const woort_Bitset* bitset, size_t* out_index);
+
+/*
+Find the first unset bit in [begin, end), `end` will be clamped to bit count.
+*/
+WOORT_NODISCARD bool woort_bitset_find_first_unset_in_range(
+    const woort_Bitset* bitset,
+    size_t begin,
+    size_t end,
+    size_t* out_index);
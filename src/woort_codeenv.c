@@ -2,13 +2,20 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <stddef.h>
 
 #include "woort_codeenv.h"
 #include "woort_spin.h"
 #include "woort_vector.h"
 #include "woort_atomic.h"
+#include "woort_util.h"
+#include "woort_threads.h"
+#include "woort_epoch.h"
 #include "woort_log.h"
 
+// Power of 2.
+#define WOORT_CODEENV_DEFERRED_REFCOUNT_SLOT_COUNT 8
+
 static struct _woort_CodeEnv_GlobalCtx
 {
     woort_RWSpinlock    m_codeenvs_lock;
@@ -17,6 +24,21 @@ static struct _woort_CodeEnv_GlobalCtx
 
 } *_codeenv_global_ctx = NULL;
 
+typedef struct _woort_CodeEnv_DeferredRefcount
+{
+    /* OPTIONAL */ woort_CodeEnv* m_code_env;
+    ptrdiff_t m_delta;
+
+} _woort_CodeEnv_DeferredRefcount;
+
+static WOORT_THREAD_LOCAL _woort_CodeEnv_DeferredRefcount
+    t_deferred_refcounts[WOORT_CODEENV_DEFERRED_REFCOUNT_SLOT_COUNT];
+static WOORT_THREAD_LOCAL bool t_deferred_refcounts_online = false;
+
+void _woort_CodeEnv_destroy(woort_CodeEnv* code_env);
+void _woort_CodeEnv_flush_deferred_refcounts(void);
+bool _woort_CodeEnv_reclaim(woort_EpochRetirement* retirement, uint64_t safe_epoch);
+
 WOORT_NODISCARD bool woort_CodeEnv_bootup(void)
 {
     assert(_codeenv_global_ctx == NULL);
@@ -41,6 +63,10 @@ void woort_CodeEnv_shutdown(void)
 {
     assert(_codeenv_global_ctx != NULL);
 
+    // Other threads should have detached, destroy all retired CodeEnvs now.
+    woort_CodeEnv_thread_detach();
+    woort_epoch_reclaim_all();
+
     // 清理存储 CodeEnv 指针的 Vector
     woort_vector_deinit(&_codeenv_global_ctx->m_codeenvs);
 
@@ -51,12 +77,31 @@ void woort_CodeEnv_shutdown(void)
     _codeenv_global_ctx = NULL;
 }
 
-WOORT_NODISCARD bool woort_CodeEnv_create(
-    woort_Vector* /* woort_Bytecode */ moving_bytecodes,
+WOORT_NODISCARD bool _woort_CodeEnv_create_impl(
+    void* code_mapping,
+    size_t code_mapping_size,
+    const woort_Bytecode* code_begin,
+    size_t code_count,
+    size_t code_capacity,
     woort_Vector* /* woort_Value */ moving_constants,
     size_t static_storage_count,
+    woort_Vector* /* woort_CodeEnv_Relocation */ moving_relocations,
     woort_CodeEnv** out_code_env)
 {
+    // Check relocations before modifying anything.
+    for (size_t i = 0; i < moving_relocations->m_size; ++i)
+    {
+        const woort_CodeEnv_Relocation* const relocation =
+            woort_vector_at(moving_relocations, i);
+
+        if (relocation->m_constant >= moving_constants->m_size
+            || relocation->m_code_offset >= code_count)
+        {
+            WOORT_DEBUG("Bad relocation.");
+            return false;
+        }
+    }
+
     if (!woort_vector_resize(
         moving_constants,
         moving_constants->m_size + static_storage_count))
@@ -64,6 +109,8 @@ WOORT_NODISCARD bool woort_CodeEnv_create(
         // Out of memory.
         return false;
     }
+    const void* const constant_storage = moving_constants->m_data;
+    size_t data_capacity = moving_constants->m_capacity;
 
     woort_CodeEnv* code_env_instance =
         malloc(sizeof(woort_CodeEnv));
@@ -74,30 +121,62 @@ WOORT_NODISCARD bool woort_CodeEnv_create(
         return false;
     }
 
+    void* data_begin;
+    size_t constant_and_static_count;
+    if (!woort_vector_move_out(moving_constants, &data_begin, &constant_and_static_count))
+    {
+        free(code_env_instance);
+        return false;
+    }
+    if (data_begin != constant_storage)
+        // Copied from buffer or arena, no room left.
+        data_capacity = constant_and_static_count;
+
+    void* relocations;
+    size_t relocation_count;
+    if (!woort_vector_move_out(moving_relocations, &relocations, &relocation_count))
+    {
+        // Constants have been taken, they are released here.
+        free(data_begin);
+        free(code_env_instance);
+        return false;
+    }
+
     woort_atomic_store_explicit(
         &code_env_instance->m_refcount,
         1,
         WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
-
-    size_t code_count;
-    code_env_instance->m_code_begin =
-        woort_vector_move_out(moving_bytecodes, &code_count);
-
-    code_env_instance->m_code_end =
-        code_env_instance->m_code_begin + code_count;
-
-    size_t constant_and_static_count;
-    code_env_instance->m_data_begin =
-        woort_vector_move_out(
-            moving_constants,
-            &constant_and_static_count);
+    woort_atomic_init(&code_env_instance->m_release_epoch, 0);
+    woort_epoch_retirement_init(
+        &code_env_instance->m_retirement, _woort_CodeEnv_reclaim);
+
+    code_env_instance->m_code_begin = code_begin;
+    code_env_instance->m_code_end = code_begin + code_count;
+    code_env_instance->m_code_mapping = code_mapping;
+    code_env_instance->m_code_mapping_size = code_mapping_size;
+    code_env_instance->m_code_capacity_end = code_begin + code_capacity;
+    code_env_instance->m_extended = false;
+
+    code_env_instance->m_data_begin = data_begin;
     code_env_instance->m_data_end =
         code_env_instance->m_data_begin + constant_and_static_count;
+    code_env_instance->m_data_capacity_end =
+        code_env_instance->m_data_begin + data_capacity;
 
     code_env_instance->m_constant_count =
         constant_and_static_count - static_storage_count;
     code_env_instance->m_static_count = static_storage_count;
 
+    woort_spinlock_init(&code_env_instance->m_type_feedbacks_lock);
+    woort_hashmap_init(
+        &code_env_instance->m_type_feedbacks,
+        sizeof(uint64_t),
+        sizeof(woort_CodeEnv_TypeFeedback),
+        woort_util_u64_hash,
+        woort_util_u64_equal);
+
+    code_env_instance->m_relocations = relocations;
+    code_env_instance->m_relocation_count = relocation_count;
 
     // Fill 0 for static storage:
     memset(
@@ -105,6 +184,20 @@ WOORT_NODISCARD bool woort_CodeEnv_create(
         0,
         static_storage_count * sizeof(woort_Value));
 
+    // Code address is fixed now, patch function constants.
+    for (size_t i = 0; i < code_env_instance->m_relocation_count; ++i)
+    {
+        const woort_CodeEnv_Relocation* const relocation =
+            &code_env_instance->m_relocations[i];
+
+        woort_Function* const patching_function =
+            &code_env_instance->m_data_begin[relocation->m_constant].m_function;
+
+        patching_function->m_type = WOORT_FUNCTION_TYPE_SCRIPT;
+        patching_function->m_address = (int64_t)(intptr_t)(
+            code_env_instance->m_code_begin + relocation->m_code_offset);
+    }
+
     // 将新创建的 CodeEnv 注册到全局容器
     woort_rwspinlock_write_lock(&_codeenv_global_ctx->m_codeenvs_lock);
     bool register_result = woort_vector_push_back(
@@ -115,8 +208,12 @@ WOORT_NODISCARD bool woort_CodeEnv_create(
 
     if (!register_result)
     {
-        // Out of memory.
-        woort_CodeEnv_unshare(code_env_instance);
+        // Out of memory, code is still owned by caller.
+        code_env_instance->m_code_begin = NULL;
+        code_env_instance->m_code_mapping = NULL;
+
+        // Never shared, no need to wait for other threads.
+        _woort_CodeEnv_destroy(code_env_instance);
         return false;
     }
 
@@ -124,12 +221,170 @@ WOORT_NODISCARD bool woort_CodeEnv_create(
     return true;
 }
 
-void woort_CodeEnv_share(woort_CodeEnv* code_env)
+WOORT_NODISCARD bool woort_CodeEnv_create(
+    woort_Vector* /* woort_Bytecode */ moving_bytecodes,
+    woort_Vector* /* woort_Value */ moving_constants,
+    size_t static_storage_count,
+    woort_Vector* /* woort_CodeEnv_Relocation */ moving_relocations,
+    woort_CodeEnv** out_code_env)
 {
-    woort_atomic_fetch_add_explicit(
-        &code_env->m_refcount,
-        1,
-        WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+    // Code storage is taken by CodeEnv, it must be allocated from heap.
+    assert(moving_bytecodes->m_buffer == NULL && moving_bytecodes->m_arena == NULL);
+
+    const woort_Bytecode* const code_begin = (const woort_Bytecode*)moving_bytecodes->m_data;
+    const size_t code_count = moving_bytecodes->m_size;
+
+    // Rest capacity of code holder is reserved for extending.
+    if (!_woort_CodeEnv_create_impl(
+        NULL,
+        0,
+        code_begin,
+        code_count,
+        moving_bytecodes->m_capacity,
+        moving_constants,
+        static_storage_count,
+        moving_relocations,
+        out_code_env))
+        return false;
+
+    // Code is owned by CodeEnv now, heap storage is taken without copying.
+    void* moved_codes;
+    size_t moved_code_count;
+    const bool moved = woort_vector_move_out(moving_bytecodes, &moved_codes, &moved_code_count);
+    assert(moved);
+    (void)moved;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_CodeEnv_create_mapped(
+    void* code_mapping,
+    size_t code_mapping_size,
+    const woort_Bytecode* code_begin,
+    size_t code_count,
+    woort_Vector* /* woort_Value */ moving_constants,
+    size_t static_storage_count,
+    woort_Vector* /* woort_CodeEnv_Relocation */ moving_relocations,
+    woort_CodeEnv** out_code_env)
+{
+    assert(code_mapping != NULL);
+
+    // Mapped code is read-only, cannot be extended.
+    return _woort_CodeEnv_create_impl(
+        code_mapping,
+        code_mapping_size,
+        code_begin,
+        code_count,
+        code_count,
+        moving_constants,
+        static_storage_count,
+        moving_relocations,
+        out_code_env);
+}
+
+WOORT_NODISCARD bool woort_CodeEnv_extend(
+    woort_CodeEnv* code_env,
+    size_t data_base,
+    woort_Vector* /* woort_Bytecode */ bytecodes,
+    woort_Vector* /* woort_Value */ constants,
+    size_t static_storage_count,
+    woort_Vector* /* woort_CodeEnv_Relocation */ relocations,
+    size_t* out_code_base)
+{
+    const size_t data_count = constants->m_size + static_storage_count;
+
+    // Code range is read by woort_CodeEnv_find, update it under the write lock.
+    woort_rwspinlock_write_lock(&_codeenv_global_ctx->m_codeenvs_lock);
+
+    const size_t code_base = (size_t)(code_env->m_code_end - code_env->m_code_begin);
+    if (data_base != (size_t)(code_env->m_data_end - code_env->m_data_begin))
+    {
+        woort_rwspinlock_write_unlock(&_codeenv_global_ctx->m_codeenvs_lock);
+
+        WOORT_DEBUG("CodeEnv has been extended by others.");
+        return false;
+    }
+    if ((size_t)(code_env->m_code_capacity_end - code_env->m_code_end) < bytecodes->m_size
+        || (size_t)(code_env->m_data_capacity_end - code_env->m_data_end) < data_count)
+    {
+        woort_rwspinlock_write_unlock(&_codeenv_global_ctx->m_codeenvs_lock);
+
+        WOORT_DEBUG("No enough reserved room to extend CodeEnv.");
+        return false;
+    }
+
+    // Check relocations before modifying anything.
+    for (size_t i = 0; i < relocations->m_size; ++i)
+    {
+        const woort_CodeEnv_Relocation* const relocation = woort_vector_at(relocations, i);
+
+        if (relocation->m_constant < data_base
+            || relocation->m_constant >= data_base + constants->m_size
+            || relocation->m_code_offset >= bytecodes->m_size)
+        {
+            woort_rwspinlock_write_unlock(&_codeenv_global_ctx->m_codeenvs_lock);
+
+            WOORT_DEBUG("Bad relocation.");
+            return false;
+        }
+    }
+
+    if (relocations->m_size != 0)
+    {
+        woort_CodeEnv_Relocation* const new_relocations = realloc(
+            code_env->m_relocations,
+            (code_env->m_relocation_count + relocations->m_size)
+                * sizeof(woort_CodeEnv_Relocation));
+
+        if (new_relocations == NULL)
+        {
+            woort_rwspinlock_write_unlock(&_codeenv_global_ctx->m_codeenvs_lock);
+
+            WOORT_DEBUG("Out of memory");
+            return false;
+        }
+        code_env->m_relocations = new_relocations;
+    }
+
+    woort_Bytecode* const code_end = (woort_Bytecode*)code_env->m_code_end;
+    if (bytecodes->m_size != 0)
+        memcpy(code_end, bytecodes->m_data, bytecodes->m_size * sizeof(woort_Bytecode));
+
+    if (constants->m_size != 0)
+        memcpy(code_env->m_data_end, constants->m_data, constants->m_size * sizeof(woort_Value));
+
+    // Fill 0 for static storage:
+    memset(
+        code_env->m_data_end + constants->m_size,
+        0,
+        static_storage_count * sizeof(woort_Value));
+
+    for (size_t i = 0; i < relocations->m_size; ++i)
+    {
+        woort_CodeEnv_Relocation relocation =
+            *(const woort_CodeEnv_Relocation*)woort_vector_at(relocations, i);
+
+        relocation.m_code_offset += (uint32_t)code_base;
+
+        woort_Function* const patching_function =
+            &code_env->m_data_begin[relocation.m_constant].m_function;
+
+        patching_function->m_type = WOORT_FUNCTION_TYPE_SCRIPT;
+        patching_function->m_address = (int64_t)(intptr_t)(
+            code_env->m_code_begin + relocation.m_code_offset);
+
+        code_env->m_relocations[code_env->m_relocation_count++] = relocation;
+    }
+
+    code_env->m_code_end = code_end + bytecodes->m_size;
+    code_env->m_data_end += data_count;
+    code_env->m_constant_count += constants->m_size;
+    code_env->m_static_count += static_storage_count;
+    code_env->m_extended = true;
+
+    woort_rwspinlock_write_unlock(&_codeenv_global_ctx->m_codeenvs_lock);
+
+    *out_code_base = code_base;
+    return true;
 }
 
 void _woort_CodeEnv_destroy(woort_CodeEnv* code_env)
@@ -154,21 +409,212 @@ void _woort_CodeEnv_destroy(woort_CodeEnv* code_env)
     woort_rwspinlock_write_unlock(&_codeenv_global_ctx->m_codeenvs_lock);
 
     // 释放 CodeEnv 占用的资源
-    free((void*)code_env->m_code_begin);
+    if (code_env->m_code_mapping != NULL)
+        woort_util_unmap_file(code_env->m_code_mapping, code_env->m_code_mapping_size);
+    else
+        free((void*)code_env->m_code_begin);
+
+    free(code_env->m_relocations);
     free(code_env->m_data_begin);
+
+    woort_hashmap_deinit(&code_env->m_type_feedbacks);
+    woort_spinlock_deinit(&code_env->m_type_feedbacks_lock);
+
     free(code_env);
 }
 
-void woort_CodeEnv_unshare(woort_CodeEnv* code_env)
+void woort_CodeEnv_record_type_feedback(
+    woort_CodeEnv* code_env,
+    const woort_Bytecode* ip,
+    uint32_t type,
+    woort_CodeEnv_TypeFeedback* out_feedback)
 {
-    if (1 == woort_atomic_fetch_sub_explicit(
+    assert(ip >= code_env->m_code_begin && ip < code_env->m_code_end);
+    assert(type < 32);
+
+    const uint64_t code_offset = (uint64_t)(ip - code_env->m_code_begin);
+
+    woort_spinlock_lock(&code_env->m_type_feedbacks_lock);
+
+    woort_CodeEnv_TypeFeedback* feedback;
+    switch (woort_hashmap_get_or_emplace(
+        &code_env->m_type_feedbacks, &code_offset, (void**)&feedback))
+    {
+    case WOORT_HASHMAP_RESULT_OK:
+        feedback->m_last_type = type;
+        feedback->m_observed_types = (uint32_t)1 << type;
+        feedback->m_type_changes = 0;
+        break;
+    case WOORT_HASHMAP_RESULT_ALREADY_EXIST:
+        if (feedback->m_last_type != type)
+        {
+            feedback->m_last_type = type;
+            feedback->m_observed_types |= (uint32_t)1 << type;
+
+            if (feedback->m_type_changes != UINT32_MAX)
+                ++feedback->m_type_changes;
+        }
+        break;
+    default:
+        WOORT_DEBUG("Out of memory, type feedback dropped.");
+
+        out_feedback->m_last_type = type;
+        out_feedback->m_observed_types = (uint32_t)1 << type;
+        out_feedback->m_type_changes = 0;
+
+        woort_spinlock_unlock(&code_env->m_type_feedbacks_lock);
+        return;
+    }
+
+    *out_feedback = *feedback;
+    woort_spinlock_unlock(&code_env->m_type_feedbacks_lock);
+}
+
+WOORT_NODISCARD bool woort_CodeEnv_get_type_feedback(
+    woort_CodeEnv* code_env,
+    size_t code_offset,
+    woort_CodeEnv_TypeFeedback* out_feedback)
+{
+    const uint64_t key = (uint64_t)code_offset;
+
+    woort_spinlock_lock(&code_env->m_type_feedbacks_lock);
+
+    woort_CodeEnv_TypeFeedback* feedback;
+    const bool found =
+        woort_hashmap_find(&code_env->m_type_feedbacks, &key, (void**)&feedback);
+
+    if (found)
+        *out_feedback = *feedback;
+
+    woort_spinlock_unlock(&code_env->m_type_feedbacks_lock);
+    return found;
+}
+
+void _woort_CodeEnv_apply_refcount_delta(woort_CodeEnv* code_env, ptrdiff_t delta)
+{
+    if (delta < 0)
+    {
+        /*
+        Record the epoch before releasing, so that retirement will wait for all
+        threads to pass safepoint after this release even if the CodeEnv has been
+        retired before.
+        */
+        const uint64_t epoch = woort_epoch_current();
+        uint64_t release_epoch = woort_atomic_load_explicit(
+            &code_env->m_release_epoch, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+        while (release_epoch < epoch
+            && !woort_atomic_compare_exchange_weak_explicit(
+                &code_env->m_release_epoch,
+                &release_epoch,
+                epoch,
+                WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST,
+                WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST))
+            ;
+    }
+
+    // Shared count may wrap temporarily, other threads may hold positive deltas.
+    const size_t old_refcount = woort_atomic_fetch_add_explicit(
         &code_env->m_refcount,
-        1,
-        WOORT_ATOMIC_MEMORY_ORDER_ACQ_REL))
+        (size_t)delta,
+        WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+    if (old_refcount + (size_t)delta == 0)
+        woort_epoch_retire(&code_env->m_retirement);
+}
+
+bool _woort_CodeEnv_reclaim(woort_EpochRetirement* retirement, uint64_t safe_epoch)
+{
+    woort_CodeEnv* const code_env = (woort_CodeEnv*)(
+        (char*)retirement - offsetof(woort_CodeEnv, m_retirement));
+
+    if (woort_atomic_load_explicit(
+        &code_env->m_refcount, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST) != 0)
+        // Shared again.
+        return true;
+
+    if (woort_atomic_load_explicit(
+        &code_env->m_release_epoch, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST) >= safe_epoch)
+        // Some thread may still be releasing it.
+        return false;
+
+    _woort_CodeEnv_destroy(code_env);
+    return true;
+}
+
+void _woort_CodeEnv_flush_deferred_refcount(_woort_CodeEnv_DeferredRefcount* slot)
+{
+    if (slot->m_delta != 0)
+        _woort_CodeEnv_apply_refcount_delta(slot->m_code_env, slot->m_delta);
+
+    slot->m_code_env = NULL;
+    slot->m_delta = 0;
+}
+
+void _woort_CodeEnv_flush_deferred_refcounts(void)
+{
+    for (size_t i = 0; i < WOORT_CODEENV_DEFERRED_REFCOUNT_SLOT_COUNT; ++i)
+    {
+        _woort_CodeEnv_DeferredRefcount* const slot = &t_deferred_refcounts[i];
+        if (slot->m_code_env != NULL)
+            _woort_CodeEnv_flush_deferred_refcount(slot);
+    }
+}
+
+_woort_CodeEnv_DeferredRefcount* _woort_CodeEnv_deferred_refcount(
+    woort_CodeEnv* code_env)
+{
+    if (!t_deferred_refcounts_online)
+    {
+        // Deltas must be flushed before retired CodeEnv reclaimed.
+        woort_epoch_thread_online();
+        t_deferred_refcounts_online = true;
+    }
+
+    _woort_CodeEnv_DeferredRefcount* const slot = &t_deferred_refcounts[
+        ((uintptr_t)code_env / sizeof(woort_CodeEnv))
+            & (WOORT_CODEENV_DEFERRED_REFCOUNT_SLOT_COUNT - 1)];
+
+    if (slot->m_code_env != code_env)
     {
-        // Drop if last owner released.
-        _woort_CodeEnv_destroy(code_env);
+        if (slot->m_code_env != NULL)
+            _woort_CodeEnv_flush_deferred_refcount(slot);
+
+        slot->m_code_env = code_env;
     }
+    return slot;
+}
+
+void woort_CodeEnv_share(woort_CodeEnv* code_env)
+{
+    ++_woort_CodeEnv_deferred_refcount(code_env)->m_delta;
+}
+
+void woort_CodeEnv_unshare(woort_CodeEnv* code_env)
+{
+    --_woort_CodeEnv_deferred_refcount(code_env)->m_delta;
+}
+
+void woort_CodeEnv_safepoint(void)
+{
+    if (!t_deferred_refcounts_online)
+        return;
+
+    _woort_CodeEnv_flush_deferred_refcounts();
+
+    // Deltas are flushed before reporting quiescent state.
+    woort_epoch_quiescent();
+}
+
+void woort_CodeEnv_thread_detach(void)
+{
+    if (!t_deferred_refcounts_online)
+        return;
+
+    _woort_CodeEnv_flush_deferred_refcounts();
+
+    woort_epoch_thread_offline();
+    t_deferred_refcounts_online = false;
 }
 
 WOORT_NODISCARD bool woort_CodeEnv_find(
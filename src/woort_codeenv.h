@@ -9,33 +9,158 @@ woort_codeenv.h
 #include "woort_value.h"
 #include "woort_vector.h"
 #include "woort_atomic.h"
+#include "woort_epoch.h"
+#include "woort_spin.h"
+#include "woort_hashmap.h"
 
+#include <stdint.h>
 #include <stdbool.h>
 
 WOORT_NODISCARD bool woort_CodeEnv_bootup(void);
 void woort_CodeEnv_shutdown(void);
 
+/*
+Script function constant which holds absolute code address, should be patched when
+code address is fixed.
+*/
+typedef struct woort_CodeEnv_Relocation
+{
+    uint32_t m_constant;
+    uint32_t m_code_offset;
+
+} woort_CodeEnv_Relocation;
+
+/*
+Types observed by a type test in code, recorded in side table of CodeEnv keyed by code
+offset of the command, as feedback for optimizing.
+*/
+typedef struct woort_CodeEnv_TypeFeedback
+{
+    uint32_t m_last_type;
+    // Bit (1 << type) is set for each observed type.
+    uint32_t m_observed_types;
+    // Count of observed type changes, 0 for monomorphic sites.
+    uint32_t m_type_changes;
+
+} woort_CodeEnv_TypeFeedback;
+
 typedef struct woort_CodeEnv {
+    // Shared count, excluding deltas deferred in threads, see woort_CodeEnv_share.
     woort_AtomicSize m_refcount;
 
+    // Latest epoch in which a negative delta was applied, and retirement used when
+    // refcount drops to 0.
+    woort_AtomicUInt64 m_release_epoch;
+    woort_EpochRetirement m_retirement;
+
     const woort_Bytecode* m_code_begin;
     const woort_Bytecode* m_code_end;
 
+    // Code is mapped from image file if m_code_mapping is not NULL.
+    /* OPTIONAL */ void* m_code_mapping;
+    size_t m_code_mapping_size;
+
+    // Reserved room for woort_CodeEnv_extend, code and data never move.
+    const woort_Bytecode* m_code_capacity_end;
+    woort_Value* m_data_capacity_end;
+    bool m_extended;
+
+    woort_CodeEnv_Relocation* m_relocations;
+    size_t m_relocation_count;
+
     woort_Value* m_data_begin;
     woort_Value* m_data_end;
 
     size_t m_constant_count;
     size_t m_static_count;
+
+    woort_Spinlock m_type_feedbacks_lock;
+    woort_HashMap /* uint64_t -> woort_CodeEnv_TypeFeedback */
+        m_type_feedbacks;
 } woort_CodeEnv;
 
+/*
+Create CodeEnv and patch script function constants by `moving_relocations`.
+*/
 WOORT_NODISCARD bool woort_CodeEnv_create(
     woort_Vector* /* woort_Bytecode */ moving_bytecodes,
     woort_Vector* /* woort_Value */ moving_constants,
     size_t static_storage_count,
+    woort_Vector* /* woort_CodeEnv_Relocation */ moving_relocations,
     woort_CodeEnv** out_code_env);
 
+/*
+Like woort_CodeEnv_create, but code is in `code_mapping` which is mapped by
+woort_util_map_file, it will be unmapped when CodeEnv destroyed.
+*/
+WOORT_NODISCARD bool woort_CodeEnv_create_mapped(
+    void* code_mapping,
+    size_t code_mapping_size,
+    const woort_Bytecode* code_begin,
+    size_t code_count,
+    woort_Vector* /* woort_Value */ moving_constants,
+    size_t static_storage_count,
+    woort_Vector* /* woort_CodeEnv_Relocation */ moving_relocations,
+    woort_CodeEnv** out_code_env);
+
+/*
+Append codes, constants and static storages to `code_env` in its reserved room, so
+that new functions can be called by existing ones in NEAR way, and share the same
+data area. Constants are placed at `data_base`, followed by static storages, the
+code offsets in `moving_relocations` are relative to the appended codes.
+
+NOTE: Fails if there is not enough reserved room, or `data_base` is not the end of
+    data area (`code_env` has been extended by others).
+NOTE: Existing codes and data never move, so running VMs are not affected.
+*/
+WOORT_NODISCARD bool woort_CodeEnv_extend(
+    woort_CodeEnv* code_env,
+    size_t data_base,
+    woort_Vector* /* woort_Bytecode */ bytecodes,
+    woort_Vector* /* woort_Value */ constants,
+    size_t static_storage_count,
+    woort_Vector* /* woort_CodeEnv_Relocation */ relocations,
+    size_t* out_code_base);
+
+/*
+Share and unshare only modify refcount delta cached in current thread, deltas are
+applied when evicted or at safepoint. CodeEnv whose refcount dropped to 0 is retired,
+and destroyed after all threads have passed safepoint if nobody shared it again.
+
+NOTE: Threads which used share/unshare should call woort_CodeEnv_safepoint regularly
+    and woort_CodeEnv_thread_detach before exit, or CodeEnvs will not be destroyed
+    until shutdown.
+*/
 void woort_CodeEnv_share(woort_CodeEnv* code_env);
 void woort_CodeEnv_unshare(woort_CodeEnv* code_env);
 
+/*
+Apply deferred refcount deltas of current thread, and reclaim retired CodeEnvs if
+possible.
+*/
+void woort_CodeEnv_safepoint(void);
+void woort_CodeEnv_thread_detach(void);
+
+/*
+Record `type` observed by command at `ip` of `code_env`, and get the updated feedback
+of it. Feedback is dropped silently if out of memory, `out_feedback` is filled as if
+`type` was the only type observed.
+
+NOTE: Locked, should be called at slow paths only, such as quickening.
+*/
+void woort_CodeEnv_record_type_feedback(
+    woort_CodeEnv* code_env,
+    const woort_Bytecode* ip,
+    uint32_t type,
+    woort_CodeEnv_TypeFeedback* out_feedback);
+
+/*
+Get type feedback of command at `code_offset`, returns false if nothing recorded.
+*/
+WOORT_NODISCARD bool woort_CodeEnv_get_type_feedback(
+    woort_CodeEnv* code_env,
+    size_t code_offset,
+    woort_CodeEnv_TypeFeedback* out_feedback);
+
 WOORT_NODISCARD bool woort_CodeEnv_find(
     const woort_Bytecode* addr, woort_CodeEnv** out_code_env);
@@ -0,0 +1,323 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "woort_codeenv_image.h"
+#include "woort_vector.h"
+#include "woort_util.h"
+#include "woort_log.h"
+
+WOORT_NODISCARD bool _woort_CodeEnvImage_write_zeros(FILE* file, size_t count)
+{
+    static const char zeros[256] = { 0 };
+    while (count != 0)
+    {
+        const size_t writing = count < sizeof(zeros) ? count : sizeof(zeros);
+        if (fwrite(zeros, 1, writing, file) != writing)
+            return false;
+
+        count -= writing;
+    }
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_CodeEnvImage_write(
+    const woort_CodeEnv* code_env,
+    const uint32_t* entries,
+    size_t entry_count,
+    FILE* file)
+{
+    const size_t sections_end =
+        sizeof(woort_CodeEnvImage_Header)
+        + code_env->m_constant_count * sizeof(woort_Value)
+        + code_env->m_relocation_count * sizeof(woort_CodeEnv_Relocation)
+        + entry_count * sizeof(uint32_t);
+
+    const size_t code_offset =
+        (sections_end + WOORT_CODEENV_IMAGE_CODE_ALIGNMENT - 1)
+        / WOORT_CODEENV_IMAGE_CODE_ALIGNMENT
+        * WOORT_CODEENV_IMAGE_CODE_ALIGNMENT;
+
+    const size_t code_count =
+        (size_t)(code_env->m_code_end - code_env->m_code_begin);
+
+    woort_CodeEnvImage_Header header;
+    memset(&header, 0, sizeof(header));
+
+    memcpy(header.m_magic, WOORT_CODEENV_IMAGE_MAGIC, sizeof(header.m_magic));
+    header.m_version = WOORT_CODEENV_IMAGE_VERSION;
+    header.m_byte_order_mark = WOORT_CODEENV_IMAGE_BYTE_ORDER_MARK;
+    header.m_value_size = (uint32_t)sizeof(woort_Value);
+    header.m_bytecode_size = (uint32_t)sizeof(woort_Bytecode);
+    header.m_constant_count = code_env->m_constant_count;
+    header.m_static_count = code_env->m_static_count;
+    header.m_relocation_count = code_env->m_relocation_count;
+    header.m_entry_count = entry_count;
+    header.m_code_offset = code_offset;
+    header.m_code_count = code_count;
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+        return false;
+
+    // Script function addresses are meaningless in other process, store them as 0
+    // to make image content stable.
+    for (size_t i = 0; i < code_env->m_constant_count; ++i)
+    {
+        woort_Value constant = code_env->m_data_begin[i];
+        for (size_t r = 0; r < code_env->m_relocation_count; ++r)
+        {
+            if (code_env->m_relocations[r].m_constant == i)
+            {
+                memset(&constant, 0, sizeof(constant));
+                break;
+            }
+        }
+        if (fwrite(&constant, sizeof(constant), 1, file) != 1)
+            return false;
+    }
+
+    if (code_env->m_relocation_count != 0
+        && fwrite(
+            code_env->m_relocations,
+            sizeof(woort_CodeEnv_Relocation),
+            code_env->m_relocation_count,
+            file) != code_env->m_relocation_count)
+        return false;
+
+    if (entry_count != 0
+        && fwrite(entries, sizeof(uint32_t), entry_count, file) != entry_count)
+        return false;
+
+    if (!_woort_CodeEnvImage_write_zeros(file, code_offset - sections_end))
+        return false;
+
+    if (code_count != 0
+        && fwrite(
+            code_env->m_code_begin,
+            sizeof(woort_Bytecode),
+            code_count,
+            file) != code_count)
+        return false;
+
+    return true;
+}
+
+WOORT_NODISCARD bool woort_CodeEnv_save_image(
+    const woort_CodeEnv* code_env,
+    const uint32_t* entries,
+    size_t entry_count,
+    const char* path)
+{
+    if (code_env->m_extended)
+    {
+        // Constants and static storages are interleaved after extending.
+        WOORT_DEBUG("Extended CodeEnv cannot be saved as image.");
+        return false;
+    }
+
+    FILE* const file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        WOORT_DEBUG("Failed to open `%s` for writing image.", path);
+        return false;
+    }
+
+    const bool write_result = _woort_CodeEnvImage_write(
+        code_env, entries, entry_count, file);
+    const bool close_result = fclose(file) == 0;
+
+    if (!write_result || !close_result)
+    {
+        WOORT_DEBUG("Failed to write image `%s`.", path);
+        (void)remove(path);
+        return false;
+    }
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_CodeEnvImage_check_header(
+    const woort_CodeEnvImage_Header* header,
+    size_t file_size)
+{
+    if (memcmp(header->m_magic, WOORT_CODEENV_IMAGE_MAGIC, sizeof(header->m_magic)) != 0)
+    {
+        WOORT_DEBUG("Not a CodeEnv image.");
+        return false;
+    }
+    if (header->m_version != WOORT_CODEENV_IMAGE_VERSION
+        || header->m_byte_order_mark != WOORT_CODEENV_IMAGE_BYTE_ORDER_MARK
+        || header->m_value_size != sizeof(woort_Value)
+        || header->m_bytecode_size != sizeof(woort_Bytecode))
+    {
+        WOORT_DEBUG("CodeEnv image is built for other version or platform.");
+        return false;
+    }
+
+    // Check sizes without overflow.
+    const uint64_t max_count = SIZE_MAX / 2 / sizeof(woort_Value);
+    if (header->m_constant_count > max_count
+        || header->m_static_count > max_count
+        || header->m_relocation_count > max_count
+        || header->m_entry_count > max_count
+        || header->m_code_count > max_count
+        || header->m_code_offset > file_size)
+    {
+        WOORT_DEBUG("Bad CodeEnv image.");
+        return false;
+    }
+
+    const size_t sections_end =
+        sizeof(woort_CodeEnvImage_Header)
+        + (size_t)header->m_constant_count * sizeof(woort_Value)
+        + (size_t)header->m_relocation_count * sizeof(woort_CodeEnv_Relocation)
+        + (size_t)header->m_entry_count * sizeof(uint32_t);
+
+    if (sections_end > (size_t)header->m_code_offset
+        || (size_t)header->m_code_count * sizeof(woort_Bytecode)
+            > file_size - (size_t)header->m_code_offset)
+    {
+        WOORT_DEBUG("Bad CodeEnv image.");
+        return false;
+    }
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_CodeEnvImage_read_vector(
+    FILE* file,
+    woort_Vector* out_vector,
+    size_t count)
+{
+    if (!woort_vector_resize(out_vector, count))
+        // Out of memory.
+        return false;
+
+    return count == 0
+        || fread(out_vector->m_data, out_vector->m_element_size, count, file) == count;
+}
+
+WOORT_NODISCARD bool _woort_CodeEnvImage_read(
+    FILE* file,
+    woort_Vector* constants,
+    woort_Vector* relocations,
+    woort_Vector* entries,
+    woort_Vector* codes,
+    woort_CodeEnv** out_code_env)
+{
+    if (fseek(file, 0, SEEK_END) != 0)
+        return false;
+
+    const long file_size = ftell(file);
+    if (file_size < 0 || fseek(file, 0, SEEK_SET) != 0)
+        return false;
+
+    woort_CodeEnvImage_Header header;
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || !_woort_CodeEnvImage_check_header(&header, (size_t)file_size))
+        return false;
+
+    if (!_woort_CodeEnvImage_read_vector(
+            file, constants, (size_t)header.m_constant_count)
+        || !_woort_CodeEnvImage_read_vector(
+            file, relocations, (size_t)header.m_relocation_count)
+        || !_woort_CodeEnvImage_read_vector(
+            file, entries, (size_t)header.m_entry_count))
+        return false;
+
+    for (size_t i = 0; i < entries->m_size; ++i)
+    {
+        if (*(const uint32_t*)woort_vector_at(entries, i) >= header.m_code_count)
+        {
+            WOORT_DEBUG("Bad CodeEnv image.");
+            return false;
+        }
+    }
+
+    const size_t code_count = (size_t)header.m_code_count;
+
+    void* code_mapping;
+    size_t code_mapping_size;
+    const void* mapped_code;
+    if (woort_util_map_file(
+        file,
+        (size_t)header.m_code_offset,
+        code_count * sizeof(woort_Bytecode),
+        &code_mapping,
+        &code_mapping_size,
+        &mapped_code))
+    {
+        if (woort_CodeEnv_create_mapped(
+            code_mapping,
+            code_mapping_size,
+            mapped_code,
+            code_count,
+            constants,
+            (size_t)header.m_static_count,
+            relocations,
+            out_code_env))
+            return true;
+
+        woort_util_unmap_file(code_mapping, code_mapping_size);
+        return false;
+    }
+
+    // Cannot map, read code instead.
+    if (fseek(file, (long)header.m_code_offset, SEEK_SET) != 0
+        || !_woort_CodeEnvImage_read_vector(file, codes, code_count))
+        return false;
+
+    return woort_CodeEnv_create(
+        codes,
+        constants,
+        (size_t)header.m_static_count,
+        relocations,
+        out_code_env);
+}
+
+WOORT_NODISCARD bool woort_CodeEnv_load_image(
+    const char* path,
+    /* OPTIONAL */ woort_Vector* out_entries,
+    woort_CodeEnv** out_code_env)
+{
+    FILE* const file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        WOORT_DEBUG("Failed to open image `%s`.", path);
+        return false;
+    }
+
+    woort_Vector /* woort_Value */ constants;
+    woort_Vector /* woort_CodeEnv_Relocation */ relocations;
+    woort_Vector /* uint32_t */ entries;
+    woort_Vector /* woort_Bytecode */ codes;
+
+    woort_vector_init(&constants, sizeof(woort_Value));
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+    woort_vector_init(&entries, sizeof(uint32_t));
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+
+    bool result = _woort_CodeEnvImage_read(
+        file, &constants, &relocations, &entries, &codes, out_code_env);
+
+    if (!result)
+        WOORT_DEBUG("Failed to load image `%s`.", path);
+    else if (out_entries != NULL
+        && entries.m_size != 0
+        && !woort_vector_push_back(out_entries, entries.m_size, entries.m_data))
+    {
+        // Out of memory.
+        woort_CodeEnv_unshare(*out_code_env);
+        result = false;
+    }
+
+    // Moved out if succeeded.
+    woort_vector_deinit(&codes);
+    woort_vector_deinit(&entries);
+    woort_vector_deinit(&relocations);
+    woort_vector_deinit(&constants);
+
+    (void)fclose(file);
+    return result;
+}
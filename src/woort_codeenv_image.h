@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+woort_codeenv_image.h
+
+Binary image of committed CodeEnv, it can be loaded without compiling again.
+
+Layout (native byte order, checked by header):
+
+    +-----------------------------------+ 0
+    | woort_CodeEnvImage_Header         |
+    +-----------------------------------+
+    | Constants    (woort_Value)        | function constants are stored as 0
+    +-----------------------------------+
+    | Relocations  (woort_CodeEnv_Relocation)
+    +-----------------------------------+
+    | Entries      (uint32_t)           | code offsets given by saver, like function entries
+    +-----------------------------------+ aligned to WOORT_CODEENV_IMAGE_CODE_ALIGNMENT
+    | Code         (woort_Bytecode)     |
+    +-----------------------------------+
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_codeenv.h"
+
+#include "woort_vector.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define WOORT_CODEENV_IMAGE_MAGIC "WOORTIMG"
+
+/*
+Should be increased when the layout changes, or bytecodes expected by VM are encoded
+differently, so that images saved before are refused by woort_CodeEnv_load_image.
+*/
+#define WOORT_CODEENV_IMAGE_VERSION 5
+
+#define WOORT_CODEENV_IMAGE_BYTE_ORDER_MARK 0x01020304u
+
+/*
+Code section begins at page boundary in common, so that mapped code pages do not
+contain other sections.
+*/
+#define WOORT_CODEENV_IMAGE_CODE_ALIGNMENT 4096
+
+typedef struct woort_CodeEnvImage_Header
+{
+    char        m_magic[8];
+    uint32_t    m_version;
+    uint32_t    m_byte_order_mark;
+    uint32_t    m_value_size;
+    uint32_t    m_bytecode_size;
+
+    uint64_t    m_constant_count;
+    uint64_t    m_static_count;
+    uint64_t    m_relocation_count;
+    uint64_t    m_entry_count;
+
+    uint64_t    m_code_offset;
+    uint64_t    m_code_count;
+
+} woort_CodeEnvImage_Header;
+
+/*
+Save `code_env` to image file at `path`, static storages are not saved. Code offsets
+in `entries` are saved too, they can be used to find function entries after loading.
+
+NOTE: CodeEnv extended by woort_CodeEnv_extend cannot be saved.
+NOTE: Constants are saved as is except script functions, so native function or
+    other host address in constants cannot be loaded by another process.
+*/
+WOORT_NODISCARD bool woort_CodeEnv_save_image(
+    const woort_CodeEnv* code_env,
+    const uint32_t* entries,
+    size_t entry_count,
+    const char* path);
+
+/*
+Load image file at `path` as a new CodeEnv. Code section is mapped read-only if the
+platform supports it (else read into memory), constants are copied because script
+functions in them need to be relocated, and static storages are filled by 0.
+
+Saved entries are pushed into `out_entries` (uint32_t) if it is not NULL.
+*/
+WOORT_NODISCARD bool woort_CodeEnv_load_image(
+    const char* path,
+    /* OPTIONAL */ woort_Vector* out_entries,
+    woort_CodeEnv** out_code_env);
@@ -21,6 +21,9 @@ typedef enum woort_PanicReason
     WOORT_PANIC_STACK_OVERFLOW = 0xD002,
     WOORT_PANIC_CODE_ENV_NOT_FOUND = 0xD003,
     WOORT_PANIC_BAD_CALLSTACK = 0xD004,
+    WOORT_PANIC_OUT_OF_MEMORY = 0xD005,
+    WOORT_PANIC_BAD_FUNCTION = 0xD006,
+    WOORT_PANIC_DIVIDED_BY_ZERO = 0xD007,
 
 } woort_PanicReason;
 
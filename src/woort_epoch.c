@@ -0,0 +1,250 @@
+#include "woort_epoch.h"
+#include "woort_spin.h"
+#include "woort_threads.h"
+#include "woort_log.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct _woort_EpochParticipant
+{
+    /* OPTIONAL */ struct _woort_EpochParticipant* m_next;
+
+    // Latest epoch observed in quiescent state.
+    woort_AtomicUInt64 m_epoch;
+
+    // Only modified under lock of epoch.
+    woort_AtomicInt32 m_online;
+
+} _woort_EpochParticipant;
+
+static struct _woort_Epoch_GlobalCtx
+{
+    woort_Spinlock      m_lock;
+    woort_AtomicUInt64  m_epoch;
+
+    // Participants are never freed until shutdown, offline ones are reused.
+    /* OPTIONAL */ _woort_EpochParticipant* m_participants;
+
+    /* OPTIONAL */ woort_EpochRetirement* m_retirements;
+
+} *_epoch_global_ctx = NULL;
+
+static WOORT_THREAD_LOCAL _woort_EpochParticipant* t_epoch_participant = NULL;
+
+WOORT_NODISCARD bool woort_epoch_bootup(void)
+{
+    assert(_epoch_global_ctx == NULL);
+
+    _epoch_global_ctx = malloc(sizeof(struct _woort_Epoch_GlobalCtx));
+    if (_epoch_global_ctx == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        return false;
+    }
+
+    woort_spinlock_init(&_epoch_global_ctx->m_lock);
+    woort_atomic_init(&_epoch_global_ctx->m_epoch, 0);
+    _epoch_global_ctx->m_participants = NULL;
+    _epoch_global_ctx->m_retirements = NULL;
+
+    return true;
+}
+
+void _woort_epoch_reclaim_locked(uint64_t safe_epoch)
+{
+    woort_EpochRetirement* kept = NULL;
+    woort_EpochRetirement* retirement = _epoch_global_ctx->m_retirements;
+    _epoch_global_ctx->m_retirements = NULL;
+
+    while (retirement != NULL)
+    {
+        woort_EpochRetirement* const next = retirement->m_next;
+
+        // Object may be freed in reclaim function, unlink it first.
+        retirement->m_retired = false;
+        if (retirement->m_epoch >= safe_epoch
+            || !retirement->m_reclaim(retirement, safe_epoch))
+        {
+            // Not reclaimed yet.
+            retirement->m_retired = true;
+            retirement->m_next = kept;
+            kept = retirement;
+        }
+        retirement = next;
+    }
+    _epoch_global_ctx->m_retirements = kept;
+}
+
+void woort_epoch_shutdown(void)
+{
+    assert(_epoch_global_ctx != NULL);
+
+    woort_epoch_reclaim_all();
+
+    if (_epoch_global_ctx->m_retirements != NULL)
+        WOORT_DEBUG("Some retired objects are still alive when shutdown.");
+
+    _woort_EpochParticipant* participant = _epoch_global_ctx->m_participants;
+    while (participant != NULL)
+    {
+        _woort_EpochParticipant* const next = participant->m_next;
+        free(participant);
+        participant = next;
+    }
+    t_epoch_participant = NULL;
+
+    woort_spinlock_deinit(&_epoch_global_ctx->m_lock);
+    free(_epoch_global_ctx);
+
+    _epoch_global_ctx = NULL;
+}
+
+void woort_epoch_retirement_init(
+    woort_EpochRetirement* retirement, woort_EpochReclaimFunc reclaim)
+{
+    retirement->m_next = NULL;
+    retirement->m_reclaim = reclaim;
+    retirement->m_epoch = 0;
+    retirement->m_retired = false;
+}
+
+WOORT_NODISCARD uint64_t woort_epoch_current(void)
+{
+    return woort_atomic_load_explicit(
+        &_epoch_global_ctx->m_epoch, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+}
+
+void woort_epoch_retire(woort_EpochRetirement* retirement)
+{
+    woort_spinlock_lock(&_epoch_global_ctx->m_lock);
+
+    // Epoch cannot advance while holding the lock.
+    retirement->m_epoch = woort_epoch_current();
+    if (!retirement->m_retired)
+    {
+        retirement->m_retired = true;
+        retirement->m_next = _epoch_global_ctx->m_retirements;
+        _epoch_global_ctx->m_retirements = retirement;
+    }
+
+    woort_spinlock_unlock(&_epoch_global_ctx->m_lock);
+}
+
+void woort_epoch_reclaim_all(void)
+{
+    woort_spinlock_lock(&_epoch_global_ctx->m_lock);
+    _woort_epoch_reclaim_locked(UINT64_MAX);
+    woort_spinlock_unlock(&_epoch_global_ctx->m_lock);
+}
+
+void woort_epoch_thread_online(void)
+{
+    if (t_epoch_participant != NULL
+        && woort_atomic_load_explicit(
+            &t_epoch_participant->m_online, WOORT_ATOMIC_MEMORY_ORDER_RELAXED) != 0)
+        // Already online.
+        return;
+
+    woort_spinlock_lock(&_epoch_global_ctx->m_lock);
+
+    if (t_epoch_participant == NULL)
+    {
+        // Reuse participant of exited thread.
+        for (_woort_EpochParticipant* participant = _epoch_global_ctx->m_participants;
+            participant != NULL;
+            participant = participant->m_next)
+        {
+            if (woort_atomic_load_explicit(
+                &participant->m_online, WOORT_ATOMIC_MEMORY_ORDER_RELAXED) == 0)
+            {
+                t_epoch_participant = participant;
+                break;
+            }
+        }
+    }
+    if (t_epoch_participant == NULL)
+    {
+        _woort_EpochParticipant* const participant =
+            malloc(sizeof(_woort_EpochParticipant));
+
+        if (participant == NULL)
+        {
+            WOORT_DEBUG("Out of memory");
+            abort();
+        }
+
+        participant->m_next = _epoch_global_ctx->m_participants;
+        _epoch_global_ctx->m_participants = participant;
+
+        t_epoch_participant = participant;
+    }
+
+    woort_atomic_store_explicit(
+        &t_epoch_participant->m_epoch,
+        woort_epoch_current(),
+        WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+    woort_atomic_store_explicit(
+        &t_epoch_participant->m_online, 1, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+    woort_spinlock_unlock(&_epoch_global_ctx->m_lock);
+}
+
+void woort_epoch_thread_offline(void)
+{
+    if (t_epoch_participant == NULL)
+        return;
+
+    woort_spinlock_lock(&_epoch_global_ctx->m_lock);
+    woort_atomic_store_explicit(
+        &t_epoch_participant->m_online, 0, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+    woort_spinlock_unlock(&_epoch_global_ctx->m_lock);
+
+    // Participant may be taken by other thread now.
+    t_epoch_participant = NULL;
+}
+
+void woort_epoch_quiescent(void)
+{
+    woort_epoch_thread_online();
+
+    const uint64_t epoch = woort_epoch_current();
+    woort_atomic_store_explicit(
+        &t_epoch_participant->m_epoch, epoch, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+    // Someone else is advancing, no need to wait.
+    if (!woort_spinlock_trylock(&_epoch_global_ctx->m_lock))
+        return;
+
+    bool all_observed = true;
+    for (_woort_EpochParticipant* participant = _epoch_global_ctx->m_participants;
+        participant != NULL;
+        participant = participant->m_next)
+    {
+        if (woort_atomic_load_explicit(
+                &participant->m_online, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST) != 0
+            && woort_atomic_load_explicit(
+                &participant->m_epoch, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST) != epoch)
+        {
+            all_observed = false;
+            break;
+        }
+    }
+
+    uint64_t current_epoch = epoch;
+    if (all_observed && woort_epoch_current() == epoch)
+    {
+        current_epoch = epoch + 1;
+        woort_atomic_store_explicit(
+            &_epoch_global_ctx->m_epoch, current_epoch, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+    }
+
+    /*
+    All threads have observed `current_epoch - 1` after it began, so anything happened
+    before `current_epoch - 1` has been seen by all threads.
+    */
+    if (_epoch_global_ctx->m_retirements != NULL && current_epoch > 0)
+        _woort_epoch_reclaim_locked(current_epoch - 1);
+
+    woort_spinlock_unlock(&_epoch_global_ctx->m_lock);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+woort_epoch.h
+Epoch based reclamation, objects retired are reclaimed after all online threads
+have passed quiescent state twice.
+
+Threads using objects protected by epoch should be online (woort_epoch_thread_online),
+report quiescent state regularly by woort_epoch_quiescent, and go offline before
+exit, or reclamation will be delayed until it does.
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_atomic.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct woort_EpochRetirement woort_EpochRetirement;
+
+/*
+Invoked (under lock of epoch, must not retire anything) once the retirement's grace
+period ends. Anything happened in epoch before `safe_epoch` has been seen by all
+threads. Returns false to keep it retired and check again later.
+*/
+typedef bool (*woort_EpochReclaimFunc)(
+    woort_EpochRetirement* retirement, uint64_t safe_epoch);
+
+/*
+Embed this in retiring object, no allocation is needed when retiring.
+*/
+struct woort_EpochRetirement
+{
+    /* OPTIONAL */ woort_EpochRetirement* m_next;
+    woort_EpochReclaimFunc m_reclaim;
+
+    // Epoch of the latest retiring, only accessed under lock of epoch.
+    uint64_t m_epoch;
+    bool m_retired;
+};
+
+WOORT_NODISCARD bool woort_epoch_bootup(void);
+
+void woort_epoch_shutdown(void);
+
+void woort_epoch_retirement_init(
+    woort_EpochRetirement* retirement, woort_EpochReclaimFunc reclaim);
+
+WOORT_NODISCARD uint64_t woort_epoch_current(void);
+
+/*
+Retire or re-retire an object, its grace period starts (again) from now.
+*/
+void woort_epoch_retire(woort_EpochRetirement* retirement);
+
+void woort_epoch_thread_online(void);
+void woort_epoch_thread_offline(void);
+
+/*
+Reclaim all retired objects without waiting, all threads must have stopped using them.
+*/
+void woort_epoch_reclaim_all(void);
+
+/*
+Report that current thread will not touch anything retired before, try advancing
+epoch and reclaiming retired objects.
+*/
+void woort_epoch_quiescent(void);
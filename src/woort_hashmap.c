@@ -192,8 +192,11 @@ WOORT_NODISCARD woort_hashmap_Result woort_hashmap_get_or_emplace(
         entry = entry->m_next)
     {
         if (map->m_equal_fn(entry->m_kv_storage, key))
+        {
             // Already exist!
+            *out_value_storage = entry->m_value;
             return WOORT_HASHMAP_RESULT_ALREADY_EXIST;
+        }
     }
 
     // Insert!
@@ -210,6 +213,9 @@ WOORT_NODISCARD woort_hashmap_Result woort_hashmap_get_or_emplace(
 
     // Put into bucket.
     new_entry->m_next = map->m_buckets[bucket_id];
+    if (new_entry->m_next != NULL)
+        new_entry->m_next->m_prev = new_entry;
+
     map->m_buckets[bucket_id] = new_entry;
 
     ++map->m_size;
@@ -238,6 +244,10 @@ WOORT_NODISCARD bool woort_hashmap_find(
     const void* key,
     void** out_value_addr)
 {
+    if (map->m_buckets == NULL)
+        // Nothing inserted yet.
+        return false;
+
     const size_t hash_mask = map->m_bucket_count - 1;
     const size_t bucket_id =
         map->m_hash_fn(key) & hash_mask;
@@ -271,6 +281,10 @@ WOORT_NODISCARD bool woort_hashmap_remove(
     woort_HashMap* map,
     const void* key)
 {
+    if (map->m_buckets == NULL)
+        // Nothing inserted yet.
+        return false;
+
     const size_t hash_mask = map->m_bucket_count - 1;
     const size_t bucket_id =
         map->m_hash_fn(key) & hash_mask;
@@ -315,6 +329,7 @@ void woort_hashmap_clear(woort_HashMap* map)
 
             _woort_hashmap_drop_entry(map, current_enrty);
         }
+        map->m_buckets[bucket_id] = NULL;
     }
     map->m_size = 0;
 }
@@ -12,29 +12,83 @@ void woort_linklist_init(woort_LinkList* list, size_t storage_size)
     list->m_tail = NULL;
 
     list->m_element_size = storage_size;
+    list->m_node_size =
+        (sizeof(woort_LinkList_Node) + storage_size + _Alignof(woort_LinkList_Node) - 1)
+        / _Alignof(woort_LinkList_Node)
+        * _Alignof(woort_LinkList_Node);
+
+    list->m_slabs = NULL;
+    list->m_slab_used_node_count = 0;
+    list->m_free_nodes = NULL;
 }
 void woort_linklist_deinit(woort_LinkList* list)
 {
-    woort_LinkList_Node* node = list->m_head;
-    while (node)
+    // Nodes are owned by slabs, no need to walk through them.
+    woort_LinkList_Slab* slab = list->m_slabs;
+    while (slab)
     {
-        woort_LinkList_Node* next = node->m_next;
-        free(node);
-        node = next;
+        woort_LinkList_Slab* next = slab->m_next;
+        free(slab);
+        slab = next;
     }
 }
 
-WOORT_NODISCARD bool woort_linklist_emplace_back(woort_LinkList* list, void** out_storage)
+WOORT_NODISCARD /* OPTIONAL */ woort_LinkList_Node* _woort_linklist_alloc_node(
+    woort_LinkList* list)
 {
-    woort_LinkList_Node* new_node =
-        malloc(sizeof(woort_LinkList_Node) + list->m_element_size);
+    woort_LinkList_Node* const free_node = list->m_free_nodes;
+    if (free_node != NULL)
+    {
+        list->m_free_nodes = free_node->m_next;
+        return free_node;
+    }
 
-    if (NULL == new_node)
+    woort_LinkList_Slab* slab = list->m_slabs;
+    if (slab == NULL || list->m_slab_used_node_count == slab->m_node_count)
     {
-        WOORT_DEBUG("Allocation failed.");
-        return false;
+        size_t node_count = WOORT_LINKLIST_MIN_SLAB_NODE_COUNT;
+        if (slab != NULL)
+        {
+            node_count = slab->m_node_count * 2;
+            if (node_count > WOORT_LINKLIST_MAX_SLAB_NODE_COUNT)
+                node_count = WOORT_LINKLIST_MAX_SLAB_NODE_COUNT;
+        }
+
+        woort_LinkList_Slab* const new_slab =
+            malloc(sizeof(woort_LinkList_Slab) + node_count * list->m_node_size);
+
+        if (NULL == new_slab)
+        {
+            WOORT_DEBUG("Allocation failed.");
+            return NULL;
+        }
+
+        new_slab->m_next = slab;
+        new_slab->m_node_count = node_count;
+
+        list->m_slabs = new_slab;
+        list->m_slab_used_node_count = 0;
+        slab = new_slab;
     }
 
+    woort_LinkList_Node* const new_node = (woort_LinkList_Node*)(
+        slab->m_nodes + list->m_slab_used_node_count * list->m_node_size);
+
+    ++list->m_slab_used_node_count;
+    return new_node;
+}
+void _woort_linklist_free_node(woort_LinkList* list, woort_LinkList_Node* node)
+{
+    node->m_next = list->m_free_nodes;
+    list->m_free_nodes = node;
+}
+
+WOORT_NODISCARD bool woort_linklist_emplace_back(woort_LinkList* list, void** out_storage)
+{
+    woort_LinkList_Node* new_node = _woort_linklist_alloc_node(list);
+    if (NULL == new_node)
+        return false;
+
     new_node->m_next = NULL;
 
     if (NULL == list->m_tail)
@@ -69,14 +123,9 @@ WOORT_NODISCARD bool woort_linklist_push_back(woort_LinkList* list, const void*
 
 WOORT_NODISCARD bool woort_linklist_emplace_front(woort_LinkList* list, void** out_storage)
 {
-    woort_LinkList_Node* new_node =
-        malloc(sizeof(woort_LinkList_Node) + list->m_element_size);
-
+    woort_LinkList_Node* new_node = _woort_linklist_alloc_node(list);
     if (NULL == new_node)
-    {
-        WOORT_DEBUG("Allocation failed.");
         return false;
-    }
 
     new_node->m_prev = NULL;
 
@@ -109,11 +158,39 @@ WOORT_NODISCARD bool woort_linklist_push_front(woort_LinkList* list, const void*
     return true;
 }
 
+WOORT_NODISCARD bool woort_linklist_emplace_after(
+    woort_LinkList* list, void* position_storage, void** out_storage)
+{
+    woort_LinkList_Node* const position_node =
+        (woort_LinkList_Node*)(
+            (char*)position_storage - offsetof(woort_LinkList_Node, m_storage));
+
+    woort_LinkList_Node* new_node = _woort_linklist_alloc_node(list);
+    if (NULL == new_node)
+        return false;
+
+    new_node->m_prev = position_node;
+    new_node->m_next = position_node->m_next;
+
+    if (NULL == position_node->m_next)
+    {
+        // Is last node.
+        assert(list->m_tail == position_node);
+        list->m_tail = new_node;
+    }
+    else
+        position_node->m_next->m_prev = new_node;
+
+    position_node->m_next = new_node;
+
+    *out_storage = new_node->m_storage;
+    return true;
+}
+
 void woort_linklist_clear(woort_LinkList* list)
 {
     woort_linklist_deinit(list);
-    list->m_head = NULL;
-    list->m_tail = NULL;
+    woort_linklist_init(list, list->m_element_size);
 }
 WOORT_NODISCARD bool woort_linklist_index(woort_LinkList* list, size_t index, void** out_storage)
 {
@@ -139,8 +216,8 @@ WOORT_NODISCARD bool woort_linklist_index(woort_LinkList* list, size_t index, vo
 
 void woort_linklist_erase(woort_LinkList* list, void* storage)
 {
-    const woort_LinkList_Node* const erasing_node = 
-        (const woort_LinkList_Node*)(
+    woort_LinkList_Node* const erasing_node =
+        (woort_LinkList_Node*)(
             (char*)storage - offsetof(woort_LinkList_Node, m_storage));
 
     if (erasing_node->m_next == NULL)
@@ -161,7 +238,7 @@ void woort_linklist_erase(woort_LinkList* list, void* storage)
     else
         erasing_node->m_prev->m_next = erasing_node->m_next;
 
-    free((void*)erasing_node);
+    _woort_linklist_free_node(list, erasing_node);
 }
 
 WOORT_NODISCARD /* OPTIONAL */ void* woort_linklist_iter(woort_LinkList* list)
@@ -181,6 +258,16 @@ WOORT_NODISCARD /* OPTIONAL */ void* woort_linklist_next(void* iterator)
         return NULL;
     return current_node->m_next->m_storage;
 }
+WOORT_NODISCARD /* OPTIONAL */ void* woort_linklist_prev(void* iterator)
+{
+    woort_LinkList_Node* const current_node =
+        (woort_LinkList_Node*)(
+            (char*)iterator - offsetof(woort_LinkList_Node, m_storage));
+
+    if (current_node->m_prev == NULL)
+        return NULL;
+    return current_node->m_prev->m_storage;
+}
 
 WOORT_NODISCARD bool woort_linklist_front(woort_LinkList* list, void** out_storage)
 {
@@ -214,7 +301,7 @@ WOORT_NODISCARD bool woort_linklist_pop_front(woort_LinkList* list)
         // Only one node in list.
         list->m_head = list->m_tail = NULL;
 
-    free(head);
+    _woort_linklist_free_node(list, head);
     return true;
 }
 WOORT_NODISCARD bool woort_linklist_pop_back(woort_LinkList* list)
@@ -223,7 +310,7 @@ WOORT_NODISCARD bool woort_linklist_pop_back(woort_LinkList* list)
     if (tail == NULL)
         return false;
 
-    if (tail->m_next != NULL)
+    if (tail->m_prev != NULL)
     {
         tail->m_prev->m_next = NULL;
         list->m_tail = tail->m_prev;
@@ -232,6 +319,6 @@ WOORT_NODISCARD bool woort_linklist_pop_back(woort_LinkList* list)
         // Only one node in list.
         list->m_head = list->m_tail = NULL;
 
-    free(tail);
+    _woort_linklist_free_node(list, tail);
     return true;
 }
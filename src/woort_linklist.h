@@ -20,6 +20,24 @@ typedef struct woort_LinkList_Node
 
 } woort_LinkList_Node;
 
+/*
+Nodes are allocated from slabs owned by the list, slab grows geometrically up to
+WOORT_LINKLIST_MAX_SLAB_NODE_COUNT nodes. Erased nodes are kept in free list for
+reusing, all slabs are released together in woort_linklist_deinit.
+*/
+#define WOORT_LINKLIST_MIN_SLAB_NODE_COUNT 8
+#define WOORT_LINKLIST_MAX_SLAB_NODE_COUNT 1024
+
+typedef struct woort_LinkList_Slab
+{
+    /* OPTIONAL */ struct woort_LinkList_Slab* m_next;
+    size_t m_node_count;
+
+    _Alignas(8)
+        char m_nodes[];
+
+} woort_LinkList_Slab;
+
 typedef struct woort_LinkList
 {
     /* OPTIONAL */ woort_LinkList_Node* m_head;
@@ -27,6 +45,16 @@ typedef struct woort_LinkList
 
     size_t m_element_size;
 
+    // Size of node with storage, rounded up to alignment of node.
+    size_t m_node_size;
+
+    // Slabs, the first one is allocating.
+    /* OPTIONAL */ woort_LinkList_Slab* m_slabs;
+    size_t m_slab_used_node_count;
+
+    // Erased nodes, linked by `m_next`.
+    /* OPTIONAL */ woort_LinkList_Node* m_free_nodes;
+
 } woort_LinkList;
 
 void woort_linklist_init(woort_LinkList* list, size_t storage_size);
@@ -38,6 +66,13 @@ WOORT_NODISCARD bool woort_linklist_push_back(woort_LinkList* list, const void*
 WOORT_NODISCARD bool woort_linklist_emplace_front(woort_LinkList* list, void** out_storage);
 WOORT_NODISCARD bool woort_linklist_push_front(woort_LinkList* list, const void* data);
 
+/*
+Emplace a new node right after the node holding `position_storage`, which must be
+in `list`.
+*/
+WOORT_NODISCARD bool woort_linklist_emplace_after(
+    woort_LinkList* list, void* position_storage, void** out_storage);
+
 WOORT_NODISCARD bool woort_linklist_front(woort_LinkList* list, void** out_storage);
 WOORT_NODISCARD bool woort_linklist_back(woort_LinkList* list, void** out_storage);
 
@@ -51,3 +86,4 @@ void woort_linklist_erase(woort_LinkList* list, void* storage);
 
 WOORT_NODISCARD /* OPTIONAL */ void* woort_linklist_iter(woort_LinkList* list);
 WOORT_NODISCARD /* OPTIONAL */ void* woort_linklist_next(void* iterator);
+WOORT_NODISCARD /* OPTIONAL */ void* woort_linklist_prev(void* iterator);
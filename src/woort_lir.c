@@ -6,7 +6,6 @@
 #include "woort_opcode.h"
 #include "woort_opcode_formal.h"
 #include "woort_vector.h"
-#include "woort_lir_compiler.h"
 
 const size_t UINT18_MAX = ((size_t)1 << 18) - 1;
 const size_t UINT24_MAX = ((size_t)1 << 24) - 1;
@@ -15,6 +14,80 @@ const size_t UINT36_MAX = ((size_t)1 << 36) - 1;
 const size_t UINT44_MAX = ((size_t)1 << 44) - 1;
 const size_t UINT50_MAX = ((size_t)1 << 50) - 1;
 
+WOORT_NODISCARD woort_LIR_OpnumFormal woort_LIR_opcode_formal(woort_LIR_Opcode opcode)
+{
+#define WOORT_LIR_OPCODE_FORMAL_CASE(LIROP)     \
+    case WOORT_LIR_OPCODE_##LIROP:              \
+        return WOORT_LIR_OP_FORMAL_KIND(LIROP)
+
+    switch (opcode)
+    {
+    WOORT_LIR_OPCODE_FORMAL_CASE(LOAD);
+    WOORT_LIR_OPCODE_FORMAL_CASE(STORE);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MOV);
+    WOORT_LIR_OPCODE_FORMAL_CASE(PUSH);
+    WOORT_LIR_OPCODE_FORMAL_CASE(PUSHCS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(POP);
+    WOORT_LIR_OPCODE_FORMAL_CASE(POPCS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(CASTITOR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(CASTITOS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(CASTRTOI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(CASTRTOS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(JMP);
+    WOORT_LIR_OPCODE_FORMAL_CASE(JNZ);
+    WOORT_LIR_OPCODE_FORMAL_CASE(JZ);
+    WOORT_LIR_OPCODE_FORMAL_CASE(JEQ);
+    WOORT_LIR_OPCODE_FORMAL_CASE(JNEQ);
+    WOORT_LIR_OPCODE_FORMAL_CASE(CALLNWO);
+    WOORT_LIR_OPCODE_FORMAL_CASE(CALLNFP);
+    WOORT_LIR_OPCODE_FORMAL_CASE(CALL);
+    WOORT_LIR_OPCODE_FORMAL_CASE(RET);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MKARR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MKMAP);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MKSTRUCT);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MKCLOSURE);
+    WOORT_LIR_OPCODE_FORMAL_CASE(ADDI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(SUBI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MULI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(DIVI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MODI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(NEGI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(LTI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(GTI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(ELTI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(EGTI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(EQI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(NEQI);
+    WOORT_LIR_OPCODE_FORMAL_CASE(ADDR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(SUBR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MULR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(DIVR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(MODR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(NEGR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(LTR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(GTR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(ELTR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(EGTR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(EQR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(NEQR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(ADDS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(LTS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(GTS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(ELTS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(EGTS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(EQS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(NEQS);
+    WOORT_LIR_OPCODE_FORMAL_CASE(LOR);
+    WOORT_LIR_OPCODE_FORMAL_CASE(LAND);
+    WOORT_LIR_OPCODE_FORMAL_CASE(LNOT);
+    default:
+        WOORT_DEBUG("Unknown LIR opcode: %d.", (int)opcode);
+        abort();
+    }
+
+#undef WOORT_LIR_OPCODE_FORMAL_CASE
+}
+
 void woort_LIR_update_static_storage(
     woort_LIR* lir, size_t constant_count)
 {
@@ -37,6 +110,31 @@ void woort_LIR_update_static_storage(
     }
 }
 
+void woort_LIR_update_constant_storage(
+    woort_LIR* lir, const woort_LIR_ConstantStorage* constant_remap)
+{
+    switch (lir->m_opnum_formal)
+    {
+    case WOORT_LIR_OPNUMFORMAL_CS:
+        if (lir->m_opnums.m_cs.m_cs.m_is_constant)
+            lir->m_opnums.m_cs.m_cs.m_constant =
+                constant_remap[lir->m_opnums.m_cs.m_cs.m_constant];
+        break;
+    case WOORT_LIR_OPNUMFORMAL_CS_R:
+        if (lir->m_opnums.m_cs_r.m_cs.m_is_constant)
+            lir->m_opnums.m_cs_r.m_cs.m_constant =
+                constant_remap[lir->m_opnums.m_cs_r.m_cs.m_constant];
+        break;
+    case WOORT_LIR_OPNUMFORMAL_C_R_COUNT16:
+        lir->m_opnums.m_c_r_count16.m_c =
+            constant_remap[lir->m_opnums.m_c_r_count16.m_c];
+        break;
+    default:
+        // No constant to update.
+        break;
+    }
+}
+
 WOORT_NODISCARD bool _woort_LIR_is_near_stack(woort_RegisterStorageId storage)
 {
     return storage >= INT8_MIN
@@ -77,7 +175,7 @@ _woort_LIR_ir_extern_formal _woort_LIR_ir_get_cmd_extern_formal(
             return WOOIR_LIR_IR_EXTERN_FORMAL_NORMAL;
 
         // Use extern formal.
-        return WOOIR_LIR_IR_EXTERN_FORMAL_NORMAL;
+        return WOOIR_LIR_IR_EXTERN_FORMAL_EXTERN_COMMAND;
     }
     case WOORT_LIR_OPCODE_STORE:
     {
@@ -92,8 +190,40 @@ _woort_LIR_ir_extern_formal _woort_LIR_ir_get_cmd_extern_formal(
             return WOOIR_LIR_IR_EXTERN_FORMAL_NORMAL;
 
         // Use extern formal.
-        return WOOIR_LIR_IR_EXTERN_FORMAL_NORMAL;
+        return WOOIR_LIR_IR_EXTERN_FORMAL_EXTERN_COMMAND;
+    }
+    case WOORT_LIR_OPCODE_MOV:
+    {
+        // MOVLD/MOVST can address one S16 register, MOVLDEXT is needed only if both are far.
+        if (_woort_LIR_is_near_stack(lir->m_opnums.m_MOV.m_r1->m_assigned_bp_offset)
+            || _woort_LIR_is_near_stack(lir->m_opnums.m_MOV.m_r2->m_assigned_bp_offset))
+            return WOOIR_LIR_IR_EXTERN_FORMAL_NORMAL;
+
+        return WOOIR_LIR_IR_EXTERN_FORMAL_EXTERN_COMMAND;
+    }
+    case WOORT_LIR_OPCODE_CALLNWO:
+    {
+        if (lir->m_opnums.m_CALLNWO.m_c > UINT26_MAX
+            || lir->m_opnums.m_CALLNWO.m_count16
+                > (WOORT_BYTECODE_MA10_MASK >> WOORT_BYTECODE_MA10_SHIFT))
+        {
+            WOORT_DEBUG("Function constant or argument count too large for CALLNWO.");
+            return WOOIR_LIR_IR_EXTERN_FORMAL_BAD;
+        }
+
+        // CALLNWO + RESULT, or TCALLNWO with function constant in extension.
+        return WOOIR_LIR_IR_EXTERN_FORMAL_COMMAND_2;
     }
+    case WOORT_LIR_OPCODE_RET:
+        // RETVS addresses S16 register.
+        return WOOIR_LIR_IR_EXTERN_FORMAL_NORMAL;
+    case WOORT_LIR_OPCODE_NEGI:
+    case WOORT_LIR_OPCODE_NEGR:
+    case WOORT_LIR_OPCODE_LNOT:
+        // Result is written to S16 register directly, only source may be far.
+        if (_woort_LIR_is_near_stack(lir->m_opnums.m_r_r.m_r2->m_assigned_bp_offset))
+            return WOOIR_LIR_IR_EXTERN_FORMAL_NORMAL;
+        return WOOIR_LIR_IR_EXTERN_FORMAL_COMMAND_2;
     default:
         break;
     }
@@ -142,6 +272,11 @@ _woort_LIR_ir_extern_formal _woort_LIR_ir_get_cmd_extern_formal(
             lir->m_opnums.m_r_count16.m_r->m_assigned_bp_offset))
             ++far_register_count;
         break;
+    case WOORT_LIR_OPNUMFORMAL_C_R_COUNT16:
+        if (!_woort_LIR_is_near_stack(
+            lir->m_opnums.m_c_r_count16.m_r->m_assigned_bp_offset))
+            ++far_register_count;
+        break;
     case WOORT_LIR_OPNUMFORMAL_R_R_COUNT16:
         if (!_woort_LIR_is_near_stack(
             lir->m_opnums.m_r_r_count16.m_r1->m_assigned_bp_offset))
@@ -213,65 +348,128 @@ WOORT_NODISCARD size_t woort_LIR_ir_length_exclude_jmp(const woort_LIR* lir)
 
 #define WOORT_LIR_EMIT_BYTECODE_TO_LIST(BC)     \
     do {                                        \
-        if (!woort_LIRCompiler_emit_code(       \
-            modifing_compiler,                  \
-            BC))                                \
+        const woort_Bytecode _emitting_bc = BC; \
+        if (!woort_vector_push_back(            \
+            code_holder,                        \
+            1,                                  \
+            &_emitting_bc))                     \
         {                                       \
             return false;                       \
         }                                       \
     } while (0)
 
-//WOORT_NODISCARD woort_RegisterStorageId woort_LIR_preload_register_to_read(
-//    struct woort_LIRCompiler* modifing_compiler,
-//    const woort_LIRRegister* r,
-//    woort_RegisterStorageId regid)
-//{
-//    if (_woort_LIR_is_near_stack(r->m_assigned_bp_offset))
-//        return r->m_assigned_bp_offset;
-//    else
-//    {
-//        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
-//            woort_OpCodeFormal_cons(
-//                OP6_M2_A8_BC16,
-//                WOORT_OPCODE_MOV,
-//                1,
-//                regid,
-//                r->m_assigned_bp_offset));
-//
-//        return regid;
-//    }
-//}
-//
-//WOORT_NODISCARD woort_RegisterStorageId woort_LIR_preload_register_to_write(
-//    struct woort_LIRCompiler* modifing_compiler,
-//    const woort_LIRRegister* r,
-//    woort_RegisterStorageId regid)
-//{
-//    if (_woort_LIR_is_near_stack(r->m_assigned_bp_offset))
-//        return r->m_assigned_bp_offset;
-//    else
-//        return regid;
-//}
-//
-//WOORT_NODISCARD bool woort_LIR_apply_register_to_write(
-//    struct woort_LIRCompiler* modifing_compiler,
-//    const woort_LIRRegister* r,
-//    woort_RegisterStorageId regid)
-//{
-//    if (!_woort_LIR_is_near_stack(r->m_assigned_bp_offset))
-//    {
-//        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
-//            woort_OpCodeFormal_cons(
-//                OP6_M2_A8_BC16,
-//                WOORT_OPCODE_MOV,
-//                0,
-//                regid,
-//                r->m_assigned_bp_offset));
-//    }
-//}
-
-WOORT_NODISCARD bool woort_LIR_emit_to_lir_compiler(
-    const woort_LIR* lir, struct woort_LIRCompiler* modifing_compiler)
+/*
+Registers out of the S8 window are accessed through reserved-place, bp offset
+INT8_MIN + `reserved_index`: loaded by MOVLD before reading and stored back by MOVST
+after writing, one more command for each, see _woort_LIR_ir_get_cmd_extern_formal.
+*/
+WOORT_NODISCARD bool _woort_LIR_preload_register_to_read(
+    woort_Vector* /* woort_Bytecode */ code_holder,
+    const woort_LIRRegister* r,
+    int reserved_index,
+    int8_t* out_regid)
+{
+    if (_woort_LIR_is_near_stack(r->m_assigned_bp_offset))
+    {
+        *out_regid = (int8_t)r->m_assigned_bp_offset;
+        return true;
+    }
+
+    const int8_t reserved_regid = (int8_t)(INT8_MIN + reserved_index);
+
+    // MOVLD reserved_regid, r
+    WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+        woort_OpCodeFormal_cons(
+            OP6_M2_A8_BC16,
+            WOORT_OPCODE_MOV, 0,
+            reserved_regid,
+            r->m_assigned_bp_offset));
+
+    *out_regid = reserved_regid;
+    return true;
+}
+
+WOORT_NODISCARD int8_t _woort_LIR_preload_register_to_write(
+    const woort_LIRRegister* r, int reserved_index)
+{
+    if (_woort_LIR_is_near_stack(r->m_assigned_bp_offset))
+        return (int8_t)r->m_assigned_bp_offset;
+
+    return (int8_t)(INT8_MIN + reserved_index);
+}
+
+WOORT_NODISCARD bool _woort_LIR_apply_register_to_write(
+    woort_Vector* /* woort_Bytecode */ code_holder,
+    const woort_LIRRegister* r,
+    int8_t regid)
+{
+    if (!_woort_LIR_is_near_stack(r->m_assigned_bp_offset))
+    {
+        // MOVST regid, r
+        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+            woort_OpCodeFormal_cons(
+                OP6_M2_A8_BC16,
+                WOORT_OPCODE_MOV, 1,
+                regid,
+                r->m_assigned_bp_offset));
+    }
+    return true;
+}
+
+/*
+Get the command of arithmetic / comparing / logical LIR, returns false if there is
+no such command in VM (string operations for now).
+*/
+WOORT_NODISCARD bool _woort_LIR_operation_command(
+    woort_LIR_Opcode opcode,
+    woort_Opcode* out_opcode,
+    uint32_t* out_mode)
+{
+#define WOORT_LIR_OPERATION_COMMAND_CASE(LIROP, OP, MODE)   \
+    case WOORT_LIR_OPCODE_##LIROP:                          \
+        *out_opcode = WOORT_OPCODE_##OP;                    \
+        *out_mode = MODE;                                   \
+        return true
+
+    switch (opcode)
+    {
+    WOORT_LIR_OPERATION_COMMAND_CASE(ADDI, OPIASMD, 0);
+    WOORT_LIR_OPERATION_COMMAND_CASE(SUBI, OPIASMD, 1);
+    WOORT_LIR_OPERATION_COMMAND_CASE(MULI, OPIASMD, 2);
+    WOORT_LIR_OPERATION_COMMAND_CASE(DIVI, OPIASMD, 3);
+    WOORT_LIR_OPERATION_COMMAND_CASE(MODI, OPIONLG, 0);
+    WOORT_LIR_OPERATION_COMMAND_CASE(NEGI, OPIONLG, 1);
+    WOORT_LIR_OPERATION_COMMAND_CASE(LTI, OPIONLG, 2);
+    WOORT_LIR_OPERATION_COMMAND_CASE(GTI, OPIONLG, 3);
+    WOORT_LIR_OPERATION_COMMAND_CASE(ELTI, OPISREN, 0);
+    WOORT_LIR_OPERATION_COMMAND_CASE(EGTI, OPISREN, 1);
+    WOORT_LIR_OPERATION_COMMAND_CASE(EQI, OPISREN, 2);
+    WOORT_LIR_OPERATION_COMMAND_CASE(NEQI, OPISREN, 3);
+    WOORT_LIR_OPERATION_COMMAND_CASE(ADDR, OPRASMD, 0);
+    WOORT_LIR_OPERATION_COMMAND_CASE(SUBR, OPRASMD, 1);
+    WOORT_LIR_OPERATION_COMMAND_CASE(MULR, OPRASMD, 2);
+    WOORT_LIR_OPERATION_COMMAND_CASE(DIVR, OPRASMD, 3);
+    WOORT_LIR_OPERATION_COMMAND_CASE(MODR, OPRONLG, 0);
+    WOORT_LIR_OPERATION_COMMAND_CASE(NEGR, OPRONLG, 1);
+    WOORT_LIR_OPERATION_COMMAND_CASE(LTR, OPRONLG, 2);
+    WOORT_LIR_OPERATION_COMMAND_CASE(GTR, OPRONLG, 3);
+    WOORT_LIR_OPERATION_COMMAND_CASE(ELTR, OPRSREN, 0);
+    WOORT_LIR_OPERATION_COMMAND_CASE(EGTR, OPRSREN, 1);
+    WOORT_LIR_OPERATION_COMMAND_CASE(EQR, OPRSREN, 2);
+    WOORT_LIR_OPERATION_COMMAND_CASE(NEQR, OPRSREN, 3);
+    WOORT_LIR_OPERATION_COMMAND_CASE(LAND, OPLAONI, 0);
+    WOORT_LIR_OPERATION_COMMAND_CASE(LOR, OPLAONI, 1);
+    // LNOTST
+    WOORT_LIR_OPERATION_COMMAND_CASE(LNOT, OPLAONI, 2);
+    default:
+        return false;
+    }
+
+#undef WOORT_LIR_OPERATION_COMMAND_CASE
+}
+
+WOORT_NODISCARD bool woort_LIR_emit_to_code_holder(
+    const woort_LIR* lir, woort_Vector* /* woort_Bytecode */ code_holder)
 {
     const uint64_t LOW_26_BIT_MASK = 0x3ffffffu;
 
@@ -357,27 +555,68 @@ WOORT_NODISCARD bool woort_LIR_emit_to_lir_compiler(
 
         break;
     }
+    case WOORT_LIR_OPCODE_MOV:
+    {
+        const int16_t aim_stack_offset =
+            lir->m_opnums.m_MOV.m_r1->m_assigned_bp_offset;
+        const int16_t src_stack_offset =
+            lir->m_opnums.m_MOV.m_r2->m_assigned_bp_offset;
+
+        if (_woort_LIR_is_near_stack(aim_stack_offset))
+            // MOVLD
+            WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                woort_OpCodeFormal_cons(
+                    OP6_M2_A8_BC16,
+                    WOORT_OPCODE_MOV, 0,
+                    aim_stack_offset,
+                    src_stack_offset));
+        else if (_woort_LIR_is_near_stack(src_stack_offset))
+            // MOVST
+            WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                woort_OpCodeFormal_cons(
+                    OP6_M2_A8_BC16,
+                    WOORT_OPCODE_MOV, 1,
+                    src_stack_offset,
+                    aim_stack_offset));
+        else
+        {
+            // MOVLDEXT
+            WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                woort_OpCodeFormal_cons(
+                    OP6_M2_BC16,
+                    WOORT_OPCODE_MOV, 2,
+                    aim_stack_offset));
+            WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                (woort_Bytecode)(int32_t)src_stack_offset);
+        }
+        break;
+    }
     case WOORT_LIR_OPCODE_PUSH:
     {
+        // PUSHS if stack room assured, or PUSHSCHK.
         WOORT_LIR_EMIT_BYTECODE_TO_LIST(
             woort_OpCodeFormal_cons(
                 OP6_M2_BC16,
-                WOORT_OPCODE_PUSH, 2,
+                lir->m_opnums.m_PUSH.m_stack_assured
+                    ? WOORT_OPCODE_PUSH
+                    : WOORT_OPCODE_PUSHCHK,
+                1,
                 lir->m_opnums.m_PUSH.m_r->m_assigned_bp_offset));
 
         break;
     }
-    case WOORT_LIR_OPCODE_PUSHCS:
     case WOORT_LIR_OPCODE_POP:
     {
+        // POPS
         WOORT_LIR_EMIT_BYTECODE_TO_LIST(
             woort_OpCodeFormal_cons(
                 OP6_M2_BC16,
-                WOORT_OPCODE_POP, 2,
-                lir->m_opnums.m_PUSH.m_r->m_assigned_bp_offset));
+                WOORT_OPCODE_POP, 1,
+                lir->m_opnums.m_POP.m_r->m_assigned_bp_offset));
 
         break;
     }
+    case WOORT_LIR_OPCODE_PUSHCS:
     case WOORT_LIR_OPCODE_POPCS:
     case WOORT_LIR_OPCODE_CASTITOR:
     case WOORT_LIR_OPCODE_CASTITOS:
@@ -415,44 +654,177 @@ WOORT_NODISCARD bool woort_LIR_emit_to_lir_compiler(
     case WOORT_LIR_OPCODE_JZ:
     case WOORT_LIR_OPCODE_JEQ:
     case WOORT_LIR_OPCODE_JNEQ:
-    case WOORT_LIR_OPCODE_CALLNWO:
-    case WOORT_LIR_OPCODE_CALLNFP:
-    case WOORT_LIR_OPCODE_CALL:
-    case WOORT_LIR_OPCODE_RET:
-    case WOORT_LIR_OPCODE_MKARR:
-    case WOORT_LIR_OPCODE_MKMAP:
-    case WOORT_LIR_OPCODE_MKSTRUCT:
-    case WOORT_LIR_OPCODE_MKCLOSURE:
-        abort();
-    case WOORT_LIR_OPCODE_ADDI:
     {
-       /* _WOORT_PREFETCH_OPNUM_ABT(lir->m_opnums.m_ADDI);
+        const size_t lir_begin_code_count = code_holder->m_size;
+        const bool compare_registers =
+            lir->m_opnum_formal == WOORT_LIR_OPNUMFORMAL_R_R_LABEL;
+
+        int8_t a;
+        int8_t b = 0;
+        woort_LIRLabel* target_label;
+        bool externed;
+        if (compare_registers)
+        {
+            if (!_woort_LIR_preload_register_to_read(
+                code_holder, lir->m_opnums.m_r_r_label.m_r1, 0, &a)
+                || !_woort_LIR_preload_register_to_read(
+                    code_holder, lir->m_opnums.m_r_r_label.m_r2, 1, &b))
+                return false;
+
+            target_label = lir->m_opnums.m_r_r_label.m_label;
+            externed = lir->m_opnums.m_r_r_label.m_externed;
+        }
+        else
+        {
+            if (!_woort_LIR_preload_register_to_read(
+                code_holder, lir->m_opnums.m_r_label.m_r, 0, &a))
+                return false;
+
+            target_label = lir->m_opnums.m_r_label.m_label;
+            externed = lir->m_opnums.m_r_label.m_externed;
+        }
 
-        if (t == a)
+        assert(target_label->m_binded_lir != NULL);
+
+        // JxCONDNZ, JxCONDZ, JxCONDEQ, JxCONDNE
+        uint32_t mode;
+        switch (lir->m_opcode)
+        {
+        case WOORT_LIR_OPCODE_JNZ: mode = 0; break;
+        case WOORT_LIR_OPCODE_JZ: mode = 1; break;
+        case WOORT_LIR_OPCODE_JEQ: mode = 2; break;
+        default: mode = 3; break;
+        }
+
+        const size_t jump_offset = lir->m_fact_bytecode_offset
+            + (code_holder->m_size - lir_begin_code_count);
+        const size_t jump_target_offset =
+            target_label->m_binded_lir->m_fact_bytecode_offset;
+
+        if (externed)
+        {
+            // Too far, skip the following JMP/JMPGC if condition is not satisfied.
+            if (compare_registers)
+                WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                    woort_OpCodeFormal_cons(
+                        OP6_M2_A8_B8_C8, WOORT_OPCODE_JCOND, mode ^ 1, a, b, 2));
+            else
+                WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                    woort_OpCodeFormal_cons(
+                        OP6_M2_A8_BC16, WOORT_OPCODE_JCOND, mode ^ 1, a, 2));
+
+            const size_t jmp_offset = jump_offset + 1;
+            if (jump_target_offset <= jmp_offset)
+                WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                    woort_OpCodeFormal_cons(
+                        OP6_MABC26, WOORT_OPCODE_JMPGC, jmp_offset - jump_target_offset));
+            else
+                WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                    woort_OpCodeFormal_cons(
+                        OP6_MABC26, WOORT_OPCODE_JMP, jump_target_offset - jmp_offset));
+            break;
+        }
+
+        // Jump back must check GC safe point.
+        const bool jump_back = jump_target_offset <= jump_offset;
+        const woort_Opcode jump_opcode =
+            jump_back ? WOORT_OPCODE_JCONDGC : WOORT_OPCODE_JCOND;
+        const size_t distance = jump_back
+            ? jump_offset - jump_target_offset
+            : jump_target_offset - jump_offset;
+
+        if (compare_registers)
+        {
+            assert(distance <= UINT8_MAX);
             WOORT_LIR_EMIT_BYTECODE_TO_LIST(
                 woort_OpCodeFormal_cons(
-                    OP6_M2_B8_C8,
-                    WOORT_OPCODE_OPCIASMD, 0, b, t));
-        else if (t == b)
+                    OP6_M2_A8_B8_C8, jump_opcode, mode, a, b, distance));
+        }
+        else
+        {
+            assert(distance <= UINT16_MAX);
             WOORT_LIR_EMIT_BYTECODE_TO_LIST(
                 woort_OpCodeFormal_cons(
-                    OP6_M2_B8_C8,
-                    WOORT_OPCODE_OPCIASMD, 0, a, t));
-        else
+                    OP6_M2_A8_BC16, jump_opcode, mode, a, distance));
+        }
+        break;
+    }
+    case WOORT_LIR_OPCODE_CALLNWO:
+    {
+        if (lir->m_opnums.m_CALLNWO.m_tail_call)
+        {
+            // TCALLNWO, current frame is reused, result will be returned by callee.
             WOORT_LIR_EMIT_BYTECODE_TO_LIST(
                 woort_OpCodeFormal_cons(
-                    OP6_M2_A8_B8_C8,
-                    WOORT_OPCODE_OPIASMD, 0, a, b, t));
+                    OP6_M2_BC16,
+                    WOORT_OPCODE_CALL, 2,
+                    lir->m_opnums.m_CALLNWO.m_count16));
+            WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+                (woort_Bytecode)lir->m_opnums.m_CALLNWO.m_c);
+            break;
+        }
 
-        _WOORT_APPLY_OPNUM_T(lir->m_opnums.m_ADDI);*/
+        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+            woort_OpCodeFormal_cons(
+                OP6_MABC26,
+                WOORT_OPCODE_CALLNWO,
+                lir->m_opnums.m_CALLNWO.m_c));
 
+        // Fetch result and pop arguments.
+        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+            woort_OpCodeFormal_cons(
+                OP6_MA10_BC16,
+                WOORT_OPCODE_RESULT,
+                lir->m_opnums.m_CALLNWO.m_count16,
+                lir->m_opnums.m_CALLNWO.m_r->m_assigned_bp_offset));
+        break;
+    }
+    case WOORT_LIR_OPCODE_RET:
+    {
+        // RETVS
+        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+            woort_OpCodeFormal_cons(
+                OP6_M2_BC16,
+                WOORT_OPCODE_RET, 1,
+                lir->m_opnums.m_RET.m_r->m_assigned_bp_offset));
         break;
     }
+    case WOORT_LIR_OPCODE_CALLNFP:
+    case WOORT_LIR_OPCODE_CALL:
+    case WOORT_LIR_OPCODE_MKARR:
+    case WOORT_LIR_OPCODE_MKMAP:
+    case WOORT_LIR_OPCODE_MKSTRUCT:
+    case WOORT_LIR_OPCODE_MKCLOSURE:
+        abort();
+    case WOORT_LIR_OPCODE_NEGI:
+    case WOORT_LIR_OPCODE_NEGR:
+    case WOORT_LIR_OPCODE_LNOT:
+    {
+        woort_Opcode opcode;
+        uint32_t mode;
+        const bool has_command = _woort_LIR_operation_command(lir->m_opcode, &opcode, &mode);
+        assert(has_command);
+        (void)has_command;
+
+        int8_t src;
+        if (!_woort_LIR_preload_register_to_read(
+            code_holder, lir->m_opnums.m_r_r.m_r2, 0, &src))
+            return false;
+
+        // NEGI, NEGR & LNOTST write S16 register.
+        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+            woort_OpCodeFormal_cons(
+                OP6_M2_A8_BC16,
+                opcode, mode,
+                src,
+                lir->m_opnums.m_r_r.m_r1->m_assigned_bp_offset));
+        break;
+    }
+    case WOORT_LIR_OPCODE_ADDI:
     case WOORT_LIR_OPCODE_SUBI:
     case WOORT_LIR_OPCODE_MULI:
     case WOORT_LIR_OPCODE_DIVI:
     case WOORT_LIR_OPCODE_MODI:
-    case WOORT_LIR_OPCODE_NEGI:
     case WOORT_LIR_OPCODE_LTI:
     case WOORT_LIR_OPCODE_GTI:
     case WOORT_LIR_OPCODE_ELTI:
@@ -464,13 +836,42 @@ WOORT_NODISCARD bool woort_LIR_emit_to_lir_compiler(
     case WOORT_LIR_OPCODE_MULR:
     case WOORT_LIR_OPCODE_DIVR:
     case WOORT_LIR_OPCODE_MODR:
-    case WOORT_LIR_OPCODE_NEGR:
     case WOORT_LIR_OPCODE_LTR:
     case WOORT_LIR_OPCODE_GTR:
     case WOORT_LIR_OPCODE_ELTR:
     case WOORT_LIR_OPCODE_EGTR:
     case WOORT_LIR_OPCODE_EQR:
     case WOORT_LIR_OPCODE_NEQR:
+    case WOORT_LIR_OPCODE_LOR:
+    case WOORT_LIR_OPCODE_LAND:
+    {
+        woort_Opcode opcode;
+        uint32_t mode;
+        const bool has_command = _woort_LIR_operation_command(lir->m_opcode, &opcode, &mode);
+        assert(has_command);
+        (void)has_command;
+
+        int8_t a, b;
+        if (!_woort_LIR_preload_register_to_read(
+            code_holder, lir->m_opnums.m_r_r_r.m_r1, 0, &a)
+            || !_woort_LIR_preload_register_to_read(
+                code_holder, lir->m_opnums.m_r_r_r.m_r2, 1, &b))
+            return false;
+
+        const int8_t t = _woort_LIR_preload_register_to_write(
+            lir->m_opnums.m_r_r_r.m_r3, 2);
+
+        WOORT_LIR_EMIT_BYTECODE_TO_LIST(
+            woort_OpCodeFormal_cons(
+                OP6_M2_A8_B8_C8,
+                opcode, mode,
+                a, b, t));
+
+        if (!_woort_LIR_apply_register_to_write(
+            code_holder, lir->m_opnums.m_r_r_r.m_r3, t))
+            return false;
+        break;
+    }
     case WOORT_LIR_OPCODE_ADDS:
     case WOORT_LIR_OPCODE_LTS:
     case WOORT_LIR_OPCODE_GTS:
@@ -478,9 +879,7 @@ WOORT_NODISCARD bool woort_LIR_emit_to_lir_compiler(
     case WOORT_LIR_OPCODE_EGTS:
     case WOORT_LIR_OPCODE_EQS:
     case WOORT_LIR_OPCODE_NEQS:
-    case WOORT_LIR_OPCODE_LOR:
-    case WOORT_LIR_OPCODE_LAND:
-    case WOORT_LIR_OPCODE_LNOT:
+        // No string value in VM yet.
         abort();
     default:
         WOORT_DEBUG("Unsupported LIR opcode in emit: %d", (int)lir->m_opcode);
@@ -22,9 +22,27 @@ typedef struct woort_LIRRegister
     /* NOTE: SIZE_MAX means not active */
     size_t m_alive_range[2];
 
+    /*
+    Use count weighted by loop depth, filled by register allocation. Hotter
+    registers are preferred to be placed in the near (S8) stack window.
+    */
+    size_t m_use_weight;
+
     /* Used in finalized only. */
     woort_RegisterStorageId m_assigned_bp_offset;
 
+    /*
+    Registers pushed one after another are grouped by register allocation, and
+    placed in contiguous slots if possible, so that their pushes can be merged
+    into one PUSHRANGE. NULL leader means not grouped.
+    */
+    struct woort_LIRRegister* m_push_range_leader;
+    // Index in group, the first pushed one gets the lowest slot.
+    size_t m_push_range_index;
+    // Used by leader only.
+    size_t m_push_range_count;
+    bool m_push_range_placed;
+
 }woort_LIRRegister;
 
 // Label.
@@ -63,6 +81,7 @@ typedef enum woort_LIR_OpnumFormal
     WOORT_LIR_OPNUMFORMAL_R_R_R,
     WOORT_LIR_OPNUMFORMAL_R_R_COUNT16,
     WOORT_LIR_OPNUMFORMAL_R_COUNT16,
+    WOORT_LIR_OPNUMFORMAL_C_R_COUNT16,
     WOORT_LIR_OPNUMFORMAL_R_R_LABEL,
     WOORT_LIR_OPNUMFORMAL_R_LABEL,
     WOORT_LIR_OPNUMFORMAL_LABEL,
@@ -93,6 +112,9 @@ typedef struct woort_LIR_OpnumFormal_R
 {
     woort_LIRRegister* m_r;
 
+    /* NOTE: If stack room of PUSH has been assured at function entry, this flag will be marked */
+    bool m_stack_assured;
+
 } woort_LIR_OpnumFormal_R;
 
 typedef struct woort_LIR_OpnumFormal_R_R
@@ -125,6 +147,17 @@ typedef struct woort_LIR_OpnumFormal_R_COUNT16
 
 } woort_LIR_OpnumFormal_R_COUNT16;
 
+typedef struct woort_LIR_OpnumFormal_C_R_COUNT16
+{
+    woort_LIR_ConstantStorage m_c;
+    woort_LIRRegister* m_r;
+    uint16_t m_count16;
+
+    /* NOTE: If CALLNWO's result returned immediately, this flag will be marked */
+    bool m_tail_call;
+
+} woort_LIR_OpnumFormal_C_R_COUNT16;
+
 typedef struct woort_LIR_OpnumFormal_R_LABEL
 {
     woort_LIRRegister* m_r;
@@ -179,6 +212,7 @@ typedef enum woort_LIR_Opcode
 {
     WOORT_LIR_OPCODE_LOAD,
     WOORT_LIR_OPCODE_STORE,
+    WOORT_LIR_OPCODE_MOV,
     WOORT_LIR_OPCODE_PUSH,
     WOORT_LIR_OPCODE_PUSHCS,
     WOORT_LIR_OPCODE_POP,
@@ -239,6 +273,7 @@ typedef enum woort_LIR_Opcode
 
 #define WOORT_LIR_OPNUM_FORMAL_LOAD CS_R
 #define WOORT_LIR_OPNUM_FORMAL_STORE S_R
+#define WOORT_LIR_OPNUM_FORMAL_MOV R_R
 #define WOORT_LIR_OPNUM_FORMAL_PUSH R
 #define WOORT_LIR_OPNUM_FORMAL_PUSHCS CS
 #define WOORT_LIR_OPNUM_FORMAL_POP R
@@ -252,10 +287,10 @@ typedef enum woort_LIR_Opcode
 #define WOORT_LIR_OPNUM_FORMAL_JZ R_LABEL
 #define WOORT_LIR_OPNUM_FORMAL_JEQ R_R_LABEL
 #define WOORT_LIR_OPNUM_FORMAL_JNEQ R_R_LABEL
-#define WOORT_LIR_OPNUM_FORMAL_CALLNWO R_R
+#define WOORT_LIR_OPNUM_FORMAL_CALLNWO C_R_COUNT16
 #define WOORT_LIR_OPNUM_FORMAL_CALLNFP R_R
 #define WOORT_LIR_OPNUM_FORMAL_CALL R_R
-#define WOORT_LIR_OPNUM_FORMAL_RET R_COUNT16
+#define WOORT_LIR_OPNUM_FORMAL_RET R
 #define WOORT_LIR_OPNUM_FORMAL_MKARR R_COUNT16
 #define WOORT_LIR_OPNUM_FORMAL_MKMAP R_COUNT16
 #define WOORT_LIR_OPNUM_FORMAL_MKSTRUCT R_COUNT16
@@ -322,12 +357,14 @@ typedef union woort_LIR_Opnums
     woort_LIR_OpnumFormal_R_R_R m_r_r_r;
     woort_LIR_OpnumFormal_R_R_COUNT16 m_r_r_count16;
     woort_LIR_OpnumFormal_R_COUNT16 m_r_count16;
+    woort_LIR_OpnumFormal_C_R_COUNT16 m_c_r_count16;
     woort_LIR_OpnumFormal_R_LABEL m_r_label;
     woort_LIR_OpnumFormal_R_R_LABEL m_r_r_label;
     woort_LIR_OpnumFormal_LABEL m_label;
 
     WOORT_LIR_OPNUM_FORMAL_DEFINE(LOAD);
     WOORT_LIR_OPNUM_FORMAL_DEFINE(STORE);
+    WOORT_LIR_OPNUM_FORMAL_DEFINE(MOV);
     WOORT_LIR_OPNUM_FORMAL_DEFINE(PUSH);
     WOORT_LIR_OPNUM_FORMAL_DEFINE(PUSHCS);
     WOORT_LIR_OPNUM_FORMAL_DEFINE(POP);
@@ -395,8 +432,8 @@ typedef struct woort_LIR
     woort_LIR_Opnums        m_opnums;
 
     /*
-    `m_fact_bytecode_offset` is populated as the absolute instruction location (in units of 4 bytes)
-    when the function IR is submitted to the code generator. This value is updated during the submission
+    `m_fact_bytecode_offset` is populated as the instruction location (in units of 4 bytes) relative to
+    the beginning of its function when the function IR is submitted to the code generator. This value is updated during the submission
     process (e.g., when encountering long-range address jumps, additional instructions need to be inserted,
     which may cause changes to this offset).
     */
@@ -404,12 +441,23 @@ typedef struct woort_LIR
 
 }woort_LIR;
 
+/*
+Get the operand formal of `opcode`, same as WOORT_LIR_OP_FORMAL_KIND but at runtime.
+*/
+WOORT_NODISCARD woort_LIR_OpnumFormal woort_LIR_opcode_formal(woort_LIR_Opcode opcode);
+
 /*
 NOTE: Since static storage shares the same addressing mechanism as constants, this method must be used to
     update the offset of the static storage space.
 */
 void woort_LIR_update_static_storage(woort_LIR* lir, size_t constant_count);
 /*
+NOTE: Used when the constant pool is compacted, `constant_remap` maps each old
+    constant index to the new one.
+*/
+void woort_LIR_update_constant_storage(
+    woort_LIR* lir, const woort_LIR_ConstantStorage* constant_remap);
+/*
 NOTE: This method is used by the ir-compiler when submitting a function to calculate the IR length required
     for each LIR, but temporarily does not consider the extra length expansion introduced by conditional
     jump instructions during long-range jumps: these will be calculated later.
@@ -419,5 +467,5 @@ NOTE: This method is used by the ir-compiler when submitting a function to calcu
 WOORT_NODISCARD /* May 0 if failed. */ size_t woort_LIR_ir_length_exclude_jmp(
     const woort_LIR* lir);
 
-WOORT_NODISCARD bool woort_LIR_emit_to_lir_compiler(
-    const woort_LIR* lir, struct woort_LIRCompiler* modifing_compiler);
+WOORT_NODISCARD bool woort_LIR_emit_to_code_holder(
+    const woort_LIR* lir, woort_Vector* /* woort_Bytecode */ code_holder);
@@ -0,0 +1,396 @@
+#include "woort_lir_cache.h"
+#include "woort_codeenv_image.h"
+#include "woort_hashmap.h"
+#include "woort_linklist.h"
+#include "woort_vector.h"
+#include "woort_util.h"
+#include "woort_log.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WOORT_LIR_CACHE_FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define WOORT_LIR_CACHE_FNV_PRIME 0x00000100000001b3ULL
+
+void _woort_LIRCache_hash_bytes(uint64_t* hash, const void* data, size_t size)
+{
+    const unsigned char* const bytes = data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        *hash ^= bytes[i];
+        *hash *= WOORT_LIR_CACHE_FNV_PRIME;
+    }
+}
+
+void _woort_LIRCache_hash_u64(uint64_t* hash, uint64_t value)
+{
+    // Hash in fixed byte order, independent of platform.
+    unsigned char bytes[8];
+    for (size_t i = 0; i < 8; ++i)
+        bytes[i] = (unsigned char)(value >> (i * 8));
+
+    _woort_LIRCache_hash_bytes(hash, bytes, sizeof(bytes));
+}
+
+WOORT_NODISCARD bool _woort_LIRCache_index_list(
+    woort_HashMap* /* void* -> uint64_t */ ordinals,
+    woort_LinkList* list,
+    uint64_t* out_count)
+{
+    uint64_t ordinal = 0;
+    for (
+        void* current = woort_linklist_iter(list);
+        current != NULL;
+        current = woort_linklist_next(current), ++ordinal)
+    {
+        if (WOORT_HASHMAP_RESULT_OUT_OF_MEMORY == woort_hashmap_insert(
+            ordinals, &current, &ordinal))
+            return false;
+    }
+    *out_count = ordinal;
+    return true;
+}
+
+void _woort_LIRCache_hash_pointer(
+    uint64_t* hash,
+    woort_HashMap* /* void* -> uint64_t */ ordinals,
+    const void* pointer)
+{
+    uint64_t* ordinal;
+    if (pointer != NULL && woort_hashmap_find(ordinals, &pointer, (void**)&ordinal))
+        _woort_LIRCache_hash_u64(hash, *ordinal);
+    else
+        _woort_LIRCache_hash_u64(hash, UINT64_MAX);
+}
+
+void _woort_LIRCache_hash_cs(uint64_t* hash, const woort_LIR_CS* cs)
+{
+    _woort_LIRCache_hash_u64(hash, cs->m_is_constant);
+    _woort_LIRCache_hash_u64(hash, cs->m_is_constant ? cs->m_constant : cs->m_static);
+}
+
+void _woort_LIRCache_hash_lir(
+    uint64_t* hash,
+    woort_HashMap* /* void* -> uint64_t */ ordinals,
+    const woort_LIR* lir)
+{
+    _woort_LIRCache_hash_u64(hash, (uint64_t)lir->m_opcode);
+    _woort_LIRCache_hash_u64(hash, (uint64_t)lir->m_opnum_formal);
+
+    // Flags decided in committing (like m_tail_call & m_externed) are not hashed.
+    const woort_LIR_Opnums* const opnums = &lir->m_opnums;
+    switch (lir->m_opnum_formal)
+    {
+    case WOORT_LIR_OPNUMFORMAL_CS:
+        _woort_LIRCache_hash_cs(hash, &opnums->m_cs.m_cs);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_CS_R:
+        _woort_LIRCache_hash_cs(hash, &opnums->m_cs_r.m_cs);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_cs_r.m_r);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_S_R:
+        _woort_LIRCache_hash_u64(hash, opnums->m_s_r.m_s);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_s_r.m_r);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_R:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r.m_r);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_R_R:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r.m_r1);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r.m_r2);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_R_R_R:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_r.m_r1);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_r.m_r2);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_r.m_r3);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_R_R_COUNT16:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_count16.m_r1);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_count16.m_r2);
+        _woort_LIRCache_hash_u64(hash, opnums->m_r_r_count16.m_count16);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_R_COUNT16:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_count16.m_r);
+        _woort_LIRCache_hash_u64(hash, opnums->m_r_count16.m_count16);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_C_R_COUNT16:
+        _woort_LIRCache_hash_u64(hash, opnums->m_c_r_count16.m_c);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_c_r_count16.m_r);
+        _woort_LIRCache_hash_u64(hash, opnums->m_c_r_count16.m_count16);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_label.m_r1);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_label.m_r2);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_r_label.m_label);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_R_LABEL:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_label.m_r);
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_r_label.m_label);
+        break;
+    case WOORT_LIR_OPNUMFORMAL_LABEL:
+        _woort_LIRCache_hash_pointer(hash, ordinals, opnums->m_label.m_label);
+        break;
+    default:
+        abort();
+    }
+}
+
+WOORT_NODISCARD bool _woort_LIRCache_hash_function(
+    uint64_t* hash,
+    woort_LIRFunction* function)
+{
+    // Registers, labels and LIRs are all in different lists, share one ordinal map.
+    woort_HashMap /* void* -> uint64_t */ ordinals;
+    woort_hashmap_init(
+        &ordinals,
+        sizeof(void*),
+        sizeof(uint64_t),
+        woort_util_ptr_hash,
+        woort_util_ptr_equal);
+
+    uint64_t register_count, label_count, lir_count;
+    if (!_woort_LIRCache_index_list(&ordinals, &function->m_register_list, &register_count)
+        || !_woort_LIRCache_index_list(&ordinals, &function->m_label_list, &label_count)
+        || !_woort_LIRCache_index_list(&ordinals, &function->m_lir_list, &lir_count))
+    {
+        woort_hashmap_deinit(&ordinals);
+        return false;
+    }
+
+    // Argument registers are different from normal ones by their fixed storage.
+    _woort_LIRCache_hash_u64(hash, register_count);
+    for (
+        woort_LIRRegister* current_register = woort_linklist_iter(&function->m_register_list);
+        current_register != NULL;
+        current_register = woort_linklist_next(current_register))
+    {
+        _woort_LIRCache_hash_u64(
+            hash, (uint64_t)(int64_t)current_register->m_assigned_bp_offset);
+    }
+
+    _woort_LIRCache_hash_u64(hash, label_count);
+    for (
+        woort_LIRLabel* current_label = woort_linklist_iter(&function->m_label_list);
+        current_label != NULL;
+        current_label = woort_linklist_next(current_label))
+    {
+        _woort_LIRCache_hash_pointer(hash, &ordinals, current_label->m_binded_lir);
+    }
+
+    _woort_LIRCache_hash_u64(hash, function->m_pending_labels_to_bind.m_size);
+    for (size_t i = 0; i < function->m_pending_labels_to_bind.m_size; ++i)
+    {
+        _woort_LIRCache_hash_pointer(
+            hash,
+            &ordinals,
+            *(woort_LIRLabel**)woort_vector_at(&function->m_pending_labels_to_bind, i));
+    }
+
+    _woort_LIRCache_hash_u64(hash, lir_count);
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
+        current_lir != NULL;
+        current_lir = woort_linklist_next(current_lir))
+    {
+        _woort_LIRCache_hash_lir(hash, &ordinals, current_lir);
+    }
+
+    woort_hashmap_deinit(&ordinals);
+    return true;
+}
+
+WOORT_NODISCARD bool woort_LIRCompiler_hash(
+    woort_LIRCompiler* lir_compiler,
+    uint64_t* out_hash)
+{
+    uint64_t hash = WOORT_LIR_CACHE_FNV_OFFSET_BASIS;
+
+    _woort_LIRCache_hash_u64(&hash, WOORT_LIR_CACHE_VERSION);
+    _woort_LIRCache_hash_u64(&hash, WOORT_CODEENV_IMAGE_VERSION);
+
+    // Emitted codes.
+    _woort_LIRCache_hash_u64(&hash, lir_compiler->m_code_holder.m_size);
+    for (size_t i = 0; i < lir_compiler->m_code_holder.m_size; ++i)
+        _woort_LIRCache_hash_u64(
+            &hash, *(const woort_Bytecode*)woort_vector_at(&lir_compiler->m_code_holder, i));
+
+    // Constants & static storages.
+    _woort_LIRCache_hash_u64(&hash, lir_compiler->m_constant_storage_holder.m_size);
+    for (size_t i = 0; i < lir_compiler->m_constant_storage_holder.m_size; ++i)
+    {
+        uint64_t value_bits;
+        memcpy(
+            &value_bits,
+            woort_vector_at(&lir_compiler->m_constant_storage_holder, i),
+            sizeof(value_bits));
+
+        _woort_LIRCache_hash_u64(&hash, value_bits);
+    }
+    _woort_LIRCache_hash_u64(&hash, lir_compiler->m_static_storage_count);
+
+    // Functions.
+    woort_HashMap /* void* -> uint64_t */ function_ordinals;
+    woort_hashmap_init(
+        &function_ordinals,
+        sizeof(void*),
+        sizeof(uint64_t),
+        woort_util_ptr_hash,
+        woort_util_ptr_equal);
+
+    uint64_t function_count;
+    bool succeed = _woort_LIRCache_index_list(
+        &function_ordinals, &lir_compiler->m_function_list, &function_count);
+
+    if (succeed)
+    {
+        _woort_LIRCache_hash_u64(&hash, function_count);
+        _woort_LIRCache_hash_u64(&hash, lir_compiler->m_function_constant_list.m_size);
+        for (size_t i = 0; i < lir_compiler->m_function_constant_list.m_size; ++i)
+        {
+            const woort_LIRCompiler_FunctionConstant* const function_constant =
+                woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+            _woort_LIRCache_hash_u64(&hash, function_constant->m_constant);
+            _woort_LIRCache_hash_pointer(
+                &hash, &function_ordinals, function_constant->m_function);
+        }
+    }
+    woort_hashmap_deinit(&function_ordinals);
+
+    for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+        succeed && NULL != current_function;
+        current_function = woort_linklist_next(current_function))
+    {
+        succeed = _woort_LIRCache_hash_function(&hash, current_function);
+    }
+
+    if (!succeed)
+        // Out of memory.
+        return false;
+
+    *out_hash = hash;
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_LIRCache_load(
+    woort_LIRCompiler* lir_compiler,
+    const char* image_path,
+    woort_CodeEnv** out_codeenv)
+{
+    woort_Vector /* uint32_t */ entries;
+    woort_vector_init(&entries, sizeof(uint32_t));
+
+    woort_CodeEnv* code_env;
+    if (!woort_CodeEnv_load_image(image_path, &entries, &code_env))
+    {
+        woort_vector_deinit(&entries);
+        return false;
+    }
+
+    size_t entry_index = 0;
+    woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+    for (;
+        NULL != current_function && entry_index < entries.m_size;
+        current_function = woort_linklist_next(current_function), ++entry_index)
+    {
+        current_function->m_entry_bytecode_offset =
+            *(const uint32_t*)woort_vector_at(&entries, entry_index);
+    }
+
+    // Both functions and entries must be used up.
+    const bool entry_matched = NULL == current_function && entry_index == entries.m_size;
+    woort_vector_deinit(&entries);
+
+    if (!entry_matched)
+    {
+        // Hash collision, or image is broken.
+        WOORT_DEBUG("Function count of cached image `%s` mismatched.", image_path);
+        woort_CodeEnv_unshare(code_env);
+        return false;
+    }
+
+    *out_codeenv = code_env;
+    return true;
+}
+
+void _woort_LIRCache_save(
+    woort_LIRCompiler* lir_compiler,
+    const woort_CodeEnv* code_env,
+    const char* image_path,
+    char* temporary_path)
+{
+    woort_Vector /* uint32_t */ entries;
+    woort_vector_init(&entries, sizeof(uint32_t));
+
+    for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+        NULL != current_function;
+        current_function = woort_linklist_next(current_function))
+    {
+        const uint32_t entry = (uint32_t)current_function->m_entry_bytecode_offset;
+        if (!woort_vector_push_back(&entries, 1, &entry))
+        {
+            // Out of memory, just skip caching.
+            woort_vector_deinit(&entries);
+            return;
+        }
+    }
+
+    // Write to a temporary file then rename, so other processes never see a partial
+    // image. If rename failed (like target exists on some platforms), just give up.
+    const uint64_t token =
+        (uint64_t)(uintptr_t)&entries ^ (uint64_t)time(NULL) ^ (uint64_t)clock();
+    sprintf(temporary_path, "%s.%016llx.tmp", image_path, (unsigned long long)token);
+
+    if (woort_CodeEnv_save_image(
+        code_env, (const uint32_t*)entries.m_data, entries.m_size, temporary_path)
+        && rename(temporary_path, image_path) != 0)
+    {
+        WOORT_DEBUG("Failed to save cached image `%s`.", image_path);
+        (void)remove(temporary_path);
+    }
+
+    woort_vector_deinit(&entries);
+}
+
+WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit_cached(
+    woort_LIRCompiler* lir_compiler,
+    const char* cache_directory,
+    woort_CodeEnv** out_codeenv)
+{
+    uint64_t hash;
+    if (!woort_LIRCompiler_hash(lir_compiler, &hash))
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+
+    // "<cache_directory>/<hash>.woortimg" and "<image path>.<token>.tmp".
+    const size_t path_capacity = strlen(cache_directory) + 64;
+    char* const paths = malloc(path_capacity * 2);
+    if (paths == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+    }
+
+    char* const image_path = paths;
+    char* const temporary_path = paths + path_capacity;
+    sprintf(image_path, "%s/%016llx.woortimg", cache_directory, (unsigned long long)hash);
+
+    if (_woort_LIRCache_load(lir_compiler, image_path, out_codeenv))
+    {
+        free(paths);
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
+    }
+
+    const woort_LIRCompiler_CommitResult result =
+        woort_LIRCompiler_commit(lir_compiler, out_codeenv);
+
+    if (result == WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+        _woort_LIRCache_save(lir_compiler, *out_codeenv, image_path, temporary_path);
+
+    free(paths);
+    return result;
+}
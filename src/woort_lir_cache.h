@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+woort_lir_cache.h
+
+Content addressed cache of committed CodeEnv images, keyed by hash of compiler.
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_lir_compiler.h"
+#include "woort_codeenv.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+Should be increased when codes generated from the same LIR may change, so that
+outdated images in cache will never be hit.
+*/
+#define WOORT_LIR_CACHE_VERSION 5
+
+/*
+Hash all functions (in order), LIRs, constants, function constants, static storage
+count and codes emitted by woort_LIRCompiler_emit_code of `lir_compiler`. Registers
+and labels are hashed by their allocating order, so the hash is stable between
+processes.
+
+NOTE: Must be called before committing. Returns false if out of memory.
+*/
+WOORT_NODISCARD bool woort_LIRCompiler_hash(
+    woort_LIRCompiler* lir_compiler,
+    uint64_t* out_hash);
+
+/*
+Like woort_LIRCompiler_commit, but look up the image in `cache_directory` by hash
+of `lir_compiler` first. If hit, the image is loaded and entries of functions are
+restored without committing; else commit and save the image into cache.
+
+NOTE: Failure of reading or writing cache is ignored, just commit as usual.
+NOTE: CodeEnv loaded from cache has no reserved room, woort_LIRCompiler_commit_into
+    it will fail.
+*/
+WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit_cached(
+    woort_LIRCompiler* lir_compiler,
+    const char* cache_directory,
+    woort_CodeEnv** out_codeenv);
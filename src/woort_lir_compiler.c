@@ -6,14 +6,25 @@
 #include "woort_lir.h"
 #include "woort_lir_function.h"
 #include "woort_util.h"
+#include "woort_bitset.h"
+#include "woort_hashmap.h"
 #include "woort_codeenv.h"
+#include "woort_threads.h"
+#include "woort_peephole.h"
+#include "woort_lir_inline.h"
+#include "woort_arena.h"
+#include "woort_spin.h"
 
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+_Static_assert(sizeof(woort_Value) == sizeof(uint64_t),
+    "Constant interning compares woort_Value by its 64 bits");
+
 void woort_LIRCompiler_init(woort_LIRCompiler* lir_compiler)
 {
     woort_vector_init(
@@ -24,11 +35,27 @@ void woort_LIRCompiler_init(woort_LIRCompiler* lir_compiler)
         &lir_compiler->m_constant_storage_holder,
         sizeof(woort_Value));
 
+    woort_hashmap_init(
+        &lir_compiler->m_interned_constant_index,
+        sizeof(uint64_t),
+        sizeof(woort_LIR_ConstantStorage),
+        woort_util_u64_hash,
+        woort_util_u64_equal);
+
     lir_compiler->m_static_storage_count = 0;
 
     woort_linklist_init(
         &lir_compiler->m_function_list,
         sizeof(woort_LIRFunction));
+
+    woort_vector_init(
+        &lir_compiler->m_function_constant_list,
+        sizeof(woort_LIRCompiler_FunctionConstant));
+
+    lir_compiler->m_reserved_code_count = 0;
+    lir_compiler->m_reserved_data_count = 0;
+    lir_compiler->m_data_base = 0;
+    lir_compiler->m_static_base = 0;
 }
 
 void woort_LIRCompiler_deinit(woort_LIRCompiler* lir_compiler)
@@ -42,6 +69,9 @@ void woort_LIRCompiler_deinit(woort_LIRCompiler* lir_compiler)
     }
     woort_linklist_deinit(&lir_compiler->m_function_list);
 
+    woort_vector_deinit(&lir_compiler->m_function_constant_list);
+
+    woort_hashmap_deinit(&lir_compiler->m_interned_constant_index);
     woort_vector_deinit(&lir_compiler->m_constant_storage_holder);
     woort_vector_deinit(&lir_compiler->m_code_holder);
 }
@@ -67,6 +97,93 @@ WOORT_NODISCARD bool woort_LIRCompiler_allocate_constant(
     (void)_useless_storage;
     return true;
 }
+WOORT_NODISCARD bool woort_LIRCompiler_intern_constant(
+    woort_LIRCompiler* lir_compiler,
+    const woort_Value* value,
+    woort_LIR_ConstantStorage* out_constant_address)
+{
+    uint64_t value_bits;
+    memcpy(&value_bits, value, sizeof(value_bits));
+
+    woort_LIR_ConstantStorage* interned_constant;
+    switch (woort_hashmap_get_or_emplace(
+        &lir_compiler->m_interned_constant_index,
+        &value_bits,
+        (void**)&interned_constant))
+    {
+    case WOORT_HASHMAP_RESULT_ALREADY_EXIST:
+        *out_constant_address = *interned_constant;
+        return true;
+    case WOORT_HASHMAP_RESULT_OK:
+        break;
+    default:
+        // Out of memory.
+        return false;
+    }
+
+    woort_LIR_ConstantStorage new_constant;
+    if (!woort_LIRCompiler_allocate_constant(lir_compiler, &new_constant))
+    {
+        // Out of memory, drop the index entry just emplaced.
+        const bool removed = woort_hashmap_remove(
+            &lir_compiler->m_interned_constant_index, &value_bits);
+        assert(removed);
+        (void)removed;
+        return false;
+    }
+
+    *(woort_Value*)woort_vector_at(
+        &lir_compiler->m_constant_storage_holder, (size_t)new_constant) = *value;
+
+    *interned_constant = new_constant;
+    *out_constant_address = new_constant;
+    return true;
+}
+WOORT_NODISCARD bool _woort_LIRCompiler_allocate_function_constant(
+    woort_LIRCompiler* lir_compiler,
+    woort_LIRFunction* function,
+    bool external,
+    woort_LIR_ConstantStorage* out_constant_address)
+{
+    woort_LIRCompiler_FunctionConstant function_constant;
+    function_constant.m_function = function;
+    function_constant.m_external = external;
+
+    if (!woort_LIRCompiler_allocate_constant(
+        lir_compiler, &function_constant.m_constant))
+    {
+        // Out of memory.
+        return false;
+    }
+
+    if (!woort_vector_push_back(
+        &lir_compiler->m_function_constant_list,
+        1,
+        &function_constant))
+    {
+        // Out of memory, the allocated constant is left unused.
+        return false;
+    }
+
+    *out_constant_address = function_constant.m_constant;
+    return true;
+}
+WOORT_NODISCARD bool woort_LIRCompiler_allocate_function_constant(
+    woort_LIRCompiler* lir_compiler,
+    woort_LIRFunction* function,
+    woort_LIR_ConstantStorage* out_constant_address)
+{
+    return _woort_LIRCompiler_allocate_function_constant(
+        lir_compiler, function, false, out_constant_address);
+}
+WOORT_NODISCARD bool woort_LIRCompiler_allocate_external_function_constant(
+    woort_LIRCompiler* lir_compiler,
+    woort_LIRFunction* function,
+    woort_LIR_ConstantStorage* out_constant_address)
+{
+    return _woort_LIRCompiler_allocate_function_constant(
+        lir_compiler, function, true, out_constant_address);
+}
 WOORT_NODISCARD woort_LIR_StaticStorage woort_LIRCompiler_allocate_static_storage(
     woort_LIRCompiler* lir_compiler)
 {
@@ -110,42 +227,197 @@ WOORT_NODISCARD bool woort_LIRCompiler_add_function(
     return true;
 }
 
-void _woort_LIRCompiler_update_following_lir_offsets(
-    woort_LIR* start_lir,
-    size_t offset_delta)
+WOORT_NODISCARD bool _woort_LIRCompiler_is_jcond_externed(
+    const woort_LIR* lir)
 {
+    switch (lir->m_opnum_formal)
+    {
+    case WOORT_LIR_OPNUMFORMAL_R_LABEL:
+        return lir->m_opnums.m_r_label.m_externed;
+    case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
+        return lir->m_opnums.m_r_r_label.m_externed;
+    default:
+        return false;
+    }
+}
+
+/*
+Fill `m_fact_bytecode_offset` of all LIRs by prefix sum of their length, extended
+conditional jumps take one more instruction.
+*/
+void _woort_LIRCompiler_layout_function_lirs(
+    woort_LIR* lir,
+    size_t base_bytecode_offset,
+    const woort_Vector* /* size_t */ lir_lengths)
+{
+    size_t current_bytecode_offset = base_bytecode_offset;
+    size_t lir_index = 0;
+
     for (
-        woort_LIR* current_lir = start_lir;
+        woort_LIR* current_lir = lir;
         current_lir != NULL;
-        current_lir = woort_linklist_next(current_lir))
+        (current_lir = woort_linklist_next(current_lir)), ++lir_index)
     {
-        current_lir->m_fact_bytecode_offset += offset_delta;
+        current_lir->m_fact_bytecode_offset = current_bytecode_offset;
+
+        current_bytecode_offset +=
+            ((const size_t*)lir_lengths->m_data)[lir_index];
+
+        if (_woort_LIRCompiler_is_jcond_externed(current_lir))
+            ++current_bytecode_offset;
     }
 }
 
-bool _woort_LIRCompiler_check_and_update_jcond_lir(
-    woort_LIR* jcond_lir,
-    woort_LIR* jmp_target_lir,
-    size_t length_limit)
+/*
+A CALLNWO can reuse current frame if its result is returned right after calling,
+arguments of callee will be placed over ours, so it must not take more arguments
+than current function. Callers always push as many arguments as argument registers
+of the function (checked by _woort_LIRCompiler_check_call_argument_counts), so the
+argument area is at least that big.
+
+NOTE: The RET is kept, it may be jumped to from somewhere else.
+*/
+WOORT_NODISCARD bool _woort_LIRCompiler_is_tail_call(
+    const woort_LIRFunction* function,
+    woort_LIR* call_lir)
 {
-    assert(jmp_target_lir != NULL && jcond_lir != NULL);
+    assert(call_lir->m_opcode == WOORT_LIR_OPCODE_CALLNWO);
+
+    const woort_LIR* const next_lir = woort_linklist_next(call_lir);
 
-    if (woort_util_abs_diff(
-        jcond_lir->m_fact_bytecode_offset,
-        jmp_target_lir->m_fact_bytecode_offset) > UINT16_MAX)
+    return next_lir != NULL
+        && next_lir->m_opcode == WOORT_LIR_OPCODE_RET
+        && next_lir->m_opnums.m_RET.m_r == call_lir->m_opnums.m_CALLNWO.m_r
+        && call_lir->m_opnums.m_CALLNWO.m_count16 <= function->m_argument_registers.m_size
+        && call_lir->m_opnums.m_CALLNWO.m_c <= UINT32_MAX;
+}
+
+int _woort_LIRCompiler_compare_lir_pointer(const void* a, const void* b)
+{
+    const uintptr_t pa = (uintptr_t)*(const woort_LIR* const*)a;
+    const uintptr_t pb = (uintptr_t)*(const woort_LIR* const*)b;
+
+    return pa < pb ? -1 : pa > pb ? 1 : 0;
+}
+
+/*
+Values pushed for calling must be consumed before any jump, label or return, so max
+push depth of function can be calculated by walking LIRs once. Then stack room can be
+assured at function entry, and pushes need not to be checked one by one.
+
+Returns false if push depth cannot be decided statically, pushes should be checked.
+*/
+WOORT_NODISCARD bool _woort_LIRCompiler_max_push_depth(
+    woort_LIRFunction* function,
+    woort_Arena* scratch_arena,
+    size_t* out_max_push_depth)
+{
+    // LIRs which labels bound to, sorted for searching.
+    woort_Vector /* woort_LIR* */ label_lirs;
+    woort_vector_init_with_arena(&label_lirs, sizeof(woort_LIR*), scratch_arena);
+
+    for (
+        woort_LIRLabel* label = woort_linklist_iter(&function->m_label_list);
+        label != NULL;
+        label = woort_linklist_next(label))
+    {
+        if (label->m_binded_lir != NULL
+            && !woort_vector_push_back(&label_lirs, 1, &label->m_binded_lir))
+        {
+            // Out of memory.
+            woort_vector_deinit(&label_lirs);
+            return false;
+        }
+    }
+    if (label_lirs.m_size != 0)
+        qsort(
+            label_lirs.m_data,
+            label_lirs.m_size,
+            sizeof(woort_LIR*),
+            _woort_LIRCompiler_compare_lir_pointer);
+
+    size_t push_depth = 0;
+    size_t max_push_depth = 0;
+    bool decided = true;
+
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
+        decided && current_lir != NULL;
+        current_lir = woort_linklist_next(current_lir))
     {
-        // Update all following lirs' fact bytecode offset.
-        _woort_LIRCompiler_update_following_lir_offsets(
-            woort_linklist_next(jcond_lir), 1);
+        if (push_depth != 0
+            && label_lirs.m_size != 0
+            && bsearch(
+                &current_lir,
+                label_lirs.m_data,
+                label_lirs.m_size,
+                sizeof(woort_LIR*),
+                _woort_LIRCompiler_compare_lir_pointer) != NULL)
+        {
+            // Might be jumped to with different depth.
+            decided = false;
+            break;
+        }
 
-        return true;
+        switch (current_lir->m_opcode)
+        {
+        case WOORT_LIR_OPCODE_PUSH:
+        case WOORT_LIR_OPCODE_PUSHCS:
+            if (++push_depth > max_push_depth)
+                max_push_depth = push_depth;
+            break;
+        case WOORT_LIR_OPCODE_POP:
+        case WOORT_LIR_OPCODE_POPCS:
+            if (push_depth == 0)
+                decided = false;
+            else
+                --push_depth;
+            break;
+        case WOORT_LIR_OPCODE_CALLNWO:
+            if (push_depth < current_lir->m_opnums.m_CALLNWO.m_count16)
+                // Arguments pushed somewhere else.
+                decided = false;
+            else
+                push_depth -= current_lir->m_opnums.m_CALLNWO.m_count16;
+            break;
+        case WOORT_LIR_OPCODE_JMP:
+        case WOORT_LIR_OPCODE_JNZ:
+        case WOORT_LIR_OPCODE_JZ:
+        case WOORT_LIR_OPCODE_JEQ:
+        case WOORT_LIR_OPCODE_JNEQ:
+            if (push_depth != 0)
+                decided = false;
+            break;
+        case WOORT_LIR_OPCODE_RET:
+            // Stack is restored by RET, code after it can only be reached by jumping.
+            push_depth = 0;
+            break;
+        case WOORT_LIR_OPCODE_CALLNFP:
+        case WOORT_LIR_OPCODE_CALL:
+        case WOORT_LIR_OPCODE_MKARR:
+        case WOORT_LIR_OPCODE_MKMAP:
+        case WOORT_LIR_OPCODE_MKSTRUCT:
+        case WOORT_LIR_OPCODE_MKCLOSURE:
+            // Not supported yet, stack effect unknown.
+            decided = false;
+            break;
+        default:
+            break;
+        }
     }
-    return false;
+    woort_vector_deinit(&label_lirs);
+
+    if (!decided
+        || max_push_depth > (WOORT_BYTECODE_ABC24_MASK >> WOORT_BYTECODE_ABC24_SHIFT))
+        return false;
+
+    *out_max_push_depth = max_push_depth;
+    return true;
 }
 
 bool _woort_LIRCompiler_commit_function_codes(
-    woort_LIRCompiler* lir_compiler,
-    woort_LIRFunction* function)
+    woort_LIRFunction* function,
+    woort_Vector* /* woort_Bytecode */ code_holder)
 {
     for (
         woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
@@ -153,13 +425,22 @@ bool _woort_LIRCompiler_commit_function_codes(
         current_lir = woort_linklist_next(current_lir))
     {
         // Emit bytecode.
-        if (!woort_LIR_emit_to_lir_compiler(current_lir, lir_compiler))
+        if (!woort_LIR_emit_to_code_holder(current_lir, code_holder))
             // Out of memory/
             return false;
     }
     return true;
 }
 
+void woort_LIRCompiler_reserve_for_extending(
+    woort_LIRCompiler* lir_compiler,
+    size_t code_count,
+    size_t data_count)
+{
+    lir_compiler->m_reserved_code_count = code_count;
+    lir_compiler->m_reserved_data_count = data_count;
+}
+
 WOORT_NODISCARD bool woort_LIRCompiler_emit_code(
     woort_LIRCompiler* lir_compiler,
     woort_Bytecode bc)
@@ -170,10 +451,21 @@ WOORT_NODISCARD bool woort_LIRCompiler_emit_code(
         &bc);
 }
 
+/*
+Commit a function into `code_holder`, which holds codes of this function only.
+Temporary memory is allocated from `scratch->m_arena`, caller resets it after committing.
+
+NOTE: This method will be invoked by multiple threads at the same time for different
+    functions, it must not modify anything shared in the compiler.
+*/
 woort_LIRCompiler_CommitResult _woort_LIRCompiler_commit_function(
-    woort_LIRCompiler* lir_compiler,
-    woort_LIRFunction* function)
+    const woort_LIRCompiler* lir_compiler,
+    woort_LIRFunction* function,
+    woort_LIRFunction_Scratch* scratch,
+    woort_Vector* /* woort_Bytecode */ code_holder)
 {
+    woort_Arena* const scratch_arena = &scratch->m_arena;
+
     woort_LIR* const lir =
         woort_linklist_iter(&function->m_lir_list);
 
@@ -213,29 +505,45 @@ woort_LIRCompiler_CommitResult _woort_LIRCompiler_commit_function(
 
     /* Register allocation */
     size_t stack_usage;
-    if (!woort_LIRFunction_register_allocation(function, &stack_usage))
+    if (!woort_LIRFunction_register_allocation(function, scratch, &stack_usage))
     {
         WOORT_DEBUG("Failed to allocate registers.");
         return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_REGISTER_ALLOCATION;
     }
 
+    /* Push depth analysis */
+    size_t max_push_depth = 0;
+    const bool push_depth_decided =
+        _woort_LIRCompiler_max_push_depth(function, scratch_arena, &max_push_depth);
+
     /* Commit */
-    // 0. Mark base offset for this function.
-    size_t current_bytecode_offset = lir_compiler->m_code_holder.m_size;
+    // 0. Update static storage references and calculate LIR lengths.
+    woort_Vector /* size_t */ lir_lengths;
+    woort_vector_init_with_arena(&lir_lengths, sizeof(size_t), scratch_arena);
+
     for (
         woort_LIR* current_lir = lir;
         current_lir != NULL;
         current_lir = woort_linklist_next(current_lir))
     {
         // Update static storage references.
-        woort_LIR_update_static_storage(
-            current_lir,
-            lir_compiler->m_constant_storage_holder.m_size);
+        woort_LIR_update_static_storage(current_lir, lir_compiler->m_static_base);
 
-        current_lir->m_fact_bytecode_offset = current_bytecode_offset;
+        if (current_lir->m_opcode == WOORT_LIR_OPCODE_CALLNWO)
+            current_lir->m_opnums.m_CALLNWO.m_tail_call =
+                _woort_LIRCompiler_is_tail_call(function, current_lir);
+        else if (current_lir->m_opcode == WOORT_LIR_OPCODE_PUSH)
+            current_lir->m_opnums.m_PUSH.m_stack_assured = push_depth_decided;
 
-        current_bytecode_offset +=
+        const size_t lir_length =
             woort_LIR_ir_length_exclude_jmp(current_lir);
+
+        if (!woort_vector_push_back(&lir_lengths, 1, &lir_length))
+        {
+            // Out of memory.
+            woort_vector_deinit(&lir_lengths);
+            return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+        }
     }
 
     // 1. Fetch & Update and insert extended jump instructions.
@@ -244,9 +552,14 @@ woort_LIRCompiler_CommitResult _woort_LIRCompiler_commit_function(
     Because conditional jump instructions have other operands occupying instruction space,
     it is easy for the target location to exceed the jump range limit of the instruction.
     Therefore, we need to record these instructions and check if they need to be updated.
+
+        Extending a jump only makes the code longer, so we start from all short jumps, and
+    in each round, layout all LIRs once by prefix sum, then extend all jumps which are out
+    of range. Repeat until no more jump need to be extended, each round costs O(n).
     */
     woort_Vector /* woort_LIR* */ jcond_lir_collection;
-    woort_vector_init(&jcond_lir_collection, sizeof(woort_LIR*));
+    woort_vector_init_with_arena(
+        &jcond_lir_collection, sizeof(woort_LIR*), scratch_arena);
     {
         for (
             woort_LIR* current_lir = lir;
@@ -263,6 +576,7 @@ woort_LIRCompiler_CommitResult _woort_LIRCompiler_commit_function(
                 {
                     // Failed to record jcond lir.
                     woort_vector_deinit(&jcond_lir_collection);
+                    woort_vector_deinit(&lir_lengths);
                     return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
                 }
                 break;
@@ -274,77 +588,95 @@ woort_LIRCompiler_CommitResult _woort_LIRCompiler_commit_function(
             }
         }
 
-        // Ok, check if the jump range is exceeded.
-        for (size_t i = 0; i < jcond_lir_collection.m_size; )
+        // Function codes begin with PUSHRCHK if stack is used, and ASSURESSZ if pushed.
+        const size_t base_bytecode_offset =
+            (stack_usage > 0 ? 1 : 0) + (max_push_depth > 0 ? 1 : 0);
+
+        bool jcond_externed;
+        do
         {
-            woort_LIR* const current_jcond_lir =
-                *(woort_LIR**)woort_vector_at(&jcond_lir_collection, i);
+            _woort_LIRCompiler_layout_function_lirs(
+                lir, base_bytecode_offset, &lir_lengths);
 
-            switch (current_jcond_lir->m_opnum_formal)
+            jcond_externed = false;
+
+            // Ok, check if the jump range is exceeded.
+            for (size_t i = 0; i < jcond_lir_collection.m_size; ++i)
             {
-            case WOORT_LIR_OPNUMFORMAL_R_LABEL:
-                if (!current_jcond_lir->m_opnums.m_r_label.m_externed)
+                woort_LIR* const current_jcond_lir =
+                    *(woort_LIR**)woort_vector_at(&jcond_lir_collection, i);
+
+                /*
+                Far registers are loaded before the jump command, so jumping back may be
+                longer than the distance from this LIR by one MOV for each register.
+                */
+                bool* externed;
+                woort_LIRLabel* target_label;
+                size_t length_limit;
+
+                switch (current_jcond_lir->m_opnum_formal)
                 {
-                    woort_LIR* const jmp_target_lir =
-                        current_jcond_lir->m_opnums.m_r_label.m_label->m_binded_lir;
-
-                    if (_woort_LIRCompiler_check_and_update_jcond_lir(
-                        current_jcond_lir,
-                        jmp_target_lir,
-                        UINT16_MAX))
-                    {
-                        // Too far to jump directly, need to extern.
-                        current_jcond_lir->m_opnums.m_r_label.m_externed = true;
-
-                        // Restart checking from the beginning.
-                        i = 0;
-                        continue;
-                    }
+                case WOORT_LIR_OPNUMFORMAL_R_LABEL:
+                    externed = &current_jcond_lir->m_opnums.m_r_label.m_externed;
+                    target_label = current_jcond_lir->m_opnums.m_r_label.m_label;
+                    length_limit = UINT16_MAX - 1;
+                    break;
+                case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
+                    externed = &current_jcond_lir->m_opnums.m_r_r_label.m_externed;
+                    target_label = current_jcond_lir->m_opnums.m_r_r_label.m_label;
+                    length_limit = UINT8_MAX - 2;
+                    break;
+                default:
+                    WOORT_DEBUG(
+                        "Internal error: invalid jcond lir opnum formal `%d`.",
+                        current_jcond_lir->m_opnum_formal);
+                    abort();
                 }
-                break;
-            case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
-                if (!current_jcond_lir->m_opnums.m_r_r_label.m_externed)
+
+                if (*externed)
+                    continue;
+
+                assert(target_label->m_binded_lir != NULL);
+
+                if (woort_util_abs_diff(
+                    current_jcond_lir->m_fact_bytecode_offset,
+                    target_label->m_binded_lir->m_fact_bytecode_offset) > length_limit)
                 {
-                    woort_LIR* const jmp_target_lir =
-                        current_jcond_lir->m_opnums.m_r_r_label.m_label->m_binded_lir;
-
-                    if (_woort_LIRCompiler_check_and_update_jcond_lir(
-                        current_jcond_lir,
-                        jmp_target_lir,
-                        UINT8_MAX))
-                    {
-                        // Too far to jump directly, need to extern.
-                        current_jcond_lir->m_opnums.m_r_r_label.m_externed = true;
-
-                        // Restart checking from the beginning.
-                        i = 0;
-                        continue;
-                    }
+                    // Too far to jump directly, need to extern.
+                    *externed = true;
+                    jcond_externed = true;
                 }
-                break;
-            default:
-                WOORT_DEBUG(
-                    "Internal error: invalid jcond lir opnum formal `%d`.",
-                    current_jcond_lir->m_opnum_formal);
-                abort();
             }
-
-            // Go ahead~!
-            ++i;
-        }
+            // Layout again if any jump extended, offsets have been changed.
+        } while (jcond_externed);
     }
     woort_vector_deinit(&jcond_lir_collection);
+    woort_vector_deinit(&lir_lengths);
 
     // 2. All jobs done, emit bytecodes.
     if (stack_usage > 0)
     {
         assert(stack_usage < UINT16_MAX);
 
-        // PUSH RESERVE STACK_USAGE
-        if (!woort_LIRCompiler_emit_code(
-            lir_compiler,
-            woort_OpcodeFormal_OP6_M2_BC16_cons(
-                WOORT_OPCODE_PUSH, 0, stack_usage)))
+        // PUSHRCHK STACK_USAGE
+        const woort_Bytecode push_reserve =
+            woort_OpCodeFormal_cons(
+                OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 0, stack_usage);
+
+        if (!woort_vector_push_back(code_holder, 1, &push_reserve))
+        {
+            // Out of memory.
+            return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+        }
+    }
+    if (max_push_depth > 0)
+    {
+        // ASSURESSZ MAX_PUSH_DEPTH, pushes in function are unchecked.
+        const woort_Bytecode assure_stack_size =
+            woort_OpCodeFormal_cons(
+                OP6_M2_ABC24, WOORT_OPCODE_PUSH, 0, max_push_depth);
+
+        if (!woort_vector_push_back(code_holder, 1, &assure_stack_size))
         {
             // Out of memory.
             return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
@@ -352,10 +684,637 @@ woort_LIRCompiler_CommitResult _woort_LIRCompiler_commit_function(
     }
 
     if (!_woort_LIRCompiler_commit_function_codes(
-        lir_compiler, function))
+        function, code_holder))
+    {
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+    }
+
+    // 3. Peephole optimize.
+    /*
+    NOTE: Instructions may be removed here, `m_fact_bytecode_offset` of LIRs are
+        not updated and should not be used after this step.
+    */
+    if (!woort_peephole_optimize(code_holder, scratch_arena))
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+
+    return WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
+}
+
+/*
+Functions are committed in parallel only if there are enough of them, starting
+threads costs more than committing a few small functions.
+*/
+#define WOORT_LIRCOMPILER_PARALLEL_COMMIT_MIN_FUNCTION_COUNT 16
+
+/*
+Codes of small functions are kept in the job itself, no allocation needed.
+*/
+#define WOORT_LIRCOMPILER_JOB_CODE_BUFFER_COUNT 32
+
+typedef struct _woort_LIRCompiler_FunctionCommitJob
+{
+    woort_LIRFunction*              m_function;
+    woort_Vector /* woort_Bytecode */
+                                    m_code_holder;
+    woort_LIRCompiler_CommitResult  m_result;
+
+    woort_Bytecode                  m_code_buffer[WOORT_LIRCOMPILER_JOB_CODE_BUFFER_COUNT];
+
+} _woort_LIRCompiler_FunctionCommitJob;
+
+typedef struct _woort_LIRCompiler_FunctionCommitContext
+{
+    const woort_LIRCompiler*                m_lir_compiler;
+    _woort_LIRCompiler_FunctionCommitJob*   m_jobs;
+
+    /*
+    One scratch for each worker, taken by job and given back after reset, so memory
+    is reused by following functions instead of allocated again.
+    */
+    woort_Spinlock                          m_scratch_lock;
+    woort_LIRFunction_Scratch**             m_free_scratches;
+    size_t                                  m_free_scratch_count;
+
+} _woort_LIRCompiler_FunctionCommitContext;
+
+static void _woort_LIRCompiler_function_commit_job(size_t job_index, void* user_data)
+{
+    _woort_LIRCompiler_FunctionCommitContext* const context = user_data;
+    _woort_LIRCompiler_FunctionCommitJob* const job = &context->m_jobs[job_index];
+
+    // No more jobs than workers running at the same time, there is always a free one.
+    woort_spinlock_lock(&context->m_scratch_lock);
+    assert(context->m_free_scratch_count > 0);
+    woort_LIRFunction_Scratch* const scratch =
+        context->m_free_scratches[--context->m_free_scratch_count];
+    woort_spinlock_unlock(&context->m_scratch_lock);
+
+    job->m_result = _woort_LIRCompiler_commit_function(
+        context->m_lir_compiler,
+        job->m_function,
+        scratch,
+        &job->m_code_holder);
+
+    woort_arena_reset(&scratch->m_arena);
+
+    woort_spinlock_lock(&context->m_scratch_lock);
+    context->m_free_scratches[context->m_free_scratch_count++] = scratch;
+    woort_spinlock_unlock(&context->m_scratch_lock);
+}
+
+/*
+Concatenate codes of all functions into compiler's code holder in order, and record
+the entry offset of each function.
+*/
+woort_LIRCompiler_CommitResult _woort_LIRCompiler_link_function_codes(
+    woort_LIRCompiler* lir_compiler,
+    _woort_LIRCompiler_FunctionCommitJob* jobs,
+    size_t job_count)
+{
+    size_t total_code_count = lir_compiler->m_code_holder.m_size;
+    for (size_t i = 0; i < job_count; ++i)
+    {
+        // Report the failure of the first function, as serial committing does.
+        if (jobs[i].m_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+            return jobs[i].m_result;
+
+        total_code_count += jobs[i].m_code_holder.m_size;
+    }
+
+    if (!woort_vector_reserve(&lir_compiler->m_code_holder, total_code_count))
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+
+    for (size_t i = 0; i < job_count; ++i)
+    {
+        jobs[i].m_function->m_entry_bytecode_offset =
+            lir_compiler->m_code_holder.m_size;
+
+        if (jobs[i].m_code_holder.m_size == 0)
+            continue;
+
+        if (!woort_vector_push_back(
+            &lir_compiler->m_code_holder,
+            jobs[i].m_code_holder.m_size,
+            jobs[i].m_code_holder.m_data))
+        {
+            // Should not happen, memory has been reserved.
+            return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+        }
+    }
+    return WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
+}
+
+/*
+Merge constants with the same value and compact the constant pool, all references
+to constants are remapped. Function constants are kept as is, their values are
+placeholders until all functions committed.
+*/
+WOORT_NODISCARD bool _woort_LIRCompiler_compact_constants(
+    woort_LIRCompiler* lir_compiler)
+{
+    const size_t constant_count = lir_compiler->m_constant_storage_holder.m_size;
+    woort_Value* const constants =
+        (woort_Value*)lir_compiler->m_constant_storage_holder.m_data;
+
+    if (constant_count <= 1)
+        return true;
+
+    woort_Bitset function_constant_mask;
+    if (!woort_bitset_init(&function_constant_mask, constant_count))
+        return false;
+
+    for (size_t i = 0; i < lir_compiler->m_function_constant_list.m_size; ++i)
+    {
+        const woort_LIRCompiler_FunctionConstant* const function_constant =
+            woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+        const bool masked = woort_bitset_set(
+            &function_constant_mask, (size_t)function_constant->m_constant);
+        assert(masked);
+        (void)masked;
+    }
+
+    woort_LIR_ConstantStorage* const constant_remap =
+        malloc(constant_count * sizeof(woort_LIR_ConstantStorage));
+    if (constant_remap == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        woort_bitset_deinit(&function_constant_mask);
+        return false;
+    }
+
+    woort_HashMap /* uint64_t -> woort_LIR_ConstantStorage */ value_index;
+    woort_hashmap_init(
+        &value_index,
+        sizeof(uint64_t),
+        sizeof(woort_LIR_ConstantStorage),
+        woort_util_u64_hash,
+        woort_util_u64_equal);
+
+    // Values are moved forward in place, new index never goes after the old one.
+    size_t compacted_count = 0;
+    bool succeed = true;
+    for (size_t i = 0; i < constant_count; ++i)
+    {
+        const woort_Value value = constants[i];
+
+        if (!woort_bitset_test(&function_constant_mask, i))
+        {
+            uint64_t value_bits;
+            memcpy(&value_bits, &value, sizeof(value_bits));
+
+            woort_LIR_ConstantStorage* existing_constant;
+            const woort_hashmap_Result result = woort_hashmap_get_or_emplace(
+                &value_index, &value_bits, (void**)&existing_constant);
+
+            if (result == WOORT_HASHMAP_RESULT_ALREADY_EXIST)
+            {
+                constant_remap[i] = *existing_constant;
+                continue;
+            }
+            else if (result != WOORT_HASHMAP_RESULT_OK)
+            {
+                succeed = false;
+                break;
+            }
+            *existing_constant = (woort_LIR_ConstantStorage)compacted_count;
+        }
+
+        constant_remap[i] = (woort_LIR_ConstantStorage)compacted_count;
+        constants[compacted_count++] = value;
+    }
+
+    woort_hashmap_deinit(&value_index);
+    woort_bitset_deinit(&function_constant_mask);
+
+    if (!succeed)
+    {
+        // Out of memory, like other failures in committing, compiler cannot be used any more.
+        free(constant_remap);
+        return false;
+    }
+
+    if (compacted_count != constant_count)
+    {
+        for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+            NULL != current_function;
+            current_function = woort_linklist_next(current_function))
+        {
+            for (woort_LIR* current_lir = woort_linklist_iter(&current_function->m_lir_list);
+                NULL != current_lir;
+                current_lir = woort_linklist_next(current_lir))
+            {
+                woort_LIR_update_constant_storage(current_lir, constant_remap);
+            }
+        }
+
+        for (size_t i = 0; i < lir_compiler->m_function_constant_list.m_size; ++i)
+        {
+            woort_LIRCompiler_FunctionConstant* const function_constant =
+                woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+            function_constant->m_constant = constant_remap[function_constant->m_constant];
+        }
+
+        // Only shrinks, no need to reallocate.
+        lir_compiler->m_constant_storage_holder.m_size = compacted_count;
+    }
+
+    free(constant_remap);
+
+    // Indices in interned constant index are outdated.
+    woort_hashmap_clear(&lir_compiler->m_interned_constant_index);
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_LIRCompiler_is_calling_itself(
+    woort_HashMap* /* uint64_t -> woort_LIRFunction* */ function_constant_index,
+    woort_LIRFunction* function)
+{
+    for (woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
+        NULL != current_lir;
+        current_lir = woort_linklist_next(current_lir))
+    {
+        if (current_lir->m_opcode != WOORT_LIR_OPCODE_CALLNWO)
+            continue;
+
+        const uint64_t constant = current_lir->m_opnums.m_CALLNWO.m_c;
+
+        woort_LIRFunction** calling_function;
+        if (woort_hashmap_find(function_constant_index, &constant, (void**)&calling_function)
+            && *calling_function == function)
+            return true;
+    }
+    return false;
+}
+
+/*
+Inline small script functions into their callers, calls in the inlined bodies are
+not inlined again, so mutual recursion will not make it endless.
+*/
+WOORT_NODISCARD bool _woort_LIRCompiler_inline_functions(
+    woort_LIRCompiler* lir_compiler)
+{
+    if (lir_compiler->m_function_constant_list.m_size == 0)
+        return true;
+
+    // Only functions which are inlinable are indexed, external functions are not.
+    woort_HashMap /* uint64_t -> woort_LIRFunction* */ function_constant_index;
+    woort_hashmap_init(
+        &function_constant_index,
+        sizeof(uint64_t),
+        sizeof(woort_LIRFunction*),
+        woort_util_u64_hash,
+        woort_util_u64_equal);
+
+    bool succeed = true;
+    for (size_t i = 0; succeed && i < lir_compiler->m_function_constant_list.m_size; ++i)
+    {
+        const woort_LIRCompiler_FunctionConstant* const function_constant =
+            woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+        if (function_constant->m_external)
+            continue;
+
+        const uint64_t constant = function_constant->m_constant;
+        if (WOORT_HASHMAP_RESULT_OUT_OF_MEMORY == woort_hashmap_insert(
+            &function_constant_index, &constant, &function_constant->m_function))
+            succeed = false;
+    }
+
+    // Recursive functions cannot be inlined, it must be checked before any inlining.
+    for (size_t i = 0; succeed && i < lir_compiler->m_function_constant_list.m_size; ++i)
+    {
+        const woort_LIRCompiler_FunctionConstant* const function_constant =
+            woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+        if (!function_constant->m_external
+            && _woort_LIRCompiler_is_calling_itself(
+            &function_constant_index, function_constant->m_function))
+        {
+            // Each function constant is indexed once, it must be found.
+            const uint64_t constant = function_constant->m_constant;
+            const bool removed = woort_hashmap_remove(&function_constant_index, &constant);
+            assert(removed);
+            (void)removed;
+        }
+    }
+
+    for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+        succeed && NULL != current_function;
+        current_function = woort_linklist_next(current_function))
+    {
+        for (woort_LIR* current_lir = woort_linklist_iter(&current_function->m_lir_list);
+            NULL != current_lir;)
+        {
+            // Inlined body is placed before next LIR, skip it.
+            woort_LIR* const next_lir = woort_linklist_next(current_lir);
+
+            if (current_lir->m_opcode == WOORT_LIR_OPCODE_CALLNWO)
+            {
+                const uint64_t constant = current_lir->m_opnums.m_CALLNWO.m_c;
+
+                woort_LIRFunction** callee;
+                bool inlined;
+                if (woort_hashmap_find(&function_constant_index, &constant, (void**)&callee)
+                    && !woort_LIRFunction_inline_call(
+                        current_function, current_lir, *callee, &inlined))
+                {
+                    succeed = false;
+                    break;
+                }
+            }
+            current_lir = next_lir;
+        }
+    }
+
+    woort_hashmap_deinit(&function_constant_index);
+    return succeed;
+}
+
+/*
+Rebase all constant references by `lir_compiler->m_data_base`, static storages are
+rebased when committing functions.
+*/
+WOORT_NODISCARD bool _woort_LIRCompiler_rebase_constants(
+    woort_LIRCompiler* lir_compiler)
+{
+    const size_t constant_count = lir_compiler->m_constant_storage_holder.m_size;
+    if (lir_compiler->m_data_base == 0 || constant_count == 0)
+        return true;
+
+    woort_LIR_ConstantStorage* const constant_remap =
+        malloc(constant_count * sizeof(woort_LIR_ConstantStorage));
+    if (constant_remap == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        return false;
+    }
+
+    for (size_t i = 0; i < constant_count; ++i)
+        constant_remap[i] = (woort_LIR_ConstantStorage)(lir_compiler->m_data_base + i);
+
+    for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+        NULL != current_function;
+        current_function = woort_linklist_next(current_function))
+    {
+        for (woort_LIR* current_lir = woort_linklist_iter(&current_function->m_lir_list);
+            NULL != current_lir;
+            current_lir = woort_linklist_next(current_lir))
+        {
+            woort_LIR_update_constant_storage(current_lir, constant_remap);
+        }
+    }
+
+    for (size_t i = 0; i < lir_compiler->m_function_constant_list.m_size; ++i)
     {
+        woort_LIRCompiler_FunctionConstant* const function_constant =
+            woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+        function_constant->m_constant = constant_remap[function_constant->m_constant];
+    }
+
+    free(constant_remap);
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_LIRCompiler_has_external_function_constant(
+    woort_LIRCompiler* lir_compiler)
+{
+    for (size_t i = 0; i < lir_compiler->m_function_constant_list.m_size; ++i)
+    {
+        const woort_LIRCompiler_FunctionConstant* const function_constant =
+            woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+        if (function_constant->m_external)
+            return true;
+    }
+    return false;
+}
+
+/*
+Check that each CALLNWO with a function constant pushes enough arguments for the
+callee, see woort_LIRFunction_get_argument_register. Only for assertion, returns true
+if it cannot be checked.
+*/
+WOORT_NODISCARD bool _woort_LIRCompiler_check_call_argument_counts(
+    woort_LIRCompiler* lir_compiler)
+{
+    if (lir_compiler->m_function_constant_list.m_size == 0)
+        return true;
+
+    woort_HashMap /* uint64_t -> woort_LIRFunction* */ function_constant_index;
+    woort_hashmap_init(
+        &function_constant_index,
+        sizeof(uint64_t),
+        sizeof(woort_LIRFunction*),
+        woort_util_u64_hash,
+        woort_util_u64_equal);
+
+    bool checked = true;
+    for (size_t i = 0; i < lir_compiler->m_function_constant_list.m_size; ++i)
+    {
+        const woort_LIRCompiler_FunctionConstant* const function_constant =
+            woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+        const uint64_t constant = function_constant->m_constant;
+        if (WOORT_HASHMAP_RESULT_OUT_OF_MEMORY == woort_hashmap_insert(
+            &function_constant_index, &constant, &function_constant->m_function))
+        {
+            // Out of memory, skip checking.
+            woort_hashmap_deinit(&function_constant_index);
+            return true;
+        }
+    }
+
+    for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+        checked && NULL != current_function;
+        current_function = woort_linklist_next(current_function))
+    {
+        for (woort_LIR* current_lir = woort_linklist_iter(&current_function->m_lir_list);
+            NULL != current_lir;
+            current_lir = woort_linklist_next(current_lir))
+        {
+            if (current_lir->m_opcode != WOORT_LIR_OPCODE_CALLNWO)
+                continue;
+
+            const uint64_t constant = current_lir->m_opnums.m_CALLNWO.m_c;
+
+            woort_LIRFunction** callee;
+            if (woort_hashmap_find(&function_constant_index, &constant, (void**)&callee)
+                && current_lir->m_opnums.m_CALLNWO.m_count16
+                    < (*callee)->m_argument_registers.m_size)
+            {
+                WOORT_DEBUG("Arguments pushed are less than callee's argument registers.");
+                checked = false;
+                break;
+            }
+        }
+    }
+
+    woort_hashmap_deinit(&function_constant_index);
+    return checked;
+}
+
+/*
+Inline small functions and merge constants, the constant count is final after this,
+so that data area can be laid out before committing codes.
+*/
+WOORT_NODISCARD woort_LIRCompiler_CommitResult _woort_LIRCompiler_prepare_codes(
+    woort_LIRCompiler* lir_compiler)
+{
+    assert(_woort_LIRCompiler_check_call_argument_counts(lir_compiler));
+
+    // Inline before constants merged, calls are found by constants.
+    if (!_woort_LIRCompiler_inline_functions(lir_compiler)
+        || !_woort_LIRCompiler_compact_constants(lir_compiler))
         return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+
+    return WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
+}
+
+/*
+Commit all functions into compiler's code holder, constants are placed from
+`lir_compiler->m_data_base` and static storages from `lir_compiler->m_static_base` in
+data area. Relocations of function constants are recorded into `out_relocations`,
+external ones are left in function constant list.
+
+NOTE: Must be called after _woort_LIRCompiler_prepare_codes.
+*/
+WOORT_NODISCARD woort_LIRCompiler_CommitResult _woort_LIRCompiler_commit_codes(
+    woort_LIRCompiler* lir_compiler,
+    woort_Vector* /* woort_CodeEnv_Relocation */ out_relocations)
+{
+    // 1. Rebase constants, static storages are rebased when committing functions.
+    if (!_woort_LIRCompiler_rebase_constants(lir_compiler))
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+
+    size_t function_count = 0;
+    for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+        NULL != current_function;
+        current_function = woort_linklist_next(current_function))
+    {
+        ++function_count;
+    }
+
+    size_t worker_count =
+        function_count >= WOORT_LIRCOMPILER_PARALLEL_COMMIT_MIN_FUNCTION_COUNT
+            ? woort_thread_hardware_concurrency()
+            : 1;
+
+    _woort_LIRCompiler_FunctionCommitJob* jobs = NULL;
+    woort_LIRFunction_Scratch* scratches = NULL;
+    woort_LIRFunction_Scratch** free_scratches = NULL;
+    if (function_count > 0)
+    {
+        jobs = malloc(function_count * sizeof(_woort_LIRCompiler_FunctionCommitJob));
+        scratches = malloc(worker_count * sizeof(woort_LIRFunction_Scratch));
+        free_scratches = malloc(worker_count * sizeof(woort_LIRFunction_Scratch*));
+        if (jobs == NULL || scratches == NULL || free_scratches == NULL)
+        {
+            WOORT_DEBUG("Out of memory");
+            free(free_scratches);
+            free(scratches);
+            free(jobs);
+            return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+        }
+
+        size_t job_index = 0;
+        for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+            NULL != current_function;
+            current_function = woort_linklist_next(current_function), ++job_index)
+        {
+            jobs[job_index].m_function = current_function;
+            woort_vector_init_with_buffer(
+                &jobs[job_index].m_code_holder,
+                sizeof(woort_Bytecode),
+                jobs[job_index].m_code_buffer,
+                WOORT_LIRCOMPILER_JOB_CODE_BUFFER_COUNT);
+            jobs[job_index].m_result = WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
+        }
+
+        // Each worker needs a scratch, run with less workers if cannot prepare enough.
+        size_t scratch_count = 0;
+        for (; scratch_count < worker_count; ++scratch_count)
+        {
+            if (!woort_LIRFunction_scratch_init(&scratches[scratch_count]))
+                break;
+
+            free_scratches[scratch_count] = &scratches[scratch_count];
+        }
+        if (scratch_count == 0)
+        {
+            free(free_scratches);
+            free(scratches);
+            free(jobs);
+            return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+        }
+        worker_count = scratch_count;
+    }
+
+    // 2. Allocate registers & encode each function into its own code holder.
+    _woort_LIRCompiler_FunctionCommitContext context;
+    context.m_lir_compiler = lir_compiler;
+    context.m_jobs = jobs;
+    context.m_free_scratches = free_scratches;
+    context.m_free_scratch_count = worker_count;
+    woort_spinlock_init(&context.m_scratch_lock);
+
+    woort_thread_parallel_for(
+        function_count,
+        worker_count,
+        _woort_LIRCompiler_function_commit_job,
+        &context);
+
+    woort_spinlock_deinit(&context.m_scratch_lock);
+    if (function_count > 0)
+    {
+        for (size_t i = 0; i < worker_count; ++i)
+            woort_LIRFunction_scratch_deinit(&scratches[i]);
+    }
+    free(free_scratches);
+    free(scratches);
+
+    // 3. Concatenate function codes.
+    const woort_LIRCompiler_CommitResult link_result =
+        _woort_LIRCompiler_link_function_codes(lir_compiler, jobs, function_count);
+
+    for (size_t i = 0; i < function_count; ++i)
+        woort_vector_deinit(&jobs[i].m_code_holder);
+    free(jobs);
+
+    if (link_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+        // Failed.
+        return link_result;
+
+    // 4. Function constants will be patched by CodeEnv once code address is fixed.
+    size_t external_count = 0;
+    for (size_t i = 0; i < lir_compiler->m_function_constant_list.m_size; ++i)
+    {
+        const woort_LIRCompiler_FunctionConstant* const function_constant =
+            woort_vector_at(&lir_compiler->m_function_constant_list, i);
+
+        assert(function_constant->m_constant - lir_compiler->m_data_base
+            < lir_compiler->m_constant_storage_holder.m_size);
+
+        if (function_constant->m_external)
+        {
+            // Keep it to be resolved after all linked compilers committed.
+            *(woort_LIRCompiler_FunctionConstant*)woort_vector_at(
+                &lir_compiler->m_function_constant_list, external_count++) =
+                *function_constant;
+            continue;
+        }
+
+        const woort_CodeEnv_Relocation relocation = {
+            .m_constant = (uint32_t)function_constant->m_constant,
+            .m_code_offset = (uint32_t)function_constant->m_function->m_entry_bytecode_offset,
+        };
+        if (!woort_vector_push_back(out_relocations, 1, &relocation))
+            // Out of memory.
+            return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
     }
+    lir_compiler->m_function_constant_list.m_size = external_count;
 
     return WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
 }
@@ -364,30 +1323,282 @@ WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit(
     woort_LIRCompiler* lir_compiler,
     woort_CodeEnv** out_codeenv)
 {
-    woort_LIRFunction* current_function =
-        woort_linklist_iter(&lir_compiler->m_function_list);
-
-    while (current_function != NULL)
+    if (_woort_LIRCompiler_has_external_function_constant(lir_compiler))
     {
-        const woort_LIRCompiler_CommitResult r =
-            _woort_LIRCompiler_commit_function(lir_compiler, current_function);
+        WOORT_DEBUG("External functions can only be resolved by linking.");
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_UNRESOLVED_FUNCTION;
+    }
+
+    woort_LIRCompiler_CommitResult commit_result =
+        _woort_LIRCompiler_prepare_codes(lir_compiler);
+    if (commit_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+        return commit_result;
 
-        if (r != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
-            // Failed.
-            return r;
+    woort_Vector /* woort_CodeEnv_Relocation */ relocations;
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
 
-        current_function = woort_linklist_next(current_function);
+    lir_compiler->m_data_base = 0;
+    lir_compiler->m_static_base = lir_compiler->m_constant_storage_holder.m_size;
+
+    commit_result = _woort_LIRCompiler_commit_codes(lir_compiler, &relocations);
+    if (commit_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+    {
+        woort_vector_deinit(&relocations);
+        return commit_result;
+    }
+
+    // Reserve room for extending, CodeEnv takes the capacity of holders.
+    if (!woort_vector_reserve(
+            &lir_compiler->m_code_holder,
+            lir_compiler->m_code_holder.m_size + lir_compiler->m_reserved_code_count)
+        || !woort_vector_reserve(
+            &lir_compiler->m_constant_storage_holder,
+            lir_compiler->m_constant_storage_holder.m_size
+                + lir_compiler->m_static_storage_count
+                + lir_compiler->m_reserved_data_count))
+    {
+        woort_vector_deinit(&relocations);
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
     }
 
     // All function commited.
+    woort_CodeEnv* code_env;
     if (!woort_CodeEnv_create(
         &lir_compiler->m_code_holder,
         &lir_compiler->m_constant_storage_holder,
         lir_compiler->m_static_storage_count,
-        out_codeenv))
+        &relocations,
+        &code_env))
     {
+        woort_vector_deinit(&relocations);
         return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
     }
 
+    *out_codeenv = code_env;
+    return WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
+}
+
+WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit_into(
+    woort_LIRCompiler* lir_compiler,
+    woort_CodeEnv* code_env)
+{
+    if (_woort_LIRCompiler_has_external_function_constant(lir_compiler))
+    {
+        WOORT_DEBUG("External functions can only be resolved by linking.");
+        return WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_UNRESOLVED_FUNCTION;
+    }
+
+    woort_LIRCompiler_CommitResult commit_result =
+        _woort_LIRCompiler_prepare_codes(lir_compiler);
+    if (commit_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+        return commit_result;
+
+    woort_Vector /* woort_CodeEnv_Relocation */ relocations;
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+
+    lir_compiler->m_data_base = (size_t)(code_env->m_data_end - code_env->m_data_begin);
+    lir_compiler->m_static_base =
+        lir_compiler->m_data_base + lir_compiler->m_constant_storage_holder.m_size;
+
+    commit_result = _woort_LIRCompiler_commit_codes(lir_compiler, &relocations);
+
+    size_t code_base;
+    if (commit_result == WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        && !woort_CodeEnv_extend(
+            code_env,
+            lir_compiler->m_data_base,
+            &lir_compiler->m_code_holder,
+            &lir_compiler->m_constant_storage_holder,
+            lir_compiler->m_static_storage_count,
+            &relocations,
+            &code_base))
+    {
+        commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_EXTENDING;
+    }
+
+    if (commit_result == WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+    {
+        // Entry offsets are relative to the whole CodeEnv now.
+        for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+            NULL != current_function;
+            current_function = woort_linklist_next(current_function))
+        {
+            current_function->m_entry_bytecode_offset += code_base;
+        }
+        woort_vector_clear(&lir_compiler->m_code_holder);
+    }
+
+    woort_vector_deinit(&relocations);
+    return commit_result;
+}
+
+WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit_linked(
+    woort_LIRCompiler** lir_compilers,
+    size_t lir_compiler_count,
+    woort_CodeEnv** out_codeenv)
+{
+    assert(lir_compiler_count > 0);
+
+    // 0. Constant counts are final after preparing, lay out data area.
+    size_t constant_count = 0;
+    size_t static_storage_count = 0;
+    size_t reserved_code_count = 0;
+    size_t reserved_data_count = 0;
+    for (size_t i = 0; i < lir_compiler_count; ++i)
+    {
+        woort_LIRCompiler* const lir_compiler = lir_compilers[i];
+
+        const woort_LIRCompiler_CommitResult prepare_result =
+            _woort_LIRCompiler_prepare_codes(lir_compiler);
+        if (prepare_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+            return prepare_result;
+
+        lir_compiler->m_data_base = constant_count;
+        lir_compiler->m_static_base = static_storage_count;
+
+        constant_count += lir_compiler->m_constant_storage_holder.m_size;
+        static_storage_count += lir_compiler->m_static_storage_count;
+        reserved_code_count += lir_compiler->m_reserved_code_count;
+        reserved_data_count += lir_compiler->m_reserved_data_count;
+    }
+
+    // Codes and constants are concatenated into holders of the first compiler.
+    woort_LIRCompiler* const first_compiler = lir_compilers[0];
+
+    woort_Vector /* woort_CodeEnv_Relocation */ relocations;
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+
+    // Linked functions, for checking external functions.
+    woort_HashMap /* woort_LIRFunction* -> bool */ linked_functions;
+    woort_hashmap_init(
+        &linked_functions,
+        sizeof(woort_LIRFunction*),
+        sizeof(bool),
+        woort_util_ptr_hash,
+        woort_util_ptr_equal);
+
+    // 1. Commit codes one by one, static storages are placed after all constants.
+    woort_LIRCompiler_CommitResult commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
+    for (size_t i = 0; commit_result == WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        && i < lir_compiler_count; ++i)
+    {
+        woort_LIRCompiler* const lir_compiler = lir_compilers[i];
+        lir_compiler->m_static_base += constant_count;
+
+        const size_t relocation_base = relocations.m_size;
+        commit_result = _woort_LIRCompiler_commit_codes(lir_compiler, &relocations);
+        if (commit_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+            break;
+
+        // Codes of the first compiler are in place.
+        const size_t code_base =
+            lir_compiler == first_compiler ? 0 : first_compiler->m_code_holder.m_size;
+        if (lir_compiler != first_compiler)
+        {
+            if ((lir_compiler->m_code_holder.m_size != 0
+                    && !woort_vector_push_back(
+                        &first_compiler->m_code_holder,
+                        lir_compiler->m_code_holder.m_size,
+                        lir_compiler->m_code_holder.m_data))
+                || (lir_compiler->m_constant_storage_holder.m_size != 0
+                    && !woort_vector_push_back(
+                        &first_compiler->m_constant_storage_holder,
+                        lir_compiler->m_constant_storage_holder.m_size,
+                        lir_compiler->m_constant_storage_holder.m_data)))
+            {
+                commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+                break;
+            }
+            woort_vector_clear(&lir_compiler->m_code_holder);
+            woort_vector_clear(&lir_compiler->m_constant_storage_holder);
+        }
+
+        // Entry offsets and relocations are relative to the whole CodeEnv now.
+        for (size_t r = relocation_base; r < relocations.m_size; ++r)
+        {
+            woort_CodeEnv_Relocation* const relocation = woort_vector_at(&relocations, r);
+            relocation->m_code_offset += (uint32_t)code_base;
+        }
+        for (woort_LIRFunction* current_function = woort_linklist_iter(&lir_compiler->m_function_list);
+            NULL != current_function;
+            current_function = woort_linklist_next(current_function))
+        {
+            current_function->m_entry_bytecode_offset += code_base;
+
+            const bool linked = true;
+            if (WOORT_HASHMAP_RESULT_OUT_OF_MEMORY == woort_hashmap_insert(
+                &linked_functions, &current_function, &linked))
+            {
+                commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+                break;
+            }
+        }
+    }
+
+    // 2. Resolve external function constants, all entry offsets are known now.
+    for (size_t i = 0; commit_result == WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        && i < lir_compiler_count; ++i)
+    {
+        woort_LIRCompiler* const lir_compiler = lir_compilers[i];
+
+        for (size_t c = 0; c < lir_compiler->m_function_constant_list.m_size; ++c)
+        {
+            const woort_LIRCompiler_FunctionConstant* const function_constant =
+                woort_vector_at(&lir_compiler->m_function_constant_list, c);
+
+            bool* linked;
+            if (!woort_hashmap_find(
+                &linked_functions, &function_constant->m_function, (void**)&linked))
+            {
+                WOORT_DEBUG("External function is not linked.");
+                commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_UNRESOLVED_FUNCTION;
+                break;
+            }
+
+            const woort_CodeEnv_Relocation relocation = {
+                .m_constant = (uint32_t)function_constant->m_constant,
+                .m_code_offset = (uint32_t)function_constant->m_function->m_entry_bytecode_offset,
+            };
+            if (!woort_vector_push_back(&relocations, 1, &relocation))
+            {
+                commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+                break;
+            }
+        }
+        woort_vector_clear(&lir_compiler->m_function_constant_list);
+    }
+    woort_hashmap_deinit(&linked_functions);
+
+    // 3. Reserve room for extending, CodeEnv takes the capacity of holders.
+    if (commit_result == WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        && (!woort_vector_reserve(
+                &first_compiler->m_code_holder,
+                first_compiler->m_code_holder.m_size + reserved_code_count)
+            || !woort_vector_reserve(
+                &first_compiler->m_constant_storage_holder,
+                constant_count + static_storage_count + reserved_data_count)))
+    {
+        commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+    }
+
+    woort_CodeEnv* code_env;
+    if (commit_result == WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        && !woort_CodeEnv_create(
+            &first_compiler->m_code_holder,
+            &first_compiler->m_constant_storage_holder,
+            static_storage_count,
+            &relocations,
+            &code_env))
+    {
+        commit_result = WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_OUT_OF_MEMORY;
+    }
+
+    if (commit_result != WOORT_LIRCOMPILER_COMMIT_RESULT_OK)
+    {
+        woort_vector_deinit(&relocations);
+        return commit_result;
+    }
+
+    *out_codeenv = code_env;
     return WOORT_LIRCOMPILER_COMMIT_RESULT_OK;
 }
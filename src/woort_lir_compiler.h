@@ -9,6 +9,7 @@ woort_lir_compiler.h
 #include "woort_opcode_formal.h"
 #include "woort_value.h"
 #include "woort_vector.h"
+#include "woort_hashmap.h"
 #include "woort_lir.h"
 #include "woort_lir_function.h"
 #include "woort_codeenv.h"
@@ -17,6 +18,20 @@ woort_lir_compiler.h
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+A constant which will be filled with the address of a function in the same compiler,
+the address is only known after all functions committed.
+*/
+typedef struct woort_LIRCompiler_FunctionConstant
+{
+    woort_LIR_ConstantStorage   m_constant;
+    woort_LIRFunction*          m_function;
+
+    // `m_function` is in another compiler, resolved by woort_LIRCompiler_commit_linked.
+    bool                        m_external;
+
+} woort_LIRCompiler_FunctionConstant;
+
 // LIRCompiler.
 typedef struct woort_LIRCompiler
 {
@@ -28,12 +43,29 @@ typedef struct woort_LIRCompiler
     woort_Vector /* woort_Value */
                     m_constant_storage_holder;
 
+    // Index of interned constants, keyed by the bits of value.
+    woort_HashMap /* uint64_t -> woort_LIR_ConstantStorage */
+                    m_interned_constant_index;
+
     // Static storage data list.
     size_t          m_static_storage_count;
 
     woort_LinkList /* woort_LIRFunction */
                     m_function_list;
 
+    // Constants to be patched with function addresses.
+    woort_Vector /* woort_LIRCompiler_FunctionConstant */
+                    m_function_constant_list;
+
+    // Room reserved in committed CodeEnv for woort_CodeEnv_extend.
+    size_t          m_reserved_code_count;
+    size_t          m_reserved_data_count;
+
+    // Index of the first constant in data area of CodeEnv, only used in committing.
+    size_t          m_data_base;
+    // Index of the first static storage in data area of CodeEnv, only used in committing.
+    size_t          m_static_base;
+
 } woort_LIRCompiler;
 
 void woort_LIRCompiler_init(woort_LIRCompiler* lir_compiler);
@@ -42,6 +74,36 @@ void woort_LIRCompiler_deinit(woort_LIRCompiler* lir_compiler);
 WOORT_NODISCARD bool woort_LIRCompiler_allocate_constant(
     woort_LIRCompiler* lir_compiler, 
     woort_LIR_ConstantStorage* out_constant_address);
+/*
+Get a constant holding `value`, constants with the same bits are shared.
+
+NOTE: Interned constants must not be modified by woort_LIRCompiler_get_constant.
+*/
+WOORT_NODISCARD bool woort_LIRCompiler_intern_constant(
+    woort_LIRCompiler* lir_compiler,
+    const woort_Value* value,
+    woort_LIR_ConstantStorage* out_constant_address);
+/*
+Allocate a constant holding the script function address of `function`, which must
+be added by `woort_LIRCompiler_add_function` of the same compiler.
+
+NOTE: Small functions called by CALLNWO with these constants may be inlined into
+    callers when committing.
+*/
+WOORT_NODISCARD bool woort_LIRCompiler_allocate_function_constant(
+    woort_LIRCompiler* lir_compiler,
+    woort_LIRFunction* function,
+    woort_LIR_ConstantStorage* out_constant_address);
+/*
+Like woort_LIRCompiler_allocate_function_constant, but `function` is added to another
+compiler, both compilers must be committed together by woort_LIRCompiler_commit_linked.
+
+NOTE: Calls with these constants are never inlined.
+*/
+WOORT_NODISCARD bool woort_LIRCompiler_allocate_external_function_constant(
+    woort_LIRCompiler* lir_compiler,
+    woort_LIRFunction* function,
+    woort_LIR_ConstantStorage* out_constant_address);
 WOORT_NODISCARD woort_LIR_StaticStorage woort_LIRCompiler_allocate_static_storage(
     woort_LIRCompiler* lir_compiler);
 
@@ -66,13 +128,59 @@ typedef enum woort_LIRCompiler_CommitResult
     WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_UNBOUND_LABEL,
     WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_LABEL_TOO_FAR,
     WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_REGISTER_ALLOCATION,
+    WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_EXTENDING,
+    WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_UNRESOLVED_FUNCTION,
 
 } woort_LIRCompiler_CommitResult;
 
+/*
+Reserve room in the CodeEnv committed later, so that it can be extended by
+woort_LIRCompiler_commit_into without moving. Vectors may leave some room even
+without reservation.
+*/
+void woort_LIRCompiler_reserve_for_extending(
+    woort_LIRCompiler* lir_compiler,
+    size_t code_count,
+    size_t data_count);
+
 WOORT_NODISCARD bool woort_LIRCompiler_emit_code(
     woort_LIRCompiler* lir_compiler,
     woort_Bytecode bc);
 
+/*
+NOTE: Constants with the same value are merged before committing, except function
+    constants, whose values are not known until all functions committed.
+NOTE: Functions are committed independently (in parallel if there are enough of them),
+    then their codes are concatenated in the order they were added.
+*/
 WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit(
     woort_LIRCompiler* lir_compiler,
     woort_CodeEnv** out_codeenv);
+
+/*
+Commit functions into an existing `code_env` instead of creating a new one, new
+constants and static storages are placed after existing data. New functions can call
+existing functions in NEAR way by constants holding their script function values.
+
+NOTE: Returns WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_EXTENDING if there is not enough
+    reserved room in `code_env`, or it is extended concurrently.
+*/
+WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit_into(
+    woort_LIRCompiler* lir_compiler,
+    woort_CodeEnv* code_env);
+
+/*
+Commit several compilers into one CodeEnv, so that functions in different compilers
+call each other in NEAR way. Codes are concatenated in the order of `lir_compilers`,
+constants of all compilers are placed before all static storages, external function
+constants are resolved to functions in any of `lir_compilers`.
+
+NOTE: Entry offsets of functions are relative to the whole CodeEnv.
+NOTE: Returns WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_UNRESOLVED_FUNCTION if an external
+    function is not in `lir_compilers`; woort_LIRCompiler_commit and
+    woort_LIRCompiler_commit_into also return it for any external function constant.
+*/
+WOORT_NODISCARD woort_LIRCompiler_CommitResult woort_LIRCompiler_commit_linked(
+    woort_LIRCompiler** lir_compilers,
+    size_t lir_compiler_count,
+    woort_CodeEnv** out_codeenv);
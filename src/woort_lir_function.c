@@ -26,6 +26,8 @@ void woort_LIRFunction_init(woort_LIRFunction* function)
     woort_linklist_init(
         &function->m_lir_list,
         sizeof(woort_LIR));
+
+    function->m_entry_bytecode_offset = 0;
 }
 void woort_LIRFunction_deinit(woort_LIRFunction* function)
 {
@@ -116,7 +118,9 @@ WOORT_NODISCARD bool woort_LIRFunction_alloc_register(
 
     new_register->m_alive_range[0] = SIZE_MAX;
     new_register->m_alive_range[1] = SIZE_MAX;
+    new_register->m_use_weight = 0;
     new_register->m_assigned_bp_offset = INT16_MAX;
+    new_register->m_push_range_leader = NULL;
 
     *out_register = new_register;
     return true;
@@ -128,7 +132,7 @@ WOORT_NODISCARD bool woort_LIRFunction_get_argument_register(
     woort_LIRRegister** out_register)
 {
     // Addressing limit.
-    assert(index < INT16_MAX);
+    assert(index < INT16_MAX - 3);
 
     if (function->m_argument_registers.m_size <= index)
     {
@@ -168,7 +172,8 @@ WOORT_NODISCARD bool woort_LIRFunction_get_argument_register(
         assert(new_argument_register->m_alive_range[0] == SIZE_MAX
             && new_argument_register->m_alive_range[1] == SIZE_MAX);
 
-        new_argument_register->m_assigned_bp_offset = /* TBD */-1 - index;
+        // Arguments are pushed by caller, see stack model in woort_opcode.h.
+        new_argument_register->m_assigned_bp_offset = 3 + (woort_RegisterStorageId)index;
 
         woort_LIRRegister** arg_reg_ptr =
             (woort_LIRRegister**)woort_vector_at(
@@ -208,22 +213,87 @@ WOORT_NODISCARD bool woort_LIRFunction_bind(
         (void**)&label);
 }
 
+/*
+Slots in [0, WOORT_LIR_NEAR_SLOT_COUNT) can be addressed by S8 operands, bp offset
+INT8_MIN ~ INT8_MIN + 2 are reserved, so the near window is offset 0 ~ INT8_MIN + 3.
+*/
+#define WOORT_LIR_NEAR_SLOT_COUNT ((size_t)(-(INT8_MIN + 3)) + 1)
+#define WOORT_LIR_SLOT_COUNT ((size_t)INT16_MAX - 3)
+
+/*
+Loop depth beyond this limit will not make register hotter any more, to avoid
+weight overflow.
+*/
+#define WOORT_LIR_MAX_WEIGHTED_LOOP_DEPTH 6
+
+/*
+PUSHRSCHK & PUSHRS count in N8.
+*/
+#define WOORT_LIR_PUSH_RANGE_MAX_COUNT ((size_t)UINT8_MAX)
+
 void _woort_LIRRegister_mark_register_active_range(
     woort_LIRRegister* target_register,
-    size_t instr_index)
+    size_t instr_index,
+    size_t use_weight)
 {
-    if (target_register->m_assigned_bp_offset < 0)
+    if (target_register->m_assigned_bp_offset != INT16_MAX)
         // Function arguments, skip.
         return;
 
-    assert(target_register->m_assigned_bp_offset == INT16_MAX);
     if (target_register->m_alive_range[0] == SIZE_MAX)
     {
         // First time to be used, set the start of alive range.
         target_register->m_alive_range[0] = instr_index;
+        target_register->m_use_weight = 0;
     }
     // Update the end of alive range.
     target_register->m_alive_range[1] = instr_index;
+    target_register->m_use_weight += use_weight;
+}
+
+void _woort_LIRRegister_assign_slot(
+    woort_LIRRegister* target_register,
+    size_t slot)
+{
+    assert(slot < WOORT_LIR_SLOT_COUNT);
+
+    const woort_RegisterStorageId assigned_bp_offset = -(int16_t)slot;
+
+    // Skip reserved-place.
+    if (assigned_bp_offset < INT8_MIN + 3)
+        target_register->m_assigned_bp_offset = assigned_bp_offset - 3;
+    else
+        target_register->m_assigned_bp_offset = assigned_bp_offset;
+}
+
+/*
+Slots are always less than WOORT_LIR_SLOT_COUNT, which the scratch bitset can hold.
+*/
+void _woort_LIRFunction_take_slot(woort_Bitset* slots, size_t slot)
+{
+    const bool taken = woort_bitset_set(slots, slot);
+    assert(taken);
+    (void)taken;
+}
+void _woort_LIRFunction_give_back_slot(woort_Bitset* slots, size_t slot)
+{
+    const bool given_back = woort_bitset_reset(slots, slot);
+    assert(given_back);
+    (void)given_back;
+}
+
+WOORT_NODISCARD size_t _woort_LIRRegister_assigned_slot(
+    const woort_LIRRegister* target_register)
+{
+    // m_assigned_bp_offset CANNOT be assigned to reserved-place.
+    assert(target_register->m_assigned_bp_offset != INT8_MIN
+        && target_register->m_assigned_bp_offset != INT8_MIN + 1
+        && target_register->m_assigned_bp_offset != INT8_MIN + 2);
+    assert(target_register->m_assigned_bp_offset <= 0);
+
+    if (target_register->m_assigned_bp_offset < INT8_MIN + 3)
+        return (size_t)(-(target_register->m_assigned_bp_offset + 3));
+    return (size_t)(-target_register->m_assigned_bp_offset);
 }
 
 int _woort_register_start_pos_comparator(const void* a, const void* b)
@@ -238,88 +308,397 @@ int _woort_register_start_pos_comparator(const void* a, const void* b)
     return 0;
 }
 
+WOORT_NODISCARD /* OPTIONAL */ woort_LIRLabel* _woort_LIR_jump_target_label(
+    const woort_LIR* lir)
+{
+    switch (lir->m_opnum_formal)
+    {
+    case WOORT_LIR_OPNUMFORMAL_LABEL:
+        return lir->m_opnums.m_label.m_label;
+    case WOORT_LIR_OPNUMFORMAL_R_LABEL:
+        return lir->m_opnums.m_r_label.m_label;
+    case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
+        return lir->m_opnums.m_r_r_label.m_label;
+    default:
+        return NULL;
+    }
+}
+
+/*
+LIR index range [m_begin, m_end] of a loop, from the jump target to the back edge.
+*/
+typedef struct _woort_LIRFunction_Loop
+{
+    size_t m_begin;
+    size_t m_end;
+
+} _woort_LIRFunction_Loop;
+
+int _woort_loop_begin_comparator(const void* a, const void* b)
+{
+    const _woort_LIRFunction_Loop* loop_a = a;
+    const _woort_LIRFunction_Loop* loop_b = b;
+
+    if (loop_a->m_begin < loop_b->m_begin)
+        return -1;
+    else if (loop_a->m_begin > loop_b->m_begin)
+        return 1;
+    return 0;
+}
+
+/*
+Count how many loops cover each LIR. A jump to a label binded at or before itself
+is treated as a loop back edge, LIRs between the target and the jump are in loop.
+Loops are recorded into `out_loops`, sorted by their begin.
+
+NOTE: `m_fact_bytecode_offset` of each LIR will be used to store its index, it will
+    be overwritten when committing.
+*/
+WOORT_NODISCARD bool _woort_LIRFunction_calculate_loop_depth(
+    woort_LIRFunction* function,
+    size_t lir_count,
+    woort_Vector* /* size_t */ out_loop_depth,
+    woort_Vector* /* _woort_LIRFunction_Loop */ out_loops)
+{
+    if (!woort_vector_resize(out_loop_depth, lir_count + 1))
+        // Out of memory.
+        return false;
+
+    size_t* const loop_depth = (size_t*)out_loop_depth->m_data;
+    memset(loop_depth, 0, (lir_count + 1) * sizeof(size_t));
+
+    size_t lir_index = 0;
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
+        current_lir != NULL;
+        (current_lir = woort_linklist_next(current_lir)), ++lir_index)
+    {
+        const woort_LIRLabel* const target_label =
+            _woort_LIR_jump_target_label(current_lir);
+
+        if (target_label == NULL || target_label->m_binded_lir == NULL)
+            continue;
+
+        const size_t target_index =
+            target_label->m_binded_lir->m_fact_bytecode_offset;
+
+        if (target_index <= lir_index)
+        {
+            // Jump back, [target_index, lir_index] is a loop body.
+            // Use difference array here, will be accumulated later.
+            ++loop_depth[target_index];
+            --loop_depth[lir_index + 1];
+
+            const _woort_LIRFunction_Loop loop = {
+                .m_begin = target_index,
+                .m_end = lir_index,
+            };
+            if (!woort_vector_push_back(out_loops, 1, &loop))
+                // Out of memory.
+                return false;
+        }
+    }
+
+    if (out_loops->m_size > 1)
+        qsort(
+            out_loops->m_data,
+            out_loops->m_size,
+            sizeof(_woort_LIRFunction_Loop),
+            _woort_loop_begin_comparator);
+
+    size_t current_depth = 0;
+    for (size_t i = 0; i < lir_count; ++i)
+    {
+        current_depth += loop_depth[i];
+        loop_depth[i] = current_depth;
+    }
+    return true;
+}
+
+/*
+A register alive before a loop and used in it is needed again by the next iteration,
+keep it alive to the end of loop, or its slot may be reused in the rest of loop body.
+    Loops are sorted by begin, so extending by a loop never makes an earlier one
+newly covered, one pass is enough.
+*/
+void _woort_LIRFunction_extend_ranges_across_loops(
+    woort_LIRFunction* function,
+    woort_Vector* /* _woort_LIRFunction_Loop */ loops)
+{
+    if (loops->m_size == 0)
+        return;
+
+    for (
+        woort_LIRRegister* current_register = woort_linklist_iter(&function->m_register_list);
+        current_register != NULL;
+        current_register = woort_linklist_next(current_register))
+    {
+        if (current_register->m_alive_range[0] == SIZE_MAX)
+            // Not used, or function argument.
+            continue;
+
+        for (size_t i = 0; i < loops->m_size; ++i)
+        {
+            const _woort_LIRFunction_Loop* const loop = woort_vector_at(loops, i);
+
+            if (current_register->m_alive_range[0] < loop->m_begin
+                && current_register->m_alive_range[1] >= loop->m_begin
+                && current_register->m_alive_range[1] < loop->m_end)
+            {
+                current_register->m_alive_range[1] = loop->m_end;
+            }
+        }
+    }
+}
+
+/*
+Group registers pushed by a run of PUSH, registers in group get the same start of
+alive range, so that they can be allocated at once.
+    Arguments have fixed slots, and a register can only be placed once, such
+registers end the group.
+*/
+void _woort_LIRFunction_group_push_ranges(woort_LIRFunction* function)
+{
+    for (
+        woort_LIRRegister* current_register = woort_linklist_iter(&function->m_register_list);
+        current_register != NULL;
+        current_register = woort_linklist_next(current_register))
+    {
+        current_register->m_push_range_leader = NULL;
+    }
+
+    woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
+    while (current_lir != NULL)
+    {
+        if (current_lir->m_opcode != WOORT_LIR_OPCODE_PUSH)
+        {
+            current_lir = woort_linklist_next(current_lir);
+            continue;
+        }
+
+        woort_LIRRegister* const leader = current_lir->m_opnums.m_PUSH.m_r;
+        size_t count = 0;
+        size_t min_start = SIZE_MAX;
+
+        woort_LIR* group_end = current_lir;
+        for (;
+            group_end != NULL
+                && group_end->m_opcode == WOORT_LIR_OPCODE_PUSH
+                && count < WOORT_LIR_PUSH_RANGE_MAX_COUNT;
+            group_end = woort_linklist_next(group_end))
+        {
+            woort_LIRRegister* const pushed_register = group_end->m_opnums.m_PUSH.m_r;
+
+            if (pushed_register->m_assigned_bp_offset != INT16_MAX
+                || pushed_register->m_push_range_leader != NULL)
+                break;
+
+            pushed_register->m_push_range_leader = leader;
+            pushed_register->m_push_range_index = count++;
+
+            if (min_start > pushed_register->m_alive_range[0])
+                min_start = pushed_register->m_alive_range[0];
+        }
+
+        if (count >= 2)
+        {
+            leader->m_push_range_count = count;
+            leader->m_push_range_placed = false;
+        }
+
+        for (woort_LIR* grouped_lir = current_lir;
+            grouped_lir != group_end;
+            grouped_lir = woort_linklist_next(grouped_lir))
+        {
+            woort_LIRRegister* const pushed_register = grouped_lir->m_opnums.m_PUSH.m_r;
+            if (count >= 2)
+                pushed_register->m_alive_range[0] = min_start;
+            else
+                pushed_register->m_push_range_leader = NULL;
+        }
+
+        // The register ended the group may begin another one.
+        current_lir = group_end == current_lir
+            ? woort_linklist_next(current_lir)
+            : group_end;
+    }
+}
+
+/*
+Find `count` contiguous unset slots in [begin, end).
+*/
+WOORT_NODISCARD bool _woort_LIRFunction_find_unset_slots(
+    const woort_Bitset* bitset,
+    size_t begin,
+    size_t end,
+    size_t count,
+    size_t* out_first_slot)
+{
+    size_t first_slot;
+    while (woort_bitset_find_first_unset_in_range(bitset, begin, end, &first_slot))
+    {
+        if (first_slot + count > end)
+            return false;
+
+        size_t slot = first_slot + 1;
+        while (slot < first_slot + count && !woort_bitset_test(bitset, slot))
+            ++slot;
+
+        if (slot == first_slot + count)
+        {
+            *out_first_slot = first_slot;
+            return true;
+        }
+        begin = slot + 1;
+    }
+    return false;
+}
+
+WOORT_NODISCARD bool woort_LIRFunction_scratch_init(woort_LIRFunction_Scratch* scratch)
+{
+    if (!woort_bitset_init(&scratch->m_slots, WOORT_LIR_SLOT_COUNT))
+        // Out of memory.
+        return false;
+
+    woort_arena_init(&scratch->m_arena, WOORT_ARENA_DEFAULT_CHUNK_SIZE);
+    return true;
+}
+void woort_LIRFunction_scratch_deinit(woort_LIRFunction_Scratch* scratch)
+{
+    woort_arena_deinit(&scratch->m_arena);
+    woort_bitset_deinit(&scratch->m_slots);
+}
+
 WOORT_NODISCARD bool woort_LIRFunction_register_allocation(
-    woort_LIRFunction* function, size_t* out_stack_usage)
+    woort_LIRFunction* function,
+    woort_LIRFunction_Scratch* scratch,
+    size_t* out_stack_usage)
 {
-    // Mark active range for all registers.
+    woort_Arena* const scratch_arena = &scratch->m_arena;
+    woort_Bitset* const bitset = &scratch->m_slots;
+
+    // Give each LIR an index, used for loop detection.
     size_t lir_count = 0;
     for (
         woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
         current_lir != NULL;
         (current_lir = woort_linklist_next(current_lir)), ++lir_count)
     {
+        current_lir->m_fact_bytecode_offset = lir_count;
+    }
+
+    woort_Vector /* size_t */ loop_depth;
+    woort_vector_init_with_arena(&loop_depth, sizeof(size_t), scratch_arena);
+
+    woort_Vector /* _woort_LIRFunction_Loop */ loops;
+    woort_vector_init_with_arena(&loops, sizeof(_woort_LIRFunction_Loop), scratch_arena);
+
+    if (!_woort_LIRFunction_calculate_loop_depth(function, lir_count, &loop_depth, &loops))
+    {
+        // Out of memory.
+        woort_vector_deinit(&loops);
+        woort_vector_deinit(&loop_depth);
+        return false;
+    }
+
+    // Mark active range and use weight for all registers.
+    lir_count = 0;
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
+        current_lir != NULL;
+        (current_lir = woort_linklist_next(current_lir)), ++lir_count)
+    {
+        size_t depth = *(size_t*)woort_vector_at(&loop_depth, lir_count);
+        if (depth > WOORT_LIR_MAX_WEIGHTED_LOOP_DEPTH)
+            depth = WOORT_LIR_MAX_WEIGHTED_LOOP_DEPTH;
+
+        // Each loop level makes the use 8 times hotter.
+        const size_t use_weight = (size_t)1 << (3 * depth);
+
         switch (current_lir->m_opnum_formal)
         {
         case WOORT_LIR_OPNUMFORMAL_CS_R:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_cs_r.m_r,
-                lir_count);
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_S_R:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_s_r.m_r,
-                lir_count);
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_R:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r.m_r,
-                lir_count);
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_R_R:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r.m_r1,
-                lir_count);
+                lir_count, use_weight);
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r.m_r2,
-                lir_count);
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_R_R_R:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r_r.m_r1,
-                lir_count);
+                lir_count, use_weight);
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r_r.m_r2,
-                lir_count);
+                lir_count, use_weight);
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r_r.m_r3,
-                lir_count);
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_R_R_COUNT16:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r_count16.m_r1,
-                lir_count);
+                lir_count, use_weight);
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r_count16.m_r2,
-                lir_count);
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_R_COUNT16:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_count16.m_r,
-                lir_count);
+                lir_count, use_weight);
+            break;
+        case WOORT_LIR_OPNUMFORMAL_C_R_COUNT16:
+            _woort_LIRRegister_mark_register_active_range(
+                current_lir->m_opnums.m_c_r_count16.m_r,
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r_label.m_r1,
-                lir_count);
+                lir_count, use_weight);
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_r_label.m_r2,
-                lir_count);
+                lir_count, use_weight);
             break;
         case WOORT_LIR_OPNUMFORMAL_R_LABEL:
             _woort_LIRRegister_mark_register_active_range(
                 current_lir->m_opnums.m_r_label.m_r,
-                lir_count);
+                lir_count, use_weight);
             break;
         default:
             // No registration allocation needed.
             break;
         }
     }
+    woort_vector_deinit(&loop_depth);
+
+    _woort_LIRFunction_extend_ranges_across_loops(function, &loops);
+    woort_vector_deinit(&loops);
+
+    _woort_LIRFunction_group_push_ranges(function);
 
     // Ok, all registers active range has been marked.
     // Now we need to allocate registers.
     woort_Vector registers;
-    woort_vector_init(&registers, sizeof(woort_LIRRegister*));
+    woort_vector_init_with_arena(
+        &registers, sizeof(woort_LIRRegister*), scratch_arena);
 
     bool success = true;
 
@@ -339,61 +718,59 @@ WOORT_NODISCARD bool woort_LIRFunction_register_allocation(
         }
     }
 
-    woort_Bitset bitset;
-    success = success && woort_bitset_init(&bitset, INT16_MAX - 3);
-
     if (success)
     {
         // Sort registers by start position.
-        qsort(
-            registers.m_data,
-            registers.m_size,
-            sizeof(woort_LIRRegister*),
-            _woort_register_start_pos_comparator);
+        if (registers.m_size > 1)
+            qsort(
+                registers.m_data,
+                registers.m_size,
+                sizeof(woort_LIRRegister*),
+                _woort_register_start_pos_comparator);
 
         woort_Vector active_registers;
-        woort_vector_init(&active_registers, sizeof(woort_LIRRegister*));
+        woort_vector_init_with_arena(
+            &active_registers, sizeof(woort_LIRRegister*), scratch_arena);
+
+        woort_Vector far_registers;
+        woort_vector_init_with_arena(
+            &far_registers, sizeof(woort_LIRRegister*), scratch_arena);
 
         *out_stack_usage = 0;
 
-        for (size_t i = 0; i < registers.m_size; ++i)
+        /*
+        Pass 1: Linear scan in near window.
+            If near window is full, the coldest register (maybe current one) will be
+        evicted to far register list, and get its slot in pass 2.
+        */
+        for (size_t i = 0; success && i < registers.m_size; ++i)
         {
             woort_LIRRegister* const current_register =
                 *(woort_LIRRegister**)woort_vector_at(&registers, i);
 
+            woort_LIRRegister* const push_range_leader =
+                current_register->m_push_range_leader;
+
+            // Placed with the group, and might have been evicted already.
+            if (push_range_leader != NULL && push_range_leader->m_push_range_placed)
+                continue;
+
             // Expire old intervals.
             for (size_t j = 0; j < active_registers.m_size; )
             {
-                const woort_LIRRegister* const active_register =
-                    *(woort_LIRRegister**)woort_vector_at(&active_registers, j);
-                if (active_register->m_alive_range[1] < current_register->m_alive_range[0])
+                woort_LIRRegister** const active_register =
+                    (woort_LIRRegister**)woort_vector_at(&active_registers, j);
+
+                if ((*active_register)->m_alive_range[1] < current_register->m_alive_range[0])
                 {
                     // Expired.
-
-                    // m_assigned_bp_offset CANNOT be assigned to reserved-place.
-                    assert(active_register->m_assigned_bp_offset != INT8_MIN
-                        && active_register->m_assigned_bp_offset != INT8_MIN + 1
-                        && active_register->m_assigned_bp_offset != INT8_MIN + 2);
-
-                    (void)woort_bitset_reset(
-                        &bitset,
-                        (size_t)(
-                            active_register->m_assigned_bp_offset < INT8_MIN + 3
-                            ? active_register->m_assigned_bp_offset + 3
-                            : active_register->m_assigned_bp_offset));
+                    _woort_LIRFunction_give_back_slot(
+                        bitset, _woort_LIRRegister_assigned_slot(*active_register));
 
                     // Remove from active list.
                     // Swap with last element and pop back.
-                    if (j != active_registers.m_size - 1)
-                    {
-                        woort_LIRRegister* const * const last_element =
-                            (woort_LIRRegister**)woort_vector_at(
-                                &active_registers, active_registers.m_size - 1);
-                        woort_LIRRegister** const current_element =
-                            (woort_LIRRegister**)woort_vector_at(
-                                &active_registers, j);
-                        *current_element = *last_element;
-                    }
+                    *active_register = *(woort_LIRRegister**)woort_vector_at(
+                        &active_registers, active_registers.m_size - 1);
                     active_registers.m_size--;
                 }
                 else
@@ -402,27 +779,161 @@ WOORT_NODISCARD bool woort_LIRFunction_register_allocation(
                 }
             }
 
-            // Allocate register.
-            size_t assigned_offset;
-            if (woort_bitset_find_first_unset(&bitset, &assigned_offset))
+            size_t assigned_slot;
+            if (push_range_leader != NULL)
             {
-                if (*out_stack_usage <= assigned_offset)
-                    *out_stack_usage = assigned_offset + 1;
+                /*
+                Registers in group have the same start, they are next to each other
+                in sorted registers.
+                */
+                const size_t group_count = push_range_leader->m_push_range_count;
+                const bool placed = _woort_LIRFunction_find_unset_slots(
+                    bitset, 0, WOORT_LIR_NEAR_SLOT_COUNT, group_count, &assigned_slot);
+
+                for (size_t j = i;
+                    j < registers.m_size
+                        && (*(woort_LIRRegister**)woort_vector_at(&registers, j))
+                            ->m_alive_range[0] == current_register->m_alive_range[0];
+                    ++j)
+                {
+                    woort_LIRRegister* const grouped_register =
+                        *(woort_LIRRegister**)woort_vector_at(&registers, j);
+
+                    if (grouped_register->m_push_range_leader != push_range_leader)
+                        continue;
+
+                    if (!placed)
+                    {
+                        // No room for whole group, allocate them one by one.
+                        grouped_register->m_push_range_leader = NULL;
+                        continue;
+                    }
+
+                    const size_t grouped_slot =
+                        assigned_slot + grouped_register->m_push_range_index;
+
+                    _woort_LIRRegister_assign_slot(grouped_register, grouped_slot);
+                    _woort_LIRFunction_take_slot(bitset, grouped_slot);
+
+                    if (!woort_vector_push_back(&active_registers, 1, &grouped_register))
+                    {
+                        // Out of memory.
+                        success = false;
+                        break;
+                    }
+                }
+
+                if (placed)
+                {
+                    push_range_leader->m_push_range_placed = true;
+                    continue;
+                }
+            }
 
-                const woort_RegisterStorageId assigned_bp_offset = 
-                    -(int16_t)assigned_offset;
+            if (woort_bitset_find_first_unset_in_range(
+                bitset, 0, WOORT_LIR_NEAR_SLOT_COUNT, &assigned_slot))
+            {
+                _woort_LIRRegister_assign_slot(current_register, assigned_slot);
+                _woort_LIRFunction_take_slot(bitset, assigned_slot);
 
-                if (assigned_bp_offset < INT8_MIN + 3)
-                    current_register->m_assigned_bp_offset = assigned_bp_offset - 3;
+                if (!woort_vector_push_back(&active_registers, 1, &current_register))
+                {
+                    // Out of memory.
+                    success = false;
+                }
+                continue;
+            }
+
+            // Near window used up, find the coldest active register.
+            woort_LIRRegister** coldest_register = NULL;
+            for (size_t j = 0; j < active_registers.m_size; ++j)
+            {
+                woort_LIRRegister** const active_register =
+                    (woort_LIRRegister**)woort_vector_at(&active_registers, j);
+
+                if (coldest_register == NULL
+                    || (*active_register)->m_use_weight < (*coldest_register)->m_use_weight)
+                    coldest_register = active_register;
+            }
+
+            woort_LIRRegister* evicted_register = current_register;
+            if (coldest_register != NULL
+                && (*coldest_register)->m_use_weight < current_register->m_use_weight)
+            {
+                // Take the near slot of the coldest one.
+                evicted_register = *coldest_register;
+
+                current_register->m_assigned_bp_offset = evicted_register->m_assigned_bp_offset;
+                evicted_register->m_assigned_bp_offset = INT16_MAX;
+
+                *coldest_register = current_register;
+            }
+
+            if (!woort_vector_push_back(&far_registers, 1, &evicted_register))
+            {
+                // Out of memory.
+                success = false;
+            }
+        }
+
+        for (size_t i = 0; i < active_registers.m_size; ++i)
+        {
+            _woort_LIRFunction_give_back_slot(
+                bitset,
+                _woort_LIRRegister_assigned_slot(
+                    *(woort_LIRRegister**)woort_vector_at(&active_registers, i)));
+        }
+        woort_vector_clear(&active_registers);
+
+        /*
+        Pass 2: Linear scan for evicted registers in far slots.
+            Registers evicted later may start earlier, sort again.
+        */
+        if (far_registers.m_size > 1)
+            qsort(
+                far_registers.m_data,
+                far_registers.m_size,
+                sizeof(woort_LIRRegister*),
+                _woort_register_start_pos_comparator);
+
+        for (size_t i = 0; success && i < far_registers.m_size; ++i)
+        {
+            woort_LIRRegister* const current_register =
+                *(woort_LIRRegister**)woort_vector_at(&far_registers, i);
+
+            // Expire old intervals.
+            for (size_t j = 0; j < active_registers.m_size; )
+            {
+                woort_LIRRegister** const active_register =
+                    (woort_LIRRegister**)woort_vector_at(&active_registers, j);
+
+                if ((*active_register)->m_alive_range[1] < current_register->m_alive_range[0])
+                {
+                    // Expired.
+                    _woort_LIRFunction_give_back_slot(
+                        bitset, _woort_LIRRegister_assigned_slot(*active_register));
+
+                    *active_register = *(woort_LIRRegister**)woort_vector_at(
+                        &active_registers, active_registers.m_size - 1);
+                    active_registers.m_size--;
+                }
                 else
-                    current_register->m_assigned_bp_offset = assigned_bp_offset;
+                {
+                    ++j;
+                }
+            }
+
+            size_t assigned_slot;
+            if (woort_bitset_find_first_unset_in_range(
+                bitset, WOORT_LIR_NEAR_SLOT_COUNT, WOORT_LIR_SLOT_COUNT, &assigned_slot))
+            {
+                _woort_LIRRegister_assign_slot(current_register, assigned_slot);
+                _woort_LIRFunction_take_slot(bitset, assigned_slot);
 
-                (void)woort_bitset_set(&bitset, assigned_offset);
                 if (!woort_vector_push_back(&active_registers, 1, &current_register))
                 {
                     // Out of memory.
                     success = false;
-                    break;
                 }
             }
             else
@@ -430,13 +941,42 @@ WOORT_NODISCARD bool woort_LIRFunction_register_allocation(
                 // Failed to allocate register.
                 WOORT_DEBUG("Failed to allocate register.");
                 success = false;
+            }
+        }
 
-                break;
+        if (success)
+        {
+            // Count stack usage, reserved-place should be counted in.
+            for (size_t i = 0; i < registers.m_size; ++i)
+            {
+                const woort_LIRRegister* const current_register =
+                    *(woort_LIRRegister**)woort_vector_at(&registers, i);
+
+                const size_t stack_usage =
+                    (size_t)(-current_register->m_assigned_bp_offset) + 1;
+
+                if (*out_stack_usage < stack_usage)
+                    *out_stack_usage = stack_usage;
             }
         }
 
+        // Give back slots for next function.
+        if (success)
+        {
+            for (size_t i = 0; i < active_registers.m_size; ++i)
+            {
+                _woort_LIRFunction_give_back_slot(
+                    bitset,
+                    _woort_LIRRegister_assigned_slot(
+                        *(woort_LIRRegister**)woort_vector_at(&active_registers, i)));
+            }
+        }
+        else
+            // Slot may be taken by register failed to be recorded, reset all.
+            woort_bitset_reset_range(bitset, 0, WOORT_LIR_SLOT_COUNT);
+
+        woort_vector_deinit(&far_registers);
         woort_vector_deinit(&active_registers);
-        woort_bitset_deinit(&bitset);
     }
     woort_vector_deinit(&registers);
 
@@ -493,12 +1033,25 @@ WOORT_NODISCARD bool woort_LIRFunction_emit_store(
     return true;
 }
 
+WOORT_NODISCARD bool woort_LIRFunction_emit_mov(
+    woort_LIRFunction* function,
+    woort_LIRRegister* aim_r,
+    woort_LIRRegister* src_r)
+{
+    WOORT_LIR_FUNCTION_EMIT_LIR(MOV);
+    opnums->m_r1 = aim_r;
+    opnums->m_r2 = src_r;
+
+    return true;
+}
+
 WOORT_NODISCARD bool woort_LIRFunction_emit_push(
     woort_LIRFunction* function,
     woort_LIRRegister* src_r)
 {
     WOORT_LIR_FUNCTION_EMIT_LIR(PUSH);
     opnums->m_r = src_r;
+    opnums->m_stack_assured = false;
 
     return true;
 }
@@ -513,4 +1066,86 @@ WOORT_NODISCARD bool woort_LIRFunction_emit_jmp(
     return true;
 }
 
+WOORT_NODISCARD bool woort_LIRFunction_emit_jnz(
+    woort_LIRFunction* function,
+    woort_LIRRegister* cond_r,
+    woort_LIRLabel* target_label)
+{
+    WOORT_LIR_FUNCTION_EMIT_LIR(JNZ);
+    opnums->m_r = cond_r;
+    opnums->m_label = target_label;
+    opnums->m_externed = false;
+
+    return true;
+}
+
+WOORT_NODISCARD bool woort_LIRFunction_emit_unary(
+    woort_LIRFunction* function,
+    woort_LIR_Opcode opcode,
+    woort_LIRRegister* aim_r,
+    woort_LIRRegister* src_r)
+{
+    assert(woort_LIR_opcode_formal(opcode) == WOORT_LIR_OPNUMFORMAL_R_R);
+
+    woort_LIR* new_lir;
+    if (!_woort_LIRFunction_append_lir(function, &new_lir))
+        // Failed to append LIR.
+        return false;
+
+    new_lir->m_opcode = opcode;
+    new_lir->m_opnum_formal = WOORT_LIR_OPNUMFORMAL_R_R;
+    new_lir->m_opnums.m_r_r.m_r1 = aim_r;
+    new_lir->m_opnums.m_r_r.m_r2 = src_r;
+
+    return true;
+}
+
+WOORT_NODISCARD bool woort_LIRFunction_emit_binary(
+    woort_LIRFunction* function,
+    woort_LIR_Opcode opcode,
+    woort_LIRRegister* aim_r,
+    woort_LIRRegister* src_r1,
+    woort_LIRRegister* src_r2)
+{
+    assert(woort_LIR_opcode_formal(opcode) == WOORT_LIR_OPNUMFORMAL_R_R_R);
+
+    woort_LIR* new_lir;
+    if (!_woort_LIRFunction_append_lir(function, &new_lir))
+        // Failed to append LIR.
+        return false;
+
+    new_lir->m_opcode = opcode;
+    new_lir->m_opnum_formal = WOORT_LIR_OPNUMFORMAL_R_R_R;
+    new_lir->m_opnums.m_r_r_r.m_r1 = src_r1;
+    new_lir->m_opnums.m_r_r_r.m_r2 = src_r2;
+    new_lir->m_opnums.m_r_r_r.m_r3 = aim_r;
+
+    return true;
+}
+
+WOORT_NODISCARD bool woort_LIRFunction_emit_callnwo(
+    woort_LIRFunction* function,
+    woort_LIRRegister* aim_r,
+    woort_LIR_ConstantStorage function_c,
+    uint16_t argument_count)
+{
+    WOORT_LIR_FUNCTION_EMIT_LIR(CALLNWO);
+    opnums->m_c = function_c;
+    opnums->m_r = aim_r;
+    opnums->m_count16 = argument_count;
+    opnums->m_tail_call = false;
+
+    return true;
+}
+
+WOORT_NODISCARD bool woort_LIRFunction_emit_ret(
+    woort_LIRFunction* function,
+    woort_LIRRegister* src_r)
+{
+    WOORT_LIR_FUNCTION_EMIT_LIR(RET);
+    opnums->m_r = src_r;
+
+    return true;
+}
+
 #undef WOORT_LIR_FUNCTION_EMIT_LIR
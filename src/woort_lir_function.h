@@ -10,6 +10,8 @@ woort_lir_function.h
 #include "woort_lir.h"
 #include "woort_linklist.h"
 #include "woort_vector.h"
+#include "woort_arena.h"
+#include "woort_bitset.h"
 
 // Function.
 typedef struct woort_LIRFunction
@@ -25,6 +27,9 @@ typedef struct woort_LIRFunction
     // LIR codes
     woort_LinkList /* woort_LIR */ m_lir_list;
 
+    // Entry location (in units of 4 bytes) in the committed code, filled when committing.
+    size_t m_entry_bytecode_offset;
+
 }woort_LIRFunction;
 
 void woort_LIRFunction_init(woort_LIRFunction* function);
@@ -38,6 +43,13 @@ WOORT_NODISCARD bool woort_LIRFunction_alloc_register(
     woort_LIRFunction* function,
     woort_LIRRegister** out_register);
 
+/*
+Argument `index` is at bp offset `3 + index`, pushed by caller.
+
+NOTE: Callers must push at least as many arguments as argument registers got by
+    this function, the whole argument area is assumed to be in current frame, tail
+    calls (TCALLNWO) place arguments of callee over it.
+*/
 WOORT_NODISCARD bool woort_LIRFunction_get_argument_register(
     woort_LIRFunction* function,
     uint16_t index,
@@ -47,8 +59,31 @@ typedef void(*woort_LIRFunction_CommitCallback)(
     woort_LIRFunction* function,
     void* user_data);
 
+/*
+Scratch state for committing functions one by one, reused to avoid allocating and
+clearing for each function. Not thread safe, each thread should have its own.
+*/
+typedef struct woort_LIRFunction_Scratch
+{
+    // Temporary memory, should be reset after each function.
+    woort_Arena     m_arena;
+
+    // Occupied slots in register allocation, all unset between functions.
+    woort_Bitset    m_slots;
+
+} woort_LIRFunction_Scratch;
+
+WOORT_NODISCARD bool woort_LIRFunction_scratch_init(woort_LIRFunction_Scratch* scratch);
+void woort_LIRFunction_scratch_deinit(woort_LIRFunction_Scratch* scratch);
+
+/*
+Temporary memory is allocated from `scratch->m_arena`, it will not be released until
+the arena is reset.
+*/
 WOORT_NODISCARD bool woort_LIRFunction_register_allocation(
-    woort_LIRFunction* function, size_t* out_stack_usage);
+    woort_LIRFunction* function,
+    woort_LIRFunction_Scratch* scratch,
+    size_t* out_stack_usage);
 
 /* LIR Emit */
 
@@ -68,9 +103,46 @@ WOORT_NODISCARD bool woort_LIRFunction_emit_store(
     woort_LIRFunction* function,
     woort_LIR_StaticStorage aim_s,
     woort_LIRRegister* src_r);
+WOORT_NODISCARD bool woort_LIRFunction_emit_mov(
+    woort_LIRFunction* function,
+    woort_LIRRegister* aim_r,
+    woort_LIRRegister* src_r);
 WOORT_NODISCARD bool woort_LIRFunction_emit_push(
     woort_LIRFunction* function,
     woort_LIRRegister* src_r);
 WOORT_NODISCARD bool woort_LIRFunction_emit_jmp(
     woort_LIRFunction* function,
     woort_LIRLabel* target_label);
+WOORT_NODISCARD bool woort_LIRFunction_emit_jnz(
+    woort_LIRFunction* function,
+    woort_LIRRegister* cond_r,
+    woort_LIRLabel* target_label);
+/*
+Emit LIR with R_R formal, like NEGI, the operands are stored as (aim, src).
+*/
+WOORT_NODISCARD bool woort_LIRFunction_emit_unary(
+    woort_LIRFunction* function,
+    woort_LIR_Opcode opcode,
+    woort_LIRRegister* aim_r,
+    woort_LIRRegister* src_r);
+/*
+Emit LIR with R_R_R formal, like ADDI, the operands are stored as (src1, src2, aim).
+*/
+WOORT_NODISCARD bool woort_LIRFunction_emit_binary(
+    woort_LIRFunction* function,
+    woort_LIR_Opcode opcode,
+    woort_LIRRegister* aim_r,
+    woort_LIRRegister* src_r1,
+    woort_LIRRegister* src_r2);
+/*
+Call script function in constant `function_c` with `argument_count` arguments pushed
+before, result will be stored in `aim_r` and arguments are popped after calling.
+*/
+WOORT_NODISCARD bool woort_LIRFunction_emit_callnwo(
+    woort_LIRFunction* function,
+    woort_LIRRegister* aim_r,
+    woort_LIR_ConstantStorage function_c,
+    uint16_t argument_count);
+WOORT_NODISCARD bool woort_LIRFunction_emit_ret(
+    woort_LIRFunction* function,
+    woort_LIRRegister* src_r);
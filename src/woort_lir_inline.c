@@ -0,0 +1,404 @@
+#include "woort_lir_inline.h"
+#include "woort_lir.h"
+#include "woort_lir_function.h"
+#include "woort_linklist.h"
+#include "woort_hashmap.h"
+#include "woort_util.h"
+#include "woort_log.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+Registers, labels and LIRs of callee are mapped to the ones in caller, they are all
+distinct objects, so share one map keyed by the address.
+*/
+typedef struct _woort_LIRInline_Context
+{
+    woort_LIRFunction* m_caller;
+
+    woort_HashMap /* uint64_t -> void* */
+                    m_object_map;
+
+} _woort_LIRInline_Context;
+
+WOORT_NODISCARD uint64_t _woort_LIRInline_object_key(const void* object)
+{
+    return (uint64_t)(uintptr_t)object;
+}
+
+WOORT_NODISCARD /* OPTIONAL */ void* _woort_LIRInline_find_mapped(
+    _woort_LIRInline_Context* context, const void* object)
+{
+    const uint64_t key = _woort_LIRInline_object_key(object);
+
+    void** mapped_object;
+    if (!woort_hashmap_find(&context->m_object_map, &key, (void**)&mapped_object))
+        return NULL;
+
+    return *mapped_object;
+}
+
+WOORT_NODISCARD bool _woort_LIRInline_map(
+    _woort_LIRInline_Context* context, const void* object, void* mapped_object)
+{
+    const uint64_t key = _woort_LIRInline_object_key(object);
+
+    return WOORT_HASHMAP_RESULT_OK == woort_hashmap_insert(
+        &context->m_object_map, &key, &mapped_object);
+}
+
+WOORT_NODISCARD bool _woort_LIRInline_map_register(
+    _woort_LIRInline_Context* context, woort_LIRRegister** inout_register)
+{
+    woort_LIRRegister* mapped_register =
+        _woort_LIRInline_find_mapped(context, *inout_register);
+
+    if (mapped_register == NULL)
+    {
+        if (!woort_LIRFunction_alloc_register(context->m_caller, &mapped_register)
+            || !_woort_LIRInline_map(context, *inout_register, mapped_register))
+            // Out of memory.
+            return false;
+    }
+
+    *inout_register = mapped_register;
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_LIRInline_map_label(
+    _woort_LIRInline_Context* context, woort_LIRLabel** inout_label)
+{
+    woort_LIRLabel* mapped_label =
+        _woort_LIRInline_find_mapped(context, *inout_label);
+
+    if (mapped_label == NULL)
+    {
+        // Will be binded after all LIRs copied.
+        if (!woort_LIRFunction_alloc_label(context->m_caller, &mapped_label)
+            || !_woort_LIRInline_map(context, *inout_label, mapped_label))
+            // Out of memory.
+            return false;
+    }
+
+    *inout_label = mapped_label;
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_LIRInline_map_operands(
+    _woort_LIRInline_Context* context, woort_LIR* lir)
+{
+    woort_LIR_Opnums* const opnums = &lir->m_opnums;
+
+    switch (lir->m_opnum_formal)
+    {
+    case WOORT_LIR_OPNUMFORMAL_CS:
+        return true;
+    case WOORT_LIR_OPNUMFORMAL_CS_R:
+        return _woort_LIRInline_map_register(context, &opnums->m_cs_r.m_r);
+    case WOORT_LIR_OPNUMFORMAL_S_R:
+        return _woort_LIRInline_map_register(context, &opnums->m_s_r.m_r);
+    case WOORT_LIR_OPNUMFORMAL_R:
+        return _woort_LIRInline_map_register(context, &opnums->m_r.m_r);
+    case WOORT_LIR_OPNUMFORMAL_R_R:
+        return _woort_LIRInline_map_register(context, &opnums->m_r_r.m_r1)
+            && _woort_LIRInline_map_register(context, &opnums->m_r_r.m_r2);
+    case WOORT_LIR_OPNUMFORMAL_R_R_R:
+        return _woort_LIRInline_map_register(context, &opnums->m_r_r_r.m_r1)
+            && _woort_LIRInline_map_register(context, &opnums->m_r_r_r.m_r2)
+            && _woort_LIRInline_map_register(context, &opnums->m_r_r_r.m_r3);
+    case WOORT_LIR_OPNUMFORMAL_R_R_COUNT16:
+        return _woort_LIRInline_map_register(context, &opnums->m_r_r_count16.m_r1)
+            && _woort_LIRInline_map_register(context, &opnums->m_r_r_count16.m_r2);
+    case WOORT_LIR_OPNUMFORMAL_R_COUNT16:
+        return _woort_LIRInline_map_register(context, &opnums->m_r_count16.m_r);
+    case WOORT_LIR_OPNUMFORMAL_C_R_COUNT16:
+        return _woort_LIRInline_map_register(context, &opnums->m_c_r_count16.m_r);
+    case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
+        // Layout of caller is different, jump range should be checked again.
+        opnums->m_r_r_label.m_externed = false;
+        return _woort_LIRInline_map_register(context, &opnums->m_r_r_label.m_r1)
+            && _woort_LIRInline_map_register(context, &opnums->m_r_r_label.m_r2)
+            && _woort_LIRInline_map_label(context, &opnums->m_r_r_label.m_label);
+    case WOORT_LIR_OPNUMFORMAL_R_LABEL:
+        opnums->m_r_label.m_externed = false;
+        return _woort_LIRInline_map_register(context, &opnums->m_r_label.m_r)
+            && _woort_LIRInline_map_label(context, &opnums->m_r_label.m_label);
+    case WOORT_LIR_OPNUMFORMAL_LABEL:
+        return _woort_LIRInline_map_label(context, &opnums->m_label.m_label);
+    default:
+        WOORT_DEBUG("Unknown LIR opnum formal: %d.", (int)lir->m_opnum_formal);
+        abort();
+    }
+}
+
+WOORT_NODISCARD bool _woort_LIRInline_is_label_binded_to(
+    woort_LIRFunction* function, const woort_LIR* lir)
+{
+    for (
+        woort_LIRLabel* current_label = woort_linklist_iter(&function->m_label_list);
+        current_label != NULL;
+        current_label = woort_linklist_next(current_label))
+    {
+        if (current_label->m_binded_lir == lir)
+            return true;
+    }
+    return false;
+}
+
+/*
+Erase `lir` from `function`, labels binded to it will be binded to the next LIR.
+*/
+void _woort_LIRInline_erase_lir(woort_LIRFunction* function, woort_LIR* lir)
+{
+    woort_LIR* const next_lir = woort_linklist_next(lir);
+    assert(next_lir != NULL);
+
+    for (
+        woort_LIRLabel* current_label = woort_linklist_iter(&function->m_label_list);
+        current_label != NULL;
+        current_label = woort_linklist_next(current_label))
+    {
+        if (current_label->m_binded_lir == lir)
+            current_label->m_binded_lir = next_lir;
+    }
+    woort_linklist_erase(&function->m_lir_list, lir);
+}
+
+WOORT_NODISCARD bool _woort_LIRInline_can_inline(
+    woort_LIRFunction* caller,
+    woort_LIR* call_lir,
+    woort_LIRFunction* callee)
+{
+    const uint16_t argument_count = call_lir->m_opnums.m_CALLNWO.m_count16;
+
+    if (callee == caller
+        || woort_linklist_next(call_lir) == NULL
+        || callee->m_argument_registers.m_size > argument_count)
+        return false;
+
+    size_t callee_lir_count = 0;
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&callee->m_lir_list);
+        current_lir != NULL;
+        current_lir = woort_linklist_next(current_lir))
+    {
+        if (++callee_lir_count > WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT)
+            return false;
+
+        woort_LIRLabel* target_label;
+        switch (current_lir->m_opnum_formal)
+        {
+        case WOORT_LIR_OPNUMFORMAL_LABEL:
+            target_label = current_lir->m_opnums.m_label.m_label;
+            break;
+        case WOORT_LIR_OPNUMFORMAL_R_LABEL:
+            target_label = current_lir->m_opnums.m_r_label.m_label;
+            break;
+        case WOORT_LIR_OPNUMFORMAL_R_R_LABEL:
+            target_label = current_lir->m_opnums.m_r_r_label.m_label;
+            break;
+        default:
+            target_label = NULL;
+            break;
+        }
+
+        if (target_label != NULL && target_label->m_binded_lir == NULL)
+            // Will be reported when committing callee.
+            return false;
+    }
+
+    if (callee_lir_count == 0)
+        // Nothing returned, let it be.
+        return false;
+
+    // Arguments must be pushed right before calling, and no one jumps in between.
+    woort_LIR* current_lir = call_lir;
+    for (uint16_t i = 0; i < argument_count; ++i)
+    {
+        if (_woort_LIRInline_is_label_binded_to(caller, current_lir))
+            return false;
+
+        current_lir = woort_linklist_prev(current_lir);
+        if (current_lir == NULL || current_lir->m_opcode != WOORT_LIR_OPCODE_PUSH)
+            return false;
+    }
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_LIRInline_copy_callee(
+    _woort_LIRInline_Context* context,
+    woort_LIR* call_lir,
+    woort_LIRFunction* callee)
+{
+    woort_LIRFunction* const caller = context->m_caller;
+    woort_LIR* const resume_lir = woort_linklist_next(call_lir);
+    woort_LIRRegister* const result_register = call_lir->m_opnums.m_CALLNWO.m_r;
+
+    // Jumped by returns in callee, binded to the LIR after calling.
+    /* OPTIONAL */ woort_LIRLabel* return_label = NULL;
+
+    woort_LIR* last_lir = call_lir;
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&callee->m_lir_list);
+        current_lir != NULL;
+        current_lir = woort_linklist_next(current_lir))
+    {
+        woort_LIR* new_lir;
+        if (!woort_linklist_emplace_after(&caller->m_lir_list, last_lir, (void**)&new_lir)
+            || !_woort_LIRInline_map(context, current_lir, new_lir))
+            // Out of memory.
+            return false;
+
+        last_lir = new_lir;
+
+        if (current_lir->m_opcode != WOORT_LIR_OPCODE_RET)
+        {
+            *new_lir = *current_lir;
+            new_lir->m_fact_bytecode_offset = 0;
+
+            if (!_woort_LIRInline_map_operands(context, new_lir))
+                return false;
+
+            continue;
+        }
+
+        // RET r -> MOV result, r; JMP return_label
+        new_lir->m_fact_bytecode_offset = 0;
+        new_lir->m_opcode = WOORT_LIR_OPCODE_MOV;
+        new_lir->m_opnum_formal = WOORT_LIR_OP_FORMAL_KIND(MOV);
+        new_lir->m_opnums.m_MOV.m_r1 = result_register;
+        new_lir->m_opnums.m_MOV.m_r2 = current_lir->m_opnums.m_RET.m_r;
+
+        if (!_woort_LIRInline_map_register(context, &new_lir->m_opnums.m_MOV.m_r2))
+            return false;
+
+        if (woort_linklist_next(current_lir) == NULL)
+            // Last return, just fall through.
+            break;
+
+        if (return_label == NULL)
+        {
+            if (!woort_LIRFunction_alloc_label(caller, &return_label))
+                return false;
+
+            return_label->m_binded_lir = resume_lir;
+        }
+
+        if (!woort_linklist_emplace_after(&caller->m_lir_list, last_lir, (void**)&new_lir))
+            return false;
+
+        last_lir = new_lir;
+        new_lir->m_fact_bytecode_offset = 0;
+        new_lir->m_opcode = WOORT_LIR_OPCODE_JMP;
+        new_lir->m_opnum_formal = WOORT_LIR_OP_FORMAL_KIND(JMP);
+        new_lir->m_opnums.m_JMP.m_label = return_label;
+    }
+
+    // Bind labels, all jumping labels are binded in callee, checked before.
+    for (
+        woort_LIRLabel* current_label = woort_linklist_iter(&callee->m_label_list);
+        current_label != NULL;
+        current_label = woort_linklist_next(current_label))
+    {
+        woort_LIRLabel* const mapped_label =
+            _woort_LIRInline_find_mapped(context, current_label);
+
+        if (mapped_label == NULL)
+            // Not used.
+            continue;
+
+        assert(current_label->m_binded_lir != NULL);
+
+        mapped_label->m_binded_lir =
+            _woort_LIRInline_find_mapped(context, current_label->m_binded_lir);
+
+        assert(mapped_label->m_binded_lir != NULL);
+    }
+    return true;
+}
+
+void _woort_LIRInline_pass_arguments(
+    _woort_LIRInline_Context* context,
+    woort_LIR* call_lir,
+    woort_LIRFunction* callee)
+{
+    woort_LIRFunction* const caller = context->m_caller;
+    const uint16_t argument_count = call_lir->m_opnums.m_CALLNWO.m_count16;
+
+    // Argument 0 is pushed last.
+    woort_LIR* push_lir = woort_linklist_prev(call_lir);
+    for (uint16_t i = 0; i < argument_count; ++i)
+    {
+        assert(push_lir != NULL && push_lir->m_opcode == WOORT_LIR_OPCODE_PUSH);
+
+        woort_LIR* const prev_lir = woort_linklist_prev(push_lir);
+
+        /* OPTIONAL */ woort_LIRRegister* argument_register = NULL;
+        if (i < callee->m_argument_registers.m_size)
+        {
+            woort_LIRRegister* const callee_argument_register =
+                *(woort_LIRRegister**)woort_vector_at(&callee->m_argument_registers, i);
+
+            if (callee_argument_register != NULL)
+                // Not mapped if not used.
+                argument_register =
+                    _woort_LIRInline_find_mapped(context, callee_argument_register);
+        }
+
+        if (argument_register == NULL)
+            _woort_LIRInline_erase_lir(caller, push_lir);
+        else
+        {
+            // PUSH r -> MOV argument, r
+            woort_LIRRegister* const pushed_register = push_lir->m_opnums.m_PUSH.m_r;
+
+            push_lir->m_opcode = WOORT_LIR_OPCODE_MOV;
+            push_lir->m_opnum_formal = WOORT_LIR_OP_FORMAL_KIND(MOV);
+            push_lir->m_opnums.m_MOV.m_r1 = argument_register;
+            push_lir->m_opnums.m_MOV.m_r2 = pushed_register;
+        }
+        push_lir = prev_lir;
+    }
+
+    _woort_LIRInline_erase_lir(caller, call_lir);
+}
+
+WOORT_NODISCARD bool woort_LIRFunction_inline_call(
+    woort_LIRFunction* caller,
+    woort_LIR* call_lir,
+    woort_LIRFunction* callee,
+    bool* out_inlined)
+{
+    assert(call_lir->m_opcode == WOORT_LIR_OPCODE_CALLNWO);
+
+    *out_inlined = false;
+
+    if (!_woort_LIRInline_can_inline(caller, call_lir, callee))
+        return true;
+
+    _woort_LIRInline_Context context;
+    context.m_caller = caller;
+    woort_hashmap_init(
+        &context.m_object_map,
+        sizeof(uint64_t),
+        sizeof(void*),
+        woort_util_u64_hash,
+        woort_util_u64_equal);
+
+    if (!_woort_LIRInline_copy_callee(&context, call_lir, callee))
+    {
+        woort_hashmap_deinit(&context.m_object_map);
+        return false;
+    }
+
+    _woort_LIRInline_pass_arguments(&context, call_lir, callee);
+
+    woort_hashmap_deinit(&context.m_object_map);
+
+    *out_inlined = true;
+    return true;
+}
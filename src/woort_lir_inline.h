@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+woort_lir_inline.h
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_lir.h"
+#include "woort_lir_function.h"
+
+#include <stdbool.h>
+
+/*
+Callee with more LIRs than this will not be inlined.
+*/
+#define WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT 16
+
+/*
+Substitute the body of `callee` for `call_lir`, a CALLNWO in `caller` which calls
+`callee`. Registers and labels of callee are remapped to new ones of caller, the
+pushed arguments become MOVs to callee's argument registers, and RETs become MOVs to
+the result register followed by jumps to the LIR after `call_lir`.
+
+`*out_inlined` will be false (and nothing changed) if:
+    1) `callee` is `caller`, or has more LIRs than WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT;
+    2) `callee` jumps to an unbound label, or uses more arguments than passed;
+    3) Arguments are not pushed right before `call_lir`, or some label binded
+        between the pushes and `call_lir`;
+    4) `call_lir` is the last LIR of `caller`.
+
+NOTE: Calls are referenced by function constants, so self recursion cannot be found
+    here, it's caller's duty to make sure `callee` does not call itself.
+NOTE: Returns false only if out of memory, `caller` may be partially modified and
+    cannot be committed any more.
+*/
+WOORT_NODISCARD bool woort_LIRFunction_inline_call(
+    woort_LIRFunction* caller,
+    woort_LIR* call_lir,
+    woort_LIRFunction* callee,
+    bool* out_inlined);
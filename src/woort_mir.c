@@ -0,0 +1,451 @@
+#include "woort_mir.h"
+#include "woort_linklist.h"
+#include "woort_vector.h"
+#include "woort_log.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+
+WOORT_NODISCARD woort_MIRType woort_MIRType_join(woort_MIRType a, woort_MIRType b)
+{
+    if (a == WOORT_MIR_TYPE_NONE)
+        return b;
+    if (b == WOORT_MIR_TYPE_NONE || a == b)
+        return a;
+
+    return WOORT_MIR_TYPE_DYNAMIC;
+}
+
+void woort_MIRFunction_init(woort_MIRFunction* function)
+{
+    woort_linklist_init(
+        &function->m_block_list,
+        sizeof(woort_MIRBlock));
+}
+void woort_MIRFunction_deinit(woort_MIRFunction* function)
+{
+    for (
+        woort_MIRBlock* current_block = woort_linklist_iter(&function->m_block_list);
+        current_block != NULL;
+        current_block = woort_linklist_next(current_block))
+    {
+        for (
+            woort_MIRInstruction* current_instruction =
+                woort_linklist_iter(&current_block->m_instructions);
+            current_instruction != NULL;
+            current_instruction = woort_linklist_next(current_instruction))
+        {
+            woort_vector_deinit(&current_instruction->m_operands);
+            woort_vector_deinit(&current_instruction->m_phi_blocks);
+        }
+        woort_linklist_deinit(&current_block->m_instructions);
+    }
+    woort_linklist_deinit(&function->m_block_list);
+}
+
+WOORT_NODISCARD bool woort_MIRFunction_add_block(
+    woort_MIRFunction* function,
+    woort_MIRBlock** out_block)
+{
+    woort_MIRBlock* new_block;
+    if (!woort_linklist_emplace_back(
+        &function->m_block_list, (void**)&new_block))
+    {
+        // Failed to allocate block.
+        return false;
+    }
+
+    woort_linklist_init(
+        &new_block->m_instructions,
+        sizeof(woort_MIRInstruction));
+    new_block->m_label = NULL;
+
+    *out_block = new_block;
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_MIROpcode_is_terminator(woort_MIROpcode opcode)
+{
+    return opcode == WOORT_MIR_OPCODE_JMP
+        || opcode == WOORT_MIR_OPCODE_BR
+        || opcode == WOORT_MIR_OPCODE_RET;
+}
+
+void _woort_MIRInstruction_init(
+    woort_MIRInstruction* instruction,
+    woort_MIRBlock* block,
+    woort_MIROpcode opcode,
+    woort_MIRType type)
+{
+    instruction->m_opcode = opcode;
+    instruction->m_type = type;
+    instruction->m_block = block;
+    woort_vector_init(
+        &instruction->m_operands,
+        sizeof(woort_MIRInstruction*));
+    woort_vector_init(
+        &instruction->m_phi_blocks,
+        sizeof(woort_MIRBlock*));
+    instruction->m_register = NULL;
+}
+
+bool _woort_MIRBlock_append_instruction(
+    woort_MIRBlock* block,
+    woort_MIROpcode opcode,
+    woort_MIRType type,
+    size_t operand_count,
+    woort_MIRInstruction* const* operands,
+    woort_MIRInstruction** out_instruction)
+{
+    woort_MIRInstruction* last_instruction;
+    if (woort_linklist_back(&block->m_instructions, (void**)&last_instruction)
+        && _woort_MIROpcode_is_terminator(last_instruction->m_opcode))
+    {
+        WOORT_DEBUG("Trying to emit MIR after terminator of block `%p`.", block);
+        return false;
+    }
+
+    woort_MIRInstruction* new_instruction;
+    if (!woort_linklist_emplace_back(
+        &block->m_instructions, (void**)&new_instruction))
+    {
+        // Failed to allocate instruction.
+        return false;
+    }
+
+    _woort_MIRInstruction_init(new_instruction, block, opcode, type);
+
+    if (operand_count != 0
+        && !woort_vector_push_back(&new_instruction->m_operands, operand_count, operands))
+    {
+        // Out of memory.
+        woort_vector_deinit(&new_instruction->m_operands);
+        woort_vector_deinit(&new_instruction->m_phi_blocks);
+        woort_linklist_erase(&block->m_instructions, new_instruction);
+        return false;
+    }
+
+    *out_instruction = new_instruction;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_const(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    woort_LIR_ConstantStorage src_c,
+    woort_MIRInstruction** out_value)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!_woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_CONST, type, 0, NULL, &new_instruction))
+        return false;
+
+    new_instruction->m_constant = src_c;
+
+    *out_value = new_instruction;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_argument(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    uint16_t index,
+    woort_MIRInstruction** out_value)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!_woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_ARG, type, 0, NULL, &new_instruction))
+        return false;
+
+    new_instruction->m_argument_index = index;
+
+    *out_value = new_instruction;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_load(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    woort_LIR_StaticStorage src_s,
+    woort_MIRInstruction** out_value)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!_woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_LOAD, type, 0, NULL, &new_instruction))
+        return false;
+
+    new_instruction->m_static = src_s;
+
+    *out_value = new_instruction;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_call(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    woort_LIR_ConstantStorage function_c,
+    uint16_t argument_count,
+    woort_MIRInstruction* const* arguments,
+    woort_MIRInstruction** out_value)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!_woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_CALL, type, argument_count, arguments, &new_instruction))
+        return false;
+
+    new_instruction->m_constant = function_c;
+
+    *out_value = new_instruction;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_phi(
+    woort_MIRBlock* block,
+    woort_MIRInstruction** out_value)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!woort_linklist_emplace_front(
+        &block->m_instructions, (void**)&new_instruction))
+    {
+        // Failed to allocate instruction.
+        return false;
+    }
+
+    _woort_MIRInstruction_init(
+        new_instruction, block, WOORT_MIR_OPCODE_PHI, WOORT_MIR_TYPE_NONE);
+
+    *out_value = new_instruction;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRInstruction_add_phi_incoming(
+    woort_MIRInstruction* phi,
+    woort_MIRBlock* from_block,
+    woort_MIRInstruction* value)
+{
+    assert(phi->m_opcode == WOORT_MIR_OPCODE_PHI);
+
+    if (!woort_vector_push_back(&phi->m_phi_blocks, 1, &from_block))
+        // Out of memory.
+        return false;
+
+    if (!woort_vector_push_back(&phi->m_operands, 1, &value))
+    {
+        // Out of memory.
+        phi->m_phi_blocks.m_size--;
+        return false;
+    }
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_binary(
+    woort_MIRBlock* block,
+    woort_MIROpcode opcode,
+    woort_MIRInstruction* src_a,
+    woort_MIRInstruction* src_b,
+    woort_MIRInstruction** out_value)
+{
+    assert(opcode >= WOORT_MIR_OPCODE_ADD && opcode <= WOORT_MIR_OPCODE_LOR
+        && opcode != WOORT_MIR_OPCODE_NEG);
+
+    woort_MIRInstruction* const operands[2] = { src_a, src_b };
+    return _woort_MIRBlock_append_instruction(
+        block, opcode, WOORT_MIR_TYPE_NONE, 2, operands, out_value);
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_unary(
+    woort_MIRBlock* block,
+    woort_MIROpcode opcode,
+    woort_MIRInstruction* src,
+    woort_MIRInstruction** out_value)
+{
+    assert(opcode == WOORT_MIR_OPCODE_NEG || opcode == WOORT_MIR_OPCODE_LNOT);
+
+    return _woort_MIRBlock_append_instruction(
+        block, opcode, WOORT_MIR_TYPE_NONE, 1, &src, out_value);
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_store(
+    woort_MIRBlock* block,
+    woort_LIR_StaticStorage aim_s,
+    woort_MIRInstruction* src)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!_woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_STORE, WOORT_MIR_TYPE_NONE, 1, &src, &new_instruction))
+        return false;
+
+    new_instruction->m_static = aim_s;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_jmp(
+    woort_MIRBlock* block,
+    woort_MIRBlock* target_block)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!_woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_JMP, WOORT_MIR_TYPE_NONE, 0, NULL, &new_instruction))
+        return false;
+
+    new_instruction->m_targets[0] = target_block;
+    new_instruction->m_targets[1] = NULL;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_br(
+    woort_MIRBlock* block,
+    woort_MIRInstruction* cond,
+    woort_MIRBlock* then_block,
+    woort_MIRBlock* else_block)
+{
+    woort_MIRInstruction* new_instruction;
+    if (!_woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_BR, WOORT_MIR_TYPE_NONE, 1, &cond, &new_instruction))
+        return false;
+
+    new_instruction->m_targets[0] = then_block;
+    new_instruction->m_targets[1] = else_block;
+    return true;
+}
+
+WOORT_NODISCARD bool woort_MIRBlock_emit_ret(
+    woort_MIRBlock* block,
+    woort_MIRInstruction* src)
+{
+    woort_MIRInstruction* new_instruction;
+    return _woort_MIRBlock_append_instruction(
+        block, WOORT_MIR_OPCODE_RET, WOORT_MIR_TYPE_NONE, 1, &src, &new_instruction);
+}
+
+WOORT_NODISCARD woort_MIRType _woort_MIRInstruction_operand_type(
+    const woort_MIRInstruction* instruction, size_t index)
+{
+    const woort_MIRInstruction* const operand =
+        *(woort_MIRInstruction**)woort_vector_at(
+            (woort_Vector*)&instruction->m_operands, index);
+
+    return operand->m_type;
+}
+
+/*
+Transfer function of type inference, it must be monotone: the result only goes up
+in the lattice if the operands go up.
+*/
+WOORT_NODISCARD woort_MIRType _woort_MIRInstruction_evaluate_type(
+    const woort_MIRInstruction* instruction)
+{
+    switch (instruction->m_opcode)
+    {
+    case WOORT_MIR_OPCODE_PHI:
+    {
+        woort_MIRType type = WOORT_MIR_TYPE_NONE;
+        for (size_t i = 0; i < instruction->m_operands.m_size; ++i)
+            type = woort_MIRType_join(
+                type, _woort_MIRInstruction_operand_type(instruction, i));
+        return type;
+    }
+    case WOORT_MIR_OPCODE_ADD:
+    case WOORT_MIR_OPCODE_SUB:
+    case WOORT_MIR_OPCODE_MUL:
+    case WOORT_MIR_OPCODE_DIV:
+    case WOORT_MIR_OPCODE_MOD:
+    {
+        const woort_MIRType type = woort_MIRType_join(
+            _woort_MIRInstruction_operand_type(instruction, 0),
+            _woort_MIRInstruction_operand_type(instruction, 1));
+
+        // Only ADD is defined for strings.
+        if (type == WOORT_MIR_TYPE_STRING
+            && instruction->m_opcode != WOORT_MIR_OPCODE_ADD)
+            return WOORT_MIR_TYPE_DYNAMIC;
+
+        if (_woort_MIRInstruction_operand_type(instruction, 0) == WOORT_MIR_TYPE_NONE
+            || _woort_MIRInstruction_operand_type(instruction, 1) == WOORT_MIR_TYPE_NONE)
+            // Wait for both operands.
+            return type == WOORT_MIR_TYPE_DYNAMIC ? type : WOORT_MIR_TYPE_NONE;
+
+        return type;
+    }
+    case WOORT_MIR_OPCODE_NEG:
+    {
+        const woort_MIRType type = _woort_MIRInstruction_operand_type(instruction, 0);
+        return type == WOORT_MIR_TYPE_STRING ? WOORT_MIR_TYPE_DYNAMIC : type;
+    }
+    case WOORT_MIR_OPCODE_LT:
+    case WOORT_MIR_OPCODE_GT:
+    case WOORT_MIR_OPCODE_ELT:
+    case WOORT_MIR_OPCODE_EGT:
+    case WOORT_MIR_OPCODE_EQ:
+    case WOORT_MIR_OPCODE_NEQ:
+    {
+        const woort_MIRType a = _woort_MIRInstruction_operand_type(instruction, 0);
+        const woort_MIRType b = _woort_MIRInstruction_operand_type(instruction, 1);
+        const woort_MIRType type = woort_MIRType_join(a, b);
+
+        if (type == WOORT_MIR_TYPE_DYNAMIC)
+            return WOORT_MIR_TYPE_DYNAMIC;
+        if (a == WOORT_MIR_TYPE_NONE || b == WOORT_MIR_TYPE_NONE)
+            return WOORT_MIR_TYPE_NONE;
+
+        // Comparing result is integer 0 or 1.
+        return WOORT_MIR_TYPE_INTEGER;
+    }
+    case WOORT_MIR_OPCODE_LAND:
+    case WOORT_MIR_OPCODE_LOR:
+    case WOORT_MIR_OPCODE_LNOT:
+    {
+        woort_MIRType type = WOORT_MIR_TYPE_NONE;
+        for (size_t i = 0; i < instruction->m_operands.m_size; ++i)
+        {
+            const woort_MIRType operand_type =
+                _woort_MIRInstruction_operand_type(instruction, i);
+
+            if (operand_type == WOORT_MIR_TYPE_NONE)
+                continue;
+            if (operand_type != WOORT_MIR_TYPE_INTEGER)
+                return WOORT_MIR_TYPE_DYNAMIC;
+
+            type = WOORT_MIR_TYPE_INTEGER;
+        }
+        return type;
+    }
+    default:
+        // Declared type or no value.
+        return instruction->m_type;
+    }
+}
+
+void woort_MIRFunction_infer_types(woort_MIRFunction* function)
+{
+    bool changed;
+    do
+    {
+        changed = false;
+        for (
+            woort_MIRBlock* current_block = woort_linklist_iter(&function->m_block_list);
+            current_block != NULL;
+            current_block = woort_linklist_next(current_block))
+        {
+            for (
+                woort_MIRInstruction* current_instruction =
+                    woort_linklist_iter(&current_block->m_instructions);
+                current_instruction != NULL;
+                current_instruction = woort_linklist_next(current_instruction))
+            {
+                // Join with old type, keep it monotone.
+                const woort_MIRType new_type = woort_MIRType_join(
+                    current_instruction->m_type,
+                    _woort_MIRInstruction_evaluate_type(current_instruction));
+
+                if (new_type != current_instruction->m_type)
+                {
+                    current_instruction->m_type = new_type;
+                    changed = true;
+                }
+            }
+        }
+    } while (changed);
+}
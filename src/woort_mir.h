@@ -0,0 +1,204 @@
+#pragma once
+
+/*
+woort_mir.h
+
+Typed SSA mid-level IR, built by frontends and lowered to woort_LIRFunction.
+*/
+
+#include "woort_diagnosis.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "woort_lir.h"
+#include "woort_linklist.h"
+#include "woort_vector.h"
+
+/*
+Type lattice:
+
+               DYNAMIC
+            /     |     \
+      INTEGER   REAL   STRING
+            \     |     /
+                NONE
+
+    NONE means not inferred yet, DYNAMIC means cannot be proven.
+*/
+typedef enum woort_MIRType
+{
+    WOORT_MIR_TYPE_NONE,
+    WOORT_MIR_TYPE_INTEGER,
+    WOORT_MIR_TYPE_REAL,
+    WOORT_MIR_TYPE_STRING,
+    WOORT_MIR_TYPE_DYNAMIC,
+
+} woort_MIRType;
+
+WOORT_NODISCARD woort_MIRType woort_MIRType_join(woort_MIRType a, woort_MIRType b);
+
+typedef enum woort_MIROpcode
+{
+    /* Values with declared type. */
+    WOORT_MIR_OPCODE_CONST,     /* m_constant */
+    WOORT_MIR_OPCODE_ARG,       /* m_argument_index */
+    WOORT_MIR_OPCODE_LOAD,      /* m_static */
+    WOORT_MIR_OPCODE_CALL,      /* m_constant (function), operands are arguments */
+
+    /* Values with inferred type. */
+    WOORT_MIR_OPCODE_PHI,       /* operands are incoming values from m_phi_blocks */
+    WOORT_MIR_OPCODE_ADD,
+    WOORT_MIR_OPCODE_SUB,
+    WOORT_MIR_OPCODE_MUL,
+    WOORT_MIR_OPCODE_DIV,
+    WOORT_MIR_OPCODE_MOD,
+    WOORT_MIR_OPCODE_NEG,
+    WOORT_MIR_OPCODE_LT,
+    WOORT_MIR_OPCODE_GT,
+    WOORT_MIR_OPCODE_ELT,
+    WOORT_MIR_OPCODE_EGT,
+    WOORT_MIR_OPCODE_EQ,
+    WOORT_MIR_OPCODE_NEQ,
+    WOORT_MIR_OPCODE_LAND,
+    WOORT_MIR_OPCODE_LOR,
+    WOORT_MIR_OPCODE_LNOT,
+
+    /* No value. */
+    WOORT_MIR_OPCODE_STORE,     /* m_static, operand 0 is the stored value */
+
+    /* Terminators, no value. */
+    WOORT_MIR_OPCODE_JMP,       /* m_targets[0] */
+    WOORT_MIR_OPCODE_BR,        /* m_targets[0] if operand 0 is not zero, else m_targets[1] */
+    WOORT_MIR_OPCODE_RET,       /* operand 0 is the returned value */
+
+} woort_MIROpcode;
+
+// Instruction, also the SSA value defined by it.
+typedef struct woort_MIRInstruction
+{
+    woort_MIROpcode m_opcode;
+
+    /* NOTE: Always NONE if the instruction does not define a value. */
+    woort_MIRType   m_type;
+
+    struct woort_MIRBlock* m_block;
+
+    woort_Vector /* woort_MIRInstruction* */ m_operands;
+
+    // PHI only, predecessor of each operand.
+    woort_Vector /* woort_MIRBlock* */ m_phi_blocks;
+
+    union {
+        woort_LIR_ConstantStorage m_constant;
+        woort_LIR_StaticStorage m_static;
+        uint16_t m_argument_index;
+        struct woort_MIRBlock* m_targets[2];
+    };
+
+    /* Used in lowering only. */
+    /* OPTIONAL */ woort_LIRRegister* m_register;
+
+} woort_MIRInstruction;
+
+// Basic block, PHIs are always placed at the beginning.
+typedef struct woort_MIRBlock
+{
+    woort_LinkList /* woort_MIRInstruction */ m_instructions;
+
+    /* Used in lowering only. */
+    /* OPTIONAL */ woort_LIRLabel* m_label;
+
+} woort_MIRBlock;
+
+// Function, the first block is the entry.
+typedef struct woort_MIRFunction
+{
+    woort_LinkList /* woort_MIRBlock */ m_block_list;
+
+} woort_MIRFunction;
+
+void woort_MIRFunction_init(woort_MIRFunction* function);
+void woort_MIRFunction_deinit(woort_MIRFunction* function);
+
+WOORT_NODISCARD bool woort_MIRFunction_add_block(
+    woort_MIRFunction* function,
+    woort_MIRBlock** out_block);
+
+/*
+Infer types of all values until fixed point, types only go up in the lattice, so
+this always terminates.
+*/
+void woort_MIRFunction_infer_types(woort_MIRFunction* function);
+
+/* MIR Emit */
+
+/*
+NOTE: Nothing can be emitted into a block after its terminator, except PHIs.
+*/
+WOORT_NODISCARD bool woort_MIRBlock_emit_const(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    woort_LIR_ConstantStorage src_c,
+    woort_MIRInstruction** out_value);
+WOORT_NODISCARD bool woort_MIRBlock_emit_argument(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    uint16_t index,
+    woort_MIRInstruction** out_value);
+WOORT_NODISCARD bool woort_MIRBlock_emit_load(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    woort_LIR_StaticStorage src_s,
+    woort_MIRInstruction** out_value);
+WOORT_NODISCARD bool woort_MIRBlock_emit_call(
+    woort_MIRBlock* block,
+    woort_MIRType type,
+    woort_LIR_ConstantStorage function_c,
+    uint16_t argument_count,
+    woort_MIRInstruction* const* arguments,
+    woort_MIRInstruction** out_value);
+/*
+PHI is placed at the beginning of block, incoming values should be added by
+woort_MIRInstruction_add_phi_incoming later.
+*/
+WOORT_NODISCARD bool woort_MIRBlock_emit_phi(
+    woort_MIRBlock* block,
+    woort_MIRInstruction** out_value);
+WOORT_NODISCARD bool woort_MIRInstruction_add_phi_incoming(
+    woort_MIRInstruction* phi,
+    woort_MIRBlock* from_block,
+    woort_MIRInstruction* value);
+/*
+`opcode` must be one of ADD, SUB, MUL, DIV, MOD, LT, GT, ELT, EGT, EQ, NEQ, LAND, LOR.
+*/
+WOORT_NODISCARD bool woort_MIRBlock_emit_binary(
+    woort_MIRBlock* block,
+    woort_MIROpcode opcode,
+    woort_MIRInstruction* src_a,
+    woort_MIRInstruction* src_b,
+    woort_MIRInstruction** out_value);
+/*
+`opcode` must be one of NEG, LNOT.
+*/
+WOORT_NODISCARD bool woort_MIRBlock_emit_unary(
+    woort_MIRBlock* block,
+    woort_MIROpcode opcode,
+    woort_MIRInstruction* src,
+    woort_MIRInstruction** out_value);
+WOORT_NODISCARD bool woort_MIRBlock_emit_store(
+    woort_MIRBlock* block,
+    woort_LIR_StaticStorage aim_s,
+    woort_MIRInstruction* src);
+WOORT_NODISCARD bool woort_MIRBlock_emit_jmp(
+    woort_MIRBlock* block,
+    woort_MIRBlock* target_block);
+WOORT_NODISCARD bool woort_MIRBlock_emit_br(
+    woort_MIRBlock* block,
+    woort_MIRInstruction* cond,
+    woort_MIRBlock* then_block,
+    woort_MIRBlock* else_block);
+WOORT_NODISCARD bool woort_MIRBlock_emit_ret(
+    woort_MIRBlock* block,
+    woort_MIRInstruction* src);
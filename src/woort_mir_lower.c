@@ -0,0 +1,381 @@
+#include "woort_mir_lower.h"
+#include "woort_log.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+
+WOORT_NODISCARD woort_MIRInstruction* _woort_MIRInstruction_operand(
+    woort_MIRInstruction* instruction, size_t index)
+{
+    return *(woort_MIRInstruction**)woort_vector_at(&instruction->m_operands, index);
+}
+
+WOORT_NODISCARD bool _woort_MIROpcode_has_value(woort_MIROpcode opcode)
+{
+    return opcode < WOORT_MIR_OPCODE_STORE;
+}
+
+WOORT_NODISCARD bool _woort_MIRBlock_has_phi(woort_MIRBlock* block)
+{
+    woort_MIRInstruction* first_instruction;
+    return woort_linklist_front(&block->m_instructions, (void**)&first_instruction)
+        && first_instruction->m_opcode == WOORT_MIR_OPCODE_PHI;
+}
+
+/*
+Select specialized LIR opcode for arithmetic / comparing / logical operation, by
+`type` of its operands (or result for NEG & logical operations).
+*/
+WOORT_NODISCARD bool _woort_MIROpcode_select_lir(
+    woort_MIROpcode opcode,
+    woort_MIRType type,
+    woort_LIR_Opcode* out_opcode)
+{
+    /* No string value in VM yet, operations of STRING are not supported, see
+       woort_MIRFunction_lower. */
+#define WOORT_MIR_SELECT_IR(MIROP, IOP, ROP)                        \
+    case WOORT_MIR_OPCODE_##MIROP:                                  \
+        switch (type)                                               \
+        {                                                           \
+        case WOORT_MIR_TYPE_INTEGER:                                \
+            *out_opcode = WOORT_LIR_OPCODE_##IOP; return true;      \
+        case WOORT_MIR_TYPE_REAL:                                   \
+            *out_opcode = WOORT_LIR_OPCODE_##ROP; return true;      \
+        default:                                                    \
+            return false;                                           \
+        }
+
+    switch (opcode)
+    {
+        WOORT_MIR_SELECT_IR(ADD, ADDI, ADDR);
+        WOORT_MIR_SELECT_IR(SUB, SUBI, SUBR);
+        WOORT_MIR_SELECT_IR(MUL, MULI, MULR);
+        WOORT_MIR_SELECT_IR(DIV, DIVI, DIVR);
+        WOORT_MIR_SELECT_IR(MOD, MODI, MODR);
+        WOORT_MIR_SELECT_IR(NEG, NEGI, NEGR);
+        WOORT_MIR_SELECT_IR(LT, LTI, LTR);
+        WOORT_MIR_SELECT_IR(GT, GTI, GTR);
+        WOORT_MIR_SELECT_IR(ELT, ELTI, ELTR);
+        WOORT_MIR_SELECT_IR(EGT, EGTI, EGTR);
+        WOORT_MIR_SELECT_IR(EQ, EQI, EQR);
+        WOORT_MIR_SELECT_IR(NEQ, NEQI, NEQR);
+    case WOORT_MIR_OPCODE_LAND:
+        *out_opcode = WOORT_LIR_OPCODE_LAND;
+        return type == WOORT_MIR_TYPE_INTEGER;
+    case WOORT_MIR_OPCODE_LOR:
+        *out_opcode = WOORT_LIR_OPCODE_LOR;
+        return type == WOORT_MIR_TYPE_INTEGER;
+    case WOORT_MIR_OPCODE_LNOT:
+        *out_opcode = WOORT_LIR_OPCODE_LNOT;
+        return type == WOORT_MIR_TYPE_INTEGER;
+    default:
+        return false;
+    }
+
+#undef WOORT_MIR_SELECT_IR
+}
+
+typedef struct _woort_MIRLower_PhiMove
+{
+    woort_LIRRegister* m_aim;
+    woort_LIRRegister* m_src;
+
+} _woort_MIRLower_PhiMove;
+
+/*
+Emit MOVs for PHIs of `to_block` on edge `from_block` -> `to_block`. All PHIs take
+their values at the same time, so if there are more than one PHI, values are moved
+into temporary registers first.
+*/
+WOORT_NODISCARD bool _woort_MIRFunction_lower_edge(
+    woort_LIRFunction* lir_function,
+    woort_MIRBlock* from_block,
+    woort_MIRBlock* to_block)
+{
+    woort_Vector /* _woort_MIRLower_PhiMove */ moves;
+    woort_vector_init(&moves, sizeof(_woort_MIRLower_PhiMove));
+
+    for (
+        woort_MIRInstruction* phi = woort_linklist_iter(&to_block->m_instructions);
+        phi != NULL && phi->m_opcode == WOORT_MIR_OPCODE_PHI;
+        phi = woort_linklist_next(phi))
+    {
+        size_t incoming_index = 0;
+        for (; incoming_index < phi->m_phi_blocks.m_size; ++incoming_index)
+        {
+            if (*(woort_MIRBlock**)woort_vector_at(
+                &phi->m_phi_blocks, incoming_index) == from_block)
+                break;
+        }
+        if (incoming_index == phi->m_phi_blocks.m_size)
+        {
+            WOORT_DEBUG("PHI `%p` has no incoming value from block `%p`.", phi, from_block);
+            woort_vector_deinit(&moves);
+            return false;
+        }
+
+        const _woort_MIRLower_PhiMove move = {
+            .m_aim = phi->m_register,
+            .m_src = _woort_MIRInstruction_operand(phi, incoming_index)->m_register,
+        };
+        if (!woort_vector_push_back(&moves, 1, &move))
+        {
+            // Out of memory.
+            woort_vector_deinit(&moves);
+            return false;
+        }
+    }
+
+    bool result = true;
+    if (moves.m_size == 1)
+    {
+        const _woort_MIRLower_PhiMove* const move = woort_vector_at(&moves, 0);
+        result = woort_LIRFunction_emit_mov(lir_function, move->m_aim, move->m_src);
+    }
+    else if (moves.m_size > 1)
+    {
+        // Move to temporary registers first, then replace the source by it.
+        for (size_t i = 0; result && i < moves.m_size; ++i)
+        {
+            _woort_MIRLower_PhiMove* const move = woort_vector_at(&moves, i);
+
+            woort_LIRRegister* temporary_register;
+            result = woort_LIRFunction_alloc_register(lir_function, &temporary_register)
+                && woort_LIRFunction_emit_mov(lir_function, temporary_register, move->m_src);
+
+            move->m_src = temporary_register;
+        }
+        for (size_t i = 0; result && i < moves.m_size; ++i)
+        {
+            const _woort_MIRLower_PhiMove* const move = woort_vector_at(&moves, i);
+            result = woort_LIRFunction_emit_mov(lir_function, move->m_aim, move->m_src);
+        }
+    }
+
+    woort_vector_deinit(&moves);
+    return result;
+}
+
+/*
+Allocate label for each block and register for each value.
+*/
+WOORT_NODISCARD bool _woort_MIRFunction_lower_prepare(
+    woort_MIRFunction* function,
+    woort_LIRFunction* lir_function)
+{
+    for (
+        woort_MIRBlock* current_block = woort_linklist_iter(&function->m_block_list);
+        current_block != NULL;
+        current_block = woort_linklist_next(current_block))
+    {
+        if (!woort_LIRFunction_alloc_label(lir_function, &current_block->m_label))
+            return false;
+
+        for (
+            woort_MIRInstruction* current_instruction =
+                woort_linklist_iter(&current_block->m_instructions);
+            current_instruction != NULL;
+            current_instruction = woort_linklist_next(current_instruction))
+        {
+            current_instruction->m_register = NULL;
+
+            if (!_woort_MIROpcode_has_value(current_instruction->m_opcode))
+                continue;
+
+            if (current_instruction->m_opcode == WOORT_MIR_OPCODE_ARG)
+            {
+                // Argument is SSA value which never be written, use it directly.
+                if (!woort_LIRFunction_get_argument_register(
+                    lir_function,
+                    current_instruction->m_argument_index,
+                    &current_instruction->m_register))
+                    return false;
+            }
+            else if (!woort_LIRFunction_alloc_register(
+                lir_function, &current_instruction->m_register))
+                return false;
+        }
+    }
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_MIRFunction_lower_instruction(
+    woort_LIRFunction* lir_function,
+    woort_MIRInstruction* instruction)
+{
+    switch (instruction->m_opcode)
+    {
+    case WOORT_MIR_OPCODE_CONST:
+        return woort_LIRFunction_emit_loadconst(
+            lir_function, instruction->m_register, instruction->m_constant);
+    case WOORT_MIR_OPCODE_ARG:
+    case WOORT_MIR_OPCODE_PHI:
+        // Nothing to emit, PHIs are lowered on edges.
+        return true;
+    case WOORT_MIR_OPCODE_LOAD:
+        return woort_LIRFunction_emit_loadglobal(
+            lir_function, instruction->m_register, instruction->m_static);
+    case WOORT_MIR_OPCODE_STORE:
+        return woort_LIRFunction_emit_store(
+            lir_function,
+            instruction->m_static,
+            _woort_MIRInstruction_operand(instruction, 0)->m_register);
+    case WOORT_MIR_OPCODE_CALL:
+    {
+        if (instruction->m_operands.m_size > UINT16_MAX)
+        {
+            WOORT_DEBUG("Too many arguments of MIR call `%p`.", instruction);
+            return false;
+        }
+
+        // Argument 0 is pushed at last, see woort_LIRFunction_get_argument_register.
+        for (size_t i = instruction->m_operands.m_size; i > 0; --i)
+        {
+            if (!woort_LIRFunction_emit_push(
+                lir_function,
+                _woort_MIRInstruction_operand(instruction, i - 1)->m_register))
+                return false;
+        }
+        return woort_LIRFunction_emit_callnwo(
+            lir_function,
+            instruction->m_register,
+            instruction->m_constant,
+            (uint16_t)instruction->m_operands.m_size);
+    }
+    case WOORT_MIR_OPCODE_NEG:
+    case WOORT_MIR_OPCODE_LNOT:
+    {
+        woort_LIR_Opcode lir_opcode;
+        if (!_woort_MIROpcode_select_lir(
+            instruction->m_opcode, instruction->m_type, &lir_opcode))
+        {
+            WOORT_DEBUG("Type of MIR `%p` is not proven or not supported.", instruction);
+            return false;
+        }
+        return woort_LIRFunction_emit_unary(
+            lir_function,
+            lir_opcode,
+            instruction->m_register,
+            _woort_MIRInstruction_operand(instruction, 0)->m_register);
+    }
+    default:
+    {
+        assert(instruction->m_opcode >= WOORT_MIR_OPCODE_ADD
+            && instruction->m_opcode <= WOORT_MIR_OPCODE_LOR);
+
+        woort_MIRInstruction* const src_a = _woort_MIRInstruction_operand(instruction, 0);
+        woort_MIRInstruction* const src_b = _woort_MIRInstruction_operand(instruction, 1);
+
+        // Comparing selects by operands, result of them is always INTEGER.
+        woort_MIRType type = instruction->m_type;
+        if (instruction->m_opcode >= WOORT_MIR_OPCODE_LT
+            && instruction->m_opcode <= WOORT_MIR_OPCODE_NEQ)
+        {
+            type = src_a->m_type == src_b->m_type
+                ? src_a->m_type
+                : WOORT_MIR_TYPE_DYNAMIC;
+        }
+
+        woort_LIR_Opcode lir_opcode;
+        if (!_woort_MIROpcode_select_lir(instruction->m_opcode, type, &lir_opcode))
+        {
+            WOORT_DEBUG("Type of MIR `%p` is not proven or not supported.", instruction);
+            return false;
+        }
+        return woort_LIRFunction_emit_binary(
+            lir_function,
+            lir_opcode,
+            instruction->m_register,
+            src_a->m_register,
+            src_b->m_register);
+    }
+    }
+}
+
+WOORT_NODISCARD bool _woort_MIRFunction_lower_terminator(
+    woort_LIRFunction* lir_function,
+    woort_MIRInstruction* terminator)
+{
+    woort_MIRBlock* const block = terminator->m_block;
+
+    switch (terminator->m_opcode)
+    {
+    case WOORT_MIR_OPCODE_JMP:
+        return _woort_MIRFunction_lower_edge(lir_function, block, terminator->m_targets[0])
+            && woort_LIRFunction_emit_jmp(lir_function, terminator->m_targets[0]->m_label);
+    case WOORT_MIR_OPCODE_BR:
+    {
+        woort_MIRBlock* const then_block = terminator->m_targets[0];
+        woort_MIRBlock* const else_block = terminator->m_targets[1];
+        woort_LIRRegister* const cond_r =
+            _woort_MIRInstruction_operand(terminator, 0)->m_register;
+
+        if (!_woort_MIRBlock_has_phi(then_block))
+        {
+            return woort_LIRFunction_emit_jnz(lir_function, cond_r, then_block->m_label)
+                && _woort_MIRFunction_lower_edge(lir_function, block, else_block)
+                && woort_LIRFunction_emit_jmp(lir_function, else_block->m_label);
+        }
+
+        // Then edge needs MOVs, jump to them first.
+        woort_LIRLabel* edge_label;
+        return woort_LIRFunction_alloc_label(lir_function, &edge_label)
+            && woort_LIRFunction_emit_jnz(lir_function, cond_r, edge_label)
+            && _woort_MIRFunction_lower_edge(lir_function, block, else_block)
+            && woort_LIRFunction_emit_jmp(lir_function, else_block->m_label)
+            && woort_LIRFunction_bind(lir_function, edge_label)
+            && _woort_MIRFunction_lower_edge(lir_function, block, then_block)
+            && woort_LIRFunction_emit_jmp(lir_function, then_block->m_label);
+    }
+    case WOORT_MIR_OPCODE_RET:
+        return woort_LIRFunction_emit_ret(
+            lir_function,
+            _woort_MIRInstruction_operand(terminator, 0)->m_register);
+    default:
+        WOORT_DEBUG("Block `%p` is not terminated.", block);
+        return false;
+    }
+}
+
+WOORT_NODISCARD bool woort_MIRFunction_lower(
+    woort_MIRFunction* function,
+    woort_LIRFunction* out_lir_function)
+{
+    woort_MIRFunction_infer_types(function);
+
+    if (!_woort_MIRFunction_lower_prepare(function, out_lir_function))
+        return false;
+
+    for (
+        woort_MIRBlock* current_block = woort_linklist_iter(&function->m_block_list);
+        current_block != NULL;
+        current_block = woort_linklist_next(current_block))
+    {
+        if (!woort_LIRFunction_bind(out_lir_function, current_block->m_label))
+            return false;
+
+        woort_MIRInstruction* terminator;
+        if (!woort_linklist_back(&current_block->m_instructions, (void**)&terminator))
+        {
+            WOORT_DEBUG("Block `%p` is empty.", current_block);
+            return false;
+        }
+
+        for (
+            woort_MIRInstruction* current_instruction =
+                woort_linklist_iter(&current_block->m_instructions);
+            current_instruction != terminator;
+            current_instruction = woort_linklist_next(current_instruction))
+        {
+            if (!_woort_MIRFunction_lower_instruction(
+                out_lir_function, current_instruction))
+                return false;
+        }
+
+        if (!_woort_MIRFunction_lower_terminator(out_lir_function, terminator))
+            return false;
+    }
+    return true;
+}
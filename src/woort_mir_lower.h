@@ -0,0 +1,28 @@
+#pragma once
+
+/*
+woort_mir_lower.h
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_mir.h"
+#include "woort_lir_function.h"
+
+#include <stdbool.h>
+
+/*
+Infer types of `function` and lower it into `out_lir_function`, which should be
+inited and empty.
+
+Arithmetic and comparing operations are lowered to the specialized LIR of their
+proven type (ADDI, ADDR ...). PHIs become MOVs on the incoming edges.
+
+NOTE: Returns false if out of memory, if some block is not terminated, or if some
+    arithmetic / comparing operation has no proven type (NONE or DYNAMIC), there is
+    no dynamic LIR to fall back to. Operations of STRING are refused too, there is
+    no string value in VM yet. `out_lir_function` may be partially emitted and
+    should be deinited then.
+*/
+WOORT_NODISCARD bool woort_MIRFunction_lower(
+    woort_MIRFunction* function,
+    woort_LIRFunction* out_lir_function);
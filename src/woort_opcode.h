@@ -70,8 +70,13 @@ typedef enum woort_Opcode
     /**/ WOORT_OPCODE_CALL,     /*_____MODE______________________________________________________|_______X_______|  */
     /*      CALLS               |_______0________|_______________|__________R_ONLY_S16___________|_______X_______|  */
     /*      CALLC               |_______1________|___________________R_ONLY_C24__________________|_______X_______|  */
-    /*      <RESERVED>          |_______2________|_______________|_______________|_______________|_______________|  */
-    /*      <RESERVED>          |_______3________|_______________|_______________|_______________|_______________|  */
+    /*      TCALLNWO            |_______2________|_______________|_______________N16_____________|__R_ONLY_C32___|  */
+    /*      CALLCDYN            |_______3________|___________________R_ONLY_C24__________________|_______X_______|  */
+    /*
+    CALLC is quickened into CALLNWO/CALLNFP/CALLNJIT by VM at its first execution,
+    and quickened again if the function type is changed; it turns into CALLCDYN (never
+    quickened) once the type changed more than WOORT_VM_CALL_MAX_REQUICKEN_COUNT times.
+    */
     WOORT_OPCODE_RET,           /*_____MODE______________________________________________________|_______X_______|   */
     /*      RET                 |_______0________|_______________________________________________|_______X_______|  */
     /*      RETVS               |_______1________|_______________|__________R_ONLY_S16___________|_______X_______|  */
@@ -191,4 +196,13 @@ typedef enum woort_Opcode
     /*      STIDXDICTEXT        |_______1________|_______________|__________R_ONLY_S16___________|_RMS16_|_R_S16_|  */
     /*      STIDXMAPEXT         |_______2________|_______________|__________R_ONLY_S16___________|_RMS16_|_R_S16_|  */
     /*      STIDSTRUCTEXT       |_______3________|_______________________N24_____________________|_RMS16_|_R_S16_|  */
+    WOORT_OPCODE_PUSHRANGE,     /*_____MODE______________________________________________________|_______X_______|  */
+    /*      PUSHRSCHK           |_______0________|______N8_______|___________R_ONLY_S16__________|_______X_______|  */
+    /*      PUSHRS              |_______1________|______N8_______|___________R_ONLY_S16__________|_______X_______|  */
+    /*      PUSHRCCHK           |_______2________|_______________________N24_____________________|__R_ONLY_C32___|  */
+    /*      PUSHRC              |_______3________|_______________________N24_____________________|__R_ONLY_C32___|  */
+    /*
+    PUSHRANGE pushes N values in one copy, as if they were pushed from the highest
+    one to the lowest one, the given S16/C32 is the lowest one.
+    */
 } woort_Opcode;
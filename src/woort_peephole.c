@@ -0,0 +1,719 @@
+#include "woort_peephole.h"
+#include "woort_log.h"
+#include "woort_opcode.h"
+#include "woort_opcode_formal.h"
+#include "woort_vector.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define WOORT_PEEPHOLE_NO_JUMP SIZE_MAX
+
+typedef struct _woort_PeepholeInstruction
+{
+    size_t  m_offset;
+    size_t  m_length;
+
+    // Index of jump target instruction, WOORT_PEEPHOLE_NO_JUMP if not a jump.
+    size_t  m_jump_target;
+
+    // Some jump targets here, cannot be merged with the previous instruction.
+    bool    m_is_leader;
+    bool    m_is_removed;
+
+} _woort_PeepholeInstruction;
+
+/*
+Return the length of instruction (in units of 4 bytes) according to the operand
+layout in woort_opcode.h, 0 means unknown (reserved) instruction.
+*/
+size_t _woort_peephole_instruction_length(woort_Bytecode bc)
+{
+    const uint32_t mode = WOORT_BYTECODE(M2, bc);
+
+    switch ((woort_Opcode)WOORT_BYTECODE(OP6, bc))
+    {
+    case WOORT_OPCODE_LOADEX:
+    case WOORT_OPCODE_STOREEX:
+    case WOORT_OPCODE_MKCLOS:
+    case WOORT_OPCODE_LDIDXEX:
+    case WOORT_OPCODE_STIDXEX:
+        return 2;
+    case WOORT_OPCODE_MOV:
+    case WOORT_OPCODE_PUSHRANGE:
+        return mode >= 2 ? 2 : 1;
+    case WOORT_OPCODE_PUSHCHK:
+    case WOORT_OPCODE_PUSH:
+    case WOORT_OPCODE_POP:
+        return mode == 3 ? 2 : 1;
+    case WOORT_OPCODE_CONSEX:
+        return mode == 3 ? 0 : 2;
+    case WOORT_OPCODE_CALL:
+        return mode == 2 ? 2 : 1;
+    case WOORT_OPCODE_RET:
+    case WOORT_OPCODE_CONS:
+    case WOORT_OPCODE_OPSREN:
+    case WOORT_OPCODE_OPCLAONST:
+        return mode == 3 ? 0 : 1;
+    case WOORT_OPCODE_NOP:
+    case WOORT_OPCODE_LOAD:
+    case WOORT_OPCODE_STORE:
+    case WOORT_OPCODE_CASTI:
+    case WOORT_OPCODE_CASTR:
+    case WOORT_OPCODE_CASTS:
+    case WOORT_OPCODE_CALLNWO:
+    case WOORT_OPCODE_CALLNFP:
+    case WOORT_OPCODE_CALLNJIT:
+    case WOORT_OPCODE_RESULT:
+    case WOORT_OPCODE_JMP:
+    case WOORT_OPCODE_JMPGC:
+    case WOORT_OPCODE_JCOND:
+    case WOORT_OPCODE_JCONDGC:
+    case WOORT_OPCODE_DYN:
+    case WOORT_OPCODE_OPIASMD:
+    case WOORT_OPCODE_OPIONLG:
+    case WOORT_OPCODE_OPISREN:
+    case WOORT_OPCODE_OPRASMD:
+    case WOORT_OPCODE_OPRONLG:
+    case WOORT_OPCODE_OPRSREN:
+    case WOORT_OPCODE_OPSALGS:
+    case WOORT_OPCODE_OPLAONI:
+    case WOORT_OPCODE_OPCIASMDST:
+    case WOORT_OPCODE_OPCRASMDST:
+    case WOORT_OPCODE_OPCSAIOOST:
+    case WOORT_OPCODE_LDIDX:
+    case WOORT_OPCODE_STIDX:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+WOORT_NODISCARD bool _woort_peephole_is_unconditional_jump(woort_Bytecode bc)
+{
+    const woort_Opcode opcode = (woort_Opcode)WOORT_BYTECODE(OP6, bc);
+    return opcode == WOORT_OPCODE_JMP || opcode == WOORT_OPCODE_JMPGC;
+}
+
+WOORT_NODISCARD bool _woort_peephole_is_conditional_jump(woort_Bytecode bc)
+{
+    const woort_Opcode opcode = (woort_Opcode)WOORT_BYTECODE(OP6, bc);
+    return opcode == WOORT_OPCODE_JCOND || opcode == WOORT_OPCODE_JCONDGC;
+}
+
+/*
+Max distance can be encoded by the jump instruction, both forward and backward.
+*/
+WOORT_NODISCARD size_t _woort_peephole_jump_distance_limit(woort_Bytecode bc)
+{
+    if (_woort_peephole_is_unconditional_jump(bc))
+        return WOORT_BYTECODE_MABC26_MASK;
+
+    assert(_woort_peephole_is_conditional_jump(bc));
+
+    // JxCONDNZ & JxCONDZ use BR16, JxCONDEQ & JxCONDNE use BR8.
+    return WOORT_BYTECODE(M2, bc) < 2 ? UINT16_MAX : UINT8_MAX;
+}
+
+/*
+Return false if the jump target is not an instruction begin, the offsets cannot be
+trusted in this case.
+*/
+WOORT_NODISCARD bool _woort_peephole_resolve_jump_target(
+    const woort_Bytecode* codes,
+    size_t code_count,
+    const size_t* instruction_index_of_offset,
+    _woort_PeepholeInstruction* instruction)
+{
+    const woort_Bytecode bc = codes[instruction->m_offset];
+
+    size_t target_offset;
+    switch ((woort_Opcode)WOORT_BYTECODE(OP6, bc))
+    {
+    case WOORT_OPCODE_JMP:
+        target_offset = instruction->m_offset + WOORT_BYTECODE(MABC26, bc);
+        break;
+    case WOORT_OPCODE_JMPGC:
+        if (WOORT_BYTECODE(MABC26, bc) > instruction->m_offset)
+            return false;
+        target_offset = instruction->m_offset - WOORT_BYTECODE(MABC26, bc);
+        break;
+    case WOORT_OPCODE_JCOND:
+    case WOORT_OPCODE_JCONDGC:
+    {
+        const size_t distance = WOORT_BYTECODE(M2, bc) < 2
+            ? WOORT_BYTECODE(BC16, bc)
+            : WOORT_BYTECODE(C8, bc);
+
+        if (WOORT_BYTECODE(OP6, bc) == WOORT_OPCODE_JCOND)
+            target_offset = instruction->m_offset + distance;
+        else if (distance > instruction->m_offset)
+            return false;
+        else
+            target_offset = instruction->m_offset - distance;
+        break;
+    }
+    default:
+        // Not a jump.
+        return true;
+    }
+
+    if (target_offset >= code_count
+        || instruction_index_of_offset[target_offset] == WOORT_PEEPHOLE_NO_JUMP)
+    {
+        WOORT_DEBUG(
+            "Jump at %zu targets %zu, which is not an instruction begin.",
+            instruction->m_offset,
+            target_offset);
+        return false;
+    }
+
+    instruction->m_jump_target = instruction_index_of_offset[target_offset];
+    return true;
+}
+
+/*
+Retarget jumps which jump to unconditional jumps to the final target, if the final
+target can be encoded.
+
+Return true if any jump has been retargeted.
+*/
+WOORT_NODISCARD bool _woort_peephole_thread_jumps(
+    const woort_Bytecode* codes,
+    _woort_PeepholeInstruction* instructions,
+    size_t instruction_count)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < instruction_count; ++i)
+    {
+        _woort_PeepholeInstruction* const instruction = &instructions[i];
+        if (instruction->m_is_removed
+            || instruction->m_jump_target == WOORT_PEEPHOLE_NO_JUMP)
+            continue;
+
+        size_t final_target = instruction->m_jump_target;
+
+        // Limit the steps to avoid looping in jump cycles.
+        for (size_t step = 0; step < instruction_count; ++step)
+        {
+            // Removed instructions do nothing, skip them.
+            while (instructions[final_target].m_is_removed
+                && final_target + 1 < instruction_count)
+                ++final_target;
+
+            const _woort_PeepholeInstruction* const target = &instructions[final_target];
+
+            if (!_woort_peephole_is_unconditional_jump(codes[target->m_offset])
+                || target->m_jump_target == final_target)
+                break;
+
+            final_target = target->m_jump_target;
+        }
+
+        if (final_target == instruction->m_jump_target)
+            continue;
+
+        const size_t self_offset = instruction->m_offset;
+        const size_t target_offset = instructions[final_target].m_offset;
+        const size_t distance = self_offset > target_offset
+            ? self_offset - target_offset
+            : target_offset - self_offset;
+
+        // Removing instructions only makes distance shorter, check it now is enough.
+        if (distance <= _woort_peephole_jump_distance_limit(codes[self_offset]))
+        {
+            instruction->m_jump_target = final_target;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/*
+Return true if the instruction is a MOV from a register to itself.
+*/
+WOORT_NODISCARD bool _woort_peephole_is_self_move(
+    const woort_Bytecode* codes,
+    const _woort_PeepholeInstruction* instruction)
+{
+    const woort_Bytecode bc = codes[instruction->m_offset];
+
+    if ((woort_Opcode)WOORT_BYTECODE(OP6, bc) != WOORT_OPCODE_MOV)
+        return false;
+
+    switch (WOORT_BYTECODE(M2, bc))
+    {
+    case 0: // MOVLD
+    case 1: // MOVST
+        return (int8_t)WOORT_BYTECODE(A8, bc) == (int16_t)WOORT_BYTECODE(BC16, bc);
+    default: // MOVLDEXT & MOVSTEXT
+        return (int16_t)WOORT_BYTECODE(BC16, bc) == (int32_t)codes[instruction->m_offset + 1];
+    }
+}
+
+/*
+`store` has been stored into a static, and `load` loads the same static right after
+it, try to remove `load` or replace it with a register MOV.
+
+Return true if the codes have been changed.
+*/
+WOORT_NODISCARD bool _woort_peephole_forward_store_to_load(
+    woort_Bytecode* codes,
+    const _woort_PeepholeInstruction* store,
+    _woort_PeepholeInstruction* load)
+{
+    const woort_Bytecode store_bc = codes[store->m_offset];
+    const woort_Bytecode load_bc = codes[load->m_offset];
+
+    const woort_Opcode store_opcode = (woort_Opcode)WOORT_BYTECODE(OP6, store_bc);
+    const woort_Opcode load_opcode = (woort_Opcode)WOORT_BYTECODE(OP6, load_bc);
+
+    if (store_opcode == WOORT_OPCODE_STORE && load_opcode == WOORT_OPCODE_LOAD)
+    {
+        if (WOORT_BYTECODE(MAB18, store_bc) != WOORT_BYTECODE(MAB18, load_bc))
+            return false;
+
+        const int8_t stored_register = (int8_t)WOORT_BYTECODE(C8, store_bc);
+        const int8_t loading_register = (int8_t)WOORT_BYTECODE(C8, load_bc);
+
+        if (stored_register == loading_register)
+            load->m_is_removed = true;
+        else
+            // MOVLD loading_register, stored_register
+            codes[load->m_offset] = woort_OpCodeFormal_cons(
+                OP6_M2_A8_BC16,
+                WOORT_OPCODE_MOV,
+                0,
+                (uint8_t)loading_register,
+                (uint16_t)(int16_t)stored_register);
+
+        return true;
+    }
+    else if (store_opcode == WOORT_OPCODE_STOREEX && load_opcode == WOORT_OPCODE_LOADEX)
+    {
+        if (WOORT_BYTECODE(MA10, store_bc) != WOORT_BYTECODE(MA10, load_bc)
+            || codes[store->m_offset + 1] != codes[load->m_offset + 1])
+            return false;
+
+        const int16_t stored_register = (int16_t)WOORT_BYTECODE(BC16, store_bc);
+        const int16_t loading_register = (int16_t)WOORT_BYTECODE(BC16, load_bc);
+
+        if (stored_register == loading_register)
+            load->m_is_removed = true;
+        else
+        {
+            // MOVLDEXT loading_register, stored_register
+            codes[load->m_offset] = woort_OpCodeFormal_cons(
+                OP6_M2_BC16,
+                WOORT_OPCODE_MOV,
+                2,
+                (uint16_t)loading_register);
+            codes[load->m_offset + 1] = (woort_Bytecode)(int32_t)stored_register;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+Max count of values can be pushed by one PUSHRANGE, PUSHRSCHK & PUSHRS count in N8.
+*/
+#define WOORT_PEEPHOLE_PUSH_RANGE_SLOT_LIMIT ((size_t)UINT8_MAX)
+#define WOORT_PEEPHOLE_PUSH_RANGE_CONSTANT_LIMIT \
+    ((size_t)(WOORT_BYTECODE_ABC24_MASK >> WOORT_BYTECODE_ABC24_SHIFT))
+
+typedef enum _woort_PeepholePushKind
+{
+    WOORT_PEEPHOLE_PUSH_NONE,
+    WOORT_PEEPHOLE_PUSH_SLOT_CHECKED,
+    WOORT_PEEPHOLE_PUSH_SLOT,
+    WOORT_PEEPHOLE_PUSH_CONSTANT_CHECKED,
+    WOORT_PEEPHOLE_PUSH_CONSTANT,
+
+} _woort_PeepholePushKind;
+
+/*
+Return the kind of single value push, and the slot or constant index it pushes.
+*/
+WOORT_NODISCARD _woort_PeepholePushKind _woort_peephole_push_kind(
+    const woort_Bytecode* codes,
+    const _woort_PeepholeInstruction* instruction,
+    int64_t* out_index)
+{
+    const woort_Bytecode bc = codes[instruction->m_offset];
+    const woort_Opcode opcode = (woort_Opcode)WOORT_BYTECODE(OP6, bc);
+
+    if (opcode != WOORT_OPCODE_PUSHCHK && opcode != WOORT_OPCODE_PUSH)
+        return WOORT_PEEPHOLE_PUSH_NONE;
+
+    const bool checked = opcode == WOORT_OPCODE_PUSHCHK;
+    switch (WOORT_BYTECODE(M2, bc))
+    {
+    case 1: // PUSHSCHK & PUSHS
+        *out_index = (int16_t)WOORT_BYTECODE(BC16, bc);
+        return checked ? WOORT_PEEPHOLE_PUSH_SLOT_CHECKED : WOORT_PEEPHOLE_PUSH_SLOT;
+    case 2: // PUSHCCHK & PUSHC
+        *out_index = WOORT_BYTECODE(ABC24, bc);
+        return checked ? WOORT_PEEPHOLE_PUSH_CONSTANT_CHECKED : WOORT_PEEPHOLE_PUSH_CONSTANT;
+    case 3: // PUSHCCHKEXT & PUSHCEXT
+        *out_index = codes[instruction->m_offset + 1];
+        return checked ? WOORT_PEEPHOLE_PUSH_CONSTANT_CHECKED : WOORT_PEEPHOLE_PUSH_CONSTANT;
+    default: // PUSHRCHK & ASSURESSZ
+        return WOORT_PEEPHOLE_PUSH_NONE;
+    }
+}
+
+/*
+Merge pushes begin from `first` into one PUSHRANGE, if they push values stored in
+contiguous slots or constants, from the highest one to the lowest one.
+
+Return true if the codes have been changed.
+*/
+WOORT_NODISCARD bool _woort_peephole_merge_push_range(
+    woort_Bytecode* codes,
+    _woort_PeepholeInstruction* instructions,
+    size_t instruction_count,
+    size_t first)
+{
+    int64_t lowest_index;
+    const _woort_PeepholePushKind kind =
+        _woort_peephole_push_kind(codes, &instructions[first], &lowest_index);
+
+    if (kind == WOORT_PEEPHOLE_PUSH_NONE)
+        return false;
+
+    const bool push_slots =
+        kind == WOORT_PEEPHOLE_PUSH_SLOT_CHECKED || kind == WOORT_PEEPHOLE_PUSH_SLOT;
+    const size_t count_limit = push_slots
+        ? WOORT_PEEPHOLE_PUSH_RANGE_SLOT_LIMIT
+        : WOORT_PEEPHOLE_PUSH_RANGE_CONSTANT_LIMIT;
+
+    size_t count = 1;
+    while (first + count < instruction_count && count < count_limit)
+    {
+        const _woort_PeepholeInstruction* const next = &instructions[first + count];
+
+        int64_t next_index;
+        if (next->m_is_removed
+            || next->m_is_leader
+            || _woort_peephole_push_kind(codes, next, &next_index) != kind
+            || next_index != lowest_index - 1)
+            break;
+
+        lowest_index = next_index;
+        ++count;
+    }
+
+    if (count < 2)
+        return false;
+
+    _woort_PeepholeInstruction* const range = &instructions[first];
+    const bool checked =
+        kind == WOORT_PEEPHOLE_PUSH_SLOT_CHECKED
+        || kind == WOORT_PEEPHOLE_PUSH_CONSTANT_CHECKED;
+
+    if (push_slots)
+    {
+        // PUSHRSCHK/PUSHRS COUNT LOWEST_SLOT
+        codes[range->m_offset] = woort_OpCodeFormal_cons(
+            OP6_M2_A8_BC16,
+            WOORT_OPCODE_PUSHRANGE,
+            checked ? 0 : 1,
+            (uint8_t)count,
+            (uint16_t)(int16_t)lowest_index);
+        range->m_length = 1;
+    }
+    else
+    {
+        /*
+        PUSHRCCHK/PUSHRC COUNT, LOWEST_CONSTANT
+            Merged pushes are at least 2 codes long and placed next to each other,
+        the following code can be taken.
+        */
+        codes[range->m_offset] = woort_OpCodeFormal_cons(
+            OP6_M2_ABC24,
+            WOORT_OPCODE_PUSHRANGE,
+            checked ? 2 : 3,
+            (uint32_t)count);
+        codes[range->m_offset + 1] = (woort_Bytecode)lowest_index;
+        range->m_length = 2;
+    }
+
+    for (size_t i = 1; i < count; ++i)
+        instructions[first + i].m_is_removed = true;
+
+    return true;
+}
+
+/*
+Remove jumps whose target is the next living instruction, scan backward so that
+removing a jump can make the jumps before it removable too.
+*/
+WOORT_NODISCARD bool _woort_peephole_remove_jumps_to_next(
+    _woort_PeepholeInstruction* instructions,
+    size_t instruction_count)
+{
+    bool changed = false;
+
+    for (size_t i = instruction_count; i > 0; --i)
+    {
+        _woort_PeepholeInstruction* const instruction = &instructions[i - 1];
+
+        if (instruction->m_is_removed
+            || instruction->m_jump_target == WOORT_PEEPHOLE_NO_JUMP
+            || instruction->m_jump_target < i)
+            continue;
+
+        bool jump_to_next = true;
+        for (size_t k = i; k < instruction->m_jump_target; ++k)
+        {
+            if (!instructions[k].m_is_removed)
+            {
+                jump_to_next = false;
+                break;
+            }
+        }
+
+        if (jump_to_next)
+        {
+            // Conditional jumps have no side effects, can be removed too.
+            instruction->m_is_removed = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/*
+Move living instructions to their new offsets and re-encode all jumps.
+*/
+void _woort_peephole_compact(
+    woort_Bytecode* codes,
+    _woort_PeepholeInstruction* instructions,
+    size_t instruction_count,
+    size_t* new_offsets,
+    size_t* out_code_count)
+{
+    size_t new_offset = 0;
+    for (size_t i = 0; i < instruction_count; ++i)
+    {
+        new_offsets[i] = new_offset;
+
+        if (!instructions[i].m_is_removed)
+            new_offset += instructions[i].m_length;
+    }
+
+    for (size_t i = 0; i < instruction_count; ++i)
+    {
+        const _woort_PeepholeInstruction* const instruction = &instructions[i];
+        if (instruction->m_is_removed)
+            continue;
+
+        // New offset never goes after the old one, move forward is safe.
+        woort_Bytecode* const moved_code = &codes[new_offsets[i]];
+        memmove(
+            moved_code,
+            &codes[instruction->m_offset],
+            instruction->m_length * sizeof(woort_Bytecode));
+
+        if (instruction->m_jump_target == WOORT_PEEPHOLE_NO_JUMP)
+            continue;
+
+        const woort_Bytecode bc = *moved_code;
+        const size_t self_offset = new_offsets[i];
+        const size_t target_offset = new_offsets[instruction->m_jump_target];
+        const bool jump_forward = target_offset > self_offset;
+        const size_t distance = jump_forward
+            ? target_offset - self_offset
+            : self_offset - target_offset;
+
+        assert(distance <= _woort_peephole_jump_distance_limit(bc));
+
+        // Jumps backward must check GC safe point.
+        if (_woort_peephole_is_unconditional_jump(bc))
+            *moved_code = woort_OpCodeFormal_cons(
+                OP6_MABC26,
+                jump_forward ? WOORT_OPCODE_JMP : WOORT_OPCODE_JMPGC,
+                distance);
+        else if (WOORT_BYTECODE(M2, bc) < 2)
+            *moved_code = woort_OpCodeFormal_cons(
+                OP6_M2_A8_BC16,
+                jump_forward ? WOORT_OPCODE_JCOND : WOORT_OPCODE_JCONDGC,
+                WOORT_BYTECODE(M2, bc),
+                WOORT_BYTECODE(A8, bc),
+                distance);
+        else
+            *moved_code = woort_OpCodeFormal_cons(
+                OP6_M2_A8_B8_C8,
+                jump_forward ? WOORT_OPCODE_JCOND : WOORT_OPCODE_JCONDGC,
+                WOORT_BYTECODE(M2, bc),
+                WOORT_BYTECODE(A8, bc),
+                WOORT_BYTECODE(B8, bc),
+                distance);
+    }
+
+    *out_code_count = new_offset;
+}
+
+WOORT_NODISCARD /* OPTIONAL */ void* _woort_peephole_scratch_alloc(
+    /* OPTIONAL */ woort_Arena* scratch_arena, size_t size)
+{
+    return scratch_arena != NULL
+        ? woort_arena_alloc(scratch_arena, size)
+        : malloc(size);
+}
+void _woort_peephole_scratch_free(
+    /* OPTIONAL */ woort_Arena* scratch_arena, void* data)
+{
+    // Memory in arena is released with the arena.
+    if (scratch_arena == NULL)
+        free(data);
+}
+
+WOORT_NODISCARD bool woort_peephole_optimize(
+    woort_Vector* /* woort_Bytecode */ code_holder,
+    /* OPTIONAL */ woort_Arena* scratch_arena)
+{
+    woort_Bytecode* const codes = (woort_Bytecode*)code_holder->m_data;
+    const size_t code_count = code_holder->m_size;
+
+    if (code_count == 0)
+        return true;
+
+    // 0. Decode instructions.
+    woort_Vector /* _woort_PeepholeInstruction */ instruction_list;
+    woort_vector_init_with_arena(
+        &instruction_list, sizeof(_woort_PeepholeInstruction), scratch_arena);
+
+    size_t* const instruction_index_of_offset =
+        _woort_peephole_scratch_alloc(scratch_arena, code_count * sizeof(size_t));
+    if (instruction_index_of_offset == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        return false;
+    }
+
+    bool optimizable = true;
+    for (size_t offset = 0; offset < code_count;)
+    {
+        _woort_PeepholeInstruction instruction;
+        instruction.m_offset = offset;
+        instruction.m_length = _woort_peephole_instruction_length(codes[offset]);
+        instruction.m_jump_target = WOORT_PEEPHOLE_NO_JUMP;
+        instruction.m_is_leader = false;
+        instruction.m_is_removed = false;
+
+        if (instruction.m_length == 0 || offset + instruction.m_length > code_count)
+        {
+            WOORT_DEBUG("Unknown instruction at %zu, skip peephole.", offset);
+            optimizable = false;
+            break;
+        }
+
+        instruction_index_of_offset[offset] = instruction_list.m_size;
+        for (size_t i = 1; i < instruction.m_length; ++i)
+            instruction_index_of_offset[offset + i] = WOORT_PEEPHOLE_NO_JUMP;
+
+        if (!woort_vector_push_back(&instruction_list, 1, &instruction))
+        {
+            _woort_peephole_scratch_free(scratch_arena, instruction_index_of_offset);
+            woort_vector_deinit(&instruction_list);
+            return false;
+        }
+
+        offset += instruction.m_length;
+    }
+
+    _woort_PeepholeInstruction* const instructions =
+        (_woort_PeepholeInstruction*)instruction_list.m_data;
+    const size_t instruction_count = instruction_list.m_size;
+
+    // 1. Resolve jumps & mark leaders.
+    for (size_t i = 0; optimizable && i < instruction_count; ++i)
+    {
+        if (!_woort_peephole_resolve_jump_target(
+            codes, code_count, instruction_index_of_offset, &instructions[i]))
+        {
+            optimizable = false;
+            break;
+        }
+        if (instructions[i].m_jump_target != WOORT_PEEPHOLE_NO_JUMP)
+            instructions[instructions[i].m_jump_target].m_is_leader = true;
+    }
+    _woort_peephole_scratch_free(scratch_arena, instruction_index_of_offset);
+
+    if (!optimizable)
+    {
+        woort_vector_deinit(&instruction_list);
+        return true;
+    }
+
+    // Allocate before changing anything, codes must be untouched if failed.
+    size_t* const new_offsets =
+        _woort_peephole_scratch_alloc(scratch_arena, instruction_count * sizeof(size_t));
+    if (new_offsets == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        woort_vector_deinit(&instruction_list);
+        return false;
+    }
+
+    // 2. Apply patterns.
+    bool changed = false;
+
+    for (size_t i = 0; i < instruction_count; ++i)
+    {
+        if (instructions[i].m_is_removed)
+            continue;
+
+        if (_woort_peephole_is_self_move(codes, &instructions[i]))
+        {
+            instructions[i].m_is_removed = true;
+            changed = true;
+        }
+        else if (i + 1 < instruction_count
+            && !instructions[i + 1].m_is_leader
+            && _woort_peephole_forward_store_to_load(
+                codes, &instructions[i], &instructions[i + 1]))
+        {
+            changed = true;
+        }
+        else if (_woort_peephole_merge_push_range(
+            codes, instructions, instruction_count, i))
+        {
+            changed = true;
+        }
+    }
+
+    // Remove jumps to next first, they should not be threaded to somewhere else.
+    if (_woort_peephole_remove_jumps_to_next(instructions, instruction_count))
+        changed = true;
+
+    if (_woort_peephole_thread_jumps(codes, instructions, instruction_count))
+    {
+        changed = true;
+
+        // Jumps may be threaded to the next instruction.
+        changed |= _woort_peephole_remove_jumps_to_next(instructions, instruction_count);
+    }
+
+    // 3. Compact & re-encode jumps.
+    if (changed)
+    {
+        size_t new_code_count;
+        _woort_peephole_compact(
+            codes, instructions, instruction_count, new_offsets, &new_code_count);
+
+        // Only shrinks, no need to reallocate.
+        code_holder->m_size = new_code_count;
+    }
+
+    _woort_peephole_scratch_free(scratch_arena, new_offsets);
+    woort_vector_deinit(&instruction_list);
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+/*
+woort_peephole.h
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_vector.h"
+
+#include <stdbool.h>
+
+/*
+Optimize the bytecodes of one function in place, following patterns are handled:
+    1) MOV a register to itself;
+    2) LOAD a static right after STORE it from register (without jump in between);
+    3) Jump to another unconditional jump (threaded to the final target);
+    4) Jump to the next instruction;
+    5) Pushes of contiguous slots or constants (merged into one PUSHRANGE).
+
+Jump displacements are re-encoded after instructions removed, all jump targets must
+be instruction begins inside `code_holder`, or the codes are kept untouched.
+
+Temporary memory is allocated from `scratch_arena` if given, it will not be released
+until the arena is reset.
+
+NOTE: Returns false only if out of memory, in which case `code_holder` is unchanged.
+*/
+WOORT_NODISCARD bool woort_peephole_optimize(
+    woort_Vector* /* woort_Bytecode */ code_holder,
+    /* OPTIONAL */ woort_Arena* scratch_arena);
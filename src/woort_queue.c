@@ -0,0 +1,217 @@
+#include "woort_queue.h"
+#include "woort_log.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+/* ============================================== */
+/*          Bounded MPMC Queue (Vyukov)           */
+/* ============================================== */
+
+WOORT_NODISCARD bool woort_mpmc_queue_init(woort_MPMCQueue* queue, size_t capacity)
+{
+    size_t cell_count = 2;
+    while (cell_count < capacity)
+    {
+        if (cell_count > SIZE_MAX / 2 / sizeof(woort_MPMCQueue_Cell))
+        {
+            WOORT_DEBUG("Queue capacity too large.");
+            return false;
+        }
+        cell_count *= 2;
+    }
+
+    queue->m_cells = malloc(cell_count * sizeof(woort_MPMCQueue_Cell));
+    if (queue->m_cells == NULL)
+    {
+        WOORT_DEBUG("Out of memory.");
+        return false;
+    }
+
+    for (size_t i = 0; i < cell_count; ++i)
+    {
+        woort_atomic_init(&queue->m_cells[i].m_sequence, (uint64_t)i);
+        queue->m_cells[i].m_data = NULL;
+    }
+
+    queue->m_mask = (uint64_t)cell_count - 1;
+    woort_atomic_init(&queue->m_enqueue_pos, 0);
+    woort_atomic_init(&queue->m_dequeue_pos, 0);
+
+    return true;
+}
+void woort_mpmc_queue_deinit(woort_MPMCQueue* queue)
+{
+    free(queue->m_cells);
+    queue->m_cells = NULL;
+}
+
+WOORT_NODISCARD bool woort_mpmc_queue_try_push(woort_MPMCQueue* queue, void* data)
+{
+    woort_MPMCQueue_Cell* cell;
+    uint64_t pos = woort_atomic_load_explicit(
+        &queue->m_enqueue_pos, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+    for (;;)
+    {
+        cell = &queue->m_cells[pos & queue->m_mask];
+
+        const uint64_t sequence = woort_atomic_load_explicit(
+            &cell->m_sequence, WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        const int64_t diff = (int64_t)(sequence - pos);
+
+        if (diff == 0)
+        {
+            // Cell is writable, try to take it.
+            if (woort_atomic_compare_exchange_weak_explicit(
+                &queue->m_enqueue_pos,
+                &pos,
+                pos + 1,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+                break;
+
+            // Taken by other producer, `pos` has been updated.
+        }
+        else if (diff < 0)
+            // Cell has not been popped since last round, queue is full.
+            return false;
+        else
+            // Other producer pushed, catch up.
+            pos = woort_atomic_load_explicit(
+                &queue->m_enqueue_pos, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+    }
+
+    cell->m_data = data;
+    woort_atomic_store_explicit(
+        &cell->m_sequence, pos + 1, WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
+
+    return true;
+}
+
+WOORT_NODISCARD bool woort_mpmc_queue_try_pop(woort_MPMCQueue* queue, void** out_data)
+{
+    woort_MPMCQueue_Cell* cell;
+    uint64_t pos = woort_atomic_load_explicit(
+        &queue->m_dequeue_pos, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+    for (;;)
+    {
+        cell = &queue->m_cells[pos & queue->m_mask];
+
+        const uint64_t sequence = woort_atomic_load_explicit(
+            &cell->m_sequence, WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        const int64_t diff = (int64_t)(sequence - (pos + 1));
+
+        if (diff == 0)
+        {
+            // Cell is readable, try to take it.
+            if (woort_atomic_compare_exchange_weak_explicit(
+                &queue->m_dequeue_pos,
+                &pos,
+                pos + 1,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+            // Cell has not been pushed, queue is empty.
+            return false;
+        else
+            pos = woort_atomic_load_explicit(
+                &queue->m_dequeue_pos, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+    }
+
+    *out_data = cell->m_data;
+
+    // Writable for the next round.
+    woort_atomic_store_explicit(
+        &cell->m_sequence, pos + queue->m_mask + 1, WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
+
+    return true;
+}
+
+/* ============================================== */
+/*       Unbounded intrusive MPSC Queue           */
+/* ============================================== */
+
+void woort_mpsc_queue_init(woort_MPSCQueue* queue)
+{
+    woort_atomic_init(&queue->m_stub.m_next, NULL);
+    woort_atomic_init(&queue->m_head, &queue->m_stub);
+    queue->m_tail = &queue->m_stub;
+}
+void woort_mpsc_queue_deinit(woort_MPSCQueue* queue)
+{
+    // Nodes are owned by user, nothing to release.
+    (void)queue;
+}
+
+void woort_mpsc_queue_push(woort_MPSCQueue* queue, woort_MPSCQueue_Node* node)
+{
+    woort_atomic_store_explicit(
+        &node->m_next, NULL, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+    // Swap head, CAS loop is used because exchange is not provided by woort_atomic.
+    void* prev = woort_atomic_load_explicit(
+        &queue->m_head, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+    while (!woort_atomic_compare_exchange_weak_explicit(
+        &queue->m_head,
+        &prev,
+        node,
+        WOORT_ATOMIC_MEMORY_ORDER_ACQ_REL,
+        WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+    {
+        // `prev` has been updated, retry.
+    }
+
+    // Link from previous node, consumer cannot see `node` before this.
+    woort_atomic_store_explicit(
+        &((woort_MPSCQueue_Node*)prev)->m_next, node, WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
+}
+
+WOORT_NODISCARD /* OPTIONAL */ woort_MPSCQueue_Node* woort_mpsc_queue_pop(
+    woort_MPSCQueue* queue)
+{
+    woort_MPSCQueue_Node* tail = queue->m_tail;
+    woort_MPSCQueue_Node* next = woort_atomic_load_explicit(
+        &tail->m_next, WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE);
+
+    if (tail == &queue->m_stub)
+    {
+        if (next == NULL)
+            // Empty.
+            return NULL;
+
+        // Skip stub.
+        queue->m_tail = next;
+        tail = next;
+        next = woort_atomic_load_explicit(
+            &tail->m_next, WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE);
+    }
+
+    if (next != NULL)
+    {
+        queue->m_tail = next;
+        return tail;
+    }
+
+    // `tail` is the last node we can see.
+    void* const head = woort_atomic_load_explicit(
+        &queue->m_head, WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE);
+    if (tail != head)
+        // A producer has swapped head but not linked yet.
+        return NULL;
+
+    // Push stub back, so that `tail` can be popped without racing with producers.
+    woort_mpsc_queue_push(queue, &queue->m_stub);
+
+    next = woort_atomic_load_explicit(
+        &tail->m_next, WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE);
+    if (next != NULL)
+    {
+        queue->m_tail = next;
+        return tail;
+    }
+    return NULL;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+/*
+woort_queue.h
+Lock-free queues for passing pointers between threads.
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_atomic.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+Positions touched by producers and consumers are placed in different cache lines,
+to avoid false sharing between them.
+*/
+#define WOORT_QUEUE_CACHE_LINE_SIZE 64
+
+/* ============================================== */
+/*          Bounded MPMC Queue (Vyukov)           */
+/* ============================================== */
+
+typedef struct woort_MPMCQueue_Cell
+{
+    /*
+    Cell at position `pos` (`pos & mask` in ring) is:
+        Writable if sequence == pos;
+        Readable if sequence == pos + 1.
+    */
+    woort_AtomicUInt64  m_sequence;
+    void*               m_data;
+
+} woort_MPMCQueue_Cell;
+
+typedef struct woort_MPMCQueue
+{
+    woort_MPMCQueue_Cell*   m_cells;
+    uint64_t                m_mask;
+
+    _Alignas(WOORT_QUEUE_CACHE_LINE_SIZE)
+        woort_AtomicUInt64  m_enqueue_pos;
+
+    _Alignas(WOORT_QUEUE_CACHE_LINE_SIZE)
+        woort_AtomicUInt64  m_dequeue_pos;
+
+} woort_MPMCQueue;
+
+/*
+Capacity will be rounded up to power of 2, at least 2.
+*/
+WOORT_NODISCARD bool woort_mpmc_queue_init(woort_MPMCQueue* queue, size_t capacity);
+void woort_mpmc_queue_deinit(woort_MPMCQueue* queue);
+
+/*
+Any thread can push & pop at the same time. Returns false if queue is full when
+pushing, or empty when popping, never blocks.
+*/
+WOORT_NODISCARD bool woort_mpmc_queue_try_push(woort_MPMCQueue* queue, void* data);
+WOORT_NODISCARD bool woort_mpmc_queue_try_pop(woort_MPMCQueue* queue, void** out_data);
+
+/* ============================================== */
+/*       Unbounded intrusive MPSC Queue           */
+/* ============================================== */
+
+/*
+Embed this node in the pushed object, no allocation is needed by queue. A node can
+be pushed again after it is popped.
+*/
+typedef struct woort_MPSCQueue_Node
+{
+    woort_AtomicPtr m_next;
+
+} woort_MPSCQueue_Node;
+
+typedef struct woort_MPSCQueue
+{
+    // Last pushed node, swapped by producers.
+    _Alignas(WOORT_QUEUE_CACHE_LINE_SIZE)
+        woort_AtomicPtr         m_head;
+
+    // Next node to pop, only touched by consumer.
+    _Alignas(WOORT_QUEUE_CACHE_LINE_SIZE)
+        woort_MPSCQueue_Node*   m_tail;
+
+    // Placeholder node, queue is never empty to avoid contention between push & pop.
+    woort_MPSCQueue_Node        m_stub;
+
+} woort_MPSCQueue;
+
+void woort_mpsc_queue_init(woort_MPSCQueue* queue);
+void woort_mpsc_queue_deinit(woort_MPSCQueue* queue);
+
+/*
+Can be invoked by any thread.
+*/
+void woort_mpsc_queue_push(woort_MPSCQueue* queue, woort_MPSCQueue_Node* node);
+
+/*
+Must be invoked by only one consumer thread. Returns NULL if queue is empty, or
+the next node is being pushed (retry later in this case).
+*/
+WOORT_NODISCARD /* OPTIONAL */ woort_MPSCQueue_Node* woort_mpsc_queue_pop(
+    woort_MPSCQueue* queue);
@@ -2,6 +2,15 @@
 #include "woort_atomic.h"
 #include "woort_threads.h"
 
+#include <stdint.h>
+#include <limits.h>
+
+#if defined(WOORT_SPIN_USE_FUTEX)
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
 inline void _woort_spin_loop_hint()
 {
     // If in msvc
@@ -27,13 +36,60 @@ inline void _woort_spin_loop_hint()
 #endif
 }
 
+/* ============================================== */
+/*                  Parking                       */
+/* ============================================== */
+
+/*
+Spin for one backoff round, returns false if backoff is exhausted and the thread
+should be parked.
+*/
+WOORT_NODISCARD bool _woort_spin_backoff(uint32_t* backoff)
+{
+    if (*backoff > WOORT_SPIN_MAX_BACKOFF)
+        return false;
+
+    for (uint32_t i = 0; i < *backoff; ++i)
+        _woort_spin_loop_hint();
+
+    *backoff *= 2;
+    return true;
+}
+
+/*
+Park current thread if `*address` is still `expected`, may return spuriously.
+*/
+void _woort_spin_park(woort_AtomicInt32* address, int32_t expected)
+{
+#if defined(WOORT_SPIN_USE_FUTEX)
+    (void)syscall(
+        SYS_futex, (int32_t*)address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+    (void)address;
+    (void)expected;
+    woort_thread_yield();
+#endif
+}
+
+void _woort_spin_unpark(woort_AtomicInt32* address, int32_t count)
+{
+#if defined(WOORT_SPIN_USE_FUTEX)
+    (void)syscall(
+        SYS_futex, (int32_t*)address, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+    // Parked threads are yielding, nothing to do.
+    (void)address;
+    (void)count;
+#endif
+}
+
 /* ============================================== */
 /*                  Spinlock                      */
 /* ============================================== */
 
 void woort_spinlock_init(woort_Spinlock* lock)
 {
-    woort_atomic_flag_clear(&lock->m_flag);
+    woort_atomic_init(&lock->m_state, 0);
 }
 void woort_spinlock_deinit(woort_Spinlock* lock)
 {
@@ -43,27 +99,83 @@ void woort_spinlock_deinit(woort_Spinlock* lock)
 
 void woort_spinlock_lock(woort_Spinlock* lock)
 {
-    while (woort_atomic_flag_test_and_set_explicit(
-        &lock->m_flag,
-        WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE))
+    int32_t expected = 0;
+    if (woort_atomic_compare_exchange_strong_explicit(
+        &lock->m_state,
+        &expected,
+        1,
+        WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
+        WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+        return;
+
+    // Spin for a while, the lock is usually held for a short time.
+    uint32_t backoff = 1;
+    while (_woort_spin_backoff(&backoff))
     {
-        // Spin until the lock is acquired.
-        _woort_spin_loop_hint();
-    }    
+        expected = 0;
+        if (woort_atomic_load_explicit(
+                &lock->m_state, WOORT_ATOMIC_MEMORY_ORDER_RELAXED) == 0
+            && woort_atomic_compare_exchange_weak_explicit(
+                &lock->m_state,
+                &expected,
+                1,
+                WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+            return;
+    }
+
+    // Mark the lock as contended, then park until it is released.
+    for (;;)
+    {
+        expected = woort_atomic_load_explicit(
+            &lock->m_state, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+        if (expected == 0)
+        {
+            // Lock is taken as contended, there may be other parked threads.
+            if (woort_atomic_compare_exchange_weak_explicit(
+                &lock->m_state,
+                &expected,
+                2,
+                WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+                return;
+            continue;
+        }
+        if (expected == 1
+            && !woort_atomic_compare_exchange_weak_explicit(
+                &lock->m_state,
+                &expected,
+                2,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+            continue;
+
+        _woort_spin_park(&lock->m_state, 2);
+    }
 }
 
 WOORT_NODISCARD bool woort_spinlock_trylock(woort_Spinlock* lock)
 {
-    return !woort_atomic_flag_test_and_set_explicit(
-        &lock->m_flag,
-        WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE);
+    int32_t expected = 0;
+    return woort_atomic_compare_exchange_strong_explicit(
+        &lock->m_state,
+        &expected,
+        1,
+        WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
+        WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
 }
 
 void woort_spinlock_unlock(woort_Spinlock* lock)
 {
-    woort_atomic_flag_clear_explicit(
-        &lock->m_flag,
-        WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
+    if (woort_atomic_fetch_sub_explicit(
+        &lock->m_state, 1, WOORT_ATOMIC_MEMORY_ORDER_RELEASE) != 1)
+    {
+        // Contended, wake one parked thread.
+        woort_atomic_store_explicit(
+            &lock->m_state, 0, WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
+        _woort_spin_unpark(&lock->m_state, 1);
+    }
 }
 
 /* ============================================== */
@@ -73,6 +185,9 @@ void woort_spinlock_unlock(woort_Spinlock* lock)
 void woort_rwspinlock_init(woort_RWSpinlock* lock)
 {
     woort_atomic_init(&lock->m_state, 0);
+    woort_atomic_init(&lock->m_waiting_writer_count, 0);
+    woort_atomic_init(&lock->m_generation, 0);
+    woort_atomic_init(&lock->m_parked_count, 0);
 }
 void woort_rwspinlock_deinit(woort_RWSpinlock* lock)
 {
@@ -80,36 +195,87 @@ void woort_rwspinlock_deinit(woort_RWSpinlock* lock)
     (void)lock;
 }
 
+/*
+Spin or park until the lock is unlocked after `generation` was read.
+*/
+void _woort_rwspinlock_wait(woort_RWSpinlock* lock, int32_t generation, uint32_t* backoff)
+{
+    if (_woort_spin_backoff(backoff))
+        return;
+
+    (void)woort_atomic_fetch_add_explicit(
+        &lock->m_parked_count, 1, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+    /*
+    NOTE: Unlocking thread increases `m_generation` before checking `m_parked_count`,
+        and futex checks `m_generation` again before parking, so wakeup cannot be
+        missed. `m_state` cannot be parked on, it might be changed and changed back
+        (0 -> -1 -> 0) before parking.
+    */
+    _woort_spin_park(&lock->m_generation, generation);
+
+    (void)woort_atomic_fetch_sub_explicit(
+        &lock->m_parked_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+}
+
+/*
+Called after `m_state` changed by unlocking.
+*/
+void _woort_rwspinlock_unpark_all(woort_RWSpinlock* lock)
+{
+    (void)woort_atomic_fetch_add_explicit(
+        &lock->m_generation, 1, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+    if (woort_atomic_load_explicit(
+        &lock->m_parked_count, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST) != 0)
+        _woort_spin_unpark(&lock->m_generation, INT_MAX);
+}
+
 void woort_rwspinlock_read_lock(woort_RWSpinlock* lock)
 {
-    int expected;
-    do
+    uint32_t backoff = 1;
+    for (;;)
     {
-        // Wait until there is no writer.
-        while ((expected = woort_atomic_load_explicit(
-            &lock->m_state, 
-            WOORT_ATOMIC_MEMORY_ORDER_RELAXED)) < 0)
+        // Read generation first, unlocking after this wakes us.
+        const int32_t generation = woort_atomic_load_explicit(
+            &lock->m_generation,
+            WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+        int32_t expected = woort_atomic_load_explicit(
+            &lock->m_state,
+            WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+        // Wait until there is no writer, waiting writers go first.
+        if (expected < 0
+            || woort_atomic_load_explicit(
+                &lock->m_waiting_writer_count,
+                WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST) != 0)
         {
-            // Spin while a writer holds the lock.
-            _woort_spin_loop_hint();
+            _woort_rwspinlock_wait(lock, generation, &backoff);
+            continue;
         }
+
         // Try to increment the reader count.
-    } while (!woort_atomic_compare_exchange_weak_explicit(
-        &lock->m_state,
-        &expected,
-        expected + 1,
-        WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
-        WOORT_ATOMIC_MEMORY_ORDER_RELAXED));
+        if (woort_atomic_compare_exchange_weak_explicit(
+            &lock->m_state,
+            &expected,
+            expected + 1,
+            WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
+            WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+            return;
+    }
 }
 
 WOORT_NODISCARD bool woort_rwspinlock_try_read_lock(woort_RWSpinlock* lock)
 {
-    int expected = woort_atomic_load_explicit(
+    int32_t expected = woort_atomic_load_explicit(
         &lock->m_state,
         WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
 
-    // If a writer holds the lock, fail immediately.
-    if (expected < 0)
+    // If a writer holds or is waiting for the lock, fail immediately.
+    if (expected < 0
+        || woort_atomic_load_explicit(
+            &lock->m_waiting_writer_count,
+            WOORT_ATOMIC_MEMORY_ORDER_RELAXED) != 0)
     {
         return false;
     }
@@ -125,34 +291,55 @@ WOORT_NODISCARD bool woort_rwspinlock_try_read_lock(woort_RWSpinlock* lock)
 
 void woort_rwspinlock_read_unlock(woort_RWSpinlock* lock)
 {
-    woort_atomic_fetch_sub_explicit(&lock->m_state, 1, WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
+    if (woort_atomic_fetch_sub_explicit(
+        &lock->m_state, 1, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST) == 1)
+    {
+        // Last reader, writers may be parked.
+        _woort_rwspinlock_unpark_all(lock);
+    }
 }
 
 void woort_rwspinlock_write_lock(woort_RWSpinlock* lock)
 {
-    int expected;
-    do
+    // Block new readers.
+    (void)woort_atomic_fetch_add_explicit(
+        &lock->m_waiting_writer_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+    uint32_t backoff = 1;
+    for (;;)
     {
+        // Read generation first, unlocking after this wakes us.
+        const int32_t generation = woort_atomic_load_explicit(
+            &lock->m_generation,
+            WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+        int32_t expected = woort_atomic_load_explicit(
+            &lock->m_state,
+            WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
         // Wait until the lock is free.
-        while ((expected = woort_atomic_load_explicit(
-            &lock->m_state, 
-            WOORT_ATOMIC_MEMORY_ORDER_RELAXED)) != 0)
+        if (expected != 0)
         {
-            // Spin while readers or a writer hold the lock.
-            _woort_spin_loop_hint();
+            _woort_rwspinlock_wait(lock, generation, &backoff);
+            continue;
         }
+
         // Try to acquire the write lock (set state to -1).
-    } while (!woort_atomic_compare_exchange_weak_explicit(
-        &lock->m_state,
-        &expected,
-        -1,
-        WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
-        WOORT_ATOMIC_MEMORY_ORDER_RELAXED));
+        if (woort_atomic_compare_exchange_weak_explicit(
+            &lock->m_state,
+            &expected,
+            -1,
+            WOORT_ATOMIC_MEMORY_ORDER_ACQUIRE,
+            WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+            break;
+    }
+
+    (void)woort_atomic_fetch_sub_explicit(
+        &lock->m_waiting_writer_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
 }
 
 WOORT_NODISCARD bool woort_rwspinlock_try_write_lock(woort_RWSpinlock* lock)
 {
-    int expected = 0;
+    int32_t expected = 0;
 
     // Try to acquire the write lock (set state to -1) only if it's free.
     return woort_atomic_compare_exchange_strong_explicit(
@@ -165,5 +352,8 @@ WOORT_NODISCARD bool woort_rwspinlock_try_write_lock(woort_RWSpinlock* lock)
 
 void woort_rwspinlock_write_unlock(woort_RWSpinlock* lock)
 {
-    woort_atomic_store_explicit(&lock->m_state, 0, WOORT_ATOMIC_MEMORY_ORDER_RELEASE);
+    woort_atomic_store_explicit(&lock->m_state, 0, WOORT_ATOMIC_MEMORY_ORDER_SEQ_CST);
+
+    // Wake all, parked writers & readers will compete again, waiting writers first.
+    _woort_rwspinlock_unpark_all(lock);
 }
@@ -3,6 +3,9 @@
 /*
 woort_spin.h
 Spinlock and Read-Write Spinlock implementation using C11 atomics.
+
+Locks spin with exponential backoff for a while, then park the thread by futex on
+Linux, or yield the thread on other platforms.
 */
 
 #include "woort_diagnosis.h"
@@ -10,9 +13,20 @@ Spinlock and Read-Write Spinlock implementation using C11 atomics.
 
 #include <stdbool.h>
 
+#if defined(__linux__)
+#   define WOORT_SPIN_USE_FUTEX 1
+#endif
+
+/*
+Max pause count of one backoff round, rounds are doubled from 1 until reaching it,
+then the thread will be parked.
+*/
+#define WOORT_SPIN_MAX_BACKOFF 64
+
 typedef struct woort_Spinlock
 {
-    woort_AtomicFlag m_flag;
+    // 0: free; 1: locked; 2: locked and there may be parked threads.
+    woort_AtomicInt32 m_state;
 } woort_Spinlock;
 
 // Initialize a spinlock.
@@ -35,6 +49,17 @@ typedef struct woort_RWSpinlock
     // -1: a writer is holding the lock.
     // 0: lock is free.
     woort_AtomicInt32 m_state;
+
+    // Writers waiting for the lock, new readers will wait if there is any, so that
+    // writers will not be starved by readers.
+    woort_AtomicInt32 m_waiting_writer_count;
+
+    // Increased by every unlocking, threads are parked on it so that any unlocking
+    // after they decided to wait wakes them.
+    woort_AtomicInt32 m_generation;
+
+    // Threads parked on `m_generation`.
+    woort_AtomicInt32 m_parked_count;
 } woort_RWSpinlock;
 
 // Initialize a read-write spinlock.
@@ -42,7 +67,7 @@ void woort_rwspinlock_init(woort_RWSpinlock* lock);
 void woort_rwspinlock_deinit(woort_RWSpinlock* lock);
 
 // Acquire read lock (blocking).
-// Multiple readers can hold the lock simultaneously.
+// Multiple readers can hold the lock simultaneously, if there is no writer waiting.
 void woort_rwspinlock_read_lock(woort_RWSpinlock* lock);
 
 // Try to acquire read lock (non-blocking).
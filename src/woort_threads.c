@@ -1,5 +1,6 @@
 #include "woort_threads.h"
 #include "woort_log.h"
+#include "woort_atomic.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -1309,3 +1310,276 @@ void woort_condition_variable_broadcast(woort_ConditionVariable* cv)
     pthread_cond_broadcast(&cv->handle);
 }
 #endif /* Platform selection */
+
+/* ============================================================================
+ * Platform independent helpers
+ * ============================================================================ */
+
+#if defined(_WIN32) || defined(_WIN64)
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   include <windows.h>
+#else
+#   include <unistd.h>
+#endif
+
+WOORT_NODISCARD size_t woort_thread_hardware_concurrency(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+
+    if (system_info.dwNumberOfProcessors > 0)
+        return (size_t)system_info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    const long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (processor_count > 0)
+        return (size_t)processor_count;
+#endif
+    return 1;
+}
+
+typedef struct _woort_ThreadParallelForContext
+{
+    woort_AtomicSize            m_next_job_index;
+    size_t                      m_job_count;
+    woort_ThreadParallelJobFunc m_job;
+    void*                       m_user_data;
+
+} _woort_ThreadParallelForContext;
+
+static void _woort_thread_parallel_for_worker(_woort_ThreadParallelForContext* context)
+{
+    for (;;)
+    {
+        const size_t job_index = woort_atomic_fetch_add_explicit(
+            &context->m_next_job_index, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+        if (job_index >= context->m_job_count)
+            break;
+
+        context->m_job(job_index, context->m_user_data);
+    }
+}
+
+/*
+Worker threads of woort_thread_parallel_for, started when first needed and kept
+until shutdown, so that short parallel jobs do not pay for starting threads.
+*/
+static struct _woort_ThreadPool_GlobalCtx
+{
+    // Only one parallel for can use the pool at a time, others run serially.
+    woort_Mutex*                m_using_mutex;
+
+    // Fields below are protected by `m_mutex`.
+    woort_Mutex*                m_mutex;
+    woort_ConditionVariable*    m_work_cv;
+    woort_ConditionVariable*    m_done_cv;
+
+    woort_Thread**              m_workers;
+    size_t                      m_worker_count;
+
+    // Current parallel for, NULL if there is none or it is closed for joining.
+    /* OPTIONAL */ _woort_ThreadParallelForContext* m_context;
+    uint64_t                    m_generation;
+    // Count of workers can still join current parallel for.
+    size_t                      m_joinable_count;
+    // Count of workers joined current parallel for and not finished.
+    size_t                      m_running_count;
+
+    bool                        m_shutting_down;
+
+} *_thread_pool_global_ctx = NULL;
+
+static void _woort_thread_pool_worker(void* user_data)
+{
+    (void)user_data;
+
+    uint64_t joined_generation = 0;
+
+    woort_mutex_lock(_thread_pool_global_ctx->m_mutex);
+    for (;;)
+    {
+        while (!_thread_pool_global_ctx->m_shutting_down
+            && (_thread_pool_global_ctx->m_context == NULL
+                || _thread_pool_global_ctx->m_joinable_count == 0
+                || _thread_pool_global_ctx->m_generation == joined_generation))
+        {
+            woort_condition_variable_wait(
+                _thread_pool_global_ctx->m_work_cv, _thread_pool_global_ctx->m_mutex);
+        }
+
+        if (_thread_pool_global_ctx->m_shutting_down)
+            break;
+
+        _woort_ThreadParallelForContext* const context = _thread_pool_global_ctx->m_context;
+        joined_generation = _thread_pool_global_ctx->m_generation;
+        --_thread_pool_global_ctx->m_joinable_count;
+        ++_thread_pool_global_ctx->m_running_count;
+
+        woort_mutex_unlock(_thread_pool_global_ctx->m_mutex);
+        _woort_thread_parallel_for_worker(context);
+        woort_mutex_lock(_thread_pool_global_ctx->m_mutex);
+
+        if (--_thread_pool_global_ctx->m_running_count == 0)
+            woort_condition_variable_broadcast(_thread_pool_global_ctx->m_done_cv);
+    }
+    woort_mutex_unlock(_thread_pool_global_ctx->m_mutex);
+}
+
+WOORT_NODISCARD bool woort_thread_pool_bootup(void)
+{
+    assert(_thread_pool_global_ctx == NULL);
+
+    _thread_pool_global_ctx = malloc(sizeof(struct _woort_ThreadPool_GlobalCtx));
+    if (_thread_pool_global_ctx == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        return false;
+    }
+
+    // Initialize all fields before creating, shutdown is used to clean up if failed.
+    _thread_pool_global_ctx->m_using_mutex = NULL;
+    _thread_pool_global_ctx->m_mutex = NULL;
+    _thread_pool_global_ctx->m_work_cv = NULL;
+    _thread_pool_global_ctx->m_done_cv = NULL;
+    _thread_pool_global_ctx->m_workers = NULL;
+    _thread_pool_global_ctx->m_worker_count = 0;
+    _thread_pool_global_ctx->m_context = NULL;
+    _thread_pool_global_ctx->m_generation = 0;
+    _thread_pool_global_ctx->m_joinable_count = 0;
+    _thread_pool_global_ctx->m_running_count = 0;
+    _thread_pool_global_ctx->m_shutting_down = false;
+
+    if (!woort_mutex_create(&_thread_pool_global_ctx->m_using_mutex)
+        || !woort_mutex_create(&_thread_pool_global_ctx->m_mutex)
+        || !woort_condition_variable_create(&_thread_pool_global_ctx->m_work_cv)
+        || !woort_condition_variable_create(&_thread_pool_global_ctx->m_done_cv))
+    {
+        WOORT_DEBUG("Failed to create thread pool.");
+        woort_thread_pool_shutdown();
+        return false;
+    }
+    return true;
+}
+
+void woort_thread_pool_shutdown(void)
+{
+    assert(_thread_pool_global_ctx != NULL);
+
+    // Workers are started only if the pool has been booted up completely.
+    if (_thread_pool_global_ctx->m_mutex != NULL
+        && _thread_pool_global_ctx->m_work_cv != NULL
+        && _thread_pool_global_ctx->m_done_cv != NULL)
+    {
+        woort_mutex_lock(_thread_pool_global_ctx->m_mutex);
+        _thread_pool_global_ctx->m_shutting_down = true;
+        woort_condition_variable_broadcast(_thread_pool_global_ctx->m_work_cv);
+        woort_mutex_unlock(_thread_pool_global_ctx->m_mutex);
+
+        for (size_t i = 0; i < _thread_pool_global_ctx->m_worker_count; ++i)
+            woort_thread_join(_thread_pool_global_ctx->m_workers[i]);
+    }
+    free(_thread_pool_global_ctx->m_workers);
+
+    if (_thread_pool_global_ctx->m_done_cv != NULL)
+        woort_condition_variable_destroy(_thread_pool_global_ctx->m_done_cv);
+    if (_thread_pool_global_ctx->m_work_cv != NULL)
+        woort_condition_variable_destroy(_thread_pool_global_ctx->m_work_cv);
+    if (_thread_pool_global_ctx->m_mutex != NULL)
+        woort_mutex_destroy(_thread_pool_global_ctx->m_mutex);
+    if (_thread_pool_global_ctx->m_using_mutex != NULL)
+        woort_mutex_destroy(_thread_pool_global_ctx->m_using_mutex);
+
+    free(_thread_pool_global_ctx);
+    _thread_pool_global_ctx = NULL;
+}
+
+/*
+Start workers until there are `worker_count` of them, returns count of workers can
+be used. Must be called with `m_mutex` locked.
+*/
+static size_t _woort_thread_pool_prepare_workers(size_t worker_count)
+{
+    if (_thread_pool_global_ctx->m_worker_count >= worker_count)
+        return worker_count;
+
+    woort_Thread** const workers = realloc(
+        _thread_pool_global_ctx->m_workers, worker_count * sizeof(woort_Thread*));
+    if (workers == NULL)
+    {
+        WOORT_DEBUG("failed to allocate worker threads, continue with fewer workers");
+        return _thread_pool_global_ctx->m_worker_count;
+    }
+    _thread_pool_global_ctx->m_workers = workers;
+
+    // New workers wait for `m_mutex` before looking at the pool.
+    for (; _thread_pool_global_ctx->m_worker_count < worker_count;
+        ++_thread_pool_global_ctx->m_worker_count)
+    {
+        if (!woort_thread_start(
+            _woort_thread_pool_worker,
+            NULL,
+            &workers[_thread_pool_global_ctx->m_worker_count]))
+        {
+            WOORT_DEBUG("failed to start worker thread, continue with fewer workers");
+            break;
+        }
+    }
+    return _thread_pool_global_ctx->m_worker_count;
+}
+
+void woort_thread_parallel_for(
+    size_t job_count,
+    size_t max_worker_count,
+    woort_ThreadParallelJobFunc job,
+    void* user_data)
+{
+    assert(NULL != job);
+
+    _woort_ThreadParallelForContext context;
+    woort_atomic_init(&context.m_next_job_index, 0);
+    context.m_job_count = job_count;
+    context.m_job = job;
+    context.m_user_data = user_data;
+
+    size_t extra_worker_count =
+        (max_worker_count < job_count ? max_worker_count : job_count);
+    extra_worker_count = extra_worker_count > 1 ? extra_worker_count - 1 : 0;
+
+    // Pool is used by others (or by the job calling us), run serially.
+    if (extra_worker_count == 0
+        || _thread_pool_global_ctx == NULL
+        || !woort_mutex_trylock(_thread_pool_global_ctx->m_using_mutex))
+    {
+        _woort_thread_parallel_for_worker(&context);
+        return;
+    }
+
+    woort_mutex_lock(_thread_pool_global_ctx->m_mutex);
+
+    _thread_pool_global_ctx->m_context = &context;
+    ++_thread_pool_global_ctx->m_generation;
+    _thread_pool_global_ctx->m_joinable_count =
+        _woort_thread_pool_prepare_workers(extra_worker_count);
+    woort_condition_variable_broadcast(_thread_pool_global_ctx->m_work_cv);
+
+    woort_mutex_unlock(_thread_pool_global_ctx->m_mutex);
+
+    // Calling thread works too.
+    _woort_thread_parallel_for_worker(&context);
+
+    // All jobs are fetched, workers not joined yet must not see the context any more.
+    woort_mutex_lock(_thread_pool_global_ctx->m_mutex);
+
+    _thread_pool_global_ctx->m_context = NULL;
+    _thread_pool_global_ctx->m_joinable_count = 0;
+    while (_thread_pool_global_ctx->m_running_count != 0)
+        woort_condition_variable_wait(
+            _thread_pool_global_ctx->m_done_cv, _thread_pool_global_ctx->m_mutex);
+
+    woort_mutex_unlock(_thread_pool_global_ctx->m_mutex);
+    woort_mutex_unlock(_thread_pool_global_ctx->m_using_mutex);
+}
@@ -22,6 +22,36 @@ void woort_thread_join(woort_Thread* thread);
 void woort_thread_sleep_ms(uint32_t ms);
 void woort_thread_yield(void);
 
+/*
+Number of hardware threads can run concurrently, at least 1.
+*/
+WOORT_NODISCARD size_t woort_thread_hardware_concurrency(void);
+
+typedef void (*woort_ThreadParallelJobFunc)(size_t /* job index */, void*);
+
+/*
+Worker threads of woort_thread_parallel_for are started on demand and kept in a pool
+until shutdown.
+*/
+WOORT_NODISCARD bool woort_thread_pool_bootup(void);
+void woort_thread_pool_shutdown(void);
+
+/*
+Run `job` for each index in [0, job_count) on at most `max_worker_count` threads,
+the calling thread is one of the workers. Jobs are fetched one by one, so there is
+no assumption about which thread runs which job. Return after all jobs finished.
+
+NOTE: If worker threads cannot be started, remaining jobs are still done by the
+    calling thread, so this method never fails.
+NOTE: Only one parallel for runs on the pool at a time, others (include the ones
+    called in jobs) and the ones before bootup run serially in calling thread.
+*/
+void woort_thread_parallel_for(
+    size_t job_count,
+    size_t max_worker_count,
+    woort_ThreadParallelJobFunc job,
+    void* user_data);
+
 typedef struct woort_Mutex woort_Mutex;
 typedef struct woort_TimeMutex woort_TimeMutex;
 typedef struct woort_RecursiveMutex woort_RecursiveMutex;
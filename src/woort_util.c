@@ -1,8 +1,18 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include "woort_util.h"
+#include "woort_log.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    // No file mapping, woort_util_map_file always fails.
+#else
+#   define WOORT_UTIL_USE_MMAP 1
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
 
 WOORT_NODISCARD size_t woort_util_abs_diff(
     size_t a,
@@ -29,3 +39,80 @@ WOORT_NODISCARD bool woort_util_ptr_equal(
 {
     return *(void**)ptr_a_addr == *(void**)ptr_b_addr;
 }
+
+WOORT_NODISCARD size_t woort_util_u64_hash(const void* u64_addr)
+{
+    uint64_t hash = *(const uint64_t*)u64_addr;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return (size_t)hash;
+}
+
+WOORT_NODISCARD bool woort_util_u64_equal(
+    const void* u64_a_addr, const void* u64_b_addr)
+{
+    return *(const uint64_t*)u64_a_addr == *(const uint64_t*)u64_b_addr;
+}
+
+WOORT_NODISCARD bool woort_util_map_file(
+    FILE* file,
+    size_t offset,
+    size_t size,
+    void** out_mapping,
+    size_t* out_mapping_size,
+    const void** out_data)
+{
+#ifdef WOORT_UTIL_USE_MMAP
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0 || size == 0)
+        return false;
+
+    const size_t aligned_offset = offset - offset % (size_t)page_size;
+    const size_t mapping_size = size + (offset - aligned_offset);
+
+    void* const mapping = mmap(
+        NULL,
+        mapping_size,
+        PROT_READ,
+        MAP_PRIVATE,
+        fileno(file),
+        (off_t)aligned_offset);
+
+    if (mapping == MAP_FAILED)
+    {
+        WOORT_DEBUG("Failed to map file.");
+        return false;
+    }
+
+    *out_mapping = mapping;
+    *out_mapping_size = mapping_size;
+    *out_data = (const char*)mapping + (offset - aligned_offset);
+    return true;
+#else
+    (void)file;
+    (void)offset;
+    (void)size;
+    (void)out_mapping;
+    (void)out_mapping_size;
+    (void)out_data;
+    return false;
+#endif
+}
+
+void woort_util_unmap_file(
+    void* mapping,
+    size_t mapping_size)
+{
+#ifdef WOORT_UTIL_USE_MMAP
+    (void)munmap(mapping, mapping_size);
+#else
+    (void)mapping;
+    (void)mapping_size;
+    abort();
+#endif
+}
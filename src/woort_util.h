@@ -9,6 +9,7 @@ woort_util.h
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 WOORT_NODISCARD size_t woort_util_abs_diff(
     size_t a,
@@ -20,3 +21,30 @@ WOORT_NODISCARD size_t woort_util_ptr_hash(
 WOORT_NODISCARD bool woort_util_ptr_equal(
     const void* ptr_a_addr, 
     const void* ptr_b_addr);
+
+WOORT_NODISCARD size_t woort_util_u64_hash(
+    const void* u64_addr);
+
+WOORT_NODISCARD bool woort_util_u64_equal(
+    const void* u64_a_addr,
+    const void* u64_b_addr);
+
+/*
+Map `size` bytes at `offset` of `file` as read-only private memory, `offset` need
+not be aligned to page size. Data begins at `*out_data`, and the mapping should be
+released by woort_util_unmap_file(*out_mapping, *out_mapping_size).
+
+NOTE: Returns false if the platform cannot map files or mapping failed, caller
+    should fall back to reading.
+*/
+WOORT_NODISCARD bool woort_util_map_file(
+    FILE* file,
+    size_t offset,
+    size_t size,
+    void** out_mapping,
+    size_t* out_mapping_size,
+    const void** out_data);
+
+void woort_util_unmap_file(
+    void* mapping,
+    size_t mapping_size);
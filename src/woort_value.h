@@ -19,7 +19,8 @@ typedef enum woort_FunctionType
 }woort_FunctionType;
 typedef struct woort_Function
 {
-    int64_t    m_type : 2;
+    // Unsigned, WOORT_FUNCTION_TYPE_JIT does not fit in signed 2 bits.
+    uint64_t   m_type : 2;
     int64_t    m_address : 62;
 
 }woort_Function;
@@ -14,14 +14,42 @@ void woort_vector_init(woort_Vector* vector, size_t element_size)
     vector->m_capacity = 0; // Initial capacity.
 
     vector->m_data = NULL;
+    vector->m_buffer = NULL;
+    vector->m_arena = NULL;
 }
+void woort_vector_init_with_buffer(
+    woort_Vector* vector,
+    size_t element_size,
+    void* buffer,
+    size_t buffer_capacity)
+{
+    woort_vector_init(vector, element_size);
+
+    vector->m_capacity = buffer_capacity;
+    vector->m_data = buffer;
+    vector->m_buffer = buffer;
+}
+void woort_vector_init_with_arena(
+    woort_Vector* vector,
+    size_t element_size,
+    /* OPTIONAL */ woort_Arena* arena)
+{
+    woort_vector_init(vector, element_size);
+
+    vector->m_arena = arena;
+}
+
+WOORT_NODISCARD bool _woort_vector_is_heap_owned(const woort_Vector* vector)
+{
+    return vector->m_arena == NULL && vector->m_data != vector->m_buffer;
+}
+
 void woort_vector_deinit(woort_Vector* vector)
 {
-    if (vector->m_data != NULL)
-    {
+    if (vector->m_data != NULL && _woort_vector_is_heap_owned(vector))
         free(vector->m_data);
-        vector->m_data = NULL;
-    }
+
+    vector->m_data = NULL;
 }
 
 WOORT_NODISCARD bool woort_vector_reserve(woort_Vector* vector, size_t new_capacity)
@@ -37,9 +65,23 @@ WOORT_NODISCARD bool woort_vector_reserve(woort_Vector* vector, size_t new_capac
         else
             vector->m_capacity *= 2;
     }
-    void* const new_data = realloc(
-        vector->m_data,
-        vector->m_capacity * vector->m_element_size);
+    void* new_data;
+    if (_woort_vector_is_heap_owned(vector))
+        new_data = realloc(
+            vector->m_data,
+            vector->m_capacity * vector->m_element_size);
+    else
+    {
+        // Buffer or arena storage cannot grow in place, copy to new storage.
+        new_data = vector->m_arena != NULL
+            ? woort_arena_alloc(
+                vector->m_arena, vector->m_capacity * vector->m_element_size)
+            : malloc(vector->m_capacity * vector->m_element_size);
+
+        if (new_data != NULL && vector->m_size != 0)
+            memcpy(new_data, vector->m_data, vector->m_size * vector->m_element_size);
+    }
+
     if (new_data == NULL)
     {
         WOORT_DEBUG("Reallocation failed.");
@@ -114,14 +156,32 @@ WOORT_NODISCARD bool woort_vector_erase_at(woort_Vector* vector, size_t index)
     vector->m_size--;
     return true;
 }
-void* woort_vector_move_out(woort_Vector* vector, size_t* out_count)
+WOORT_NODISCARD bool woort_vector_move_out(
+    woort_Vector* vector, void** out_data, size_t* out_count)
 {
+    void* result = vector->m_data;
+
+    if (!_woort_vector_is_heap_owned(vector))
+    {
+        result = NULL;
+        if (vector->m_size != 0)
+        {
+            result = malloc(vector->m_size * vector->m_element_size);
+            if (result == NULL)
+            {
+                WOORT_DEBUG("Allocation failed.");
+                return false;
+            }
+            memcpy(result, vector->m_data, vector->m_size * vector->m_element_size);
+        }
+    }
+
+    *out_data = result;
     *out_count = vector->m_size;
-    void* const result = vector->m_data;
 
     vector->m_size = 0;
     vector->m_capacity = 0;
     vector->m_data = NULL;
 
-    return result;
+    return true;
 }
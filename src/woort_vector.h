@@ -5,11 +5,20 @@ woort_vector.h
 */
 
 #include "woort_diagnosis.h"
+#include "woort_arena.h"
 
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 
+/*
+Storage of vector is one of:
+    1) Heap, allocated by malloc/realloc, default;
+    2) Buffer given by woort_vector_init_with_buffer, usually on stack, moved to heap
+        when it is not big enough;
+    3) Arena given by woort_vector_init_with_arena, old storage is abandoned in arena
+        when growing.
+*/
 typedef struct woort_Vector
 {
     char*       m_data;
@@ -18,9 +27,23 @@ typedef struct woort_Vector
 
     size_t      m_element_size;
 
+    // Data is not owned if `m_data` is `m_buffer`.
+    /* OPTIONAL */ char*        m_buffer;
+    /* OPTIONAL */ woort_Arena* m_arena;
+
 } woort_Vector;
 
 void woort_vector_init(woort_Vector* vector, size_t element_size);
+void woort_vector_init_with_buffer(
+    woort_Vector* vector,
+    size_t element_size,
+    void* buffer,
+    size_t buffer_capacity);
+// Same as woort_vector_init if `arena` is NULL.
+void woort_vector_init_with_arena(
+    woort_Vector* vector,
+    size_t element_size,
+    /* OPTIONAL */ woort_Arena* arena);
 void woort_vector_deinit(woort_Vector* vector);
 
 WOORT_NODISCARD bool woort_vector_reserve(woort_Vector* vector, size_t new_capacity);
@@ -34,5 +57,11 @@ WOORT_NODISCARD void* woort_vector_at(woort_Vector* vector, size_t index);
 
 WOORT_NODISCARD bool woort_vector_erase_at(woort_Vector* vector, size_t index);
 
-/* OPTIONAL, Null if empty. */ void* woort_vector_move_out(
-    woort_Vector* vector, size_t* out_count);
+/*
+Take the heap storage out into `*out_data` (NULL if empty), vector becomes empty.
+
+NOTE: Storage in buffer or arena is copied into heap, returns false if out of memory,
+    in which case vector is unchanged.
+*/
+WOORT_NODISCARD bool woort_vector_move_out(
+    woort_Vector* vector, void** out_data, size_t* out_count);
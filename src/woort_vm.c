@@ -9,12 +9,17 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <memory.h>
+#include <math.h>
 
 WOORT_THREAD_LOCAL woort_VMRuntime* t_this_thread_vm = NULL;
 
 const size_t WOORT_VM_DEFAULT_STACK_BEGIN_SIZE = 32;
+const size_t WOORT_VM_MIN_STACK_SIZE = 4;
 const size_t WOORT_VM_MAX_STACK_SIZE = 1024 * 1024 * 1024 / 8;
+// Stack is trimmed when returning to native if it's this times bigger than trim size.
+const size_t WOORT_VM_STACK_TRIM_THRESHOLD_FACTOR = 4;
 
 WOORT_NODISCARD bool woort_VMRuntime_init(woort_VMRuntime* vm)
 {
@@ -35,25 +40,225 @@ WOORT_NODISCARD bool woort_VMRuntime_init(woort_VMRuntime* vm)
     // Init runtime state.
     vm->m_ip = NULL;
     vm->m_env = NULL;
+    vm->m_data = NULL;
+    vm->m_data_copy_on_write = false;
+
+    vm->m_invoke_depth = 0;
+    // Stack kept at its high-water mark, trimming to a fixed small size would make
+    // every deep invoking grow it again. Pooled VMs trim to the size of pool.
+    vm->m_stack_trim_size = 0;
+
+    vm->m_private_statics = false;
+    woort_vector_init(&vm->m_private_datas, sizeof(woort_VMRuntime_PrivateData));
 
     return true;
 }
+WOORT_NODISCARD bool woort_VMRuntime_init_with_private_statics(woort_VMRuntime* vm)
+{
+    if (!woort_VMRuntime_init(vm))
+        return false;
+
+    vm->m_private_statics = true;
+    return true;
+}
+void _woort_VMRuntime_drop_private_datas(woort_VMRuntime* vm)
+{
+    for (size_t i = 0; i < vm->m_private_datas.m_size; ++i)
+    {
+        woort_VMRuntime_PrivateData* const private_data =
+            woort_vector_at(&vm->m_private_datas, i);
+
+        free(private_data->m_data);
+        woort_CodeEnv_unshare(private_data->m_env);
+    }
+    woort_vector_clear(&vm->m_private_datas);
+}
 void woort_VMRuntime_deinit(woort_VMRuntime* vm)
 {
     if (vm->m_stack != NULL)
     {
         free(vm->m_stack);
     }
+
+    _woort_VMRuntime_drop_private_datas(vm);
+    woort_vector_deinit(&vm->m_private_datas);
+
+    // Good chance to flush deferred refcount of CodeEnvs.
+    woort_CodeEnv_safepoint();
+}
+
+WOORT_NODISCARD bool woort_VMRuntime_reset(woort_VMRuntime* vm, size_t stack_size)
+{
+    assert(stack_size >= WOORT_VM_MIN_STACK_SIZE && stack_size <= WOORT_VM_MAX_STACK_SIZE);
+
+    // Private statics are dropped, will be copied from CodeEnv again.
+    _woort_VMRuntime_drop_private_datas(vm);
+
+    vm->m_ip = NULL;
+    vm->m_env = NULL;
+    vm->m_data = NULL;
+    vm->m_data_copy_on_write = false;
+
+    if ((size_t)(vm->m_stack_end - vm->m_stack) != stack_size)
+    {
+        // Stack is not in use, no need to keep content.
+        woort_Value* const new_stack = malloc(stack_size * sizeof(woort_Value));
+        if (new_stack == NULL)
+        {
+            WOORT_DEBUG("Out of memory");
+            vm->m_sb = vm->m_sp = vm->m_stack_end - 1;
+            return false;
+        }
+        free(vm->m_stack);
+
+        vm->m_stack = new_stack;
+        vm->m_stack_end = new_stack + stack_size;
+
+        ++vm->m_stack_realloc_version;
+    }
+    vm->m_sb = vm->m_sp = vm->m_stack_end - 1;
+
+    return true;
 }
 
 WOORT_NODISCARD woort_VmCallStatus _woort_VMRuntime_dispatch(
     woort_VMRuntime* vm);
+bool _woort_VMRuntime_extern_stack(woort_VMRuntime* vm);
+
+/* OPTIONAL */ woort_VMRuntime_PrivateData* _woort_VMRuntime_find_private_data(
+    woort_VMRuntime* vm)
+{
+    for (size_t i = 0; i < vm->m_private_datas.m_size; ++i)
+    {
+        woort_VMRuntime_PrivateData* const private_data =
+            woort_vector_at(&vm->m_private_datas, i);
+
+        if (private_data->m_env == vm->m_env)
+            return private_data;
+    }
+    return NULL;
+}
+
+// Should be called after m_env updated.
+WOORT_NODISCARD bool _woort_VMRuntime_bind_env_data(woort_VMRuntime* vm)
+{
+    const woort_CodeEnv* const env = vm->m_env;
+
+    woort_VMRuntime_PrivateData* const private_data =
+        vm->m_private_statics ? _woort_VMRuntime_find_private_data(vm) : NULL;
+
+    if (private_data == NULL)
+    {
+        vm->m_data = env->m_data_begin;
+        vm->m_data_copy_on_write = vm->m_private_statics;
+        return true;
+    }
+
+    const size_t data_count = env->m_data_end - env->m_data_begin;
+    if (private_data->m_data_count < data_count)
+    {
+        // CodeEnv extended, copy the appended part.
+        woort_Value* const new_data =
+            realloc(private_data->m_data, data_count * sizeof(woort_Value));
+
+        if (new_data == NULL)
+        {
+            WOORT_DEBUG("Out of memory.");
+            return false;
+        }
+        memcpy(
+            new_data + private_data->m_data_count,
+            env->m_data_begin + private_data->m_data_count,
+            (data_count - private_data->m_data_count) * sizeof(woort_Value));
+
+        private_data->m_data = new_data;
+        private_data->m_data_count = data_count;
+    }
+
+    vm->m_data = private_data->m_data;
+    vm->m_data_copy_on_write = false;
+    return true;
+}
+
+WOORT_NODISCARD bool _woort_VMRuntime_copy_env_data(woort_VMRuntime* vm)
+{
+    assert(vm->m_private_statics);
+
+    // Might have been copied by nested invoke.
+    if (_woort_VMRuntime_find_private_data(vm) == NULL)
+    {
+        woort_CodeEnv* const env = (woort_CodeEnv*)vm->m_env;
+        const size_t data_count = env->m_data_end - env->m_data_begin;
+
+        woort_VMRuntime_PrivateData private_data;
+        private_data.m_env = env;
+        private_data.m_data_count = data_count;
+        private_data.m_data = malloc(
+            (data_count != 0 ? data_count : 1) * sizeof(woort_Value));
+
+        if (private_data.m_data == NULL)
+        {
+            WOORT_DEBUG("Out of memory.");
+            return false;
+        }
+        memcpy(private_data.m_data, env->m_data_begin, data_count * sizeof(woort_Value));
+
+        if (!woort_vector_push_back(&vm->m_private_datas, 1, &private_data))
+        {
+            free(private_data.m_data);
+            return false;
+        }
+        woort_CodeEnv_share(env);
+    }
+    return _woort_VMRuntime_bind_env_data(vm);
+}
+
+/*
+Back to caller of woort_VMRuntime_invoke, data area must be bound again instead of
+restoring the saved one: nested invoking might have copied (or reallocated) private
+static storages of `env`, caller should see what have been written there.
+*/
+void _woort_VMRuntime_rebind_env_data(woort_VMRuntime* vm, const woort_CodeEnv* env)
+{
+    vm->m_env = env;
+
+    if (env == NULL)
+    {
+        // Invoked from outside of VM.
+        vm->m_data = NULL;
+        vm->m_data_copy_on_write = false;
+    }
+    else if (!_woort_VMRuntime_bind_env_data(vm))
+    {
+        /*
+        Failed to copy the part appended by extending, private copy must exist. Caller
+        was bound to it before extending, it covers all storages used by caller.
+        */
+        woort_VMRuntime_PrivateData* const private_data =
+            _woort_VMRuntime_find_private_data(vm);
+        assert(private_data != NULL);
+
+        vm->m_data = private_data->m_data;
+        vm->m_data_copy_on_write = false;
+    }
+}
 
 WOORT_NODISCARD woort_VmCallStatus woort_VMRuntime_invoke(
     woort_VMRuntime* vm, const woort_Bytecode* func)
 {
-    if (!woort_CodeEnv_find(func, &vm->m_env))
+    // Stack might be moved during invoking, keep offsets.
+    const size_t sp_offset = vm->m_stack_end - vm->m_sp;
+    const size_t sb_offset = vm->m_stack_end - vm->m_sb;
+
+    const woort_Bytecode* const ip = vm->m_ip;
+    const woort_CodeEnv* const env = vm->m_env;
+
+    if (!woort_CodeEnv_find(func, &vm->m_env)
+        || !_woort_VMRuntime_bind_env_data(vm))
+    {
+        _woort_VMRuntime_rebind_env_data(vm, env);
         return WOORT_VM_CALL_STATUS_ABORTED;
+    }
 
     // Push call stack info here.
     /*
@@ -65,6 +270,14 @@ WOORT_NODISCARD woort_VmCallStatus woort_VMRuntime_invoke(
     */
 
     // Reserve sp
+    while (/* UNLIKELY */ vm->m_sp - 3 < vm->m_stack)
+    {
+        if (!_woort_VMRuntime_extern_stack(vm))
+        {
+            _woort_VMRuntime_rebind_env_data(vm, env);
+            return WOORT_VM_CALL_STATUS_ABORTED;
+        }
+    }
     vm->m_sp -= 3;
 
     // Set call way and bp offset.
@@ -81,7 +294,81 @@ WOORT_NODISCARD woort_VmCallStatus woort_VMRuntime_invoke(
     // Set target ip.
     vm->m_ip = func;
 
-    return _woort_VMRuntime_dispatch(vm);
+    ++vm->m_invoke_depth;
+    const woort_VmCallStatus status = _woort_VMRuntime_dispatch(vm);
+    --vm->m_invoke_depth;
+
+    /*
+    Restore state of caller, frame reserved above is released, result of callee is
+    still at `m_sp[-1]` until next push.
+    */
+    vm->m_sp = vm->m_stack_end - sp_offset;
+    vm->m_sb = vm->m_stack_end - sb_offset;
+    vm->m_ip = ip;
+    _woort_VMRuntime_rebind_env_data(vm, env);
+
+    // Back to native at outermost, good chance to trim stack grown by deep recursion.
+    if (vm->m_invoke_depth == 0
+        && vm->m_stack_trim_size != 0
+        && (size_t)(vm->m_stack_end - vm->m_stack)
+            > vm->m_stack_trim_size * WOORT_VM_STACK_TRIM_THRESHOLD_FACTOR)
+    {
+        if (!woort_VMRuntime_trim_stack(vm, vm->m_stack_trim_size))
+            // Harmless, stack is still usable.
+            WOORT_DEBUG("Failed to trim stack.");
+    }
+
+    return status;
+}
+
+WOORT_NODISCARD bool woort_VMRuntime_trim_stack(woort_VMRuntime* vm, size_t target_size)
+{
+    assert(target_size >= WOORT_VM_MIN_STACK_SIZE);
+
+    if (vm->m_invoke_depth != 0)
+    {
+        // Running functions rely on stack room assured at their entry.
+        WOORT_DEBUG("Cannot trim stack of running VM.");
+        return false;
+    }
+
+    const size_t current_stack_size = vm->m_stack_end - vm->m_stack;
+    // Result of the last invoking at `m_sp[-1]` must be kept.
+    const size_t used_stack_size = vm->m_stack_end - vm->m_sp + 1;
+
+    size_t new_stack_size = target_size;
+    while (new_stack_size < used_stack_size)
+        new_stack_size *= 2;
+
+    if (new_stack_size >= current_stack_size)
+        // Nothing to trim.
+        return true;
+
+    // Move stack data from tail to head, then release the tail.
+    memmove(
+        vm->m_stack,
+        vm->m_stack_end - new_stack_size,
+        new_stack_size * sizeof(woort_Value));
+
+    woort_Value* new_stack = realloc(vm->m_stack, new_stack_size * sizeof(woort_Value));
+    if (new_stack == NULL)
+    {
+        // Data has been moved, keep using the old block as smaller one.
+        WOORT_DEBUG("Failed to shrink stack.");
+        new_stack = vm->m_stack;
+    }
+
+    // Update vm state.
+    woort_Value* const new_stack_end = new_stack + new_stack_size;
+    vm->m_sp = new_stack_end - (vm->m_stack_end - vm->m_sp);
+    vm->m_sb = new_stack_end - (vm->m_stack_end - vm->m_sb);
+    vm->m_stack = new_stack;
+    vm->m_stack_end = new_stack_end;
+
+    // Update stack version.
+    ++vm->m_stack_realloc_version;
+
+    return true;
 }
 
 bool _woort_VMRuntime_extern_stack(woort_VMRuntime* vm)
@@ -103,7 +390,10 @@ bool _woort_VMRuntime_extern_stack(woort_VMRuntime* vm)
     }
 
     // Move stack data from head to tail.
-    memcpy(new_stack + current_stack_size, new_stack, current_stack_size);
+    memcpy(
+        new_stack + current_stack_size,
+        new_stack,
+        current_stack_size * sizeof(woort_Value));
 
     // Update vm state.
     woort_Value* const new_stack_end = new_stack + new_stack_size;
@@ -118,6 +408,76 @@ bool _woort_VMRuntime_extern_stack(woort_VMRuntime* vm)
     return true;
 }
 
+/*
+Rewrite the command at `ip`, codes mapped from image are read only and kept untouched.
+    Other VMs might be running the same codes, command is replaced in one store, they
+will execute either the old one or the new one, both of them work.
+*/
+void _woort_VMRuntime_patch_code(
+    const woort_CodeEnv* env, const woort_Bytecode* ip, woort_Bytecode code)
+{
+    if (env->m_code_mapping != NULL)
+        return;
+
+    woort_atomic_store_explicit(
+        (woort_AtomicUInt32*)ip, code, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+}
+
+/*
+Replace the call of constant `constant_index` at `ip` by the command specialized for
+type of `callee`, which checks the type before calling and comes here again if it is
+changed. Type feedback of the call is recorded, calls whose function type changed more
+than WOORT_VM_CALL_MAX_REQUICKEN_COUNT times turn into CALLCDYN (never quickened).
+*/
+void _woort_VMRuntime_quicken_call(
+    const woort_CodeEnv* env,
+    const woort_Bytecode* ip,
+    uint32_t constant_index,
+    woort_Function callee)
+{
+    // Cannot be quickened, CALLC will come here every time, skip feedback too.
+    if (env->m_code_mapping != NULL)
+        return;
+
+    woort_CodeEnv_TypeFeedback feedback;
+    woort_CodeEnv_record_type_feedback(
+        (woort_CodeEnv*)env, ip, (uint32_t)callee.m_type, &feedback);
+
+    if (feedback.m_type_changes > WOORT_VM_CALL_MAX_REQUICKEN_COUNT)
+    {
+        // Unstable call, CALLCDYN only has 24 bits for constant index.
+        if (constant_index <= (WOORT_BYTECODE_ABC24_MASK >> WOORT_BYTECODE_ABC24_SHIFT))
+            _woort_VMRuntime_patch_code(
+                env,
+                ip,
+                woort_OpCodeFormal_cons(
+                    OP6_M2_ABC24, WOORT_OPCODE_CALL, 3, constant_index));
+        return;
+    }
+
+    woort_Opcode quickened_opcode;
+    switch ((woort_FunctionType)callee.m_type)
+    {
+    case WOORT_FUNCTION_TYPE_SCRIPT:
+        quickened_opcode = WOORT_OPCODE_CALLNWO;
+        break;
+    case WOORT_FUNCTION_TYPE_NATIVE:
+        quickened_opcode = WOORT_OPCODE_CALLNFP;
+        break;
+    case WOORT_FUNCTION_TYPE_JIT:
+        quickened_opcode = WOORT_OPCODE_CALLNJIT;
+        break;
+    default:
+        // Bad function, will panic when calling.
+        return;
+    }
+
+    _woort_VMRuntime_patch_code(
+        env,
+        ip,
+        woort_OpCodeFormal_cons(OP6_MABC26, quickened_opcode, constant_index));
+}
+
 WOORT_NODISCARD woort_VmCallStatus _woort_VMRuntime_dispatch(
     woort_VMRuntime* vm)
 {
@@ -156,7 +516,9 @@ WOORT_NODISCARD woort_VmCallStatus _woort_VMRuntime_dispatch(
         rt_env = vm->m_env;                     \
         rt_env_code = rt_env->m_code_begin;     \
         rt_env_code_end = rt_env->m_code_end;   \
-        rt_env_data = rt_env->m_data_begin;     \
+        rt_env_data = vm->m_data;               \
+        rt_env_data_copy_on_write =             \
+            vm->m_data_copy_on_write;           \
     }while(0)
 #define WOORT_VM_SYNC_STATE_AND_PANIC(...)  \
     do{                                     \
@@ -175,6 +537,25 @@ WOORT_NODISCARD woort_VmCallStatus _woort_VMRuntime_dispatch(
         }                                                                   \
     }while(0)
 
+/*
+Static storages might be copied or reallocated by woort_VMRuntime_invoke in native
+function, data area bound to VM is re-read after native calls.
+*/
+#define WOORT_VM_RESYNC_ENV_DATA()                              \
+    do{                                                         \
+        rt_env_data = vm->m_data;                               \
+        rt_env_data_copy_on_write = vm->m_data_copy_on_write;   \
+    }while(0)
+
+#define WOORT_VM_PREPARE_STATIC_WRITE()             \
+    do{                                             \
+        if (/* UNLIKELY */ rt_env_data_copy_on_write) \
+        {                                           \
+            WOORT_VM_SYNC_STATE();                  \
+            goto _label_exception_handler_copy_on_write; \
+        }                                           \
+    }while(0)
+
 #define WOORT_VM_THROW(NAME)                    \
     do{                                         \
         WOORT_VM_SYNC_STATE();                  \
@@ -191,13 +572,17 @@ WOORT_NODISCARD woort_VmCallStatus _woort_VMRuntime_dispatch(
     const woort_CodeEnv* rt_env = vm->m_env;
     const woort_Bytecode* rt_env_code = rt_env->m_code_begin;
     const woort_Bytecode* rt_env_code_end = rt_env->m_code_end;
-    woort_Value* rt_env_data = rt_env->m_data_begin;
+    woort_Value* rt_env_data = vm->m_data;
+    bool rt_env_data_copy_on_write = vm->m_data_copy_on_write;
 
     woort_Value* rt_stack = vm->m_stack;
     woort_Value* rt_stack_end = vm->m_stack_end;
     woort_Value* rt_sp = vm->m_sp;
     woort_Value* rt_sb = vm->m_sb;
 
+    // Function to be called by CALL commands.
+    woort_Function rt_callee;
+
     // Ok
 _label_continue_execution:
     for (;;)
@@ -210,6 +595,10 @@ _label_continue_execution:
     case WOORT_VM_CASE_OP6_M2(CODE, 2):     \
     case WOORT_VM_CASE_OP6_M2(CODE, 3)
 
+// Register addressed by S8 operand `FORMAL` of current command.
+#define WOORT_VM_S8(FORMAL)                 \
+    rt_sb[(int8_t)WOORT_BYTECODE(FORMAL, c)]
+
         register const woort_Bytecode c = *rt_ip;
         switch (WOORT_BYTECODE_OPM8_MASK & c)
         {
@@ -223,6 +612,8 @@ _label_continue_execution:
         // STORE
         case WOORT_VM_CASE_OP6(WOORT_OPCODE_STORE):
         {
+            WOORT_VM_PREPARE_STATIC_WRITE();
+
             rt_env_data[WOORT_BYTECODE(MAB18, c)] =
                 rt_sb[(int8_t)WOORT_BYTECODE(C8, c)];
             break;
@@ -239,6 +630,8 @@ _label_continue_execution:
         // STOREEX
         case WOORT_VM_CASE_OP6(WOORT_OPCODE_STOREEX):
         {
+            WOORT_VM_PREPARE_STATIC_WRITE();
+
             rt_env_data[rt_ip[1]] =
                 rt_sb[(int16_t)WOORT_BYTECODE(BC16, c)];
 
@@ -375,6 +768,8 @@ _label_continue_execution:
         // POPC
         case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_POP, 2):
         {
+            WOORT_VM_PREPARE_STATIC_WRITE();
+
             rt_env_data[WOORT_BYTECODE(ABC24, c)] = *(++rt_sp);
 
             assert(rt_sp <= rt_sb);
@@ -383,35 +778,104 @@ _label_continue_execution:
         // POPCEXT
         case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_POP, 3):
         {
+            WOORT_VM_PREPARE_STATIC_WRITE();
+
             rt_env_data[rt_ip[1]] = *(++rt_sp);
-            
+
             assert(rt_sp <= rt_sb);
 
             rt_ip += 2;
             continue;
         }
+        // PUSHRSCHK
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_PUSHRANGE, 0):
+        {
+            const uint32_t push_count = WOORT_BYTECODE(A8, c);
+
+            if (rt_sp - rt_stack >= (ptrdiff_t)push_count - 1)
+            {
+                rt_sp -= push_count;
+                memcpy(
+                    rt_sp + 1,
+                    rt_sb + (int16_t)WOORT_BYTECODE(BC16, c),
+                    push_count * sizeof(woort_Value));
+                break;
+            }
+            WOORT_VM_THROW(stack_overflow);
+        }
+        // PUSHRS
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_PUSHRANGE, 1):
+        {
+            const uint32_t push_count = WOORT_BYTECODE(A8, c);
+
+            rt_sp -= push_count;
+            assert(rt_sp + 1 >= rt_stack);
+
+            memcpy(
+                rt_sp + 1,
+                rt_sb + (int16_t)WOORT_BYTECODE(BC16, c),
+                push_count * sizeof(woort_Value));
+            break;
+        }
+        // PUSHRCCHK
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_PUSHRANGE, 2):
+        {
+            const uint32_t push_count = WOORT_BYTECODE(ABC24, c);
+
+            if (rt_sp - rt_stack >= (ptrdiff_t)push_count - 1)
+            {
+                rt_sp -= push_count;
+                memcpy(
+                    rt_sp + 1,
+                    rt_env_data + rt_ip[1],
+                    push_count * sizeof(woort_Value));
+
+                rt_ip += 2;
+                continue;
+            }
+            WOORT_VM_THROW(stack_overflow);
+        }
+        // PUSHRC
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_PUSHRANGE, 3):
+        {
+            const uint32_t push_count = WOORT_BYTECODE(ABC24, c);
+
+            rt_sp -= push_count;
+            assert(rt_sp + 1 >= rt_stack);
+
+            memcpy(
+                rt_sp + 1,
+                rt_env_data + rt_ip[1],
+                push_count * sizeof(woort_Value));
+
+            rt_ip += 2;
+            continue;
+        }
         // TODO: WOORT_OPCODE_CASTI
         // TODO: WOORT_OPCODE_CASTR
         // TODO: WOORT_OPCODE_CASTS
 
         // CALLNWO
         case WOORT_VM_CASE_OP6(WOORT_OPCODE_CALLNWO):
+            rt_callee = rt_env_data[WOORT_BYTECODE(MABC26, c)].m_function;
+
+            // Guard for quickened CALLC, function in static storage might be changed.
+            if (/* UNLIKELY */ rt_callee.m_type != WOORT_FUNCTION_TYPE_SCRIPT)
+                goto _label_call_guard_failed;
+            /* FALLTHROUGH */
+        _label_call_script:
         {
             rt_sp -= 2;
             if (rt_sp >= rt_stack)
             {
                 rt_sp[1].m_ret_bp.m_way = WOORT_CALL_WAY_NEAR;
                 rt_sp[1].m_ret_bp.m_bp_offset = (uint32_t)(rt_stack_end - rt_sb);
-                rt_sp[2].m_ret_addr = rt_ip + 1;
+                // Return to this CALLNWO, RET moves forward to next command.
+                rt_sp[2].m_ret_addr = rt_ip;
 
                 rt_sb = rt_sp;
 
-                // Check for assuring invoke script function.
-                assert(rt_env_data[WOORT_BYTECODE(MABC26, c)].m_function.m_type ==
-                    WOORT_FUNCTION_TYPE_SCRIPT);
-
-                rt_ip = (const woort_Bytecode*)rt_env_data[
-                    WOORT_BYTECODE(MABC26, c)].m_function.m_address;
+                rt_ip = (const woort_Bytecode*)rt_callee.m_address;
                 continue;
             }
 
@@ -420,23 +884,24 @@ _label_continue_execution:
         }
         // CALLNFP
         case WOORT_VM_CASE_OP6(WOORT_OPCODE_CALLNFP):
+            rt_callee = rt_env_data[WOORT_BYTECODE(MABC26, c)].m_function;
+
+            if (/* UNLIKELY */ rt_callee.m_type != WOORT_FUNCTION_TYPE_NATIVE)
+                goto _label_call_guard_failed;
+            /* FALLTHROUGH */
+        _label_call_native:
         {
             rt_sp -= 2;
             if (rt_sp >= rt_stack)
             {
                 rt_sp[1].m_ret_bp.m_way = WOORT_CALL_WAY_NEAR;
                 rt_sp[1].m_ret_bp.m_bp_offset = (uint32_t)(rt_stack_end - rt_sb);
-                rt_sp[2].m_ret_addr = rt_ip + 1;
+                rt_sp[2].m_ret_addr = rt_ip;
 
                 rt_sb = rt_sp;
 
-                // Check for assuring invoke native function.
-                assert(rt_env_data[WOORT_BYTECODE(MABC26, c)].m_function.m_type ==
-                    WOORT_FUNCTION_TYPE_NATIVE);
-
                 const woort_NativeFunction function =
-                    (woort_NativeFunction)rt_env_data[
-                        WOORT_BYTECODE(MABC26, c)].m_function.m_address;
+                    (woort_NativeFunction)rt_callee.m_address;
 
                 WOORT_VM_SYNC_STATE();
 
@@ -455,9 +920,13 @@ _label_continue_execution:
 
                 WOORT_VM_CHECK_STACK_VERSION_AND_RESYNC_STACK_STATE(
                     stack_version_before_native_call);
+                WOORT_VM_RESYNC_ENV_DATA();
 
                 if (status == WOORT_VM_CALL_STATUS_NORMAL)
                 {
+                    // Back to caller's frame, result will be taken by RESULT.
+                    rt_sb = rt_stack_end - rt_sp[1].m_ret_bp.m_bp_offset;
+
                     // Ok, continue execute.
                     break;
                 }
@@ -469,23 +938,24 @@ _label_continue_execution:
         }
         // CALLNJIT
         case WOORT_VM_CASE_OP6(WOORT_OPCODE_CALLNJIT):
+            rt_callee = rt_env_data[WOORT_BYTECODE(MABC26, c)].m_function;
+
+            if (/* UNLIKELY */ rt_callee.m_type != WOORT_FUNCTION_TYPE_JIT)
+                goto _label_call_guard_failed;
+            /* FALLTHROUGH */
+        _label_call_jit:
         {
             rt_sp -= 2;
             if (rt_sp >= rt_stack)
             {
                 rt_sp[1].m_ret_bp.m_way = WOORT_CALL_WAY_FAR;
                 rt_sp[1].m_ret_bp.m_bp_offset = (uint32_t)(rt_stack_end - rt_sb);
-                rt_sp[2].m_ret_addr = rt_ip + 1;
+                rt_sp[2].m_ret_addr = rt_ip;
 
                 rt_sb = rt_sp;
 
-                // Check for assuring invoke jit function.
-                assert(rt_env_data[WOORT_BYTECODE(MABC26, c)].m_function.m_type ==
-                    WOORT_FUNCTION_TYPE_JIT);
-
                 const woort_NativeFunction jit_function =
-                    (woort_NativeFunction)rt_env_data[
-                        WOORT_BYTECODE(MABC26, c)].m_function.m_address;
+                    (woort_NativeFunction)rt_callee.m_address;
 
                 const woort_VmCallStatus status = jit_function(vm, rt_sp + 3);
                 switch (status)
@@ -494,6 +964,10 @@ _label_continue_execution:
                     WOORT_VM_RESYNC_STATE();
                     break;
                 case WOORT_VM_CALL_STATUS_NORMAL:
+                    WOORT_VM_RESYNC_ENV_DATA();
+
+                    // Back to caller's frame, result will be taken by RESULT.
+                    rt_sb = rt_stack_end - rt_sp[1].m_ret_bp.m_bp_offset;
                     break;
                 default:
                     return status;
@@ -506,7 +980,69 @@ _label_continue_execution:
             rt_sp += 2;
             WOORT_VM_THROW(stack_overflow);
         }
-        // TODO: WOORT_OPCODE_CALL
+        // CALLS
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_CALL, 0):
+            rt_callee = rt_sb[(int16_t)WOORT_BYTECODE(BC16, c)].m_function;
+            goto _label_call_dynamic;
+        // CALLC
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_CALL, 1):
+            rt_callee = rt_env_data[WOORT_BYTECODE(ABC24, c)].m_function;
+
+            // Quicken, calls followed go directly if function type is not changed.
+            _woort_VMRuntime_quicken_call(
+                rt_env, rt_ip, WOORT_BYTECODE(ABC24, c), rt_callee);
+            goto _label_call_dynamic;
+        _label_call_guard_failed:
+            // Function type changed, quicken again or give up if it keeps changing.
+            _woort_VMRuntime_quicken_call(
+                rt_env, rt_ip, WOORT_BYTECODE(MABC26, c), rt_callee);
+            goto _label_call_dynamic;
+        // CALLCDYN
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_CALL, 3):
+            rt_callee = rt_env_data[WOORT_BYTECODE(ABC24, c)].m_function;
+            /* FALLTHROUGH */
+        _label_call_dynamic:
+            switch ((woort_FunctionType)rt_callee.m_type)
+            {
+            case WOORT_FUNCTION_TYPE_SCRIPT:
+                goto _label_call_script;
+            case WOORT_FUNCTION_TYPE_NATIVE:
+                goto _label_call_native;
+            case WOORT_FUNCTION_TYPE_JIT:
+                goto _label_call_jit;
+            default:
+                WOORT_VM_SYNC_STATE_AND_PANIC(
+                    WOORT_PANIC_BAD_FUNCTION,
+                    "Bad function, unexpected function type(%x).",
+                    (uint32_t)rt_callee.m_type);
+                return WOORT_VM_CALL_STATUS_ABORTED;
+            }
+
+        // TCALLNWO
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_CALL, 2):
+        {
+            /*
+            Tail call, arguments pushed for callee are moved over arguments of current
+            frame, return info of current frame is kept, callee will return to our caller.
+
+            NOTE: Argument count cannot be more than current frame's, it's compiler's
+                duty: callers push as many arguments as argument registers of current
+                function, see woort_LIRFunction_get_argument_register.
+            */
+            memmove(
+                rt_sb + 3,
+                rt_sp + 1,
+                WOORT_BYTECODE(BC16, c) * sizeof(woort_Value));
+
+            rt_sp = rt_sb;
+
+            // Check for assuring invoke script function.
+            assert(rt_env_data[rt_ip[1]].m_function.m_type ==
+                WOORT_FUNCTION_TYPE_SCRIPT);
+
+            rt_ip = (const woort_Bytecode*)(intptr_t)rt_env_data[rt_ip[1]].m_function.m_address;
+            continue;
+        }
 
         // RET
         case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_RET, 0):
@@ -600,13 +1136,236 @@ _label_continue_execution:
         // RESULT
         case WOORT_VM_CASE_OP6(WOORT_OPCODE_RESULT):
         {
-            rt_sb[WOORT_BYTECODE(BC16, c)] = rt_sp[2];
+            rt_sb[(int16_t)WOORT_BYTECODE(BC16, c)] = rt_sp[2];
             rt_sp += 2 + WOORT_BYTECODE(MA10, c);
 
             assert(rt_sp <= rt_sb);
 
             break;
         }
+        // JMP
+        case WOORT_VM_CASE_OP6(WOORT_OPCODE_JMP):
+            rt_ip += WOORT_BYTECODE(MABC26, c);
+            continue;
+        // JMPGC
+        case WOORT_VM_CASE_OP6(WOORT_OPCODE_JMPGC):
+            // No GC yet, nothing to check at this safe point.
+            rt_ip -= WOORT_BYTECODE(MABC26, c);
+            continue;
+        // JFCONDNZ
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCOND, 0):
+            if (WOORT_VM_S8(A8).m_integer != 0)
+            {
+                rt_ip += WOORT_BYTECODE(BC16, c);
+                continue;
+            }
+            break;
+        // JFCONDZ
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCOND, 1):
+            if (WOORT_VM_S8(A8).m_integer == 0)
+            {
+                rt_ip += WOORT_BYTECODE(BC16, c);
+                continue;
+            }
+            break;
+        // JFCONDEQ
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCOND, 2):
+            if (WOORT_VM_S8(A8).m_integer == WOORT_VM_S8(B8).m_integer)
+            {
+                rt_ip += WOORT_BYTECODE(C8, c);
+                continue;
+            }
+            break;
+        // JFCONDNE
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCOND, 3):
+            if (WOORT_VM_S8(A8).m_integer != WOORT_VM_S8(B8).m_integer)
+            {
+                rt_ip += WOORT_BYTECODE(C8, c);
+                continue;
+            }
+            break;
+        // JBCONDNZ
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCONDGC, 0):
+            if (WOORT_VM_S8(A8).m_integer != 0)
+            {
+                rt_ip -= WOORT_BYTECODE(BC16, c);
+                continue;
+            }
+            break;
+        // JBCONDZ
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCONDGC, 1):
+            if (WOORT_VM_S8(A8).m_integer == 0)
+            {
+                rt_ip -= WOORT_BYTECODE(BC16, c);
+                continue;
+            }
+            break;
+        // JBCONDEQ
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCONDGC, 2):
+            if (WOORT_VM_S8(A8).m_integer == WOORT_VM_S8(B8).m_integer)
+            {
+                rt_ip -= WOORT_BYTECODE(C8, c);
+                continue;
+            }
+            break;
+        // JBCONDNE
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_JCONDGC, 3):
+            if (WOORT_VM_S8(A8).m_integer != WOORT_VM_S8(B8).m_integer)
+            {
+                rt_ip -= WOORT_BYTECODE(C8, c);
+                continue;
+            }
+            break;
+        // ADDI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIASMD, 0):
+            // Wrap around if overflow.
+            WOORT_VM_S8(C8).m_integer = (woort_Integer)(
+                (uint64_t)WOORT_VM_S8(A8).m_integer + (uint64_t)WOORT_VM_S8(B8).m_integer);
+            break;
+        // SUBI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIASMD, 1):
+            WOORT_VM_S8(C8).m_integer = (woort_Integer)(
+                (uint64_t)WOORT_VM_S8(A8).m_integer - (uint64_t)WOORT_VM_S8(B8).m_integer);
+            break;
+        // MULI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIASMD, 2):
+            WOORT_VM_S8(C8).m_integer = (woort_Integer)(
+                (uint64_t)WOORT_VM_S8(A8).m_integer * (uint64_t)WOORT_VM_S8(B8).m_integer);
+            break;
+        // DIVI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIASMD, 3):
+        {
+            const woort_Integer divisor = WOORT_VM_S8(B8).m_integer;
+            if (/* UNLIKELY */ divisor == 0)
+                WOORT_VM_THROW(divided_by_zero);
+
+            // INT64_MIN / -1 overflows, wrap around as SUBI.
+            WOORT_VM_S8(C8).m_integer = divisor == -1
+                ? (woort_Integer)(0 - (uint64_t)WOORT_VM_S8(A8).m_integer)
+                : WOORT_VM_S8(A8).m_integer / divisor;
+            break;
+        }
+        // MODI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIONLG, 0):
+        {
+            const woort_Integer divisor = WOORT_VM_S8(B8).m_integer;
+            if (/* UNLIKELY */ divisor == 0)
+                WOORT_VM_THROW(divided_by_zero);
+
+            WOORT_VM_S8(C8).m_integer = divisor == -1
+                ? 0
+                : WOORT_VM_S8(A8).m_integer % divisor;
+            break;
+        }
+        // NEGI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIONLG, 1):
+            rt_sb[(int16_t)WOORT_BYTECODE(BC16, c)].m_integer =
+                (woort_Integer)(0 - (uint64_t)WOORT_VM_S8(A8).m_integer);
+            break;
+        // LTI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIONLG, 2):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer < WOORT_VM_S8(B8).m_integer;
+            break;
+        // GTI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPIONLG, 3):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer > WOORT_VM_S8(B8).m_integer;
+            break;
+        // LEI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPISREN, 0):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer <= WOORT_VM_S8(B8).m_integer;
+            break;
+        // GEI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPISREN, 1):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer >= WOORT_VM_S8(B8).m_integer;
+            break;
+        // EQI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPISREN, 2):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer == WOORT_VM_S8(B8).m_integer;
+            break;
+        // NEI
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPISREN, 3):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer != WOORT_VM_S8(B8).m_integer;
+            break;
+        // ADDR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRASMD, 0):
+            WOORT_VM_S8(C8).m_real =
+                WOORT_VM_S8(A8).m_real + WOORT_VM_S8(B8).m_real;
+            break;
+        // SUBR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRASMD, 1):
+            WOORT_VM_S8(C8).m_real =
+                WOORT_VM_S8(A8).m_real - WOORT_VM_S8(B8).m_real;
+            break;
+        // MULR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRASMD, 2):
+            WOORT_VM_S8(C8).m_real =
+                WOORT_VM_S8(A8).m_real * WOORT_VM_S8(B8).m_real;
+            break;
+        // DIVR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRASMD, 3):
+            WOORT_VM_S8(C8).m_real =
+                WOORT_VM_S8(A8).m_real / WOORT_VM_S8(B8).m_real;
+            break;
+        // MODR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRONLG, 0):
+            WOORT_VM_S8(C8).m_real =
+                fmod(WOORT_VM_S8(A8).m_real, WOORT_VM_S8(B8).m_real);
+            break;
+        // NEGR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRONLG, 1):
+            rt_sb[(int16_t)WOORT_BYTECODE(BC16, c)].m_real = -WOORT_VM_S8(A8).m_real;
+            break;
+        // LTR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRONLG, 2):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_real < WOORT_VM_S8(B8).m_real;
+            break;
+        // GTR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRONLG, 3):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_real > WOORT_VM_S8(B8).m_real;
+            break;
+        // LER
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRSREN, 0):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_real <= WOORT_VM_S8(B8).m_real;
+            break;
+        // GER
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRSREN, 1):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_real >= WOORT_VM_S8(B8).m_real;
+            break;
+        // EQR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRSREN, 2):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_real == WOORT_VM_S8(B8).m_real;
+            break;
+        // NER
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPRSREN, 3):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_real != WOORT_VM_S8(B8).m_real;
+            break;
+        // LAND
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPLAONI, 0):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer != 0 && WOORT_VM_S8(B8).m_integer != 0;
+            break;
+        // LOR
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPLAONI, 1):
+            WOORT_VM_S8(C8).m_integer =
+                WOORT_VM_S8(A8).m_integer != 0 || WOORT_VM_S8(B8).m_integer != 0;
+            break;
+        // LNOTST
+        case WOORT_VM_CASE_OP6_M2(WOORT_OPCODE_OPLAONI, 2):
+            rt_sb[(int16_t)WOORT_BYTECODE(BC16, c)].m_integer =
+                WOORT_VM_S8(A8).m_integer == 0;
+            break;
         default:
             // Unknown bytecode command.
             WOORT_VM_THROW(bad_command);
@@ -635,8 +1394,30 @@ _label_exception_handler_env_updated:
             WOORT_PANIC_CODE_ENV_NOT_FOUND,
             "Cannot find code environment from `%p`.", vm->m_ip);
     }
+    if (/* UNLIKELY */ !_woort_VMRuntime_bind_env_data(vm))
+    {
+        WOORT_VM_SYNC_STATE_AND_PANIC(
+            WOORT_PANIC_OUT_OF_MEMORY,
+            "Failed to copy static storages.");
+    }
     WOORT_VM_HANDLED();
 
+_label_exception_handler_copy_on_write:
+    // First static storage write of this VM, copy data area, then retry.
+    if (/* UNLIKELY */ !_woort_VMRuntime_copy_env_data(vm))
+    {
+        WOORT_VM_SYNC_STATE_AND_PANIC(
+            WOORT_PANIC_OUT_OF_MEMORY,
+            "Failed to copy static storages.");
+    }
+    WOORT_VM_HANDLED();
+
+_label_exception_handler_divided_by_zero:
+    WOORT_VM_SYNC_STATE_AND_PANIC(
+        WOORT_PANIC_DIVIDED_BY_ZERO,
+        "Integer divided by zero.");
+    return WOORT_VM_CALL_STATUS_ABORTED;
+
 _label_exception_handler_bad_command:
     // Bad command.
     WOORT_VM_SYNC_STATE_AND_PANIC(
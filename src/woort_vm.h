@@ -10,9 +10,16 @@ woort_vm.h
 #include "woort_value.h"
 #include "woort_opcode_formal.h"
 #include "woort_codeenv.h"
+#include "woort_vector.h"
 
 #include <stdbool.h>
 
+/*
+Quickened call whose function type changed more than this times (by type feedback)
+turns into CALLCDYN and is never quickened again.
+*/
+#define WOORT_VM_CALL_MAX_REQUICKEN_COUNT 2
+
 typedef struct woort_VMRuntime
 {
     // VM Runtime status.
@@ -26,10 +33,68 @@ typedef struct woort_VMRuntime
 
     const woort_CodeEnv* m_env;
 
+    // Count of woort_VMRuntime_invoke running on this VM.
+    uint32_t                m_invoke_depth;
+    // Target size for trimming stack when back to native, 0 (default) for never trimming.
+    size_t                  m_stack_trim_size;
+
+    // Data area used with m_env, shared one in m_env or private copy of this VM.
+    woort_Value*            m_data;
+    // m_data is shared, should be copied before writing static storages.
+    bool                    m_data_copy_on_write;
+
+    bool                    m_private_statics;
+    woort_Vector /* woort_VMRuntime_PrivateData */
+                            m_private_datas;
+
 } woort_VMRuntime;
 
+/*
+Private copy of a CodeEnv's data area, constants in it are never written.
+*/
+typedef struct woort_VMRuntime_PrivateData
+{
+    // Shared by VM until deinit.
+    woort_CodeEnv*  m_env;
+    woort_Value*    m_data;
+    size_t          m_data_count;
+
+} woort_VMRuntime_PrivateData;
+
 WOORT_NODISCARD bool woort_VMRuntime_init(woort_VMRuntime* vm);
+
+/*
+Like woort_VMRuntime_init, but static storages written by this VM are private: data
+area of CodeEnv is copied on first write, so that same CodeEnv can be run by VMs in
+different threads without races.
+
+NOTE: Static storages appended by woort_CodeEnv_extend are visible after next
+    invoke.
+*/
+WOORT_NODISCARD bool woort_VMRuntime_init_with_private_statics(woort_VMRuntime* vm);
 void woort_VMRuntime_deinit(woort_VMRuntime* vm);
 
+/*
+Reset an idle VM (not running) to initial state for reuse, private statics are
+dropped, stack is reallocated if its size is not `stack_size`.
+
+NOTE: If failed, VM is still reset and usable with its old stack.
+*/
+WOORT_NODISCARD bool woort_VMRuntime_reset(woort_VMRuntime* vm, size_t stack_size);
+
+/*
+Stack is trimmed to `m_stack_trim_size` after outermost invoking returned if it
+has been grown too big by deep recursion. Trimming is off by default, so stack stays
+at its high-water mark.
+*/
 WOORT_NODISCARD woort_VmCallStatus woort_VMRuntime_invoke(
     woort_VMRuntime* vm, const woort_Bytecode* func);
+
+/*
+Shrink stack to `target_size`, or the smallest power of 2 times of it which can hold
+values in use.
+
+NOTE: Fails if VM is running (called by native functions), functions being executed
+    rely on stack room assured at their entry.
+*/
+WOORT_NODISCARD bool woort_VMRuntime_trim_stack(woort_VMRuntime* vm, size_t target_size);
@@ -0,0 +1,168 @@
+#include "woort_vm_pool.h"
+#include "woort_log.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+WOORT_NODISCARD /* OPTIONAL */ woort_VMRuntime* _woort_VMRuntimePool_create_vm(
+    woort_VMRuntimePool* pool)
+{
+    woort_VMRuntime* const vm = malloc(sizeof(woort_VMRuntime));
+    if (vm == NULL)
+    {
+        WOORT_DEBUG("Out of memory");
+        return NULL;
+    }
+
+    const bool init_result = pool->m_private_statics
+        ? woort_VMRuntime_init_with_private_statics(vm)
+        : woort_VMRuntime_init(vm);
+
+    if (!init_result)
+    {
+        free(vm);
+        return NULL;
+    }
+
+    // Grow stack now, instead of doubling it in first deep call.
+    if (!woort_VMRuntime_reset(vm, pool->m_stack_size))
+    {
+        woort_VMRuntime_deinit(vm);
+        free(vm);
+        return NULL;
+    }
+    vm->m_stack_trim_size = pool->m_stack_size;
+
+    return vm;
+}
+
+void _woort_VMRuntimePool_destroy_vm(woort_VMRuntime* vm)
+{
+    woort_VMRuntime_deinit(vm);
+    free(vm);
+}
+
+WOORT_NODISCARD bool woort_VMRuntimePool_init(
+    woort_VMRuntimePool* pool,
+    size_t capacity,
+    size_t prewarm_count,
+    size_t stack_size,
+    bool private_statics)
+{
+    assert(prewarm_count <= capacity);
+
+    if (!woort_mpmc_queue_init(&pool->m_idle_vms, capacity))
+        return false;
+
+    pool->m_stack_size = stack_size;
+    pool->m_private_statics = private_statics;
+
+    woort_atomic_init(&pool->m_idle_count, 0);
+
+    for (size_t i = 0; i < prewarm_count; ++i)
+    {
+        woort_VMRuntime* const vm = _woort_VMRuntimePool_create_vm(pool);
+        if (vm == NULL)
+        {
+            woort_VMRuntimePool_deinit(pool);
+            return false;
+        }
+
+        if (!woort_mpmc_queue_try_push(&pool->m_idle_vms, vm))
+        {
+            // Should not happen, capacity is enough.
+            WOORT_DEBUG("Idle queue is full.");
+            _woort_VMRuntimePool_destroy_vm(vm);
+            break;
+        }
+        woort_atomic_fetch_add_explicit(
+            &pool->m_idle_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+    }
+
+    woort_atomic_init(
+        &pool->m_idle_low_watermark,
+        woort_atomic_load_explicit(&pool->m_idle_count, WOORT_ATOMIC_MEMORY_ORDER_RELAXED));
+    return true;
+}
+
+void woort_VMRuntimePool_deinit(woort_VMRuntimePool* pool)
+{
+    void* vm;
+    while (woort_mpmc_queue_try_pop(&pool->m_idle_vms, &vm))
+        _woort_VMRuntimePool_destroy_vm(vm);
+
+    woort_mpmc_queue_deinit(&pool->m_idle_vms);
+}
+
+WOORT_NODISCARD bool woort_VMRuntimePool_acquire(
+    woort_VMRuntimePool* pool, woort_VMRuntime** out_vm)
+{
+    void* vm;
+    if (woort_mpmc_queue_try_pop(&pool->m_idle_vms, &vm))
+    {
+        const uint64_t idle_count = woort_atomic_fetch_sub_explicit(
+            &pool->m_idle_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED) - 1;
+
+        uint64_t low_watermark = woort_atomic_load_explicit(
+            &pool->m_idle_low_watermark, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+        while (idle_count < low_watermark
+            && !woort_atomic_compare_exchange_weak_explicit(
+                &pool->m_idle_low_watermark,
+                &low_watermark,
+                idle_count,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED,
+                WOORT_ATOMIC_MEMORY_ORDER_RELAXED))
+            ;
+
+        *out_vm = vm;
+        return true;
+    }
+
+    woort_VMRuntime* const new_vm = _woort_VMRuntimePool_create_vm(pool);
+    if (new_vm == NULL)
+        return false;
+
+    *out_vm = new_vm;
+    return true;
+}
+
+void woort_VMRuntimePool_release(woort_VMRuntimePool* pool, woort_VMRuntime* vm)
+{
+    if (!woort_VMRuntime_reset(vm, pool->m_stack_size)
+        || !woort_mpmc_queue_try_push(&pool->m_idle_vms, vm))
+    {
+        // Out of memory or pool is full.
+        _woort_VMRuntimePool_destroy_vm(vm);
+        return;
+    }
+
+    woort_atomic_fetch_add_explicit(
+        &pool->m_idle_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+}
+
+size_t woort_VMRuntimePool_shrink(woort_VMRuntimePool* pool)
+{
+    const uint64_t unused_count = woort_atomic_load_explicit(
+        &pool->m_idle_low_watermark, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+    size_t freed_count = 0;
+    void* vm;
+    while (freed_count < unused_count
+        && woort_mpmc_queue_try_pop(&pool->m_idle_vms, &vm))
+    {
+        woort_atomic_fetch_sub_explicit(
+            &pool->m_idle_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+        _woort_VMRuntimePool_destroy_vm(vm);
+        ++freed_count;
+    }
+
+    // Start watching from now.
+    woort_atomic_store_explicit(
+        &pool->m_idle_low_watermark,
+        woort_atomic_load_explicit(&pool->m_idle_count, WOORT_ATOMIC_MEMORY_ORDER_RELAXED),
+        WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+    return freed_count;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+woort_vm_pool.h
+Pool of idle VMs with retained stacks, for creating VM per request cheaply.
+*/
+
+#include "woort_diagnosis.h"
+#include "woort_atomic.h"
+#include "woort_queue.h"
+#include "woort_vm.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct woort_VMRuntimePool
+{
+    woort_MPMCQueue /* woort_VMRuntime* */ m_idle_vms;
+
+    // Stack size of pooled VMs, bigger stacks are shrunk when released.
+    size_t  m_stack_size;
+    bool    m_private_statics;
+
+    // Approximate, VMs which are idle since last shrink will be freed in next shrink.
+    woort_AtomicUInt64 m_idle_count;
+    woort_AtomicUInt64 m_idle_low_watermark;
+
+} woort_VMRuntimePool;
+
+/*
+Create pool holding at most `capacity` idle VMs, `prewarm_count` of them are created
+now. All VMs have stacks of `stack_size` slots, created by
+woort_VMRuntime_init_with_private_statics if `private_statics`.
+*/
+WOORT_NODISCARD bool woort_VMRuntimePool_init(
+    woort_VMRuntimePool* pool,
+    size_t capacity,
+    size_t prewarm_count,
+    size_t stack_size,
+    bool private_statics);
+
+/*
+NOTE: VMs acquired must have been released before deinit.
+*/
+void woort_VMRuntimePool_deinit(woort_VMRuntimePool* pool);
+
+/*
+Acquire & release never block, VM is created if no idle one, and freed if pool is
+full when released.
+*/
+WOORT_NODISCARD bool woort_VMRuntimePool_acquire(
+    woort_VMRuntimePool* pool, woort_VMRuntime** out_vm);
+void woort_VMRuntimePool_release(woort_VMRuntimePool* pool, woort_VMRuntime* vm);
+
+/*
+Free VMs which have never been acquired since last shrink, returns count of freed.
+Should be called periodically, like once every few seconds.
+*/
+size_t woort_VMRuntimePool_shrink(woort_VMRuntimePool* pool);
@@ -0,0 +1,114 @@
+#include "test_bitset.h"
+#include "test_util.h"
+
+#include "woort_bitset.h"
+
+// Two summary words, last word is partly filled.
+#define WOORT_TEST_BITSET_BIT_COUNT (4096 + 64 + 37)
+
+static bool _woort_test_find(
+    const woort_Bitset* bitset, size_t begin, size_t end, size_t expected_index)
+{
+    size_t index;
+    return woort_bitset_find_first_unset_in_range(bitset, begin, end, &index)
+        && index == expected_index;
+}
+
+static bool _woort_test_not_found(const woort_Bitset* bitset, size_t begin, size_t end)
+{
+    size_t index;
+    return !woort_bitset_find_first_unset_in_range(bitset, begin, end, &index);
+}
+
+static void _woort_test_bitset_boundaries(void)
+{
+    woort_Bitset bitset;
+    WOORT_TEST_CHECK(woort_bitset_init(&bitset, WOORT_TEST_BITSET_BIT_COUNT));
+    WOORT_TEST_CHECK(bitset.m_word_count == 66);
+    WOORT_TEST_CHECK(bitset.m_summary_word_count == 2);
+
+    WOORT_TEST_CHECK(!woort_bitset_set(&bitset, WOORT_TEST_BITSET_BIT_COUNT));
+    WOORT_TEST_CHECK(!woort_bitset_test(&bitset, WOORT_TEST_BITSET_BIT_COUNT));
+
+    // Word boundary.
+    WOORT_TEST_CHECK(woort_bitset_set(&bitset, 63));
+    WOORT_TEST_CHECK(woort_bitset_test(&bitset, 63));
+    WOORT_TEST_CHECK(!woort_bitset_test(&bitset, 64));
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 63, 128, 64));
+
+    // Range ends at word boundary, the next word is not touched.
+    woort_bitset_set_range(&bitset, 0, 64);
+    WOORT_TEST_CHECK(bitset.m_data[0] == UINT64_MAX && bitset.m_data[1] == 0);
+    WOORT_TEST_CHECK(bitset.m_full_words[0] == 1);
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 0, 64));
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 0, 65, 64));
+
+    // Across several words, ends at word boundary.
+    woort_bitset_set_range(&bitset, 60, 4096);
+    WOORT_TEST_CHECK(bitset.m_full_words[0] == UINT64_MAX);
+    WOORT_TEST_CHECK(bitset.m_full_words[1] == 0);
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 0, 4096));
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 0, 4097, 4096));
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 4095, WOORT_TEST_BITSET_BIT_COUNT, 4096));
+
+    // Summary boundary, the next summary word is found.
+    woort_bitset_set_range(&bitset, 4096, 4096 + 64);
+    WOORT_TEST_CHECK(bitset.m_full_words[1] == 1);
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 0, WOORT_TEST_BITSET_BIT_COUNT, 4096 + 64));
+
+    // Reset clears the full word bit, so it's found again through summary.
+    WOORT_TEST_CHECK(woort_bitset_reset(&bitset, 4095));
+    WOORT_TEST_CHECK(!woort_bitset_test(&bitset, 4095));
+    WOORT_TEST_CHECK((bitset.m_full_words[0] >> 63) == 0);
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 0, WOORT_TEST_BITSET_BIT_COUNT, 4095));
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 100, 4096, 4095));
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 100, 4095));
+    WOORT_TEST_CHECK(woort_bitset_set(&bitset, 4095));
+    WOORT_TEST_CHECK(bitset.m_full_words[0] == UINT64_MAX);
+
+    // Partly filled last word, end is clamped and bits after it never found.
+    woort_bitset_set_range(&bitset, 4096 + 64, SIZE_MAX);
+    WOORT_TEST_CHECK(woort_bitset_test(&bitset, WOORT_TEST_BITSET_BIT_COUNT - 1));
+    WOORT_TEST_CHECK(bitset.m_data[65] == (1ULL << 37) - 1);
+    WOORT_TEST_CHECK(bitset.m_full_words[1] == 1);
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 0, SIZE_MAX));
+
+    size_t index;
+    WOORT_TEST_CHECK(!woort_bitset_find_first_unset(&bitset, &index));
+
+    // Reset range within one word and across the summary boundary.
+    woort_bitset_reset_range(&bitset, 4094, 4098);
+    WOORT_TEST_CHECK((bitset.m_full_words[0] >> 63) == 0);
+    WOORT_TEST_CHECK(bitset.m_full_words[1] == 0);
+    WOORT_TEST_CHECK(woort_bitset_test(&bitset, 4093) && woort_bitset_test(&bitset, 4098));
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 0, SIZE_MAX, 4094));
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 4096, SIZE_MAX, 4096));
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 4098, SIZE_MAX));
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 10, 10));
+
+    woort_bitset_deinit(&bitset);
+}
+
+static void _woort_test_bitset_full_words(void)
+{
+    // Bit count is a multiple of 64, all words can be full.
+    woort_Bitset bitset;
+    WOORT_TEST_CHECK(woort_bitset_init(&bitset, 128));
+
+    woort_bitset_set_range(&bitset, 0, 128);
+    WOORT_TEST_CHECK(bitset.m_full_words[0] == 3);
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 0, 128));
+    WOORT_TEST_CHECK(_woort_test_not_found(&bitset, 64, SIZE_MAX));
+
+    WOORT_TEST_CHECK(woort_bitset_reset(&bitset, 127));
+    WOORT_TEST_CHECK(bitset.m_full_words[0] == 1);
+    WOORT_TEST_CHECK(_woort_test_find(&bitset, 0, 128, 127));
+
+    woort_bitset_deinit(&bitset);
+}
+
+void woort_test_bitset(void)
+{
+    _woort_test_bitset_boundaries();
+    _woort_test_bitset_full_words();
+}
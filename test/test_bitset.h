@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_bitset.h
+*/
+
+/*
+Check setting, resetting and finding unset bits across word boundaries (63/64),
+summary boundaries (4095/4096), ranges ending at word boundaries and the partly
+filled last word, and that reset clears the full word bit in summary.
+*/
+void woort_test_bitset(void);
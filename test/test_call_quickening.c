@@ -0,0 +1,208 @@
+#include "test_call_quickening.h"
+#include "test_util.h"
+
+#include "woort_codeenv.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+#include "woort_opcode_formal.h"
+
+static woort_api _woort_test_native_11(woort_vm vm, woort_value* args)
+{
+    (void)vm;
+    ((woort_Value*)args)[-1].m_integer = 11;
+    return WOORT_VM_CALL_STATUS_NORMAL;
+}
+
+static woort_api _woort_test_native_22(woort_vm vm, woort_value* args)
+{
+    (void)vm;
+    ((woort_Value*)args)[-1].m_integer = 22;
+    return WOORT_VM_CALL_STATUS_NORMAL;
+}
+
+// Offset of the CALLC in codes below.
+#define WOORT_TEST_CALL_OFFSET 1
+// Static storage holding the function called.
+#define WOORT_TEST_CALLEE_INDEX 4
+
+static void _woort_test_call_constant(void)
+{
+    woort_Vector codes, constants, relocations;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+    woort_vector_init(&constants, sizeof(woort_Value));
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+
+    // main(): return callee(), script callee at offset 4 returns 42.
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 0, 1),
+        woort_OpCodeFormal_cons(
+            OP6_M2_ABC24, WOORT_OPCODE_CALL, 1, WOORT_TEST_CALLEE_INDEX),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_RESULT, 0, 0),
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, 0),
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_RET, 2, 3),
+    };
+    WOORT_TEST_CHECK(woort_vector_push_back(
+        &codes, sizeof(bytecodes) / sizeof(bytecodes[0]), bytecodes));
+
+    woort_Value values[4];
+    values[0].m_function.m_type = WOORT_FUNCTION_TYPE_SCRIPT;
+    values[1].m_function.m_type = WOORT_FUNCTION_TYPE_NATIVE;
+    values[1].m_function.m_address = (int64_t)(intptr_t)&_woort_test_native_11;
+    values[2].m_function.m_type = WOORT_FUNCTION_TYPE_NATIVE;
+    values[2].m_function.m_address = (int64_t)(intptr_t)&_woort_test_native_22;
+    values[3].m_integer = 42;
+    WOORT_TEST_CHECK(woort_vector_push_back(&constants, 4, values));
+
+    const woort_CodeEnv_Relocation relocation = { 0, 4 };
+    WOORT_TEST_CHECK(woort_vector_push_back(&relocations, 1, &relocation));
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(woort_CodeEnv_create(&codes, &constants, 1, &relocations, &code_env));
+
+    woort_Value* const script_callee = &code_env->m_data_begin[0];
+    woort_Value* const native_11 = &code_env->m_data_begin[1];
+    woort_Value* const native_22 = &code_env->m_data_begin[2];
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    const struct
+    {
+        const woort_Value* m_callee;
+        woort_Integer m_result;
+        uint32_t m_opcode;
+        uint32_t m_mode;
+    } steps[] = {
+        // Quickened at first call.
+        { native_11, 11, WOORT_OPCODE_CALLNFP, 0 },
+        // Same type, keep going.
+        { native_22, 22, WOORT_OPCODE_CALLNFP, 0 },
+        // Type changed, quickened again, till WOORT_VM_CALL_MAX_REQUICKEN_COUNT.
+        { script_callee, 42, WOORT_OPCODE_CALLNWO, 0 },
+        { native_11, 11, WOORT_OPCODE_CALLNFP, 0 },
+        // Keeps changing, never quicken again.
+        { script_callee, 42, WOORT_OPCODE_CALL, 3 },
+        { native_22, 22, WOORT_OPCODE_CALL, 3 },
+    };
+    _Static_assert(WOORT_VM_CALL_MAX_REQUICKEN_COUNT == 2,
+        "Steps should be updated with WOORT_VM_CALL_MAX_REQUICKEN_COUNT.");
+
+    woort_Value* const sp = vm.m_sp;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i)
+    {
+        code_env->m_data_begin[WOORT_TEST_CALLEE_INDEX] = *steps[i].m_callee;
+
+        WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL
+            == woort_VMRuntime_invoke(&vm, code_env->m_code_begin));
+        WOORT_TEST_CHECK(vm.m_sp == sp);
+        WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == steps[i].m_result);
+
+        WOORT_TEST_CHECK(woort_test_contains_opcode(
+            code_env,
+            WOORT_TEST_CALL_OFFSET,
+            WOORT_TEST_CALL_OFFSET + 1,
+            steps[i].m_opcode,
+            steps[i].m_mode));
+    }
+
+    // CALLCDYN records nothing, changes are counted till it gives up.
+    woort_CodeEnv_TypeFeedback feedback;
+    WOORT_TEST_CHECK(woort_CodeEnv_get_type_feedback(
+        code_env, WOORT_TEST_CALL_OFFSET, &feedback));
+    WOORT_TEST_CHECK(feedback.m_last_type == WOORT_FUNCTION_TYPE_SCRIPT);
+    WOORT_TEST_CHECK(feedback.m_observed_types
+        == ((1u << WOORT_FUNCTION_TYPE_SCRIPT) | (1u << WOORT_FUNCTION_TYPE_NATIVE)));
+    WOORT_TEST_CHECK(feedback.m_type_changes == WOORT_VM_CALL_MAX_REQUICKEN_COUNT + 1);
+
+    WOORT_TEST_CHECK(!woort_CodeEnv_get_type_feedback(
+        code_env, WOORT_TEST_CALL_OFFSET + 1, &feedback));
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+}
+
+// Offset of the CALLS in codes below.
+#define WOORT_TEST_CALL_SLOT_OFFSET 3
+// Static storage holding the function loaded into slot.
+#define WOORT_TEST_CALL_SLOT_CALLEE_INDEX 2
+
+static void _woort_test_call_slot(void)
+{
+    woort_Vector codes, constants, relocations;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+    woort_vector_init(&constants, sizeof(woort_Value));
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+
+    // main(): f = callee; return f(), script callee at offset 6 returns 42.
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 0, 1),
+        woort_OpCodeFormal_cons(
+            OP6_MA10_BC16, WOORT_OPCODE_LOADEX, 0, (uint16_t)(int16_t)-1),
+        WOORT_TEST_CALL_SLOT_CALLEE_INDEX,
+        woort_OpCodeFormal_cons(
+            OP6_M2_BC16, WOORT_OPCODE_CALL, 0, (uint16_t)(int16_t)-1),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_RESULT, 0, (uint16_t)(int16_t)-1),
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, (uint16_t)(int16_t)-1),
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_RET, 2, 1),
+    };
+    WOORT_TEST_CHECK(woort_vector_push_back(
+        &codes, sizeof(bytecodes) / sizeof(bytecodes[0]), bytecodes));
+
+    woort_Value values[2];
+    values[0].m_function.m_type = WOORT_FUNCTION_TYPE_SCRIPT;
+    values[1].m_integer = 42;
+    WOORT_TEST_CHECK(woort_vector_push_back(&constants, 2, values));
+
+    const woort_CodeEnv_Relocation relocation = { 0, 6 };
+    WOORT_TEST_CHECK(woort_vector_push_back(&relocations, 1, &relocation));
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(woort_CodeEnv_create(&codes, &constants, 1, &relocations, &code_env));
+
+    woort_Value native_11, native_22;
+    native_11.m_function.m_type = WOORT_FUNCTION_TYPE_NATIVE;
+    native_11.m_function.m_address = (int64_t)(intptr_t)&_woort_test_native_11;
+    native_22.m_function.m_type = WOORT_FUNCTION_TYPE_NATIVE;
+    native_22.m_function.m_address = (int64_t)(intptr_t)&_woort_test_native_22;
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    // CALLS is never quickened, function in slot might be different at every call.
+    const struct
+    {
+        const woort_Value* m_callee;
+        woort_Integer m_result;
+    } steps[] = {
+        { &native_11, 11 },
+        { &code_env->m_data_begin[0], 42 },
+        { &native_22, 22 },
+    };
+
+    woort_Value* const sp = vm.m_sp;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i)
+    {
+        code_env->m_data_begin[WOORT_TEST_CALL_SLOT_CALLEE_INDEX] = *steps[i].m_callee;
+
+        WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL
+            == woort_VMRuntime_invoke(&vm, code_env->m_code_begin));
+        WOORT_TEST_CHECK(vm.m_sp == sp);
+        WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == steps[i].m_result);
+
+        WOORT_TEST_CHECK(code_env->m_code_begin[WOORT_TEST_CALL_SLOT_OFFSET]
+            == bytecodes[WOORT_TEST_CALL_SLOT_OFFSET]);
+    }
+
+    woort_CodeEnv_TypeFeedback feedback;
+    WOORT_TEST_CHECK(!woort_CodeEnv_get_type_feedback(
+        code_env, WOORT_TEST_CALL_SLOT_OFFSET, &feedback));
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+}
+
+void woort_test_call_quickening(void)
+{
+    _woort_test_call_constant();
+    _woort_test_call_slot();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_call_quickening.h
+*/
+
+/*
+Check that CALLC is quickened by type of the function called, quickened again when
+the type is changed, and turns into CALLCDYN once it keeps changing; type feedback of
+the call is checked too. CALLS is checked to be never quickened.
+*/
+void woort_test_call_quickening(void);
@@ -0,0 +1,154 @@
+#include "test_codeenv_extend.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+
+#include <string.h>
+
+// Big enough for codes & data committed into the CodeEnv below.
+#define WOORT_TEST_RESERVED_CODE_COUNT 64
+#define WOORT_TEST_RESERVED_DATA_COUNT 16
+
+void woort_test_codeenv_extend(void)
+{
+    woort_Value value;
+
+    // existing(): return 5
+    woort_LIRCompiler existing_compiler;
+    woort_LIRCompiler_init(&existing_compiler);
+    woort_LIRCompiler_reserve_for_extending(
+        &existing_compiler, WOORT_TEST_RESERVED_CODE_COUNT, WOORT_TEST_RESERVED_DATA_COUNT);
+
+    woort_LIRFunction* existing;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&existing_compiler, &existing));
+    {
+        woort_LIR_ConstantStorage c5;
+        value.m_integer = 5;
+        WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&existing_compiler, &value, &c5));
+
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(existing, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(existing, result, c5));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(existing, result));
+    }
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&existing_compiler, &code_env));
+
+    const woort_Bytecode* const existing_entry =
+        code_env->m_code_begin + existing->m_entry_bytecode_offset;
+    woort_LIRCompiler_deinit(&existing_compiler);
+
+    const woort_Bytecode* const code_begin = code_env->m_code_begin;
+    const woort_Value* const data_begin = code_env->m_data_begin;
+    const size_t existing_code_count = (size_t)(code_env->m_code_end - code_begin);
+
+    woort_Bytecode existing_codes[WOORT_TEST_RESERVED_CODE_COUNT];
+    WOORT_TEST_CHECK(existing_code_count <= WOORT_TEST_RESERVED_CODE_COUNT);
+    memcpy(existing_codes, code_begin, existing_code_count * sizeof(woort_Bytecode));
+
+    // appended(): return existing() + nine(), nine(): return 9
+    woort_LIRCompiler appended_compiler;
+    woort_LIRCompiler_init(&appended_compiler);
+
+    woort_LIRFunction* appended;
+    woort_LIRFunction* nine;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&appended_compiler, &appended));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&appended_compiler, &nine));
+    {
+        woort_LIR_ConstantStorage existing_c, nine_c, c9;
+        value.m_function.m_type = WOORT_FUNCTION_TYPE_SCRIPT;
+        value.m_function.m_address = (int64_t)(intptr_t)existing_entry;
+        WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(
+            &appended_compiler, &value, &existing_c));
+        WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+            &appended_compiler, nine, &nine_c));
+        value.m_integer = 9;
+        WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&appended_compiler, &value, &c9));
+
+        woort_LIRRegister* a;
+        woort_LIRRegister* b;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(appended, &a));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(appended, &b));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(appended, a, existing_c, 0));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(appended, b, nine_c, 0));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            appended, WOORT_LIR_OPCODE_ADDI, a, a, b));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(appended, a));
+
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(nine, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(nine, result, c9));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(nine, result));
+    }
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit_into(&appended_compiler, code_env));
+
+    // Existing codes and data never move.
+    WOORT_TEST_CHECK(code_env->m_code_begin == code_begin);
+    WOORT_TEST_CHECK(code_env->m_data_begin == data_begin);
+    WOORT_TEST_CHECK(memcmp(
+        code_begin, existing_codes, existing_code_count * sizeof(woort_Bytecode)) == 0);
+    WOORT_TEST_CHECK(appended->m_entry_bytecode_offset >= existing_code_count);
+
+    woort_CodeEnv* found_env;
+    WOORT_TEST_CHECK(woort_CodeEnv_find(
+        code_begin + appended->m_entry_bytecode_offset, &found_env));
+    WOORT_TEST_CHECK(found_env == code_env);
+
+    // Calls are NEAR, never quickened.
+    const size_t code_end = (size_t)(code_env->m_code_end - code_begin);
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, appended->m_entry_bytecode_offset, code_end, WOORT_OPCODE_CALLNWO, 0));
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env, appended->m_entry_bytecode_offset, code_end, WOORT_OPCODE_CALL, 1));
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    woort_Value* const sp = vm.m_sp;
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_begin + appended->m_entry_bytecode_offset));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 14);
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, existing_entry));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 5);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_LIRCompiler_deinit(&appended_compiler);
+
+    // Not enough room left, CodeEnv is kept untouched.
+    woort_LIRCompiler oversized_compiler;
+    woort_LIRCompiler_init(&oversized_compiler);
+
+    woort_LIRFunction* oversized;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&oversized_compiler, &oversized));
+    {
+        woort_LIR_ConstantStorage c7;
+        value.m_integer = 7;
+        WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&oversized_compiler, &value, &c7));
+
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(oversized, &result));
+        // Vectors may leave more room than reserved, fill all room left.
+        const size_t code_room = (size_t)(code_env->m_code_capacity_end - code_env->m_code_end);
+        for (size_t i = 0; i <= code_room; ++i)
+            WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(oversized, result, c7));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(oversized, result));
+    }
+    const woort_Bytecode* const code_end_before = code_env->m_code_end;
+    const woort_Value* const data_end_before = code_env->m_data_end;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_EXTENDING
+        == woort_LIRCompiler_commit_into(&oversized_compiler, code_env));
+    WOORT_TEST_CHECK(code_env->m_code_end == code_end_before);
+    WOORT_TEST_CHECK(code_env->m_data_end == data_end_before);
+
+    woort_LIRCompiler_deinit(&oversized_compiler);
+    woort_CodeEnv_unshare(code_env);
+}
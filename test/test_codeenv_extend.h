@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_codeenv_extend.h
+*/
+
+/*
+Commit functions into a CodeEnv committed before, check existing codes do not move,
+new functions call existing ones in NEAR way, and committing fails without room.
+*/
+void woort_test_codeenv_extend(void);
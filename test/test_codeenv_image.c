@@ -0,0 +1,129 @@
+#include "test_codeenv_image.h"
+#include "test_util.h"
+
+#include "woort_codeenv_image.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+#include "woort_opcode_formal.h"
+
+#include <string.h>
+
+#define WOORT_TEST_IMAGE_PATH "woort_test_codeenv_image.woortimg"
+
+static woort_api _woort_test_native_11(woort_vm vm, woort_value* args)
+{
+    (void)vm;
+    ((woort_Value*)args)[-1].m_integer = 11;
+    return WOORT_VM_CALL_STATUS_NORMAL;
+}
+
+// Offset of the CALLC in codes below.
+#define WOORT_TEST_CALL_OFFSET 1
+// Offset of the script callee in codes below.
+#define WOORT_TEST_CALLEE_OFFSET 4
+// Static storage holding the function called.
+#define WOORT_TEST_CALLEE_INDEX 2
+
+void woort_test_codeenv_image(void)
+{
+    woort_Vector codes, constants, relocations;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+    woort_vector_init(&constants, sizeof(woort_Value));
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+
+    // main(): return callee(), script callee returns 42.
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 0, 1),
+        woort_OpCodeFormal_cons(
+            OP6_M2_ABC24, WOORT_OPCODE_CALL, 1, WOORT_TEST_CALLEE_INDEX),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_RESULT, 0, 0),
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, 0),
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_RET, 2, 1),
+    };
+    const size_t code_count = sizeof(bytecodes) / sizeof(bytecodes[0]);
+    WOORT_TEST_CHECK(woort_vector_push_back(&codes, code_count, bytecodes));
+
+    woort_Value values[2];
+    values[0].m_function.m_type = WOORT_FUNCTION_TYPE_SCRIPT;
+    values[1].m_integer = 42;
+    WOORT_TEST_CHECK(woort_vector_push_back(&constants, 2, values));
+
+    const woort_CodeEnv_Relocation relocation = { 0, WOORT_TEST_CALLEE_OFFSET };
+    WOORT_TEST_CHECK(woort_vector_push_back(&relocations, 1, &relocation));
+
+    woort_CodeEnv* saved_env;
+    WOORT_TEST_CHECK(woort_CodeEnv_create(&codes, &constants, 1, &relocations, &saved_env));
+
+    const uint32_t entries[] = { 0, WOORT_TEST_CALLEE_OFFSET };
+    WOORT_TEST_CHECK(woort_CodeEnv_save_image(saved_env, entries, 2, WOORT_TEST_IMAGE_PATH));
+    woort_CodeEnv_unshare(saved_env);
+
+    woort_Vector loaded_entries;
+    woort_vector_init(&loaded_entries, sizeof(uint32_t));
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(woort_CodeEnv_load_image(
+        WOORT_TEST_IMAGE_PATH, &loaded_entries, &code_env));
+
+    // Codes and entries are restored, script function is relocated to loaded codes.
+    WOORT_TEST_CHECK((size_t)(code_env->m_code_end - code_env->m_code_begin) == code_count);
+    WOORT_TEST_CHECK(memcmp(code_env->m_code_begin, bytecodes, sizeof(bytecodes)) == 0);
+    WOORT_TEST_CHECK(code_env->m_constant_count == 2 && code_env->m_static_count == 1);
+    WOORT_TEST_CHECK(loaded_entries.m_size == 2
+        && memcmp(loaded_entries.m_data, entries, sizeof(entries)) == 0);
+    WOORT_TEST_CHECK(code_env->m_data_begin[0].m_function.m_type == WOORT_FUNCTION_TYPE_SCRIPT);
+    WOORT_TEST_CHECK(code_env->m_data_begin[0].m_function.m_address
+        == (int64_t)(intptr_t)(code_env->m_code_begin + WOORT_TEST_CALLEE_OFFSET));
+    WOORT_TEST_CHECK(code_env->m_data_begin[1].m_integer == 42);
+
+    woort_Value native_11;
+    native_11.m_function.m_type = WOORT_FUNCTION_TYPE_NATIVE;
+    native_11.m_function.m_address = (int64_t)(intptr_t)&_woort_test_native_11;
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    const struct
+    {
+        const woort_Value* m_callee;
+        woort_Integer m_result;
+    } steps[] = {
+        { &code_env->m_data_begin[0], 42 },
+        { &native_11, 11 },
+    };
+
+    woort_Value* const sp = vm.m_sp;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i)
+    {
+        code_env->m_data_begin[WOORT_TEST_CALLEE_INDEX] = *steps[i].m_callee;
+
+        WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL
+            == woort_VMRuntime_invoke(&vm, code_env->m_code_begin));
+        WOORT_TEST_CHECK(vm.m_sp == sp);
+        WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == steps[i].m_result);
+
+        // Mapped codes are read only, CALLC is not quickened.
+        if (code_env->m_code_mapping != NULL)
+            WOORT_TEST_CHECK(code_env->m_code_begin[WOORT_TEST_CALL_OFFSET]
+                == bytecodes[WOORT_TEST_CALL_OFFSET]);
+    }
+
+    woort_VMRuntime_deinit(&vm);
+    woort_vector_deinit(&loaded_entries);
+    woort_CodeEnv_unshare(code_env);
+
+    // Image of other version is refused.
+    FILE* file = fopen(WOORT_TEST_IMAGE_PATH, "r+b");
+    WOORT_TEST_CHECK(file != NULL);
+
+    woort_CodeEnvImage_Header header;
+    WOORT_TEST_CHECK(fread(&header, sizeof(header), 1, file) == 1);
+    header.m_version = WOORT_CODEENV_IMAGE_VERSION + 1;
+    WOORT_TEST_CHECK(fseek(file, 0, SEEK_SET) == 0);
+    WOORT_TEST_CHECK(fwrite(&header, sizeof(header), 1, file) == 1);
+    WOORT_TEST_CHECK(fclose(file) == 0);
+
+    WOORT_TEST_CHECK(!woort_CodeEnv_load_image(WOORT_TEST_IMAGE_PATH, NULL, &code_env));
+
+    WOORT_TEST_CHECK(remove(WOORT_TEST_IMAGE_PATH) == 0);
+}
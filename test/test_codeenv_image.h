@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_codeenv_image.h
+*/
+
+/*
+Save CodeEnv as image and load it back, check codes, relocated constants and entries
+are restored, loaded functions can be invoked without mapped codes rewritten by
+quickening, and images of other version are refused.
+*/
+void woort_test_codeenv_image(void);
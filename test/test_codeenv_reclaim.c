@@ -0,0 +1,146 @@
+#include "test_codeenv_reclaim.h"
+#include "test_util.h"
+
+#include "woort_codeenv.h"
+#include "woort_threads.h"
+#include "woort_atomic.h"
+
+#define WOORT_TEST_CODEENV_COUNT 4
+#define WOORT_TEST_THREAD_COUNT 6
+#define WOORT_TEST_ROUND_COUNT 2000
+// Grace period ends after all online threads have passed safepoint twice.
+#define WOORT_TEST_SAFEPOINT_COUNT 3
+
+static woort_CodeEnv* _woort_test_create_codeenv(void)
+{
+    woort_Vector codes, constants, relocations;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+    woort_vector_init(&constants, sizeof(woort_Value));
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+
+    const woort_Bytecode nop = 0;
+    WOORT_TEST_CHECK(woort_vector_push_back(&codes, 1, &nop));
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(woort_CodeEnv_create(&codes, &constants, 1, &relocations, &code_env));
+    return code_env;
+}
+
+static void _woort_test_safepoints(void)
+{
+    for (size_t i = 0; i < WOORT_TEST_SAFEPOINT_COUNT; ++i)
+        woort_CodeEnv_safepoint();
+}
+
+static bool _woort_test_is_alive(const woort_Bytecode* code)
+{
+    woort_CodeEnv* found_env;
+    return woort_CodeEnv_find(code, &found_env);
+}
+
+static void _woort_test_share_unshare_job(void* user_data)
+{
+    woort_CodeEnv** const code_envs = user_data;
+
+    for (size_t round = 0; round < WOORT_TEST_ROUND_COUNT; ++round)
+    {
+        for (size_t i = 0; i < WOORT_TEST_CODEENV_COUNT; ++i)
+        {
+            woort_CodeEnv_share(code_envs[i]);
+            woort_CodeEnv_share(code_envs[i]);
+        }
+        for (size_t i = 0; i < WOORT_TEST_CODEENV_COUNT; ++i)
+            woort_CodeEnv_unshare(code_envs[i]);
+
+        if (round % 7 == 0)
+            woort_CodeEnv_safepoint();
+
+        for (size_t i = 0; i < WOORT_TEST_CODEENV_COUNT; ++i)
+            woort_CodeEnv_unshare(code_envs[i]);
+
+        if (round % 13 == 0)
+            woort_CodeEnv_safepoint();
+    }
+    woort_CodeEnv_thread_detach();
+}
+
+typedef struct _woort_TestOnlineContext
+{
+    woort_CodeEnv*      m_code_env;
+    woort_AtomicUInt64  m_online;
+    woort_AtomicUInt64  m_leaving;
+
+} _woort_TestOnlineContext;
+
+/*
+Go online by sharing, and do not pass safepoint until asked to leave.
+*/
+static void _woort_test_online_job(void* user_data)
+{
+    _woort_TestOnlineContext* const context = user_data;
+
+    woort_CodeEnv_share(context->m_code_env);
+    woort_CodeEnv_unshare(context->m_code_env);
+    woort_atomic_store(&context->m_online, 1);
+
+    while (woort_atomic_load(&context->m_leaving) == 0)
+        woort_thread_yield();
+
+    woort_CodeEnv_safepoint();
+    woort_CodeEnv_thread_detach();
+}
+
+void woort_test_codeenv_reclaim(void)
+{
+    woort_CodeEnv* code_envs[WOORT_TEST_CODEENV_COUNT];
+    for (size_t i = 0; i < WOORT_TEST_CODEENV_COUNT; ++i)
+        code_envs[i] = _woort_test_create_codeenv();
+
+    // Deltas of all threads are applied at last.
+    woort_Thread* threads[WOORT_TEST_THREAD_COUNT];
+    for (size_t i = 0; i < WOORT_TEST_THREAD_COUNT; ++i)
+        WOORT_TEST_CHECK(woort_thread_start(
+            _woort_test_share_unshare_job, code_envs, &threads[i]));
+    for (size_t i = 0; i < WOORT_TEST_THREAD_COUNT; ++i)
+        woort_thread_join(threads[i]);
+
+    for (size_t i = 0; i < WOORT_TEST_CODEENV_COUNT; ++i)
+        WOORT_TEST_CHECK(woort_atomic_load(&code_envs[i]->m_refcount) == 1);
+
+    // Released by current thread, but another thread is online without safepoint.
+    _woort_TestOnlineContext context;
+    context.m_code_env = code_envs[1];
+    woort_atomic_init(&context.m_online, 0);
+    woort_atomic_init(&context.m_leaving, 0);
+
+    woort_Thread* online_thread;
+    WOORT_TEST_CHECK(woort_thread_start(_woort_test_online_job, &context, &online_thread));
+    while (woort_atomic_load(&context.m_online) == 0)
+        woort_thread_yield();
+
+    const woort_Bytecode* const released_code = code_envs[0]->m_code_begin;
+    woort_CodeEnv_unshare(code_envs[0]);
+    _woort_test_safepoints();
+    WOORT_TEST_CHECK(_woort_test_is_alive(released_code));
+
+    woort_atomic_store(&context.m_leaving, 1);
+    woort_thread_join(online_thread);
+
+    _woort_test_safepoints();
+    WOORT_TEST_CHECK(!_woort_test_is_alive(released_code));
+
+    // Shared again before grace period ends, kept.
+    const woort_Bytecode* const reshared_code = code_envs[1]->m_code_begin;
+    woort_CodeEnv_unshare(code_envs[1]);
+    woort_CodeEnv_safepoint();
+    woort_CodeEnv_share(code_envs[1]);
+    _woort_test_safepoints();
+    WOORT_TEST_CHECK(_woort_test_is_alive(reshared_code));
+    WOORT_TEST_CHECK(woort_atomic_load(&code_envs[1]->m_refcount) == 1);
+
+    for (size_t i = 1; i < WOORT_TEST_CODEENV_COUNT; ++i)
+        woort_CodeEnv_unshare(code_envs[i]);
+    _woort_test_safepoints();
+
+    WOORT_TEST_CHECK(!_woort_test_is_alive(reshared_code));
+}
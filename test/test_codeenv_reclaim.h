@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_codeenv_reclaim.h
+*/
+
+/*
+Share and unshare CodeEnvs concurrently and check refcounts are balanced after
+threads detached, then check CodeEnv released is not destroyed until all online
+threads have passed safepoint, and is kept if shared again before that.
+*/
+void woort_test_codeenv_reclaim(void);
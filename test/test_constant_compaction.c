@@ -0,0 +1,227 @@
+#include "test_constant_compaction.h"
+#include "test_util.h"
+
+#include "woort_linklist.h"
+#include "woort_lir.h"
+#include "woort_lir_compiler.h"
+#include "woort_lir_inline.h"
+#include "woort_vm.h"
+
+static void _woort_test_constant_interning(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    woort_Value value;
+    woort_LIR_ConstantStorage c1, c1_again, c2, positive_zero, negative_zero;
+
+    value.m_integer = 1;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c1));
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c1_again));
+    value.m_integer = 2;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c2));
+
+    WOORT_TEST_CHECK(c1 == c1_again);
+    WOORT_TEST_CHECK(c1 != c2);
+
+    // Equal values with different bits are different constants.
+    value.m_real = 0.0;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &positive_zero));
+    value.m_real = -0.0;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &negative_zero));
+    WOORT_TEST_CHECK(positive_zero != negative_zero);
+
+    WOORT_TEST_CHECK(lir_compiler.m_constant_storage_holder.m_size == 4);
+
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
+
+static void _woort_test_constant_operand_remap(void)
+{
+    // PUSHCS cannot be emitted yet, check the remapping of CS operand directly.
+    const woort_LIR_ConstantStorage constant_remap[] = { 0, 1, 1 };
+
+    woort_LIR lir;
+    lir.m_opcode = WOORT_LIR_OPCODE_PUSHCS;
+    lir.m_opnum_formal = WOORT_LIR_OPNUMFORMAL_CS;
+    lir.m_opnums.m_cs.m_cs.m_is_constant = true;
+    lir.m_opnums.m_cs.m_cs.m_constant = 2;
+
+    woort_LIR_update_constant_storage(&lir, constant_remap);
+    WOORT_TEST_CHECK(lir.m_opnums.m_cs.m_cs.m_constant == 1);
+
+    // Static storages are not touched.
+    lir.m_opnums.m_cs.m_cs.m_is_constant = false;
+    lir.m_opnums.m_cs.m_cs.m_static = 2;
+
+    woort_LIR_update_constant_storage(&lir, constant_remap);
+    WOORT_TEST_CHECK(lir.m_opnums.m_cs.m_cs.m_static == 2);
+}
+
+/*
+Return the constant of `value`, by a non-interned constant.
+*/
+static void _woort_test_emit_return_constant(
+    woort_LIRFunction* function,
+    woort_LIR_ConstantStorage value_c,
+    woort_LIR_StaticStorage padding_s)
+{
+    woort_LIRRegister* result;
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(function, &result));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(function, result, value_c));
+    woort_test_emit_padding(function, padding_s, result, WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT);
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(function, result));
+}
+
+static woort_LIR_ConstantStorage _woort_test_allocate_integer_constant(
+    woort_LIRCompiler* lir_compiler, woort_Integer value)
+{
+    woort_LIR_ConstantStorage constant;
+    woort_Value* storage;
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_constant(lir_compiler, &constant));
+    WOORT_TEST_CHECK(woort_LIRCompiler_get_constant(lir_compiler, constant, &storage));
+    storage->m_integer = value;
+    return constant;
+}
+
+static void _woort_test_constant_compaction_commit(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    woort_LIRFunction* left;
+    woort_LIRFunction* right;
+    woort_LIRFunction* main_function;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &left));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &right));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &main_function));
+
+    /*
+    0: 1;  1: 7;  2: 7 (merged to 1);  3: 1 (merged to 0);
+    4: left & 5: right (holding 7, never merged);  6: 10;  7: 3;  8: 4
+    */
+    woort_Value value;
+    woort_LIR_ConstantStorage c1, c7, c7_dup, c1_dup, left_c, right_c, c10, c3, c4;
+    value.m_integer = 1;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c1));
+    c7 = _woort_test_allocate_integer_constant(&lir_compiler, 7);
+    c7_dup = _woort_test_allocate_integer_constant(&lir_compiler, 7);
+    c1_dup = _woort_test_allocate_integer_constant(&lir_compiler, 1);
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, left, &left_c));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, right, &right_c));
+    value.m_integer = 10;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c10));
+    value.m_integer = 3;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c3));
+    value.m_integer = 4;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c4));
+
+    // Placeholders of function constants have the same bits as other constants.
+    woort_Value* storage;
+    WOORT_TEST_CHECK(woort_LIRCompiler_get_constant(&lir_compiler, left_c, &storage));
+    storage->m_integer = 7;
+    WOORT_TEST_CHECK(woort_LIRCompiler_get_constant(&lir_compiler, right_c, &storage));
+    storage->m_integer = 7;
+
+    const woort_LIR_StaticStorage result_s =
+        woort_LIRCompiler_allocate_static_storage(&lir_compiler);
+    const woort_LIR_StaticStorage padding_s =
+        woort_LIRCompiler_allocate_static_storage(&lir_compiler);
+
+    // left(): return 3; right(): return 4
+    _woort_test_emit_return_constant(left, c3, padding_s);
+    _woort_test_emit_return_constant(right, c4, padding_s);
+
+    // main(): s = 7; return ((s * 10 + 1) * 10 + left()) * 10 + right()
+    {
+        woort_LIRRegister* seven;
+        woort_LIRRegister* one;
+        woort_LIRRegister* ten;
+        woort_LIRRegister* left_result;
+        woort_LIRRegister* right_result;
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &seven));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &one));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &left_result));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &right_result));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &result));
+
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, seven, c7_dup));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, one, c1_dup));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, ten, c10));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_store(main_function, result_s, seven));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(main_function, left_result, left_c, 0));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(main_function, right_result, right_c, 0));
+
+        // Static is read after calls, not forwarded from the store.
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadglobal(main_function, result, result_s));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            main_function, WOORT_LIR_OPCODE_MULI, result, result, ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            main_function, WOORT_LIR_OPCODE_ADDI, result, result, one));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            main_function, WOORT_LIR_OPCODE_MULI, result, result, ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            main_function, WOORT_LIR_OPCODE_ADDI, result, result, left_result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            main_function, WOORT_LIR_OPCODE_MULI, result, result, ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            main_function, WOORT_LIR_OPCODE_ADDI, result, result, right_result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(main_function, result));
+    }
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&lir_compiler, &code_env));
+
+    // Two duplicated constants are merged, function constants are kept.
+    WOORT_TEST_CHECK(code_env->m_constant_count == 7);
+
+    // Calls are remapped to the function constants right after the merged ones.
+    woort_LIR_ConstantStorage called_constants[2];
+    size_t call_count = 0;
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&main_function->m_lir_list);
+        current_lir != NULL;
+        current_lir = woort_linklist_next(current_lir))
+    {
+        if (current_lir->m_opcode != WOORT_LIR_OPCODE_CALLNWO)
+            continue;
+
+        WOORT_TEST_CHECK(call_count < 2);
+        called_constants[call_count++] = current_lir->m_opnums.m_CALLNWO.m_c;
+    }
+    WOORT_TEST_CHECK(call_count == 2);
+    WOORT_TEST_CHECK(called_constants[0] == 2 && called_constants[1] == 3);
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    // Run twice, constants must not be overwritten by static storages.
+    for (size_t i = 0; i < 2; ++i)
+    {
+        WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+            &vm, code_env->m_code_begin + main_function->m_entry_bytecode_offset));
+        WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 7134);
+    }
+
+    // Static storages are placed right after the shrunk constants.
+    WOORT_TEST_CHECK(code_env->m_static_count == 2);
+    WOORT_TEST_CHECK(code_env->m_data_begin[code_env->m_constant_count + result_s].m_integer == 7);
+    WOORT_TEST_CHECK(code_env->m_data_begin[c1].m_integer == 1);
+    WOORT_TEST_CHECK(code_env->m_data_begin[c7].m_integer == 7);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
+
+void woort_test_constant_compaction(void)
+{
+    _woort_test_constant_interning();
+    _woort_test_constant_operand_remap();
+    _woort_test_constant_compaction_commit();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_constant_compaction.h
+*/
+
+/*
+Check that interned constants with the same bits share one slot, and that committing
+merges duplicated constants, remaps constant operands, never merges function constants
+and places static storages after the shrunk constants.
+*/
+void woort_test_constant_compaction(void);
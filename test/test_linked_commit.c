@@ -0,0 +1,130 @@
+#include "test_linked_commit.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+
+void woort_test_linked_commit(void)
+{
+    woort_LIRCompiler first_compiler, second_compiler;
+    woort_LIRCompiler_init(&first_compiler);
+    woort_LIRCompiler_init(&second_compiler);
+
+    // first: main() -> second: forward() -> first: target(7, 9)
+    woort_LIRFunction* target;
+    woort_LIRFunction* main_function;
+    woort_LIRFunction* forward;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&first_compiler, &target));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&first_compiler, &main_function));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&second_compiler, &forward));
+
+    woort_Value value;
+    woort_LIR_ConstantStorage c7, c9, target_c, forward_c;
+    value.m_integer = 7;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&second_compiler, &value, &c7));
+    value.m_integer = 9;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&second_compiler, &value, &c9));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_external_function_constant(
+        &second_compiler, target, &target_c));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_external_function_constant(
+        &first_compiler, forward, &forward_c));
+
+    const woort_LIR_StaticStorage first_s =
+        woort_LIRCompiler_allocate_static_storage(&first_compiler);
+    const woort_LIR_StaticStorage second_s =
+        woort_LIRCompiler_allocate_static_storage(&second_compiler);
+
+    // target(a0, a1): first_s = a1; return a0
+    {
+        woort_LIRRegister* a0;
+        woort_LIRRegister* a1;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(target, 0, &a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(target, 1, &a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_store(target, first_s, a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(target, a0));
+    }
+    // forward(): second_s = target(7, 9); return second_s
+    {
+        woort_LIRRegister* r7;
+        woort_LIRRegister* r9;
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(forward, &r7));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(forward, &r9));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(forward, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(forward, r7, c7));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(forward, r9, c9));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(forward, r9));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(forward, r7));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(forward, result, target_c, 2));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_store(forward, second_s, result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(forward, result));
+    }
+    // main(): return forward(), a tail call.
+    {
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(main_function, result, forward_c, 0));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(main_function, result));
+    }
+
+    // External functions cannot be resolved by a single compiler.
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_FAILED_UNRESOLVED_FUNCTION
+        == woort_LIRCompiler_commit(&second_compiler, &code_env));
+
+    woort_LIRCompiler* lir_compilers[] = { &first_compiler, &second_compiler };
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit_linked(lir_compilers, 2, &code_env));
+
+    // Codes are concatenated in order of compilers, calls between them are NEAR, calls
+    // with external function constants are never inlined.
+    const size_t code_end = (size_t)(code_env->m_code_end - code_env->m_code_begin);
+    WOORT_TEST_CHECK(target->m_entry_bytecode_offset < main_function->m_entry_bytecode_offset);
+    WOORT_TEST_CHECK(main_function->m_entry_bytecode_offset < forward->m_entry_bytecode_offset);
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env,
+        main_function->m_entry_bytecode_offset,
+        forward->m_entry_bytecode_offset,
+        WOORT_OPCODE_CALL, 2));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, forward->m_entry_bytecode_offset, code_end, WOORT_OPCODE_CALLNWO, 0));
+
+    // Function constants are resolved to entries in the whole CodeEnv.
+    const int64_t target_address =
+        (int64_t)(intptr_t)(code_env->m_code_begin + target->m_entry_bytecode_offset);
+    const int64_t forward_address =
+        (int64_t)(intptr_t)(code_env->m_code_begin + forward->m_entry_bytecode_offset);
+
+    bool target_resolved = false;
+    bool forward_resolved = false;
+    for (size_t i = 0; i < code_env->m_constant_count; ++i)
+    {
+        const woort_Value* const constant = &code_env->m_data_begin[i];
+        if (constant->m_function.m_type != WOORT_FUNCTION_TYPE_SCRIPT)
+            continue;
+
+        target_resolved = target_resolved || constant->m_function.m_address == target_address;
+        forward_resolved = forward_resolved || constant->m_function.m_address == forward_address;
+    }
+    WOORT_TEST_CHECK(target_resolved && forward_resolved);
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    woort_Value* const sp = vm.m_sp;
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + main_function->m_entry_bytecode_offset));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 7);
+
+    // Static storages of compilers follow all constants, in order of compilers.
+    const woort_Value* const statics = code_env->m_data_begin + code_env->m_constant_count;
+    WOORT_TEST_CHECK(statics[0].m_integer == 9);
+    WOORT_TEST_CHECK(statics[1].m_integer == 7);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&first_compiler);
+    woort_LIRCompiler_deinit(&second_compiler);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_linked_commit.h
+*/
+
+/*
+Commit functions of two compilers calling each other into one CodeEnv, check the
+external functions are resolved to NEAR calls, static storages of both compilers are
+placed after all constants, and committing alone refuses unresolved functions.
+*/
+void woort_test_linked_commit(void);
@@ -0,0 +1,145 @@
+#include "test_linklist.h"
+#include "test_util.h"
+
+#include "woort_linklist.h"
+
+// Grows through slabs of 8, 16, 32, 64 & 128 nodes.
+#define WOORT_TEST_LINKLIST_NODE_COUNT 200
+
+static size_t _woort_test_slab_count(const woort_LinkList* list)
+{
+    size_t count = 0;
+    for (const woort_LinkList_Slab* slab = list->m_slabs; slab != NULL; slab = slab->m_next)
+        ++count;
+    return count;
+}
+
+/*
+Walk the list forward and backward, both must match `expected` and link each other.
+*/
+static void _woort_test_check_links(
+    woort_LinkList* list, const size_t* expected, size_t expected_count)
+{
+    size_t index = 0;
+    void* prev = NULL;
+    for (void* current = woort_linklist_iter(list);
+        current != NULL;
+        current = woort_linklist_next(current), ++index)
+    {
+        WOORT_TEST_CHECK(index < expected_count);
+        WOORT_TEST_CHECK(*(size_t*)current == expected[index]);
+        WOORT_TEST_CHECK(woort_linklist_prev(current) == prev);
+        prev = current;
+    }
+    WOORT_TEST_CHECK(index == expected_count);
+
+    void* back;
+    if (expected_count == 0)
+    {
+        WOORT_TEST_CHECK(!woort_linklist_back(list, &back));
+        return;
+    }
+
+    WOORT_TEST_CHECK(woort_linklist_back(list, &back) && back == prev);
+    for (void* current = back; current != NULL; current = woort_linklist_prev(current))
+    {
+        WOORT_TEST_CHECK(index > 0);
+        WOORT_TEST_CHECK(*(size_t*)current == expected[--index]);
+    }
+    WOORT_TEST_CHECK(index == 0);
+}
+
+void woort_test_linklist(void)
+{
+    woort_LinkList list;
+    woort_linklist_init(&list, sizeof(size_t));
+
+    size_t expected[WOORT_TEST_LINKLIST_NODE_COUNT * 2];
+    size_t expected_count = 0;
+
+    _woort_test_check_links(&list, expected, 0);
+
+    for (size_t i = 0; i < WOORT_TEST_LINKLIST_NODE_COUNT; ++i)
+    {
+        WOORT_TEST_CHECK(woort_linklist_push_back(&list, &i));
+        expected[expected_count++] = i;
+    }
+    _woort_test_check_links(&list, expected, expected_count);
+    WOORT_TEST_CHECK(_woort_test_slab_count(&list) == 5);
+
+    // Erase odd ones (including the tail), and the head.
+    expected_count = 0;
+    for (void* current = woort_linklist_iter(&list); current != NULL;)
+    {
+        void* const next = woort_linklist_next(current);
+        const size_t value = *(size_t*)current;
+
+        if (value % 2 == 1 || value == 0)
+            woort_linklist_erase(&list, current);
+        else
+            expected[expected_count++] = value;
+
+        current = next;
+    }
+    _woort_test_check_links(&list, expected, expected_count);
+
+    // Emplace after each one, erased nodes are reused first, then a new slab is needed.
+    const size_t erased_count = WOORT_TEST_LINKLIST_NODE_COUNT - expected_count;
+    size_t emplaced_count = 0;
+    size_t rebuilt_count = 0;
+    size_t rebuilt[WOORT_TEST_LINKLIST_NODE_COUNT * 2];
+    for (void* current = woort_linklist_iter(&list); current != NULL;)
+    {
+        const size_t value = *(size_t*)current;
+
+        for (size_t k = 0; k < 2; ++k)
+        {
+            void* storage;
+            WOORT_TEST_CHECK(woort_linklist_emplace_after(&list, current, &storage));
+            *(size_t*)storage = value * 1000 + 2 - k;
+
+            if (++emplaced_count == erased_count)
+                // All erased nodes reused, no new slab yet.
+                WOORT_TEST_CHECK(_woort_test_slab_count(&list) == 5);
+        }
+        rebuilt[rebuilt_count++] = value;
+        rebuilt[rebuilt_count++] = value * 1000 + 1;
+        rebuilt[rebuilt_count++] = value * 1000 + 2;
+
+        current = woort_linklist_next(woort_linklist_next(woort_linklist_next(current)));
+    }
+    WOORT_TEST_CHECK(emplaced_count > erased_count);
+    WOORT_TEST_CHECK(_woort_test_slab_count(&list) == 6);
+    _woort_test_check_links(&list, rebuilt, rebuilt_count);
+
+    // Emplacing after the tail moves the tail.
+    void* tail;
+    void* storage;
+    WOORT_TEST_CHECK(woort_linklist_back(&list, &tail));
+    WOORT_TEST_CHECK(woort_linklist_emplace_after(&list, tail, &storage));
+    *(size_t*)storage = SIZE_MAX;
+    rebuilt[rebuilt_count++] = SIZE_MAX;
+    _woort_test_check_links(&list, rebuilt, rebuilt_count);
+
+    // Pop all from both ends.
+    size_t first = 0;
+    for (size_t step = 0; first < rebuilt_count; ++step)
+    {
+        if (step % 2 == 0)
+        {
+            WOORT_TEST_CHECK(woort_linklist_pop_front(&list));
+            ++first;
+        }
+        else
+        {
+            WOORT_TEST_CHECK(woort_linklist_pop_back(&list));
+            --rebuilt_count;
+        }
+
+        _woort_test_check_links(&list, rebuilt + first, rebuilt_count - first);
+    }
+    WOORT_TEST_CHECK(!woort_linklist_pop_front(&list));
+    WOORT_TEST_CHECK(!woort_linklist_pop_back(&list));
+
+    woort_linklist_deinit(&list);
+}
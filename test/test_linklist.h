@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_linklist.h
+*/
+
+/*
+Check that erasing and emplacing nodes across slab growth keeps both directions of
+links consistent, and that erased nodes are reused before allocating new slabs.
+*/
+void woort_test_linklist(void);
@@ -0,0 +1,170 @@
+#include "test_lir_cache.h"
+#include "test_util.h"
+
+#include "woort_lir_cache.h"
+#include "woort_lir_compiler.h"
+#include "woort_linklist.h"
+#include "woort_vm.h"
+
+#include <stdio.h>
+
+#define WOORT_TEST_CACHE_DIRECTORY "."
+
+/*
+main(): return `value` + 1, or `value` - 1 if `subtract`. With `extra_function`, an
+unused function is added before main.
+*/
+static woort_LIRFunction* _woort_test_build_cached(
+    woort_LIRCompiler* lir_compiler,
+    woort_Integer value,
+    bool subtract,
+    bool extra_function)
+{
+    woort_LIRCompiler_init(lir_compiler);
+
+    if (extra_function)
+    {
+        woort_LIRFunction* extra;
+        woort_LIRRegister* a0;
+        WOORT_TEST_CHECK(woort_LIRCompiler_add_function(lir_compiler, &extra));
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(extra, 0, &a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(extra, a0));
+    }
+
+    woort_LIRFunction* main_function;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(lir_compiler, &main_function));
+
+    woort_Value constant;
+    woort_LIR_ConstantStorage value_c, one_c;
+    constant.m_integer = value;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(lir_compiler, &constant, &value_c));
+    constant.m_integer = 1;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(lir_compiler, &constant, &one_c));
+
+    woort_LIRRegister* result;
+    woort_LIRRegister* one;
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &result));
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &one));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, result, value_c));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, one, one_c));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+        main_function,
+        subtract ? WOORT_LIR_OPCODE_SUBI : WOORT_LIR_OPCODE_ADDI,
+        result,
+        result,
+        one));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(main_function, result));
+
+    return main_function;
+}
+
+static uint64_t _woort_test_hash_of(woort_Integer value, bool subtract, bool extra_function)
+{
+    woort_LIRCompiler lir_compiler;
+    (void)_woort_test_build_cached(&lir_compiler, value, subtract, extra_function);
+
+    uint64_t hash;
+    WOORT_TEST_CHECK(woort_LIRCompiler_hash(&lir_compiler, &hash));
+
+    woort_LIRCompiler_deinit(&lir_compiler);
+    return hash;
+}
+
+static void _woort_test_image_path_of(char* path, size_t path_capacity, uint64_t hash)
+{
+    snprintf(path, path_capacity, "%s/%016llx.woortimg",
+        WOORT_TEST_CACHE_DIRECTORY, (unsigned long long)hash);
+}
+
+static bool _woort_test_file_exists(const char* path)
+{
+    FILE* const file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    fclose(file);
+    return true;
+}
+
+/*
+Commit main() with cache and run it, return if it's restored from cache (registers
+are not assigned).
+*/
+static bool _woort_test_commit_cached_and_run(
+    woort_Integer value,
+    bool extra_function,
+    size_t* out_entry)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRFunction* const main_function =
+        _woort_test_build_cached(&lir_compiler, value, false, extra_function);
+    woort_LIRRegister* const result = woort_linklist_iter(&main_function->m_register_list);
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK == woort_LIRCompiler_commit_cached(
+        &lir_compiler, WOORT_TEST_CACHE_DIRECTORY, &code_env));
+
+    const bool hit = result->m_assigned_bp_offset == INT16_MAX;
+    *out_entry = main_function->m_entry_bytecode_offset;
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + main_function->m_entry_bytecode_offset));
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == value + 1);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+
+    return hit;
+}
+
+void woort_test_lir_cache(void)
+{
+    // Hash is stable for the same LIRs, and changes with LIRs and constants.
+    const uint64_t hash = _woort_test_hash_of(41, false, true);
+    WOORT_TEST_CHECK(hash == _woort_test_hash_of(41, false, true));
+    WOORT_TEST_CHECK(hash != _woort_test_hash_of(42, false, true));
+    WOORT_TEST_CHECK(hash != _woort_test_hash_of(41, true, true));
+    WOORT_TEST_CHECK(hash != _woort_test_hash_of(41, false, false));
+
+    char image_path[64];
+    _woort_test_image_path_of(image_path, sizeof(image_path), hash);
+    (void)remove(image_path);
+
+    // Missed, committed and saved.
+    size_t committed_entry;
+    WOORT_TEST_CHECK(!_woort_test_commit_cached_and_run(41, true, &committed_entry));
+    WOORT_TEST_CHECK(_woort_test_file_exists(image_path));
+
+    // Hit, entry is restored from image.
+    size_t restored_entry;
+    WOORT_TEST_CHECK(_woort_test_commit_cached_and_run(41, true, &restored_entry));
+    WOORT_TEST_CHECK(restored_entry == committed_entry);
+
+    // Broken image, fall back to commit, then it's saved again.
+    FILE* const broken_image = fopen(image_path, "wb");
+    WOORT_TEST_CHECK(broken_image != NULL);
+    WOORT_TEST_CHECK(fputs("broken", broken_image) >= 0);
+    fclose(broken_image);
+
+    WOORT_TEST_CHECK(!_woort_test_commit_cached_and_run(41, true, &committed_entry));
+    WOORT_TEST_CHECK(_woort_test_commit_cached_and_run(41, true, &restored_entry));
+    WOORT_TEST_CHECK(restored_entry == committed_entry);
+
+    // Image of another compiler with different function count, fall back to commit.
+    const uint64_t other_hash = _woort_test_hash_of(41, false, false);
+    char other_image_path[64];
+    _woort_test_image_path_of(other_image_path, sizeof(other_image_path), other_hash);
+    (void)remove(other_image_path);
+
+    WOORT_TEST_CHECK(!_woort_test_commit_cached_and_run(41, false, &committed_entry));
+    WOORT_TEST_CHECK(remove(image_path) == 0);
+    WOORT_TEST_CHECK(rename(other_image_path, image_path) == 0);
+
+    WOORT_TEST_CHECK(!_woort_test_commit_cached_and_run(41, true, &committed_entry));
+
+    WOORT_TEST_CHECK(remove(image_path) == 0);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_lir_cache.h
+*/
+
+/*
+Check that hash of compiler is stable for the same LIRs and changes with LIRs or
+constants, that committing with cache saves the image when missed and restores the
+entries from it when hit, and that broken or mismatched images fall back to commit.
+*/
+void woort_test_lir_cache(void);
@@ -0,0 +1,248 @@
+#include "test_lir_inline.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_lir_inline.h"
+#include "woort_linklist.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+
+static size_t _woort_test_count_lir(woort_LIRFunction* function, woort_LIR_Opcode opcode)
+{
+    size_t count = 0;
+    for (
+        woort_LIR* current_lir = woort_linklist_iter(&function->m_lir_list);
+        current_lir != NULL;
+        current_lir = woort_linklist_next(current_lir))
+    {
+        if (current_lir->m_opcode == opcode)
+            ++count;
+    }
+    return count;
+}
+
+static bool _woort_test_contains_call(const woort_CodeEnv* code_env, size_t begin, size_t end)
+{
+    // Constant indexes are small, CALLNWO is always in mode 0.
+    return woort_test_contains_opcode(code_env, begin, end, WOORT_OPCODE_CALLNWO, 0)
+        || woort_test_contains_opcode(code_env, begin, end, WOORT_OPCODE_CALL, 2);
+}
+
+/*
+Push values of `value_cs` from the last one to the first one, then call `function_c`.
+*/
+static woort_LIRRegister* _woort_test_emit_call(
+    woort_LIRFunction* function,
+    woort_LIR_ConstantStorage function_c,
+    const woort_LIR_ConstantStorage* value_cs,
+    uint16_t argument_count,
+    bool bind_label_between_pushes)
+{
+    woort_LIRRegister* values[3];
+    woort_LIRRegister* result;
+    WOORT_TEST_CHECK(argument_count <= 3);
+
+    for (uint16_t i = 0; i < argument_count; ++i)
+    {
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(function, &values[i]));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(function, values[i], value_cs[i]));
+    }
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(function, &result));
+
+    for (uint16_t i = argument_count; i > 0; --i)
+    {
+        if (bind_label_between_pushes && i == 1)
+        {
+            woort_LIRLabel* label;
+            WOORT_TEST_CHECK(woort_LIRFunction_alloc_label(function, &label));
+            WOORT_TEST_CHECK(woort_LIRFunction_bind(function, label));
+        }
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(function, values[i - 1]));
+    }
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(
+        function, result, function_c, argument_count));
+
+    return result;
+}
+
+void woort_test_lir_inline(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    woort_LIRFunction* pick;
+    woort_LIRFunction* countdown;
+    woort_LIRFunction* big;
+    woort_LIRFunction* inlined;
+    woort_LIRFunction* not_inlined;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &pick));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &countdown));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &big));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &inlined));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &not_inlined));
+
+    woort_Value value;
+    woort_LIR_ConstantStorage c0, c1, c3, c4, c7, c9, c10, c100;
+    woort_LIR_ConstantStorage pick_c, countdown_c, big_c;
+    const struct
+    {
+        woort_Integer m_value;
+        woort_LIR_ConstantStorage* m_c;
+    } constants[] = {
+        { 0, &c0 }, { 1, &c1 }, { 3, &c3 }, { 4, &c4 },
+        { 7, &c7 }, { 9, &c9 }, { 10, &c10 }, { 100, &c100 },
+    };
+    for (size_t i = 0; i < sizeof(constants) / sizeof(constants[0]); ++i)
+    {
+        value.m_integer = constants[i].m_value;
+        WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(
+            &lir_compiler, &value, constants[i].m_c));
+    }
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, pick, &pick_c));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, countdown, &countdown_c));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, big, &big_c));
+
+    const woort_LIR_StaticStorage padding_s =
+        woort_LIRCompiler_allocate_static_storage(&lir_compiler);
+
+    // pick(a0, a1, a2): return a0 > a1 ? a0 - a1 : a1, a2 is not used.
+    {
+        woort_LIRRegister* a0;
+        woort_LIRRegister* a1;
+        woort_LIRRegister* cond;
+        woort_LIRRegister* result;
+        woort_LIRLabel* greater;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(pick, 0, &a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(pick, 1, &a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(pick, &cond));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(pick, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_label(pick, &greater));
+
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            pick, WOORT_LIR_OPCODE_GTI, cond, a0, a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_jnz(pick, cond, greater));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(pick, a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_bind(pick, greater));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            pick, WOORT_LIR_OPCODE_SUBI, result, a0, a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(pick, result));
+    }
+    // countdown(a0): return a0 > 0 ? countdown(a0 - 1) : a0
+    {
+        woort_LIRRegister* a0;
+        woort_LIRRegister* zero;
+        woort_LIRRegister* one;
+        woort_LIRRegister* cond;
+        woort_LIRRegister* result;
+        woort_LIRLabel* recurse;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(countdown, 0, &a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(countdown, &zero));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(countdown, &one));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(countdown, &cond));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(countdown, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_label(countdown, &recurse));
+
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(countdown, zero, c0));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(countdown, one, c1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            countdown, WOORT_LIR_OPCODE_GTI, cond, a0, zero));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_jnz(countdown, cond, recurse));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(countdown, a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_bind(countdown, recurse));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            countdown, WOORT_LIR_OPCODE_SUBI, result, a0, one));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(countdown, result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(countdown, result, countdown_c, 1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(countdown, result));
+    }
+    // big(a0): return a0, with more LIRs than an inlinable callee.
+    {
+        woort_LIRRegister* a0;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(big, 0, &a0));
+        woort_test_emit_padding(big, padding_s, a0, WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT);
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(big, a0));
+    }
+    // inlined(): return pick(9, 4, 100) * 10 + pick(4, 9, 100)
+    {
+        const woort_LIR_ConstantStorage greater_cs[] = { c9, c4, c100 };
+        const woort_LIR_ConstantStorage less_cs[] = { c4, c9, c100 };
+        woort_LIRRegister* ten;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(inlined, &ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(inlined, ten, c10));
+
+        woort_LIRRegister* const greater =
+            _woort_test_emit_call(inlined, pick_c, greater_cs, 3, false);
+        woort_LIRRegister* const less =
+            _woort_test_emit_call(inlined, pick_c, less_cs, 3, false);
+
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            inlined, WOORT_LIR_OPCODE_MULI, greater, greater, ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            inlined, WOORT_LIR_OPCODE_ADDI, greater, greater, less));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(inlined, greater));
+    }
+    // not_inlined(): return (countdown(3) + big(7)) * 10 + pick(9, 4, 100)
+    {
+        const woort_LIR_ConstantStorage countdown_cs[] = { c3 };
+        const woort_LIR_ConstantStorage big_cs[] = { c7 };
+        const woort_LIR_ConstantStorage pick_cs[] = { c9, c4, c100 };
+        woort_LIRRegister* ten;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(not_inlined, &ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(not_inlined, ten, c10));
+
+        woort_LIRRegister* const result =
+            _woort_test_emit_call(not_inlined, countdown_c, countdown_cs, 1, false);
+        woort_LIRRegister* const big_result =
+            _woort_test_emit_call(not_inlined, big_c, big_cs, 1, false);
+        woort_LIRRegister* const pick_result =
+            _woort_test_emit_call(not_inlined, pick_c, pick_cs, 3, true);
+
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            not_inlined, WOORT_LIR_OPCODE_ADDI, result, result, big_result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            not_inlined, WOORT_LIR_OPCODE_MULI, result, result, ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            not_inlined, WOORT_LIR_OPCODE_ADDI, result, result, pick_result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(not_inlined, result));
+    }
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&lir_compiler, &code_env));
+
+    const size_t inlined_begin = inlined->m_entry_bytecode_offset;
+    const size_t not_inlined_begin = not_inlined->m_entry_bytecode_offset;
+    const size_t code_end = (size_t)(code_env->m_code_end - code_env->m_code_begin);
+
+    // Both calls are inlined, all pushes are turned into MOVs or erased if not used.
+    WOORT_TEST_CHECK(_woort_test_count_lir(inlined, WOORT_LIR_OPCODE_CALLNWO) == 0);
+    WOORT_TEST_CHECK(_woort_test_count_lir(inlined, WOORT_LIR_OPCODE_PUSH) == 0);
+    WOORT_TEST_CHECK(!_woort_test_contains_call(code_env, inlined_begin, not_inlined_begin));
+
+    // All calls are kept.
+    WOORT_TEST_CHECK(_woort_test_count_lir(not_inlined, WOORT_LIR_OPCODE_CALLNWO) == 3);
+    WOORT_TEST_CHECK(_woort_test_count_lir(not_inlined, WOORT_LIR_OPCODE_PUSH) == 5);
+    WOORT_TEST_CHECK(_woort_test_contains_call(code_env, not_inlined_begin, code_end));
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    woort_Value* const sp = vm.m_sp;
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + inlined_begin));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 59);
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + not_inlined_begin));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 75);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
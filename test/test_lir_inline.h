@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_lir_inline.h
+*/
+
+/*
+Check that calls to a small callee with several RETs are inlined, pushes of unused
+arguments are erased and the result is still right, and that calls are kept if the
+callee calls itself, is too big, or a label is binded between the pushes.
+*/
+void woort_test_lir_inline(void);
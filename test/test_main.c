@@ -3,20 +3,85 @@
 #include "woort_lir_compiler.h"
 #include "woort_vm.h"
 
+#include "test_queue.h"
+#include "test_spin.h"
+#include "test_parallel_for.h"
+#include "test_register_allocation.h"
+#include "test_tail_call.h"
+#include "test_call_quickening.h"
+#include "test_mir_lower.h"
+#include "test_push_depth.h"
+#include "test_push_range.h"
+#include "test_codeenv_image.h"
+#include "test_codeenv_extend.h"
+#include "test_linked_commit.h"
+#include "test_codeenv_reclaim.h"
+#include "test_private_statics.h"
+#include "test_stack_trim.h"
+#include "test_peephole.h"
+#include "test_lir_inline.h"
+#include "test_lir_cache.h"
+#include "test_constant_compaction.h"
+#include "test_bitset.h"
+#include "test_linklist.h"
+#include "test_vector.h"
+#include "test_vm_pool.h"
+
+#include <string.h>
+
 int main(int argc, char** argv) {
     woort_init();
 
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+    {
+        woort_test_queue_benchmark();
+
+        woort_shutdown();
+        return 0;
+    }
+
+    woort_test_queue_stress();
+    woort_test_spin_stress();
+    woort_test_parallel_for();
+    woort_test_register_allocation();
+    woort_test_tail_call();
+    woort_test_call_quickening();
+    woort_test_mir_lower();
+    woort_test_push_depth();
+    woort_test_push_range();
+    woort_test_codeenv_image();
+    woort_test_codeenv_extend();
+    woort_test_linked_commit();
+    woort_test_codeenv_reclaim();
+    woort_test_private_statics();
+    woort_test_stack_trim();
+    woort_test_peephole();
+    woort_test_lir_inline();
+    woort_test_lir_cache();
+    woort_test_constant_compaction();
+    woort_test_bitset();
+    woort_test_linklist();
+    woort_test_vector();
+    woort_test_vm_pool();
+
     woort_LIRCompiler lir_compiler;
 
     woort_LIRCompiler_init(&lir_compiler);
     {
         woort_LIR_ConstantStorage c0;
         (void)woort_LIRCompiler_allocate_constant(&lir_compiler, &c0);
+        woort_LIR_ConstantStorage c1;
+        (void)woort_LIRCompiler_allocate_constant(&lir_compiler, &c1);
+        woort_LIR_ConstantStorage c2;
+        (void)woort_LIRCompiler_allocate_constant(&lir_compiler, &c2);
 
         woort_Value* cvp;
         (void)woort_LIRCompiler_get_constant(&lir_compiler, c0, &cvp);
-
         cvp->m_integer = 123321;
+        (void)woort_LIRCompiler_get_constant(&lir_compiler, c1, &cvp);
+        cvp->m_integer = 1;
+        (void)woort_LIRCompiler_get_constant(&lir_compiler, c2, &cvp);
+        cvp->m_integer = 3;
 
         woort_LIR_StaticStorage s0 =
             woort_LIRCompiler_allocate_static_storage(&lir_compiler);
@@ -26,8 +91,16 @@ int main(int argc, char** argv) {
 
         //woort_LIRRegister* arg0;
         woort_LIRRegister* val0;
+        woort_LIRRegister* counter;
+        woort_LIRRegister* step;
+        woort_LIRRegister* limit;
+        woort_LIRRegister* cond;
         //(void)woort_LIRFunction_get_argument_register(function, 0, &arg0);
         (void)woort_LIRFunction_alloc_register(function, &val0);
+        (void)woort_LIRFunction_alloc_register(function, &counter);
+        (void)woort_LIRFunction_alloc_register(function, &step);
+        (void)woort_LIRFunction_alloc_register(function, &limit);
+        (void)woort_LIRFunction_alloc_register(function, &cond);
 
         // Further testing can be done here.
         woort_LIRLabel* label;
@@ -35,9 +108,17 @@ int main(int argc, char** argv) {
 
         //(void)woort_LIRFunction_emit_push(function, arg0);
         (void)woort_LIRFunction_emit_loadconst(function, val0, c0);
+        (void)woort_LIRFunction_emit_loadconst(function, counter, c1);
+        (void)woort_LIRFunction_emit_loadconst(function, step, c1);
+        (void)woort_LIRFunction_emit_loadconst(function, limit, c2);
         (void)woort_LIRFunction_bind(function, label);
         (void)woort_LIRFunction_emit_store(function, s0, val0);
-        (void)woort_LIRFunction_emit_jmp(function, label);
+        (void)woort_LIRFunction_emit_binary(
+            function, WOORT_LIR_OPCODE_ADDI, counter, counter, step);
+        (void)woort_LIRFunction_emit_binary(
+            function, WOORT_LIR_OPCODE_LTI, cond, counter, limit);
+        (void)woort_LIRFunction_emit_jnz(function, cond, label);
+        (void)woort_LIRFunction_emit_ret(function, val0);
 
         woort_CodeEnv* code_env;
         (void)woort_LIRCompiler_commit(&lir_compiler, &code_env);
@@ -0,0 +1,220 @@
+#include "test_mir_lower.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_mir_lower.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+
+/*
+More values than the S8 window can hold are kept alive across the loop, so that
+some of them are placed in far slots and loaded through reserved-place.
+*/
+#define WOORT_TEST_LIVE_VALUE_COUNT 140
+
+static woort_LIR_ConstantStorage _woort_test_integer_constant(
+    woort_LIRCompiler* lir_compiler, woort_Integer integer)
+{
+    woort_Value value;
+    value.m_integer = integer;
+
+    woort_LIR_ConstantStorage constant;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(lir_compiler, &value, &constant));
+    return constant;
+}
+
+static woort_LIR_ConstantStorage _woort_test_real_constant(
+    woort_LIRCompiler* lir_compiler, woort_Real real)
+{
+    woort_Value value;
+    value.m_real = real;
+
+    woort_LIR_ConstantStorage constant;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(lir_compiler, &value, &constant));
+    return constant;
+}
+
+/*
+sum = 0
+for (i = 0; i < 10; i = i + 1)
+    sum = sum + i * i
+return sum + k[0] + k[1] + ... , k[n] = n, all k are alive across the loop.
+*/
+static void _woort_test_build_integer_loop(
+    woort_LIRCompiler* lir_compiler, woort_MIRFunction* function)
+{
+    woort_MIRBlock* entry;
+    woort_MIRBlock* header;
+    woort_MIRBlock* body;
+    woort_MIRBlock* exit_block;
+    WOORT_TEST_CHECK(woort_MIRFunction_add_block(function, &entry));
+    WOORT_TEST_CHECK(woort_MIRFunction_add_block(function, &header));
+    WOORT_TEST_CHECK(woort_MIRFunction_add_block(function, &body));
+    WOORT_TEST_CHECK(woort_MIRFunction_add_block(function, &exit_block));
+
+    woort_MIRInstruction* zero;
+    woort_MIRInstruction* one;
+    woort_MIRInstruction* ten;
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_const(
+        entry, WOORT_MIR_TYPE_INTEGER, _woort_test_integer_constant(lir_compiler, 0), &zero));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_const(
+        entry, WOORT_MIR_TYPE_INTEGER, _woort_test_integer_constant(lir_compiler, 1), &one));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_const(
+        entry, WOORT_MIR_TYPE_INTEGER, _woort_test_integer_constant(lir_compiler, 10), &ten));
+
+    woort_MIRInstruction* live_values[WOORT_TEST_LIVE_VALUE_COUNT];
+    for (size_t i = 0; i < WOORT_TEST_LIVE_VALUE_COUNT; ++i)
+        WOORT_TEST_CHECK(woort_MIRBlock_emit_const(
+            entry,
+            WOORT_MIR_TYPE_INTEGER,
+            _woort_test_integer_constant(lir_compiler, (woort_Integer)i),
+            &live_values[i]));
+
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_jmp(entry, header));
+
+    woort_MIRInstruction* i;
+    woort_MIRInstruction* sum;
+    woort_MIRInstruction* cond;
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_phi(header, &i));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_phi(header, &sum));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(header, WOORT_MIR_OPCODE_LT, i, ten, &cond));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_br(header, cond, body, exit_block));
+
+    woort_MIRInstruction* square;
+    woort_MIRInstruction* next_sum;
+    woort_MIRInstruction* next_i;
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(body, WOORT_MIR_OPCODE_MUL, i, i, &square));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(
+        body, WOORT_MIR_OPCODE_ADD, sum, square, &next_sum));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(body, WOORT_MIR_OPCODE_ADD, i, one, &next_i));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_jmp(body, header));
+
+    WOORT_TEST_CHECK(woort_MIRInstruction_add_phi_incoming(i, entry, zero));
+    WOORT_TEST_CHECK(woort_MIRInstruction_add_phi_incoming(i, body, next_i));
+    WOORT_TEST_CHECK(woort_MIRInstruction_add_phi_incoming(sum, entry, zero));
+    WOORT_TEST_CHECK(woort_MIRInstruction_add_phi_incoming(sum, body, next_sum));
+
+    woort_MIRInstruction* result = sum;
+    for (size_t k = 0; k < WOORT_TEST_LIVE_VALUE_COUNT; ++k)
+        WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(
+            exit_block, WOORT_MIR_OPCODE_ADD, result, live_values[k], &result));
+
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_ret(exit_block, result));
+}
+
+/*
+return -(7.5 % 2.0) / 2.0 if !(7.5 < 2.0), else 0.0
+*/
+static void _woort_test_build_real_operations(
+    woort_LIRCompiler* lir_compiler, woort_MIRFunction* function)
+{
+    woort_MIRBlock* entry;
+    woort_MIRBlock* then_block;
+    woort_MIRBlock* else_block;
+    WOORT_TEST_CHECK(woort_MIRFunction_add_block(function, &entry));
+    WOORT_TEST_CHECK(woort_MIRFunction_add_block(function, &then_block));
+    WOORT_TEST_CHECK(woort_MIRFunction_add_block(function, &else_block));
+
+    woort_MIRInstruction* a;
+    woort_MIRInstruction* b;
+    woort_MIRInstruction* zero;
+    woort_MIRInstruction* less;
+    woort_MIRInstruction* not_less;
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_const(
+        entry, WOORT_MIR_TYPE_REAL, _woort_test_real_constant(lir_compiler, 7.5), &a));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_const(
+        entry, WOORT_MIR_TYPE_REAL, _woort_test_real_constant(lir_compiler, 2.0), &b));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_const(
+        entry, WOORT_MIR_TYPE_REAL, _woort_test_real_constant(lir_compiler, 0.0), &zero));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(entry, WOORT_MIR_OPCODE_LT, a, b, &less));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_unary(entry, WOORT_MIR_OPCODE_LNOT, less, &not_less));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_br(entry, not_less, then_block, else_block));
+
+    woort_MIRInstruction* remainder;
+    woort_MIRInstruction* negative;
+    woort_MIRInstruction* quotient;
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(
+        then_block, WOORT_MIR_OPCODE_MOD, a, b, &remainder));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_unary(
+        then_block, WOORT_MIR_OPCODE_NEG, remainder, &negative));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_binary(
+        then_block, WOORT_MIR_OPCODE_DIV, negative, b, &quotient));
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_ret(then_block, quotient));
+
+    WOORT_TEST_CHECK(woort_MIRBlock_emit_ret(else_block, zero));
+}
+
+void woort_test_mir_lower(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    woort_LIRFunction* integer_loop;
+    woort_LIRFunction* real_operations;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &integer_loop));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &real_operations));
+
+    woort_MIRFunction mir_function;
+
+    woort_MIRFunction_init(&mir_function);
+    _woort_test_build_integer_loop(&lir_compiler, &mir_function);
+    WOORT_TEST_CHECK(woort_MIRFunction_lower(&mir_function, integer_loop));
+    woort_MIRFunction_deinit(&mir_function);
+
+    woort_MIRFunction_init(&mir_function);
+    _woort_test_build_real_operations(&lir_compiler, &mir_function);
+    WOORT_TEST_CHECK(woort_MIRFunction_lower(&mir_function, real_operations));
+    woort_MIRFunction_deinit(&mir_function);
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&lir_compiler, &code_env));
+
+    const size_t integer_loop_begin = integer_loop->m_entry_bytecode_offset;
+    const size_t real_operations_begin = real_operations->m_entry_bytecode_offset;
+    const size_t code_end = (size_t)(code_env->m_code_end - code_env->m_code_begin);
+    WOORT_TEST_CHECK(integer_loop_begin < real_operations_begin);
+
+    // ADDI, MULI, LTI, loop back by JMPGC, and far registers loaded by MOVLD.
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, integer_loop_begin, real_operations_begin, WOORT_OPCODE_OPIASMD, 0));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, integer_loop_begin, real_operations_begin, WOORT_OPCODE_OPIASMD, 2));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, integer_loop_begin, real_operations_begin, WOORT_OPCODE_OPIONLG, 2));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, integer_loop_begin, real_operations_begin, WOORT_OPCODE_MOV, 0));
+
+    // MODR, NEGR, DIVR, LTR, LNOTST.
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, real_operations_begin, code_end, WOORT_OPCODE_OPRONLG, 0));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, real_operations_begin, code_end, WOORT_OPCODE_OPRONLG, 1));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, real_operations_begin, code_end, WOORT_OPCODE_OPRASMD, 3));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, real_operations_begin, code_end, WOORT_OPCODE_OPRONLG, 2));
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env, real_operations_begin, code_end, WOORT_OPCODE_OPLAONI, 2));
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    // Stack might be extended and moved by the frame with far registers, keep offset.
+    const size_t sp_offset = (size_t)(vm.m_stack_end - vm.m_sp);
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + integer_loop_begin));
+    WOORT_TEST_CHECK((size_t)(vm.m_stack_end - vm.m_sp) == sp_offset);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer
+        == 285 + WOORT_TEST_LIVE_VALUE_COUNT * (WOORT_TEST_LIVE_VALUE_COUNT - 1) / 2);
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + real_operations_begin));
+    WOORT_TEST_CHECK((size_t)(vm.m_stack_end - vm.m_sp) == sp_offset);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_real == -0.75);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_mir_lower.h
+*/
+
+/*
+Lower MIR functions with loops, integer & real operations and far registers, commit
+and invoke them, check results and commands emitted.
+*/
+void woort_test_mir_lower(void);
@@ -0,0 +1,70 @@
+#include "test_parallel_for.h"
+#include "test_util.h"
+
+#include "woort_threads.h"
+#include "woort_atomic.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define WOORT_TEST_PARALLEL_FOR_JOB_COUNT 64
+#define WOORT_TEST_PARALLEL_FOR_ROUND_COUNT 1000
+
+typedef struct _woort_TestParallelForContext
+{
+    woort_AtomicUInt64  m_run_counts[WOORT_TEST_PARALLEL_FOR_JOB_COUNT];
+    // Run another parallel for in each job, it cannot use the busy pool.
+    bool                m_nested;
+
+} _woort_TestParallelForContext;
+
+static void _woort_test_parallel_for_job(size_t job_index, void* user_data)
+{
+    _woort_TestParallelForContext* const context = user_data;
+
+    WOORT_TEST_CHECK(job_index < WOORT_TEST_PARALLEL_FOR_JOB_COUNT);
+    woort_atomic_fetch_add_explicit(
+        &context->m_run_counts[job_index], 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+    if (context->m_nested)
+    {
+        _woort_TestParallelForContext nested_context;
+        for (size_t i = 0; i < WOORT_TEST_PARALLEL_FOR_JOB_COUNT; ++i)
+            woort_atomic_init(&nested_context.m_run_counts[i], 0);
+        nested_context.m_nested = false;
+
+        woort_thread_parallel_for(
+            WOORT_TEST_PARALLEL_FOR_JOB_COUNT,
+            woort_thread_hardware_concurrency(),
+            _woort_test_parallel_for_job,
+            &nested_context);
+
+        for (size_t i = 0; i < WOORT_TEST_PARALLEL_FOR_JOB_COUNT; ++i)
+            WOORT_TEST_CHECK(1 == woort_atomic_load_explicit(
+                &nested_context.m_run_counts[i], WOORT_ATOMIC_MEMORY_ORDER_RELAXED));
+    }
+}
+
+void woort_test_parallel_for(void)
+{
+    // At least 2 workers, so that the pool is used even on single core machines.
+    const size_t worker_count = woort_thread_hardware_concurrency() + 1;
+
+    for (size_t round = 0; round < WOORT_TEST_PARALLEL_FOR_ROUND_COUNT; ++round)
+    {
+        _woort_TestParallelForContext context;
+        for (size_t i = 0; i < WOORT_TEST_PARALLEL_FOR_JOB_COUNT; ++i)
+            woort_atomic_init(&context.m_run_counts[i], 0);
+        context.m_nested = round % 100 == 0;
+
+        woort_thread_parallel_for(
+            WOORT_TEST_PARALLEL_FOR_JOB_COUNT,
+            worker_count,
+            _woort_test_parallel_for_job,
+            &context);
+
+        for (size_t i = 0; i < WOORT_TEST_PARALLEL_FOR_JOB_COUNT; ++i)
+            WOORT_TEST_CHECK(1 == woort_atomic_load_explicit(
+                &context.m_run_counts[i], WOORT_ATOMIC_MEMORY_ORDER_RELAXED));
+    }
+}
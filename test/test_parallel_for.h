@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_parallel_for.h
+*/
+
+/*
+Run woort_thread_parallel_for many times on the worker pool, including nested ones,
+abort if any job is missed or run twice.
+*/
+void woort_test_parallel_for(void);
@@ -0,0 +1,184 @@
+#include "test_peephole.h"
+#include "test_util.h"
+
+#include "woort_arena.h"
+#include "woort_peephole.h"
+#include "woort_opcode.h"
+#include "woort_opcode_formal.h"
+
+#include <string.h>
+
+// Registers are negative offsets to bp, encoded in 8 or 16 bits.
+#define WOORT_TEST_R8(R) ((uint8_t)(int8_t)(R))
+#define WOORT_TEST_R16(R) ((uint16_t)(int16_t)(R))
+
+#define WOORT_TEST_FAR_JUMP_PADDING 300
+
+#define WOORT_TEST_COUNT_OF(ARRAY) (sizeof(ARRAY) / sizeof((ARRAY)[0]))
+
+static void _woort_test_peephole_expect(
+    const woort_Bytecode* bytecodes,
+    size_t bytecode_count,
+    const woort_Bytecode* expected,
+    size_t expected_count,
+    /* OPTIONAL */ woort_Arena* scratch_arena)
+{
+    woort_Vector codes;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+    WOORT_TEST_CHECK(woort_vector_push_back(&codes, bytecode_count, bytecodes));
+
+    WOORT_TEST_CHECK(woort_peephole_optimize(&codes, scratch_arena));
+
+    WOORT_TEST_CHECK(codes.m_size == expected_count);
+    WOORT_TEST_CHECK(0 == memcmp(
+        codes.m_data, expected, expected_count * sizeof(woort_Bytecode)));
+
+    woort_vector_deinit(&codes);
+}
+
+static void _woort_test_peephole_self_move(void)
+{
+    // MOVLD -1, -1; MOVLDEXT -300, -300; MOVLD -1, -2; RETVS -1
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_M2_A8_BC16, WOORT_OPCODE_MOV, 0,
+            WOORT_TEST_R8(-1), WOORT_TEST_R16(-1)),
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_MOV, 2, WOORT_TEST_R16(-300)),
+        (woort_Bytecode)(int32_t)-300,
+        woort_OpCodeFormal_cons(OP6_M2_A8_BC16, WOORT_OPCODE_MOV, 0,
+            WOORT_TEST_R8(-1), WOORT_TEST_R16(-2)),
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, WOORT_TEST_R16(-1)),
+    };
+    // MOVLD -1, -2; RETVS -1
+    const woort_Bytecode expected[] = {
+        bytecodes[3],
+        bytecodes[4],
+    };
+    _woort_test_peephole_expect(
+        bytecodes, WOORT_TEST_COUNT_OF(bytecodes),
+        expected, WOORT_TEST_COUNT_OF(expected),
+        NULL);
+}
+
+static void _woort_test_peephole_store_to_load(void)
+{
+    // STORE 5, -1; LOAD -1, 5; STORE 6, -1; LOAD -2, 6;
+    // STOREEX -1, 7; LOADEX -3, 7; RETVS -2
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_MAB18_C8, WOORT_OPCODE_STORE, 5, WOORT_TEST_R8(-1)),
+        woort_OpCodeFormal_cons(OP6_MAB18_C8, WOORT_OPCODE_LOAD, 5, WOORT_TEST_R8(-1)),
+        woort_OpCodeFormal_cons(OP6_MAB18_C8, WOORT_OPCODE_STORE, 6, WOORT_TEST_R8(-1)),
+        woort_OpCodeFormal_cons(OP6_MAB18_C8, WOORT_OPCODE_LOAD, 6, WOORT_TEST_R8(-2)),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_STOREEX, 0, WOORT_TEST_R16(-1)),
+        7,
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_LOADEX, 0, WOORT_TEST_R16(-3)),
+        7,
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, WOORT_TEST_R16(-2)),
+    };
+    // STORE 5, -1; STORE 6, -1; MOVLD -2, -1; STOREEX -1, 7; MOVLDEXT -3, -1; RETVS -2
+    const woort_Bytecode expected[] = {
+        bytecodes[0],
+        bytecodes[2],
+        woort_OpCodeFormal_cons(OP6_M2_A8_BC16, WOORT_OPCODE_MOV, 0,
+            WOORT_TEST_R8(-2), WOORT_TEST_R16(-1)),
+        bytecodes[4],
+        bytecodes[5],
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_MOV, 2, WOORT_TEST_R16(-3)),
+        (woort_Bytecode)(int32_t)-1,
+        bytecodes[8],
+    };
+    _woort_test_peephole_expect(
+        bytecodes, WOORT_TEST_COUNT_OF(bytecodes),
+        expected, WOORT_TEST_COUNT_OF(expected),
+        NULL);
+}
+
+static void _woort_test_peephole_store_to_load_with_label(void)
+{
+    // JFCONDNZ -2, +2; STORE 5, -1; (label) LOAD -1, 5; RETVS -1
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_M2_A8_BC16, WOORT_OPCODE_JCOND, 0, WOORT_TEST_R8(-2), 2),
+        woort_OpCodeFormal_cons(OP6_MAB18_C8, WOORT_OPCODE_STORE, 5, WOORT_TEST_R8(-1)),
+        woort_OpCodeFormal_cons(OP6_MAB18_C8, WOORT_OPCODE_LOAD, 5, WOORT_TEST_R8(-1)),
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, WOORT_TEST_R16(-1)),
+    };
+    // LOAD is jumped to, static may be stored by others, nothing changed.
+    _woort_test_peephole_expect(
+        bytecodes, WOORT_TEST_COUNT_OF(bytecodes),
+        bytecodes, WOORT_TEST_COUNT_OF(bytecodes),
+        NULL);
+}
+
+static void _woort_test_peephole_jump_threading(void)
+{
+    // JMP +2; NOP; JMP +3; NOP; NOP; RET
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_MABC26, WOORT_OPCODE_JMP, 2),
+        woort_OpCodeFormal_cons(OP6, WOORT_OPCODE_NOP),
+        woort_OpCodeFormal_cons(OP6_MABC26, WOORT_OPCODE_JMP, 3),
+        woort_OpCodeFormal_cons(OP6, WOORT_OPCODE_NOP),
+        woort_OpCodeFormal_cons(OP6, WOORT_OPCODE_NOP),
+        woort_OpCodeFormal_cons(OP6_M2, WOORT_OPCODE_RET, 0),
+    };
+    // JMP +5; NOP; JMP +3; NOP; NOP; RET
+    const woort_Bytecode expected[] = {
+        woort_OpCodeFormal_cons(OP6_MABC26, WOORT_OPCODE_JMP, 5),
+        bytecodes[1],
+        bytecodes[2],
+        bytecodes[3],
+        bytecodes[4],
+        bytecodes[5],
+    };
+    _woort_test_peephole_expect(
+        bytecodes, WOORT_TEST_COUNT_OF(bytecodes),
+        expected, WOORT_TEST_COUNT_OF(expected),
+        NULL);
+}
+
+static void _woort_test_peephole_far_jump(void)
+{
+    woort_Arena arena;
+    woort_arena_init(&arena, 256);
+
+    woort_Vector codes;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+
+    // NOP; JFCONDNZ -1, +(N + 2); (MOVLD -1, -1) * N; JMPGC -(N + 2); RETVS -1
+    woort_Bytecode bc = woort_OpCodeFormal_cons(OP6, WOORT_OPCODE_NOP);
+    WOORT_TEST_CHECK(woort_vector_push_back(&codes, 1, &bc));
+    bc = woort_OpCodeFormal_cons(OP6_M2_A8_BC16, WOORT_OPCODE_JCOND, 0,
+        WOORT_TEST_R8(-1), WOORT_TEST_FAR_JUMP_PADDING + 2);
+    WOORT_TEST_CHECK(woort_vector_push_back(&codes, 1, &bc));
+    bc = woort_OpCodeFormal_cons(OP6_M2_A8_BC16, WOORT_OPCODE_MOV, 0,
+        WOORT_TEST_R8(-1), WOORT_TEST_R16(-1));
+    for (size_t i = 0; i < WOORT_TEST_FAR_JUMP_PADDING; ++i)
+        WOORT_TEST_CHECK(woort_vector_push_back(&codes, 1, &bc));
+    bc = woort_OpCodeFormal_cons(OP6_MABC26, WOORT_OPCODE_JMPGC,
+        WOORT_TEST_FAR_JUMP_PADDING + 2);
+    WOORT_TEST_CHECK(woort_vector_push_back(&codes, 1, &bc));
+    bc = woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, WOORT_TEST_R16(-1));
+    WOORT_TEST_CHECK(woort_vector_push_back(&codes, 1, &bc));
+
+    WOORT_TEST_CHECK(woort_peephole_optimize(&codes, &arena));
+
+    // NOP; JFCONDNZ -1, +2; JMPGC -2; RETVS -1
+    const woort_Bytecode* const optimized = (const woort_Bytecode*)codes.m_data;
+    WOORT_TEST_CHECK(codes.m_size == 4);
+    WOORT_TEST_CHECK(optimized[0] == woort_OpCodeFormal_cons(OP6, WOORT_OPCODE_NOP));
+    WOORT_TEST_CHECK(optimized[1] == woort_OpCodeFormal_cons(
+        OP6_M2_A8_BC16, WOORT_OPCODE_JCOND, 0, WOORT_TEST_R8(-1), 2));
+    WOORT_TEST_CHECK(optimized[2]
+        == woort_OpCodeFormal_cons(OP6_MABC26, WOORT_OPCODE_JMPGC, 2));
+    WOORT_TEST_CHECK(optimized[3] == bc);
+
+    woort_vector_deinit(&codes);
+    woort_arena_deinit(&arena);
+}
+
+void woort_test_peephole(void)
+{
+    _woort_test_peephole_self_move();
+    _woort_test_peephole_store_to_load();
+    _woort_test_peephole_store_to_load_with_label();
+    _woort_test_peephole_jump_threading();
+    _woort_test_peephole_far_jump();
+}
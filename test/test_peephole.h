@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_peephole.h
+*/
+
+/*
+Check the bytecodes optimized by peephole: self MOVs are removed, LOAD right after
+STORE is forwarded unless some jump targets it, jumps to unconditional jumps are
+threaded, and jumps over removed instructions are re-encoded after compaction.
+*/
+void woort_test_peephole(void);
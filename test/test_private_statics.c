@@ -0,0 +1,111 @@
+#include "test_private_statics.h"
+#include "test_util.h"
+
+#include "woort_codeenv.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+#include "woort_opcode_formal.h"
+
+// Data indexes of codes below.
+#define WOORT_TEST_NATIVE_INDEX 0
+#define WOORT_TEST_VALUE_INDEX 1
+#define WOORT_TEST_STATIC_INDEX 2
+
+// Offsets of functions in codes below.
+#define WOORT_TEST_OUTER_OFFSET 0
+#define WOORT_TEST_SET_OFFSET 7
+#define WOORT_TEST_GET_OFFSET 14
+
+static const woort_Bytecode* _woort_test_set_function;
+
+// Invoke set() in the same VM, its static write is the first one of the VM.
+static woort_api _woort_test_native_invoke_set(woort_vm vm, woort_value* args)
+{
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL
+        == woort_VMRuntime_invoke((woort_VMRuntime*)vm, _woort_test_set_function));
+
+    ((woort_Value*)args)[-1].m_integer = 0;
+    return WOORT_VM_CALL_STATUS_NORMAL;
+}
+
+static woort_Integer _woort_test_invoke(
+    woort_VMRuntime* vm, const woort_CodeEnv* code_env, size_t offset)
+{
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL
+        == woort_VMRuntime_invoke(vm, code_env->m_code_begin + offset));
+    return vm->m_sp[-1].m_integer;
+}
+
+void woort_test_private_statics(void)
+{
+    woort_Vector codes, constants, relocations;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+    woort_vector_init(&constants, sizeof(woort_Value));
+    woort_vector_init(&relocations, sizeof(woort_CodeEnv_Relocation));
+
+    const uint16_t r0 = (uint16_t)(int16_t)-1;
+    const woort_Bytecode bytecodes[] = {
+        // outer(): native(); return s
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 0, 1),
+        woort_OpCodeFormal_cons(
+            OP6_M2_ABC24, WOORT_OPCODE_CALL, 1, WOORT_TEST_NATIVE_INDEX),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_RESULT, 0, r0),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_LOADEX, 0, r0),
+        WOORT_TEST_STATIC_INDEX,
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, r0),
+        woort_OpCodeFormal_cons(OP6_MABC26, WOORT_OPCODE_NOP, 0),
+        // set(): s = 7; return s
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 0, 1),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_LOADEX, 0, r0),
+        WOORT_TEST_VALUE_INDEX,
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_STOREEX, 0, r0),
+        WOORT_TEST_STATIC_INDEX,
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, r0),
+        woort_OpCodeFormal_cons(OP6_MABC26, WOORT_OPCODE_NOP, 0),
+        // get(): return s
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 0, 1),
+        woort_OpCodeFormal_cons(OP6_MA10_BC16, WOORT_OPCODE_LOADEX, 0, r0),
+        WOORT_TEST_STATIC_INDEX,
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, r0),
+    };
+    WOORT_TEST_CHECK(woort_vector_push_back(
+        &codes, sizeof(bytecodes) / sizeof(bytecodes[0]), bytecodes));
+
+    woort_Value values[2];
+    values[WOORT_TEST_NATIVE_INDEX].m_function.m_type = WOORT_FUNCTION_TYPE_NATIVE;
+    values[WOORT_TEST_NATIVE_INDEX].m_function.m_address =
+        (int64_t)(intptr_t)&_woort_test_native_invoke_set;
+    values[WOORT_TEST_VALUE_INDEX].m_integer = 7;
+    WOORT_TEST_CHECK(woort_vector_push_back(&constants, 2, values));
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(woort_CodeEnv_create(&codes, &constants, 1, &relocations, &code_env));
+    code_env->m_data_begin[WOORT_TEST_STATIC_INDEX].m_integer = 0;
+
+    _woort_test_set_function = code_env->m_code_begin + WOORT_TEST_SET_OFFSET;
+
+    woort_VMRuntime nested_vm, other_vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init_with_private_statics(&nested_vm));
+    WOORT_TEST_CHECK(woort_VMRuntime_init_with_private_statics(&other_vm));
+
+    // Copied by nested invoke, outer frame reads the private copy after native returned.
+    WOORT_TEST_CHECK(_woort_test_invoke(&nested_vm, code_env, WOORT_TEST_OUTER_OFFSET) == 7);
+    WOORT_TEST_CHECK(_woort_test_invoke(&nested_vm, code_env, WOORT_TEST_GET_OFFSET) == 7);
+
+    // Other VMs and the CodeEnv are not affected.
+    WOORT_TEST_CHECK(_woort_test_invoke(&other_vm, code_env, WOORT_TEST_GET_OFFSET) == 0);
+    WOORT_TEST_CHECK(code_env->m_data_begin[WOORT_TEST_STATIC_INDEX].m_integer == 0);
+
+    WOORT_TEST_CHECK(_woort_test_invoke(&other_vm, code_env, WOORT_TEST_SET_OFFSET) == 7);
+    WOORT_TEST_CHECK(_woort_test_invoke(&other_vm, code_env, WOORT_TEST_GET_OFFSET) == 7);
+    WOORT_TEST_CHECK(code_env->m_data_begin[WOORT_TEST_STATIC_INDEX].m_integer == 0);
+
+    // Dropped by reset, copied from CodeEnv again.
+    WOORT_TEST_CHECK(woort_VMRuntime_reset(
+        &other_vm, (size_t)(other_vm.m_stack_end - other_vm.m_stack)));
+    WOORT_TEST_CHECK(_woort_test_invoke(&other_vm, code_env, WOORT_TEST_GET_OFFSET) == 0);
+
+    woort_VMRuntime_deinit(&other_vm);
+    woort_VMRuntime_deinit(&nested_vm);
+    woort_CodeEnv_unshare(code_env);
+}
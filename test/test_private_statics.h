@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_private_statics.h
+*/
+
+/*
+Check that static storages written by VMs with private statics are copied on first
+write and never seen by other VMs, including the copy made by a nested invoke from
+native function, which must be seen by the outer frame after the native returned.
+*/
+void woort_test_private_statics(void);
@@ -0,0 +1,145 @@
+#include "test_push_depth.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_lir_inline.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+#include "woort_opcode_formal.h"
+
+static void _woort_test_emit_call_digits(
+    woort_LIRFunction* function,
+    woort_LIR_ConstantStorage digits_c,
+    const woort_LIR_ConstantStorage* value_cs,
+    bool bind_label_between_pushes)
+{
+    woort_LIRRegister* values[3];
+    woort_LIRRegister* result;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(function, &values[i]));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(function, values[i], value_cs[i]));
+    }
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(function, &result));
+
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_push(function, values[2]));
+    if (bind_label_between_pushes)
+    {
+        // Might be jumped to with another depth, depth cannot be decided.
+        woort_LIRLabel* label;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_label(function, &label));
+        WOORT_TEST_CHECK(woort_LIRFunction_bind(function, label));
+    }
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_push(function, values[1]));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_push(function, values[0]));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(function, result, digits_c, 3));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(function, result));
+}
+
+void woort_test_push_depth(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    // decided() & undecided(): return digits(1, 2, 3)
+    woort_LIRFunction* digits;
+    woort_LIRFunction* decided;
+    woort_LIRFunction* undecided;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &digits));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &decided));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &undecided));
+
+    woort_Value value;
+    woort_LIR_ConstantStorage value_cs[3], c10, digits_c;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        value.m_integer = (woort_Integer)i + 1;
+        WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &value_cs[i]));
+    }
+    value.m_integer = 10;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c10));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, digits, &digits_c));
+
+    const woort_LIR_StaticStorage padding_s =
+        woort_LIRCompiler_allocate_static_storage(&lir_compiler);
+
+    // digits(a0, a1, a2): return (a0 * 10 + a1) * 10 + a2
+    {
+        woort_LIRRegister* a0;
+        woort_LIRRegister* a1;
+        woort_LIRRegister* a2;
+        woort_LIRRegister* ten;
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(digits, 0, &a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(digits, 1, &a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(digits, 2, &a2));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(digits, &ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(digits, &result));
+        woort_test_emit_padding(digits, padding_s, a0, WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT);
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(digits, ten, c10));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            digits, WOORT_LIR_OPCODE_MULI, result, a0, ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            digits, WOORT_LIR_OPCODE_ADDI, result, result, a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            digits, WOORT_LIR_OPCODE_MULI, result, result, ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            digits, WOORT_LIR_OPCODE_ADDI, result, result, a2));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(digits, result));
+    }
+    _woort_test_emit_call_digits(decided, digits_c, value_cs, false);
+    _woort_test_emit_call_digits(undecided, digits_c, value_cs, true);
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&lir_compiler, &code_env));
+
+    const size_t decided_begin = decided->m_entry_bytecode_offset;
+    const size_t undecided_begin = undecided->m_entry_bytecode_offset;
+    const size_t code_end = (size_t)(code_env->m_code_end - code_env->m_code_begin);
+
+    // decided(): PUSHRCHK registers, then ASSURESSZ 3, no checked push.
+    const woort_Bytecode reserve = code_env->m_code_begin[decided_begin];
+    const woort_Bytecode assure = code_env->m_code_begin[decided_begin + 1];
+    WOORT_TEST_CHECK(WOORT_BYTECODE(OP6, reserve) == WOORT_OPCODE_PUSHCHK
+        && WOORT_BYTECODE(M2, reserve) == 0
+        && WOORT_BYTECODE(ABC24, reserve) != 0);
+    WOORT_TEST_CHECK(WOORT_BYTECODE(OP6, assure) == WOORT_OPCODE_PUSH
+        && WOORT_BYTECODE(M2, assure) == 0
+        && WOORT_BYTECODE(ABC24, assure) == 3);
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env, decided_begin, undecided_begin, WOORT_OPCODE_PUSHCHK, 1));
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env, decided_begin, undecided_begin, WOORT_OPCODE_PUSHRANGE, 0));
+
+    // undecided(): no ASSURESSZ, pushes are checked.
+    const woort_Bytecode undecided_reserve = code_env->m_code_begin[undecided_begin];
+    WOORT_TEST_CHECK(WOORT_BYTECODE(OP6, undecided_reserve) == WOORT_OPCODE_PUSHCHK
+        && WOORT_BYTECODE(M2, undecided_reserve) == 0);
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env, undecided_begin, code_end, WOORT_OPCODE_PUSH, 0));
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env, undecided_begin, code_end, WOORT_OPCODE_PUSH, 1));
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env, undecided_begin, code_end, WOORT_OPCODE_PUSHRANGE, 1));
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    woort_Value* const sp = vm.m_sp;
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + decided_begin));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 123);
+
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + undecided_begin));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 123);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_push_depth.h
+*/
+
+/*
+Check that functions whose push depth can be decided reserve registers by PUSHRCHK and
+assure the depth by ASSURESSZ at entry with unchecked pushes after, and that pushes are
+still checked one by one if the depth cannot be decided.
+*/
+void woort_test_push_depth(void);
@@ -0,0 +1,168 @@
+#include "test_push_range.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_lir_inline.h"
+#include "woort_peephole.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+#include "woort_opcode_formal.h"
+
+#define WOORT_TEST_PUSH_COUNT 4
+
+static void _woort_test_push_range_of_registers(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    // main(): return digits(1, 2, 3, 4)
+    woort_LIRFunction* digits;
+    woort_LIRFunction* main_function;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &digits));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &main_function));
+
+    woort_Value value;
+    woort_LIR_ConstantStorage value_cs[WOORT_TEST_PUSH_COUNT], c10, digits_c;
+    for (size_t i = 0; i < WOORT_TEST_PUSH_COUNT; ++i)
+    {
+        value.m_integer = (woort_Integer)i + 1;
+        WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &value_cs[i]));
+    }
+    value.m_integer = 10;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c10));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, digits, &digits_c));
+
+    const woort_LIR_StaticStorage padding_s =
+        woort_LIRCompiler_allocate_static_storage(&lir_compiler);
+
+    // digits(a0, a1, a2, a3): return ((a0 * 10 + a1) * 10 + a2) * 10 + a3
+    {
+        woort_LIRRegister* ten;
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(digits, &ten));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(digits, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(digits, ten, c10));
+
+        for (uint16_t i = 0; i < WOORT_TEST_PUSH_COUNT; ++i)
+        {
+            woort_LIRRegister* argument;
+            WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(digits, i, &argument));
+
+            if (i == 0)
+            {
+                woort_test_emit_padding(
+                    digits, padding_s, argument, WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT);
+                WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+                    digits, WOORT_LIR_OPCODE_MULI, result, argument, ten));
+            }
+            else
+            {
+                WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+                    digits, WOORT_LIR_OPCODE_ADDI, result, result, argument));
+                if (i + 1 != WOORT_TEST_PUSH_COUNT)
+                    WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+                        digits, WOORT_LIR_OPCODE_MULI, result, result, ten));
+            }
+        }
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(digits, result));
+    }
+    // main(), arguments are pushed from the last one to the first one.
+    woort_LIRRegister* values[WOORT_TEST_PUSH_COUNT];
+    {
+        woort_LIRRegister* result;
+        for (size_t i = 0; i < WOORT_TEST_PUSH_COUNT; ++i)
+        {
+            WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &values[i]));
+            WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(
+                main_function, values[i], value_cs[i]));
+        }
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &result));
+
+        for (size_t i = WOORT_TEST_PUSH_COUNT; i > 0; --i)
+            WOORT_TEST_CHECK(woort_LIRFunction_emit_push(main_function, values[i - 1]));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(
+            main_function, result, digits_c, WOORT_TEST_PUSH_COUNT));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(main_function, result));
+    }
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&lir_compiler, &code_env));
+
+    // Pushed registers are placed in contiguous slots, the first argument in the lowest.
+    for (size_t i = 1; i < WOORT_TEST_PUSH_COUNT; ++i)
+        WOORT_TEST_CHECK(values[i]->m_assigned_bp_offset
+            == values[0]->m_assigned_bp_offset + (woort_RegisterStorageId)i);
+
+    // All pushes are merged into one unchecked PUSHRS, push depth is assured at entry.
+    const size_t main_begin = main_function->m_entry_bytecode_offset;
+    const size_t code_end = (size_t)(code_env->m_code_end - code_env->m_code_begin);
+
+    size_t push_range_count = 0;
+    for (size_t i = main_begin; i < code_end; ++i)
+    {
+        const woort_Bytecode c = code_env->m_code_begin[i];
+        if (WOORT_BYTECODE(OP6, c) == WOORT_OPCODE_PUSHRANGE)
+        {
+            WOORT_TEST_CHECK(WOORT_BYTECODE(M2, c) == 1);
+            WOORT_TEST_CHECK(WOORT_BYTECODE(A8, c) == WOORT_TEST_PUSH_COUNT);
+            WOORT_TEST_CHECK((int16_t)WOORT_BYTECODE(BC16, c)
+                == (int16_t)values[0]->m_assigned_bp_offset);
+            ++push_range_count;
+        }
+    }
+    WOORT_TEST_CHECK(push_range_count == 1);
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env, main_begin, code_end, WOORT_OPCODE_PUSH, 1));
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    woort_Value* const sp = vm.m_sp;
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + main_begin));
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 1234);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
+
+static void _woort_test_push_range_of_constants(void)
+{
+    woort_Vector codes;
+    woort_vector_init(&codes, sizeof(woort_Bytecode));
+
+    // PUSHCCHK 7; PUSHCCHK 6; PUSHCCHKEXT 5; PUSHCCHK 3; RETVS 0
+    const woort_Bytecode bytecodes[] = {
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 2, 7),
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 2, 6),
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 3, 0),
+        5,
+        woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHCHK, 2, 3),
+        woort_OpCodeFormal_cons(OP6_M2_BC16, WOORT_OPCODE_RET, 1, 0),
+    };
+    WOORT_TEST_CHECK(woort_vector_push_back(
+        &codes, sizeof(bytecodes) / sizeof(bytecodes[0]), bytecodes));
+
+    WOORT_TEST_CHECK(woort_peephole_optimize(&codes, NULL));
+
+    // PUSHRCCHK 3, 5; PUSHCCHK 3; RETVS 0
+    const woort_Bytecode* const optimized = (const woort_Bytecode*)codes.m_data;
+    WOORT_TEST_CHECK(codes.m_size == 4);
+    WOORT_TEST_CHECK(optimized[0]
+        == woort_OpCodeFormal_cons(OP6_M2_ABC24, WOORT_OPCODE_PUSHRANGE, 2, 3));
+    WOORT_TEST_CHECK(optimized[1] == 5);
+    WOORT_TEST_CHECK(optimized[2] == bytecodes[4]);
+    WOORT_TEST_CHECK(optimized[3] == bytecodes[5]);
+
+    woort_vector_deinit(&codes);
+}
+
+void woort_test_push_range(void)
+{
+    _woort_test_push_range_of_registers();
+    _woort_test_push_range_of_constants();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_push_range.h
+*/
+
+/*
+Check that registers pushed one after another are placed in contiguous slots and
+their pushes are merged into one PUSHRANGE, and that pushes of contiguous constants
+are merged by peephole.
+*/
+void woort_test_push_range(void);
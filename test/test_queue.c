@@ -0,0 +1,327 @@
+#include "test_queue.h"
+#include "test_util.h"
+
+#include "woort_queue.h"
+#include "woort_threads.h"
+#include "woort_atomic.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WOORT_TEST_QUEUE_MAX_THREAD_COUNT 16
+
+/*
+Items are encoded as (producer index + 1) << 32 | sequence, so that zero is never
+pushed and the order of each producer can be checked.
+*/
+static uintptr_t _woort_test_queue_item(size_t producer, size_t sequence)
+{
+    return ((uintptr_t)(producer + 1) << 32) | (uintptr_t)sequence;
+}
+
+static double _woort_test_queue_now_seconds(void)
+{
+    struct timespec ts;
+    (void)timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* ============================================== */
+/*                  MPMC Queue                    */
+/* ============================================== */
+
+typedef struct _woort_TestMPMCContext
+{
+    woort_MPMCQueue     m_queue;
+    size_t              m_item_count_per_producer;
+    size_t              m_producer_count;
+    woort_AtomicUInt64  m_popped_count;
+
+    // Count of items popped from each (consumer, producer).
+    size_t              m_received[WOORT_TEST_QUEUE_MAX_THREAD_COUNT][WOORT_TEST_QUEUE_MAX_THREAD_COUNT];
+
+} _woort_TestMPMCContext;
+
+typedef struct _woort_TestMPMCWorker
+{
+    _woort_TestMPMCContext* m_context;
+    size_t                  m_index;
+
+} _woort_TestMPMCWorker;
+
+static void _woort_test_mpmc_producer(void* user_data)
+{
+    _woort_TestMPMCWorker* const worker = user_data;
+    _woort_TestMPMCContext* const context = worker->m_context;
+
+    for (size_t i = 0; i < context->m_item_count_per_producer; ++i)
+    {
+        const uintptr_t item = _woort_test_queue_item(worker->m_index, i);
+        while (!woort_mpmc_queue_try_push(&context->m_queue, (void*)item))
+            woort_thread_yield();
+    }
+}
+
+static void _woort_test_mpmc_consumer(void* user_data)
+{
+    _woort_TestMPMCWorker* const worker = user_data;
+    _woort_TestMPMCContext* const context = worker->m_context;
+
+    const uint64_t total_count =
+        (uint64_t)context->m_item_count_per_producer * context->m_producer_count;
+
+    size_t* const last_sequence = calloc(context->m_producer_count, sizeof(size_t));
+    WOORT_TEST_CHECK(last_sequence != NULL);
+
+    while (woort_atomic_load_explicit(
+        &context->m_popped_count, WOORT_ATOMIC_MEMORY_ORDER_RELAXED) < total_count)
+    {
+        void* data;
+        if (!woort_mpmc_queue_try_pop(&context->m_queue, &data))
+        {
+            woort_thread_yield();
+            continue;
+        }
+        (void)woort_atomic_fetch_add_explicit(
+            &context->m_popped_count, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+
+        const uintptr_t item = (uintptr_t)data;
+        const size_t producer = (size_t)(item >> 32) - 1;
+        const size_t sequence = (size_t)(item & UINT32_MAX);
+
+        WOORT_TEST_CHECK(producer < context->m_producer_count);
+        WOORT_TEST_CHECK(sequence < context->m_item_count_per_producer);
+
+        // Items of one producer must be seen in order by each consumer.
+        size_t* const received = context->m_received[worker->m_index];
+        WOORT_TEST_CHECK(received[producer] == 0 || sequence > last_sequence[producer]);
+
+        last_sequence[producer] = sequence;
+        ++received[producer];
+    }
+    free(last_sequence);
+}
+
+/*
+Returns seconds used.
+*/
+static double _woort_test_mpmc_run(
+    size_t producer_count,
+    size_t consumer_count,
+    size_t capacity,
+    size_t item_count_per_producer)
+{
+    WOORT_TEST_CHECK(producer_count <= WOORT_TEST_QUEUE_MAX_THREAD_COUNT);
+    WOORT_TEST_CHECK(consumer_count <= WOORT_TEST_QUEUE_MAX_THREAD_COUNT);
+
+    _woort_TestMPMCContext* const context = calloc(1, sizeof(_woort_TestMPMCContext));
+    WOORT_TEST_CHECK(context != NULL);
+    WOORT_TEST_CHECK(woort_mpmc_queue_init(&context->m_queue, capacity));
+
+    context->m_item_count_per_producer = item_count_per_producer;
+    context->m_producer_count = producer_count;
+    woort_atomic_init(&context->m_popped_count, 0);
+
+    _woort_TestMPMCWorker producers[WOORT_TEST_QUEUE_MAX_THREAD_COUNT];
+    _woort_TestMPMCWorker consumers[WOORT_TEST_QUEUE_MAX_THREAD_COUNT];
+    woort_Thread* threads[WOORT_TEST_QUEUE_MAX_THREAD_COUNT * 2];
+    size_t thread_count = 0;
+
+    const double begin_time = _woort_test_queue_now_seconds();
+
+    for (size_t i = 0; i < consumer_count; ++i)
+    {
+        consumers[i].m_context = context;
+        consumers[i].m_index = i;
+        WOORT_TEST_CHECK(woort_thread_start(
+            _woort_test_mpmc_consumer, &consumers[i], &threads[thread_count++]));
+    }
+    for (size_t i = 0; i < producer_count; ++i)
+    {
+        producers[i].m_context = context;
+        producers[i].m_index = i;
+        WOORT_TEST_CHECK(woort_thread_start(
+            _woort_test_mpmc_producer, &producers[i], &threads[thread_count++]));
+    }
+    for (size_t i = 0; i < thread_count; ++i)
+        woort_thread_join(threads[i]);
+
+    const double used_time = _woort_test_queue_now_seconds() - begin_time;
+
+    // Nothing lost or duplicated.
+    for (size_t p = 0; p < producer_count; ++p)
+    {
+        size_t received = 0;
+        for (size_t c = 0; c < consumer_count; ++c)
+            received += context->m_received[c][p];
+
+        WOORT_TEST_CHECK(received == item_count_per_producer);
+    }
+    void* data;
+    WOORT_TEST_CHECK(!woort_mpmc_queue_try_pop(&context->m_queue, &data));
+
+    woort_mpmc_queue_deinit(&context->m_queue);
+    free(context);
+
+    return used_time;
+}
+
+/* ============================================== */
+/*                  MPSC Queue                    */
+/* ============================================== */
+
+typedef struct _woort_TestMPSCItem
+{
+    woort_MPSCQueue_Node    m_node;
+    uintptr_t               m_value;
+
+} _woort_TestMPSCItem;
+
+typedef struct _woort_TestMPSCContext
+{
+    woort_MPSCQueue         m_queue;
+    size_t                  m_item_count_per_producer;
+    size_t                  m_producer_count;
+    _woort_TestMPSCItem*    m_items;
+
+} _woort_TestMPSCContext;
+
+typedef struct _woort_TestMPSCWorker
+{
+    _woort_TestMPSCContext* m_context;
+    size_t                  m_index;
+
+} _woort_TestMPSCWorker;
+
+static void _woort_test_mpsc_producer(void* user_data)
+{
+    _woort_TestMPSCWorker* const worker = user_data;
+    _woort_TestMPSCContext* const context = worker->m_context;
+
+    _woort_TestMPSCItem* const items =
+        context->m_items + worker->m_index * context->m_item_count_per_producer;
+
+    for (size_t i = 0; i < context->m_item_count_per_producer; ++i)
+    {
+        items[i].m_value = _woort_test_queue_item(worker->m_index, i);
+        woort_mpsc_queue_push(&context->m_queue, &items[i].m_node);
+    }
+}
+
+static double _woort_test_mpsc_run(
+    size_t producer_count,
+    size_t item_count_per_producer)
+{
+    WOORT_TEST_CHECK(producer_count <= WOORT_TEST_QUEUE_MAX_THREAD_COUNT);
+
+    _woort_TestMPSCContext context;
+    woort_mpsc_queue_init(&context.m_queue);
+    context.m_item_count_per_producer = item_count_per_producer;
+    context.m_producer_count = producer_count;
+    context.m_items = malloc(
+        producer_count * item_count_per_producer * sizeof(_woort_TestMPSCItem));
+    WOORT_TEST_CHECK(context.m_items != NULL);
+
+    size_t received[WOORT_TEST_QUEUE_MAX_THREAD_COUNT] = { 0 };
+
+    _woort_TestMPSCWorker producers[WOORT_TEST_QUEUE_MAX_THREAD_COUNT];
+    woort_Thread* threads[WOORT_TEST_QUEUE_MAX_THREAD_COUNT];
+
+    const double begin_time = _woort_test_queue_now_seconds();
+
+    for (size_t i = 0; i < producer_count; ++i)
+    {
+        producers[i].m_context = &context;
+        producers[i].m_index = i;
+        WOORT_TEST_CHECK(woort_thread_start(
+            _woort_test_mpsc_producer, &producers[i], &threads[i]));
+    }
+
+    // Current thread is the only consumer.
+    const size_t total_count = producer_count * item_count_per_producer;
+    for (size_t popped_count = 0; popped_count < total_count;)
+    {
+        woort_MPSCQueue_Node* const node = woort_mpsc_queue_pop(&context.m_queue);
+        if (node == NULL)
+        {
+            woort_thread_yield();
+            continue;
+        }
+        ++popped_count;
+
+        const uintptr_t item = ((_woort_TestMPSCItem*)node)->m_value;
+        const size_t producer = (size_t)(item >> 32) - 1;
+        const size_t sequence = (size_t)(item & UINT32_MAX);
+
+        WOORT_TEST_CHECK(producer < producer_count);
+
+        // Items of one producer must be popped in order, one by one.
+        WOORT_TEST_CHECK(sequence == received[producer]);
+        ++received[producer];
+    }
+
+    for (size_t i = 0; i < producer_count; ++i)
+        woort_thread_join(threads[i]);
+
+    const double used_time = _woort_test_queue_now_seconds() - begin_time;
+
+    WOORT_TEST_CHECK(woort_mpsc_queue_pop(&context.m_queue) == NULL);
+
+    woort_mpsc_queue_deinit(&context.m_queue);
+    free(context.m_items);
+
+    return used_time;
+}
+
+void woort_test_queue_stress(void)
+{
+    // Small capacity makes full & empty happen frequently.
+    (void)_woort_test_mpmc_run(1, 1, 2, 100000);
+    (void)_woort_test_mpmc_run(4, 4, 8, 50000);
+    (void)_woort_test_mpmc_run(8, 2, 64, 20000);
+    (void)_woort_test_mpmc_run(2, 8, 64, 50000);
+
+    (void)_woort_test_mpsc_run(1, 100000);
+    (void)_woort_test_mpsc_run(4, 50000);
+    (void)_woort_test_mpsc_run(8, 20000);
+
+    // Nodes can be pushed again after popped.
+    woort_MPSCQueue queue;
+    woort_mpsc_queue_init(&queue);
+    woort_MPSCQueue_Node node;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        woort_mpsc_queue_push(&queue, &node);
+        WOORT_TEST_CHECK(woort_mpsc_queue_pop(&queue) == &node);
+        WOORT_TEST_CHECK(woort_mpsc_queue_pop(&queue) == NULL);
+    }
+    woort_mpsc_queue_deinit(&queue);
+}
+
+void woort_test_queue_benchmark(void)
+{
+    const size_t item_count_per_producer = 1000000;
+    const size_t thread_counts[] = { 1, 2, 4, 8 };
+
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i)
+    {
+        const size_t thread_count = thread_counts[i];
+
+        const double mpmc_time = _woort_test_mpmc_run(
+            thread_count, thread_count, 1024, item_count_per_producer);
+        printf("MPMC %zu producers, %zu consumers: %.2f Mops/s\n",
+            thread_count,
+            thread_count,
+            (double)(thread_count * item_count_per_producer) / mpmc_time / 1e6);
+
+        const double mpsc_time = _woort_test_mpsc_run(
+            thread_count, item_count_per_producer);
+        printf("MPSC %zu producers, 1 consumer: %.2f Mops/s\n",
+            thread_count,
+            (double)(thread_count * item_count_per_producer) / mpsc_time / 1e6);
+    }
+}
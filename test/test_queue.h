@@ -0,0 +1,16 @@
+#pragma once
+
+/*
+test_queue.h
+*/
+
+/*
+Stress woort_MPMCQueue & woort_MPSCQueue with multiple threads, abort if anything
+is lost, duplicated or reordered.
+*/
+void woort_test_queue_stress(void);
+
+/*
+Print push/pop throughput of queues with different thread counts.
+*/
+void woort_test_queue_benchmark(void);
@@ -0,0 +1,115 @@
+#include "test_register_allocation.h"
+#include "test_util.h"
+
+#include "woort_lir_function.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WOORT_TEST_REGISTER_COUNT 300
+#define WOORT_TEST_HOT_REGISTER_COUNT 10
+
+/*
+All registers are alive through the whole function, only the last ones are used in
+a loop. Near window cannot hold them all, the hot ones must be kept in it.
+*/
+static void _woort_test_register_allocation_eviction(woort_LIRFunction_Scratch* scratch)
+{
+    woort_LIRFunction function;
+    woort_LIRFunction_init(&function);
+
+    woort_LIRRegister* registers[WOORT_TEST_REGISTER_COUNT];
+    for (size_t i = 0; i < WOORT_TEST_REGISTER_COUNT; ++i)
+    {
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(&function, &registers[i]));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(&function, registers[i], 0));
+    }
+
+    woort_LIRLabel* loop_label;
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_label(&function, &loop_label));
+    WOORT_TEST_CHECK(woort_LIRFunction_bind(&function, loop_label));
+
+    for (size_t i = WOORT_TEST_REGISTER_COUNT - WOORT_TEST_HOT_REGISTER_COUNT;
+        i < WOORT_TEST_REGISTER_COUNT;
+        ++i)
+    {
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_store(&function, 0, registers[i]));
+    }
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_jmp(&function, loop_label));
+
+    for (size_t i = 0; i < WOORT_TEST_REGISTER_COUNT; ++i)
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_store(&function, 0, registers[i]));
+
+    size_t stack_usage;
+    WOORT_TEST_CHECK(woort_LIRFunction_register_allocation(&function, scratch, &stack_usage));
+    woort_arena_reset(&scratch->m_arena);
+
+    size_t far_count = 0;
+    for (size_t i = 0; i < WOORT_TEST_REGISTER_COUNT; ++i)
+    {
+        const woort_RegisterStorageId offset = registers[i]->m_assigned_bp_offset;
+
+        // Reserved places are never assigned.
+        WOORT_TEST_CHECK(offset <= 0);
+        WOORT_TEST_CHECK(offset != INT8_MIN && offset != INT8_MIN + 1 && offset != INT8_MIN + 2);
+
+        if (offset < INT8_MIN)
+        {
+            ++far_count;
+            // Hot registers are not evicted.
+            WOORT_TEST_CHECK(i < WOORT_TEST_REGISTER_COUNT - WOORT_TEST_HOT_REGISTER_COUNT);
+        }
+        WOORT_TEST_CHECK(stack_usage >= (size_t)(-offset) + 1);
+
+        for (size_t j = 0; j < i; ++j)
+            WOORT_TEST_CHECK(registers[j]->m_assigned_bp_offset != offset);
+    }
+    WOORT_TEST_CHECK(far_count > 0);
+
+    woort_LIRFunction_deinit(&function);
+}
+
+/*
+`before` is defined before loop and last used at the head of loop, `inside` is
+defined later in the loop body, they must not share a slot: `before` is used again
+by the next iteration.
+*/
+static void _woort_test_register_allocation_loop(woort_LIRFunction_Scratch* scratch)
+{
+    woort_LIRFunction function;
+    woort_LIRFunction_init(&function);
+
+    woort_LIRRegister* before;
+    woort_LIRRegister* inside;
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(&function, &before));
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(&function, &inside));
+
+    woort_LIRLabel* loop_label;
+    WOORT_TEST_CHECK(woort_LIRFunction_alloc_label(&function, &loop_label));
+
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(&function, before, 0));
+    WOORT_TEST_CHECK(woort_LIRFunction_bind(&function, loop_label));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_store(&function, 0, before));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(&function, inside, 1));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_store(&function, 1, inside));
+    WOORT_TEST_CHECK(woort_LIRFunction_emit_jmp(&function, loop_label));
+
+    size_t stack_usage;
+    WOORT_TEST_CHECK(woort_LIRFunction_register_allocation(&function, scratch, &stack_usage));
+    woort_arena_reset(&scratch->m_arena);
+
+    WOORT_TEST_CHECK(before->m_assigned_bp_offset != inside->m_assigned_bp_offset);
+
+    woort_LIRFunction_deinit(&function);
+}
+
+void woort_test_register_allocation(void)
+{
+    woort_LIRFunction_Scratch scratch;
+    WOORT_TEST_CHECK(woort_LIRFunction_scratch_init(&scratch));
+
+    _woort_test_register_allocation_eviction(&scratch);
+    _woort_test_register_allocation_loop(&scratch);
+
+    woort_LIRFunction_scratch_deinit(&scratch);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_register_allocation.h
+*/
+
+/*
+Check slots assigned by woort_LIRFunction_register_allocation: hot registers stay in
+near window, cold ones fall back to far slots, and registers alive across loops are
+never shared.
+*/
+void woort_test_register_allocation(void);
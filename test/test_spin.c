@@ -0,0 +1,100 @@
+#include "test_spin.h"
+#include "test_util.h"
+
+#include "woort_spin.h"
+#include "woort_threads.h"
+
+#define WOORT_TEST_SPIN_THREAD_COUNT 8
+#define WOORT_TEST_SPIN_ROUND_COUNT 20000
+
+typedef struct _woort_TestSpinContext
+{
+    woort_Spinlock  m_spinlock;
+    size_t          m_spinlock_counter;
+
+    woort_RWSpinlock m_rwspinlock;
+    // Written by writers together, readers must never see them differ.
+    size_t          m_rwspinlock_counters[2];
+    woort_AtomicSize m_reader_passes;
+
+} _woort_TestSpinContext;
+
+static void _woort_test_spinlock_job(void* user_data)
+{
+    _woort_TestSpinContext* const context = user_data;
+
+    for (size_t i = 0; i < WOORT_TEST_SPIN_ROUND_COUNT; ++i)
+    {
+        woort_spinlock_lock(&context->m_spinlock);
+        ++context->m_spinlock_counter;
+        woort_spinlock_unlock(&context->m_spinlock);
+    }
+}
+
+static void _woort_test_rwspinlock_writer(void* user_data)
+{
+    _woort_TestSpinContext* const context = user_data;
+
+    for (size_t i = 0; i < WOORT_TEST_SPIN_ROUND_COUNT; ++i)
+    {
+        woort_rwspinlock_write_lock(&context->m_rwspinlock);
+        ++context->m_rwspinlock_counters[0];
+        ++context->m_rwspinlock_counters[1];
+        woort_rwspinlock_write_unlock(&context->m_rwspinlock);
+    }
+}
+
+static void _woort_test_rwspinlock_reader(void* user_data)
+{
+    _woort_TestSpinContext* const context = user_data;
+
+    for (size_t i = 0; i < WOORT_TEST_SPIN_ROUND_COUNT; ++i)
+    {
+        woort_rwspinlock_read_lock(&context->m_rwspinlock);
+        WOORT_TEST_CHECK(
+            context->m_rwspinlock_counters[0] == context->m_rwspinlock_counters[1]);
+        woort_rwspinlock_read_unlock(&context->m_rwspinlock);
+
+        (void)woort_atomic_fetch_add_explicit(
+            &context->m_reader_passes, 1, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+    }
+}
+
+void woort_test_spin_stress(void)
+{
+    _woort_TestSpinContext context;
+    woort_spinlock_init(&context.m_spinlock);
+    context.m_spinlock_counter = 0;
+    woort_rwspinlock_init(&context.m_rwspinlock);
+    context.m_rwspinlock_counters[0] = 0;
+    context.m_rwspinlock_counters[1] = 0;
+    woort_atomic_init(&context.m_reader_passes, 0);
+
+    woort_Thread* threads[WOORT_TEST_SPIN_THREAD_COUNT];
+
+    for (size_t i = 0; i < WOORT_TEST_SPIN_THREAD_COUNT; ++i)
+        WOORT_TEST_CHECK(woort_thread_start(
+            _woort_test_spinlock_job, &context, &threads[i]));
+    for (size_t i = 0; i < WOORT_TEST_SPIN_THREAD_COUNT; ++i)
+        woort_thread_join(threads[i]);
+
+    WOORT_TEST_CHECK(context.m_spinlock_counter
+        == WOORT_TEST_SPIN_THREAD_COUNT * WOORT_TEST_SPIN_ROUND_COUNT);
+
+    // Half writers and half readers.
+    for (size_t i = 0; i < WOORT_TEST_SPIN_THREAD_COUNT; ++i)
+        WOORT_TEST_CHECK(woort_thread_start(
+            i % 2 == 0 ? _woort_test_rwspinlock_writer : _woort_test_rwspinlock_reader,
+            &context,
+            &threads[i]));
+    for (size_t i = 0; i < WOORT_TEST_SPIN_THREAD_COUNT; ++i)
+        woort_thread_join(threads[i]);
+
+    WOORT_TEST_CHECK(context.m_rwspinlock_counters[0]
+        == WOORT_TEST_SPIN_THREAD_COUNT / 2 * WOORT_TEST_SPIN_ROUND_COUNT);
+    WOORT_TEST_CHECK(woort_atomic_load(&context.m_reader_passes)
+        == WOORT_TEST_SPIN_THREAD_COUNT / 2 * WOORT_TEST_SPIN_ROUND_COUNT);
+
+    woort_rwspinlock_deinit(&context.m_rwspinlock);
+    woort_spinlock_deinit(&context.m_spinlock);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_spin.h
+*/
+
+/*
+Stress woort_Spinlock & woort_RWSpinlock with contended threads, so that waiters are
+parked, abort if mutual exclusion is broken. A lost wakeup hangs the test.
+*/
+void woort_test_spin_stress(void);
@@ -0,0 +1,119 @@
+#include "test_stack_trim.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_vm.h"
+
+#define WOORT_TEST_STACK_TRIM_DEPTH 2000
+
+void woort_test_stack_trim(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    // main() -> depth(2000)
+    woort_LIRFunction* depth;
+    woort_LIRFunction* main_function;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &depth));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &main_function));
+
+    woort_Value value;
+    woort_LIR_ConstantStorage c0, c1, cn, depth_c;
+    value.m_integer = 0;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c0));
+    value.m_integer = 1;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c1));
+    value.m_integer = WOORT_TEST_STACK_TRIM_DEPTH;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &cn));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, depth, &depth_c));
+
+    // depth(a0): return a0 > 0 ? depth(a0 - 1) + 1 : 0, not a tail call.
+    {
+        woort_LIRRegister* a0;
+        woort_LIRRegister* zero;
+        woort_LIRRegister* one;
+        woort_LIRRegister* cond;
+        woort_LIRRegister* result;
+        woort_LIRLabel* recurse;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(depth, 0, &a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(depth, &zero));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(depth, &one));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(depth, &cond));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(depth, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_label(depth, &recurse));
+
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(depth, zero, c0));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(depth, one, c1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            depth, WOORT_LIR_OPCODE_GTI, cond, a0, zero));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_jnz(depth, cond, recurse));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(depth, zero));
+
+        WOORT_TEST_CHECK(woort_LIRFunction_bind(depth, recurse));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            depth, WOORT_LIR_OPCODE_SUBI, result, a0, one));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(depth, result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(depth, result, depth_c, 1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_binary(
+            depth, WOORT_LIR_OPCODE_ADDI, result, result, one));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(depth, result));
+    }
+    // main(): return depth(2000)
+    {
+        woort_LIRRegister* n;
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &n));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, n, cn));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(main_function, n));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(main_function, result, depth_c, 1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(main_function, result));
+    }
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&lir_compiler, &code_env));
+
+    const woort_Bytecode* const main_code =
+        code_env->m_code_begin + main_function->m_entry_bytecode_offset;
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    // Trimming is off by default.
+    WOORT_TEST_CHECK(vm.m_stack_trim_size == 0);
+
+    const size_t begin_stack_size = (size_t)(vm.m_stack_end - vm.m_stack);
+    const size_t sp_offset = (size_t)(vm.m_stack_end - vm.m_sp);
+
+    // Stack is kept at its high-water mark.
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(&vm, main_code));
+    WOORT_TEST_CHECK((size_t)(vm.m_stack_end - vm.m_sp) == sp_offset);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == WOORT_TEST_STACK_TRIM_DEPTH);
+
+    const size_t grown_stack_size = (size_t)(vm.m_stack_end - vm.m_stack);
+    WOORT_TEST_CHECK(grown_stack_size >= WOORT_TEST_STACK_TRIM_DEPTH);
+
+    // Invoking again doesn't need to grow it.
+    const uint32_t realloc_version = vm.m_stack_realloc_version;
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(&vm, main_code));
+    WOORT_TEST_CHECK(vm.m_stack_realloc_version == realloc_version);
+    WOORT_TEST_CHECK((size_t)(vm.m_stack_end - vm.m_stack) == grown_stack_size);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == WOORT_TEST_STACK_TRIM_DEPTH);
+
+    // With trim size set, stack is trimmed back and the result survives.
+    vm.m_stack_trim_size = begin_stack_size;
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(&vm, main_code));
+    WOORT_TEST_CHECK((size_t)(vm.m_stack_end - vm.m_stack) == begin_stack_size);
+    WOORT_TEST_CHECK((size_t)(vm.m_stack_end - vm.m_sp) == sp_offset);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == WOORT_TEST_STACK_TRIM_DEPTH);
+
+    // Trimmed stack still grows for the next deep invoking.
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(&vm, main_code));
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == WOORT_TEST_STACK_TRIM_DEPTH);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
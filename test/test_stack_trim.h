@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+test_stack_trim.h
+*/
+
+/*
+Check that stack grown by deep recursion is kept at its high-water mark by default,
+and is trimmed back after outermost invoking if trim size is set, the result of the
+invoking must survive the trimming.
+*/
+void woort_test_stack_trim(void);
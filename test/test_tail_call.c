@@ -0,0 +1,102 @@
+#include "test_tail_call.h"
+#include "test_util.h"
+
+#include "woort_lir_compiler.h"
+#include "woort_lir_inline.h"
+#include "woort_vm.h"
+#include "woort_opcode.h"
+
+void woort_test_tail_call(void)
+{
+    woort_LIRCompiler lir_compiler;
+    woort_LIRCompiler_init(&lir_compiler);
+
+    // main() -> forward(7, 9) -> tail call target(9)
+    woort_LIRFunction* target;
+    woort_LIRFunction* forward;
+    woort_LIRFunction* main_function;
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &target));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &forward));
+    WOORT_TEST_CHECK(woort_LIRCompiler_add_function(&lir_compiler, &main_function));
+
+    woort_Value value;
+    woort_LIR_ConstantStorage c7, c9, target_c, forward_c;
+    value.m_integer = 7;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c7));
+    value.m_integer = 9;
+    WOORT_TEST_CHECK(woort_LIRCompiler_intern_constant(&lir_compiler, &value, &c9));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, target, &target_c));
+    WOORT_TEST_CHECK(woort_LIRCompiler_allocate_function_constant(
+        &lir_compiler, forward, &forward_c));
+
+    const woort_LIR_StaticStorage padding_s =
+        woort_LIRCompiler_allocate_static_storage(&lir_compiler);
+
+    // target(a0): return a0
+    {
+        woort_LIRRegister* a0;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(target, 0, &a0));
+        woort_test_emit_padding(target, padding_s, a0, WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT);
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(target, a0));
+    }
+    // forward(a0, a1): return target(a1)
+    {
+        woort_LIRRegister* a0;
+        woort_LIRRegister* a1;
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(forward, 0, &a0));
+        WOORT_TEST_CHECK(woort_LIRFunction_get_argument_register(forward, 1, &a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(forward, &result));
+        woort_test_emit_padding(forward, padding_s, a0, WOORT_LIR_INLINE_MAX_CALLEE_LIR_COUNT);
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(forward, a1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(forward, result, target_c, 1));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(forward, result));
+    }
+    // main(): return forward(7, 9), result is stored first, so it is not a tail call.
+    {
+        woort_LIRRegister* r7;
+        woort_LIRRegister* r9;
+        woort_LIRRegister* result;
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &r7));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &r9));
+        WOORT_TEST_CHECK(woort_LIRFunction_alloc_register(main_function, &result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, r7, c7));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_loadconst(main_function, r9, c9));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(main_function, r9));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_push(main_function, r7));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_callnwo(main_function, result, forward_c, 2));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_store(main_function, padding_s, result));
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_ret(main_function, result));
+    }
+
+    woort_CodeEnv* code_env;
+    WOORT_TEST_CHECK(WOORT_LIRCOMPILER_COMMIT_RESULT_OK
+        == woort_LIRCompiler_commit(&lir_compiler, &code_env));
+
+    // Only the call in `forward` is a tail call.
+    WOORT_TEST_CHECK(woort_test_contains_opcode(
+        code_env,
+        forward->m_entry_bytecode_offset,
+        main_function->m_entry_bytecode_offset,
+        WOORT_OPCODE_CALL, 2));
+    WOORT_TEST_CHECK(!woort_test_contains_opcode(
+        code_env,
+        main_function->m_entry_bytecode_offset,
+        (size_t)(code_env->m_code_end - code_env->m_code_begin),
+        WOORT_OPCODE_CALL, 2));
+
+    woort_VMRuntime vm;
+    WOORT_TEST_CHECK(woort_VMRuntime_init(&vm));
+
+    woort_Value* const sp = vm.m_sp;
+    WOORT_TEST_CHECK(WOORT_VM_CALL_STATUS_NORMAL == woort_VMRuntime_invoke(
+        &vm, code_env->m_code_begin + main_function->m_entry_bytecode_offset));
+
+    WOORT_TEST_CHECK(vm.m_sp == sp);
+    WOORT_TEST_CHECK(vm.m_sp[-1].m_integer == 9);
+
+    woort_VMRuntime_deinit(&vm);
+    woort_CodeEnv_unshare(code_env);
+    woort_LIRCompiler_deinit(&lir_compiler);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_tail_call.h
+*/
+
+/*
+Check that a call whose result is returned right away is emitted as TCALLNWO, and
+the callee returns to caller of the frame it reuses.
+*/
+void woort_test_tail_call(void);
@@ -0,0 +1,32 @@
+#include "test_util.h"
+
+#include "woort_opcode_formal.h"
+
+bool woort_test_contains_opcode(
+    const woort_CodeEnv* code_env,
+    size_t begin,
+    size_t end,
+    uint32_t opcode,
+    uint32_t mode)
+{
+    WOORT_TEST_CHECK(begin <= end
+        && end <= (size_t)(code_env->m_code_end - code_env->m_code_begin));
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const woort_Bytecode c = code_env->m_code_begin[i];
+        if (WOORT_BYTECODE(OP6, c) == opcode && WOORT_BYTECODE(M2, c) == mode)
+            return true;
+    }
+    return false;
+}
+
+void woort_test_emit_padding(
+    woort_LIRFunction* function,
+    woort_LIR_StaticStorage aim_s,
+    woort_LIRRegister* src_r,
+    size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        WOORT_TEST_CHECK(woort_LIRFunction_emit_store(function, aim_s, src_r));
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+test_util.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WOORT_TEST_CHECK(COND)                                          \
+    do {                                                                \
+        if (!(COND))                                                    \
+        {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                \
+                __FILE__, __LINE__, #COND);                             \
+            abort();                                                    \
+        }                                                               \
+    } while (0)
+
+#include "woort_codeenv.h"
+#include "woort_lir_function.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Check if there is a bytecode with `opcode` and `mode` in [begin, end) of codes.
+
+NOTE: Extension words are scanned too, only use it with opcodes which cannot be
+    confused with small data indexes.
+*/
+bool woort_test_contains_opcode(
+    const woort_CodeEnv* code_env,
+    size_t begin,
+    size_t end,
+    uint32_t opcode,
+    uint32_t mode);
+
+/*
+Emit `count` STOREs of `src_r` into `aim_s`, to make function too big to be inlined.
+*/
+void woort_test_emit_padding(
+    woort_LIRFunction* function,
+    woort_LIR_StaticStorage aim_s,
+    woort_LIRRegister* src_r,
+    size_t count);
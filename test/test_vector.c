@@ -0,0 +1,142 @@
+#include "test_vector.h"
+#include "test_util.h"
+
+#include "woort_arena.h"
+#include "woort_vector.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define WOORT_TEST_VECTOR_BUFFER_COUNT 4
+#define WOORT_TEST_VECTOR_ELEMENT_COUNT 100
+#define WOORT_TEST_ARENA_CHUNK_SIZE 256
+
+static size_t _woort_test_chunk_count(const woort_Arena_Chunk* chunk)
+{
+    size_t count = 0;
+    for (; chunk != NULL; chunk = chunk->m_next)
+        ++count;
+    return count;
+}
+
+static void _woort_test_check_elements(const woort_Vector* vector, size_t count)
+{
+    WOORT_TEST_CHECK(vector->m_size == count);
+    for (size_t i = 0; i < count; ++i)
+        WOORT_TEST_CHECK(((const uint64_t*)vector->m_data)[i] == i);
+}
+
+static void _woort_test_push_elements(woort_Vector* vector, size_t begin, size_t end)
+{
+    for (uint64_t i = begin; i < end; ++i)
+        WOORT_TEST_CHECK(woort_vector_push_back(vector, 1, &i));
+}
+
+static void _woort_test_vector_buffer(void)
+{
+    uint64_t buffer[WOORT_TEST_VECTOR_BUFFER_COUNT];
+
+    woort_Vector vector;
+    woort_vector_init_with_buffer(
+        &vector, sizeof(uint64_t), buffer, WOORT_TEST_VECTOR_BUFFER_COUNT);
+
+    // Fits in buffer.
+    _woort_test_push_elements(&vector, 0, WOORT_TEST_VECTOR_BUFFER_COUNT);
+    WOORT_TEST_CHECK(vector.m_data == (char*)buffer);
+
+    // Moved to heap, buffer is left as is.
+    _woort_test_push_elements(
+        &vector, WOORT_TEST_VECTOR_BUFFER_COUNT, WOORT_TEST_VECTOR_ELEMENT_COUNT);
+    WOORT_TEST_CHECK(vector.m_data != (char*)buffer);
+    _woort_test_check_elements(&vector, WOORT_TEST_VECTOR_ELEMENT_COUNT);
+    for (size_t i = 0; i < WOORT_TEST_VECTOR_BUFFER_COUNT; ++i)
+        WOORT_TEST_CHECK(buffer[i] == i);
+
+    // Heap storage is taken without copying.
+    char* const heap_data = vector.m_data;
+    void* moved;
+    size_t moved_count;
+    WOORT_TEST_CHECK(woort_vector_move_out(&vector, &moved, &moved_count));
+    WOORT_TEST_CHECK(moved == heap_data);
+    WOORT_TEST_CHECK(moved_count == WOORT_TEST_VECTOR_ELEMENT_COUNT);
+    WOORT_TEST_CHECK(vector.m_size == 0 && vector.m_data == NULL);
+    free(moved);
+
+    // Empty vector gives NULL.
+    WOORT_TEST_CHECK(woort_vector_move_out(&vector, &moved, &moved_count));
+    WOORT_TEST_CHECK(moved == NULL && moved_count == 0);
+
+    woort_vector_deinit(&vector);
+
+    // Storage in buffer is copied.
+    woort_vector_init_with_buffer(
+        &vector, sizeof(uint64_t), buffer, WOORT_TEST_VECTOR_BUFFER_COUNT);
+    _woort_test_push_elements(&vector, 0, 3);
+
+    WOORT_TEST_CHECK(woort_vector_move_out(&vector, &moved, &moved_count));
+    WOORT_TEST_CHECK(moved != (void*)buffer && moved_count == 3);
+    for (size_t i = 0; i < 3; ++i)
+        WOORT_TEST_CHECK(((const uint64_t*)moved)[i] == i);
+    free(moved);
+
+    woort_vector_deinit(&vector);
+}
+
+static void _woort_test_vector_arena(void)
+{
+    woort_Arena arena;
+    woort_arena_init(&arena, WOORT_TEST_ARENA_CHUNK_SIZE);
+
+    woort_Vector vector;
+    woort_vector_init_with_arena(&vector, sizeof(uint64_t), &arena);
+
+    // Grows in arena, old storages are abandoned in it.
+    _woort_test_push_elements(&vector, 0, WOORT_TEST_VECTOR_ELEMENT_COUNT);
+    _woort_test_check_elements(&vector, WOORT_TEST_VECTOR_ELEMENT_COUNT);
+    WOORT_TEST_CHECK(((uintptr_t)vector.m_data % 16) == 0);
+
+    const size_t chunk_count = _woort_test_chunk_count(arena.m_chunks);
+    WOORT_TEST_CHECK(chunk_count > 1);
+    WOORT_TEST_CHECK(arena.m_free_chunks == NULL);
+
+    // Storage in arena is copied.
+    void* moved;
+    size_t moved_count;
+    WOORT_TEST_CHECK(woort_vector_move_out(&vector, &moved, &moved_count));
+    WOORT_TEST_CHECK(moved_count == WOORT_TEST_VECTOR_ELEMENT_COUNT);
+    for (size_t i = 0; i < WOORT_TEST_VECTOR_ELEMENT_COUNT; ++i)
+        WOORT_TEST_CHECK(((const uint64_t*)moved)[i] == i);
+
+    // Released chunks are reused, no chunk is allocated again.
+    woort_arena_reset(&arena);
+    WOORT_TEST_CHECK(arena.m_chunks == NULL);
+    WOORT_TEST_CHECK(_woort_test_chunk_count(arena.m_free_chunks) == chunk_count);
+
+    woort_Arena_Chunk* const reused_chunk = arena.m_free_chunks;
+    void* const allocated = woort_arena_alloc(&arena, WOORT_TEST_ARENA_CHUNK_SIZE);
+    WOORT_TEST_CHECK(allocated == reused_chunk->m_storage);
+    WOORT_TEST_CHECK(arena.m_chunks == reused_chunk);
+    WOORT_TEST_CHECK(_woort_test_chunk_count(arena.m_chunks)
+        + _woort_test_chunk_count(arena.m_free_chunks) == chunk_count);
+
+    // Allocations are aligned to 16.
+    void* const small = woort_arena_alloc(&arena, 1);
+    void* const next_small = woort_arena_alloc(&arena, 1);
+    WOORT_TEST_CHECK(small != NULL && next_small != NULL);
+    WOORT_TEST_CHECK((char*)next_small - (char*)small == 16);
+
+    // Bigger allocation gets its own chunk.
+    void* const big = woort_arena_alloc(&arena, WOORT_TEST_ARENA_CHUNK_SIZE * 4 + 1);
+    WOORT_TEST_CHECK(big != NULL);
+    WOORT_TEST_CHECK(arena.m_chunks->m_size == WOORT_TEST_ARENA_CHUNK_SIZE * 4 + 16);
+
+    free(moved);
+    woort_vector_deinit(&vector);
+    woort_arena_deinit(&arena);
+}
+
+void woort_test_vector(void)
+{
+    _woort_test_vector_buffer();
+    _woort_test_vector_arena();
+}
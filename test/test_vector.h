@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_vector.h
+*/
+
+/*
+Check vector storage moving from buffer to heap and growing in arena, chunks of arena
+are reused after reset, and woort_vector_move_out copies storage not owned by heap.
+*/
+void woort_test_vector(void);
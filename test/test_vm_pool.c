@@ -0,0 +1,175 @@
+#include "test_vm_pool.h"
+#include "test_util.h"
+
+#include "woort_vm_pool.h"
+#include "woort_threads.h"
+#include "woort_atomic.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WOORT_TEST_VM_POOL_STACK_SIZE 256
+#define WOORT_TEST_VM_POOL_CAPACITY 4
+#define WOORT_TEST_VM_POOL_THREAD_COUNT 8
+#define WOORT_TEST_VM_POOL_ROUND_COUNT 2000
+
+static uint64_t _woort_test_vm_pool_idle_count(woort_VMRuntimePool* pool)
+{
+    return woort_atomic_load_explicit(
+        &pool->m_idle_count, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+}
+
+static uint64_t _woort_test_vm_pool_low_watermark(woort_VMRuntimePool* pool)
+{
+    return woort_atomic_load_explicit(
+        &pool->m_idle_low_watermark, WOORT_ATOMIC_MEMORY_ORDER_RELAXED);
+}
+
+static void _woort_test_vm_pool_check_fresh(const woort_VMRuntime* vm)
+{
+    WOORT_TEST_CHECK(
+        (size_t)(vm->m_stack_end - vm->m_stack) == WOORT_TEST_VM_POOL_STACK_SIZE);
+    WOORT_TEST_CHECK(vm->m_sp == vm->m_stack_end - 1);
+    WOORT_TEST_CHECK(vm->m_stack_trim_size == WOORT_TEST_VM_POOL_STACK_SIZE);
+}
+
+static void _woort_test_vm_pool_shrink(void)
+{
+    woort_VMRuntimePool pool;
+    WOORT_TEST_CHECK(woort_VMRuntimePool_init(
+        &pool,
+        WOORT_TEST_VM_POOL_CAPACITY,
+        WOORT_TEST_VM_POOL_CAPACITY,
+        WOORT_TEST_VM_POOL_STACK_SIZE,
+        false));
+
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == 4);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_low_watermark(&pool) == 4);
+
+    // Idle count goes down to 1, then back to 3.
+    woort_VMRuntime* vms[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        WOORT_TEST_CHECK(woort_VMRuntimePool_acquire(&pool, &vms[i]));
+        _woort_test_vm_pool_check_fresh(vms[i]);
+    }
+    WOORT_TEST_CHECK(_woort_test_vm_pool_low_watermark(&pool) == 1);
+
+    // Grown stack is shrunk back when released.
+    WOORT_TEST_CHECK(woort_VMRuntime_reset(vms[0], WOORT_TEST_VM_POOL_STACK_SIZE * 4));
+    woort_VMRuntimePool_release(&pool, vms[0]);
+    woort_VMRuntimePool_release(&pool, vms[1]);
+
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == 3);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_low_watermark(&pool) == 1);
+
+    // Only the one never acquired is freed.
+    WOORT_TEST_CHECK(woort_VMRuntimePool_shrink(&pool) == 1);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == 2);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_low_watermark(&pool) == 2);
+
+    // Released after shrink, not counted as unused in next shrink.
+    woort_VMRuntimePool_release(&pool, vms[2]);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == 3);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_low_watermark(&pool) == 2);
+
+    WOORT_TEST_CHECK(woort_VMRuntimePool_shrink(&pool) == 2);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == 1);
+
+    WOORT_TEST_CHECK(woort_VMRuntimePool_shrink(&pool) == 1);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == 0);
+    WOORT_TEST_CHECK(woort_VMRuntimePool_shrink(&pool) == 0);
+
+    // Empty pool creates VM, and frees the ones over capacity when released.
+    woort_VMRuntime* more_vms[WOORT_TEST_VM_POOL_CAPACITY + 2];
+    for (size_t i = 0; i < WOORT_TEST_VM_POOL_CAPACITY + 2; ++i)
+    {
+        WOORT_TEST_CHECK(woort_VMRuntimePool_acquire(&pool, &more_vms[i]));
+        _woort_test_vm_pool_check_fresh(more_vms[i]);
+    }
+    WOORT_TEST_CHECK(_woort_test_vm_pool_low_watermark(&pool) == 0);
+
+    for (size_t i = 0; i < WOORT_TEST_VM_POOL_CAPACITY + 2; ++i)
+        woort_VMRuntimePool_release(&pool, more_vms[i]);
+
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == WOORT_TEST_VM_POOL_CAPACITY);
+
+    woort_VMRuntimePool_deinit(&pool);
+}
+
+typedef struct _woort_TestVMPoolWorker
+{
+    woort_VMRuntimePool*    m_pool;
+    size_t                  m_index;
+
+} _woort_TestVMPoolWorker;
+
+static void _woort_test_vm_pool_worker(void* user_data)
+{
+    _woort_TestVMPoolWorker* const worker = user_data;
+
+    for (size_t i = 0; i < WOORT_TEST_VM_POOL_ROUND_COUNT; ++i)
+    {
+        woort_VMRuntime* vm;
+        WOORT_TEST_CHECK(woort_VMRuntimePool_acquire(worker->m_pool, &vm));
+        _woort_test_vm_pool_check_fresh(vm);
+
+        // If VM were handed out twice, the mark would be overwritten by other one.
+        const int64_t mark = (int64_t)(worker->m_index * WOORT_TEST_VM_POOL_ROUND_COUNT + i);
+        vm->m_stack[0].m_integer = mark;
+        woort_thread_yield();
+        WOORT_TEST_CHECK(vm->m_stack[0].m_integer == mark);
+
+        // Grown stack is shrunk back when released.
+        if (i % 16 == 0)
+            WOORT_TEST_CHECK(woort_VMRuntime_reset(vm, WOORT_TEST_VM_POOL_STACK_SIZE * 2));
+
+        woort_VMRuntimePool_release(worker->m_pool, vm);
+    }
+}
+
+static void _woort_test_vm_pool_threads(void)
+{
+    woort_VMRuntimePool pool;
+    WOORT_TEST_CHECK(woort_VMRuntimePool_init(
+        &pool,
+        WOORT_TEST_VM_POOL_CAPACITY,
+        WOORT_TEST_VM_POOL_CAPACITY / 2,
+        WOORT_TEST_VM_POOL_STACK_SIZE,
+        true));
+
+    _woort_TestVMPoolWorker workers[WOORT_TEST_VM_POOL_THREAD_COUNT];
+    woort_Thread* threads[WOORT_TEST_VM_POOL_THREAD_COUNT];
+
+    for (size_t i = 0; i < WOORT_TEST_VM_POOL_THREAD_COUNT; ++i)
+    {
+        workers[i].m_pool = &pool;
+        workers[i].m_index = i;
+        WOORT_TEST_CHECK(woort_thread_start(
+            _woort_test_vm_pool_worker, &workers[i], &threads[i]));
+    }
+    for (size_t i = 0; i < WOORT_TEST_VM_POOL_THREAD_COUNT; ++i)
+        woort_thread_join(threads[i]);
+
+    // Idle count matches VMs in pool, and watermark never goes over it.
+    const uint64_t idle_count = _woort_test_vm_pool_idle_count(&pool);
+    WOORT_TEST_CHECK(idle_count <= WOORT_TEST_VM_POOL_CAPACITY);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_low_watermark(&pool) <= idle_count);
+
+    size_t freed_count = woort_VMRuntimePool_shrink(&pool);
+    freed_count += woort_VMRuntimePool_shrink(&pool);
+
+    WOORT_TEST_CHECK(freed_count == idle_count);
+    WOORT_TEST_CHECK(_woort_test_vm_pool_idle_count(&pool) == 0);
+
+    void* vm;
+    WOORT_TEST_CHECK(!woort_mpmc_queue_try_pop(&pool.m_idle_vms, &vm));
+
+    woort_VMRuntimePool_deinit(&pool);
+}
+
+void woort_test_vm_pool(void)
+{
+    _woort_test_vm_pool_shrink();
+    _woort_test_vm_pool_threads();
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+test_vm_pool.h
+*/
+
+/*
+Check idle VMs are freed by shrink only if they stayed idle since last shrink, and
+acquire & release from many threads never hand one VM out twice or lose it.
+*/
+void woort_test_vm_pool(void);